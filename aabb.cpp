@@ -0,0 +1,44 @@
+/**
+ * @file aabb.cpp
+ * @brief Implémentation de la classe Aabb
+ */
+
+#include "aabb.h"
+#include <algorithm>
+#include <limits>
+
+Aabb::Aabb()
+    : min(std::numeric_limits<Real>::max()), max(-std::numeric_limits<Real>::max()) {}
+
+void Aabb::extend(const Vector3f &p) {
+    min = Vector3f(std::min(min.getX(), p.getX()), std::min(min.getY(), p.getY()), std::min(min.getZ(), p.getZ()));
+    max = Vector3f(std::max(max.getX(), p.getX()), std::max(max.getY(), p.getY()), std::max(max.getZ(), p.getZ()));
+}
+
+void Aabb::extend(const Aabb &other) {
+    if (other.isEmpty())
+        return;
+    extend(other.min);
+    extend(other.max);
+}
+
+bool Aabb::isEmpty() const {
+    return min.getX() > max.getX() || min.getY() > max.getY() || min.getZ() > max.getZ();
+}
+
+Vector3f Aabb::center() const {
+    return (min + max) * 0.5f;
+}
+
+Real Aabb::surfaceArea() const {
+    if (isEmpty())
+        return 0;
+    Vector3f d = max - min;
+    return 2 * (d.getX() * d.getY() + d.getY() * d.getZ() + d.getZ() * d.getX());
+}
+
+Vector3f Aabb::positiveVertex(const Vector3f &n) const {
+    return Vector3f(n.getX() >= 0 ? max.getX() : min.getX(),
+                    n.getY() >= 0 ? max.getY() : min.getY(),
+                    n.getZ() >= 0 ? max.getZ() : min.getZ());
+}
@@ -0,0 +1,87 @@
+/**
+ * @file aabb.h
+ * @brief Création de la classe Aabb (boîte englobante alignée sur les axes)
+ */
+#ifndef AABB_H
+#define AABB_H
+
+#include "vector3f.h"
+#include "ray3f.h"
+
+/**
+ * @brief Boîte englobante alignée sur les axes du monde, définie par ses coins min et max
+ *
+ */
+class Aabb {
+
+    private:
+        /**
+         * @brief Coins minimal et maximal
+         *
+         */
+        Vector3f min, max;
+
+    public:
+        /**
+         * @brief Construit une boîte vide (qui ne contient rien)
+         *
+         */
+        Aabb();
+
+        /**
+         * @brief Construit la boîte de coins min et max
+         *
+         * @param min
+         * @param max
+         */
+        Aabb(const Vector3f &min, const Vector3f &max) : min(min), max(max) {}
+
+        inline const Vector3f &getMin() const { return min; }
+        inline const Vector3f &getMax() const { return max; }
+
+        /**
+         * @brief Agrandit la boîte pour contenir le point p
+         *
+         * @param p
+         */
+        void extend(const Vector3f &p);
+
+        /**
+         * @brief Agrandit la boîte pour contenir la boîte other
+         *
+         * @param other
+         */
+        void extend(const Aabb &other);
+
+        /**
+         * @brief Retourne vrai si la boîte est vide
+         *
+         * @return bool
+         */
+        bool isEmpty() const;
+
+        /**
+         * @brief Retourne le centre de la boîte
+         *
+         * @return Vector3f
+         */
+        Vector3f center() const;
+
+        /**
+         * @brief Retourne l'aire de la surface de la boîte
+         *
+         * @return Real
+         */
+        Real surfaceArea() const;
+
+        /**
+         * @brief Retourne le coin de la boîte le plus avancé dans la direction n
+         * (sommet "positif" pour les tests contre un plan)
+         *
+         * @param n
+         * @return Vector3f
+         */
+        Vector3f positiveVertex(const Vector3f &n) const;
+};
+
+#endif
@@ -0,0 +1,159 @@
+/**
+ * @file alloctracker.cpp
+ * @brief Implémentation de la classe AllocationTracker et remplacement d'operator new
+ */
+
+#include "alloctracker.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> nbAllocations(0), octetsAlloues(0);
+static std::atomic<uint64_t> nbAllocationsCritiques(0), octetsCritiques(0);
+
+/**
+ * @brief Compte une allocation de size octets
+ */
+static inline void compte(std::size_t size) {
+    nbAllocations.fetch_add(1, std::memory_order_relaxed);
+    octetsAlloues.fetch_add(size, std::memory_order_relaxed);
+    if (hotPathDepth > 0) {
+        nbAllocationsCritiques.fetch_add(1, std::memory_order_relaxed);
+        octetsCritiques.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+static void* alloue(std::size_t size) {
+    compte(size);
+    while (true) {
+        void* p = std::malloc(size == 0 ? 1 : size);
+        if (p != nullptr)
+            return p;
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+static void* alloueAligne(std::size_t size, std::align_val_t align) {
+    compte(size);
+    std::size_t a = std::max(std::size_t(align), sizeof(void*));
+    while (true) {
+        // aligned_alloc veut une taille multiple de l'alignement
+        void* p = std::aligned_alloc(a, (std::max<std::size_t>(size, 1) + a - 1) / a * a);
+        if (p != nullptr)
+            return p;
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new(std::size_t size) { return alloue(size); }
+void* operator new[](std::size_t size) { return alloue(size); }
+void* operator new(std::size_t size, std::align_val_t align) { return alloueAligne(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return alloueAligne(size, align); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return alloue(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return alloue(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void* operator new(std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    try {
+        return alloueAligne(size, align);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void* operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    try {
+        return alloueAligne(size, align);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+
+AllocationCount getAllocations() {
+    AllocationCount c;
+    c.count = nbAllocations.load(std::memory_order_relaxed);
+    c.bytes = octetsAlloues.load(std::memory_order_relaxed);
+    return c;
+}
+
+AllocationCount getHotPathAllocations() {
+    AllocationCount c;
+    c.count = nbAllocationsCritiques.load(std::memory_order_relaxed);
+    c.bytes = octetsCritiques.load(std::memory_order_relaxed);
+    return c;
+}
+
+/**
+ * @brief Ecart entre deux relevés
+ */
+static AllocationCount ecart(const AllocationCount& fin, const AllocationCount& debut) {
+    AllocationCount c;
+    c.count = fin.count - debut.count;
+    c.bytes = fin.bytes - debut.bytes;
+    return c;
+}
+
+static void ajoute(AllocationCount& total, const AllocationCount& c) {
+    total.count += c.count;
+    total.bytes += c.bytes;
+}
+
+AllocationTracker::AllocationTracker() {
+    reset();
+}
+
+void AllocationTracker::reset() {
+    _debut = _debutHot = _last = _lastHot = _total = _totalHot = AllocationCount();
+    _nbFrames = 0;
+}
+
+void AllocationTracker::beginFrame() {
+    _debut = getAllocations();
+    _debutHot = getHotPathAllocations();
+}
+
+void AllocationTracker::endFrame() {
+    _last = ecart(getAllocations(), _debut);
+    _lastHot = ecart(getHotPathAllocations(), _debutHot);
+    ajoute(_total, _last);
+    ajoute(_totalHot, _lastHot);
+    _nbFrames++;
+}
+
+void AllocationTracker::report(std::ostream& out) const {
+    if (_nbFrames == 0)
+        return;
+    out << "Allocations par image : " << _total.count / _nbFrames << " (" << _total.bytes / _nbFrames << " octets) en moyenne sur "
+        << _nbFrames << " image(s), " << _last.count << " (" << _last.bytes << " octets) pour la dernière ; chemin critique : "
+        << _totalHot.count << " allocation(s)" << std::endl;
+}
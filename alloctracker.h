@@ -0,0 +1,125 @@
+/**
+ * @file alloctracker.h
+ * @brief Création de la classe AllocationTracker (allocations du tas par image)
+ */
+#ifndef ALLOCTRACKER_H
+#define ALLOCTRACKER_H
+
+#include <cstdint>
+#include <ostream>
+
+/**
+ * @brief Nombre et taille cumulés d'allocations du tas
+ */
+struct AllocationCount {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+/**
+ * @brief Profondeur des HotPathScope du thread courant (0 : hors du chemin critique)
+ */
+inline thread_local int hotPathDepth = 0;
+
+/**
+ * @brief Allocations faites par operator new (toutes ses formes) depuis le début du
+ * programme, sur tous les threads
+ *
+ * @return AllocationCount
+ */
+AllocationCount getAllocations();
+
+/**
+ * @brief Allocations faites dans le chemin critique du rendu (dans un HotPathScope),
+ * depuis le début du programme, sur tous les threads
+ *
+ * @return AllocationCount
+ */
+AllocationCount getHotPathAllocations();
+
+/**
+ * @brief Chemin critique du rendu (tracé des pixels) pendant la durée de vie de l'objet :
+ * ses allocations y sont comptées à part. Il ne doit en faire aucune
+ */
+class HotPathScope {
+
+    public:
+        HotPathScope() { hotPathDepth++; }
+        ~HotPathScope() { hotPathDepth--; }
+
+        HotPathScope(const HotPathScope&) = delete;
+        HotPathScope& operator=(const HotPathScope&) = delete;
+};
+
+/**
+ * @brief Sort du chemin critique pendant la durée de vie de l'objet, pour un travail
+ * amorti dont les allocations sont bornées (remplissage d'un cache de taille fixe)
+ */
+class ColdPathScope {
+
+    public:
+        ColdPathScope() : _depth(hotPathDepth) { hotPathDepth = 0; }
+        ~ColdPathScope() { hotPathDepth = _depth; }
+
+        ColdPathScope(const ColdPathScope&) = delete;
+        ColdPathScope& operator=(const ColdPathScope&) = delete;
+
+    private:
+        int _depth;
+};
+
+/**
+ * @brief Allocations des images successives d'un rendu, toutes et dans le chemin
+ * critique. Une image est délimitée par beginFrame et endFrame ; les allocations des
+ * autres threads pendant ce temps sont comptées aussi
+ *
+ */
+class AllocationTracker {
+
+    public:
+        AllocationTracker();
+
+        /**
+         * @brief Début d'une image
+         */
+        void beginFrame();
+
+        /**
+         * @brief Fin de l'image commencée par beginFrame
+         */
+        void endFrame();
+
+        /**
+         * @brief Oublie les images mesurées
+         */
+        void reset();
+
+        inline int getNbFrames() const {return _nbFrames;};
+
+        /**
+         * @brief Allocations de la dernière image, toutes et dans le chemin critique
+         */
+        inline const AllocationCount& getLastFrame() const {return _last;};
+        inline const AllocationCount& getLastFrameHotPath() const {return _lastHot;};
+
+        /**
+         * @brief Allocations du chemin critique de toutes les images mesurées
+         */
+        inline const AllocationCount& getHotPathTotal() const {return _totalHot;};
+
+        /**
+         * @brief Ecrit les allocations par image (moyenne et dernière image) et celles du
+         * chemin critique
+         *
+         * @param out
+         */
+        void report(std::ostream& out) const;
+
+    private:
+        AllocationCount _debut, _debutHot;
+        AllocationCount _last, _lastHot;
+        AllocationCount _total, _totalHot;
+        int _nbFrames;
+};
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * @file arena.cpp
+ * @brief Implémentation de la classe Arena
+ */
+
+#include "arena.h"
+#include "alloctracker.h"
+#include <algorithm>
+
+void Arena::newBlock(std::size_t size) {
+    // On arrondit au multiple de la ligne de cache supérieur
+    size = (std::max(size, _blockSize) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    char* data = static_cast<char*>(::operator new(size, std::align_val_t(CACHE_LINE)));
+    _blocks.push_back({data, size, 0});
+}
+
+void Arena::reserve(std::size_t bytes) {
+    if (_blocks.empty() || _blocks.back().size - _blocks.back().offset < bytes) {
+        newBlock(bytes);
+    }
+}
+
+void* Arena::allocate(std::size_t size, std::size_t align) {
+    if (!_blocks.empty()) {
+        Block& b = _blocks.back();
+        std::size_t start = (b.offset + align - 1) / align * align;
+        if (start + size <= b.size) {
+            b.offset = start + size;
+            _used += size;
+            return b.data + start;
+        }
+    }
+    // Le bloc courant est plein : le nouveau bloc est aligné sur une ligne de cache
+    newBlock(size + align);
+    Block& b = _blocks.back();
+    b.offset = size;
+    _used += size;
+    return b.data;
+}
+
+void Arena::reset() {
+    if (_blocks.size() > 1) {
+        std::size_t total = 0;
+        for (const Block& b : _blocks)
+            total += b.size;
+        release();
+        newBlock(total);
+    } else if (!_blocks.empty())
+        _blocks.back().offset = 0;
+    _used = 0;
+}
+
+void Arena::release() {
+    for (Block& b : _blocks) {
+        ::operator delete(b.data, std::align_val_t(CACHE_LINE));
+    }
+    _blocks.clear();
+    _used = 0;
+}
+
+/**
+ * @brief Arena de travail de chaque thread, et profondeur de ses ScratchScope
+ */
+const std::size_t TAILLE_TRAVAIL = 256 * 1024;
+static thread_local Arena arenaTravail(TAILLE_TRAVAIL);
+static thread_local int profondeurTravail = 0;
+
+Arena& scratchArena() {
+    return arenaTravail;
+}
+
+ScratchScope::ScratchScope() : _arena(arenaTravail) {
+    // Le premier bloc est réservé hors du chemin critique ; s'il devient trop petit,
+    // son agrandissement y est compté
+    if (_arena.getNbBlocks() == 0) {
+        ColdPathScope reservation;
+        _arena.reserve(TAILLE_TRAVAIL);
+    }
+    profondeurTravail++;
+}
+
+ScratchScope::~ScratchScope() {
+    if (--profondeurTravail == 0)
+        _arena.reset();
+}
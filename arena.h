@@ -0,0 +1,179 @@
+/**
+ * @file arena.h
+ * @brief Création de la classe Arena (allocateur par blocs contigus)
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <algorithm> // Pour std::fill
+#include <cstddef> // Pour std::size_t
+#include <new>     // Pour le placement new
+#include <utility> // Pour std::forward
+#include <vector>
+
+/**
+ * @brief Allocateur "bump" : les objets sont placés les uns à la suite des autres
+ * dans de grands blocs alignés sur une ligne de cache. Il n'y a pas de libération
+ * individuelle, tous les blocs sont rendus d'un coup par release() ou le destructeur
+ *
+ */
+class Arena {
+
+    public:
+        /**
+         * @brief Taille d'une ligne de cache (alignement des blocs)
+         *
+         */
+        static const std::size_t CACHE_LINE = 64;
+
+        /**
+         * @brief Construit une Arena vide
+         *
+         * @param blockSize taille par défaut des blocs alloués
+         */
+        explicit Arena(std::size_t blockSize = 64 * 1024)
+            : _blockSize(blockSize), _used(0) {}
+
+        /**
+         * @brief Destructeur : libère tous les blocs (sans appeler les destructeurs
+         * des objets, c'est au propriétaire de le faire si besoin)
+         *
+         */
+        ~Arena() { release(); }
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        /**
+         * @brief S'assure que les prochains bytes octets tiennent dans un seul bloc :
+         * une création en masse coûte alors une seule allocation
+         *
+         * @param bytes
+         */
+        void reserve(std::size_t bytes);
+
+        /**
+         * @brief Réserve size octets alignés sur align dans le bloc courant
+         *
+         * @param size
+         * @param align
+         * @return void*
+         */
+        void* allocate(std::size_t size, std::size_t align);
+
+        /**
+         * @brief Construit un objet de type T dans l'Arena
+         *
+         * @tparam T
+         * @param args arguments du constructeur de T
+         * @return T*
+         */
+        template<class T, class... Args>
+        T* create(Args&&... args) {
+            void* p = allocate(sizeof(T), alignof(T));
+            return new (p) T(std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Réserve un tableau de n valeurs de type T (trivial) initialisées à value
+         *
+         * @tparam T
+         * @param n
+         * @param value
+         * @return T*
+         */
+        template<class T>
+        T* createArray(std::size_t n, const T& value = T()) {
+            T* p = static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+            std::fill(p, p + n, value);
+            return p;
+        }
+
+        /**
+         * @brief Oublie les objets en gardant la mémoire : les allocations suivantes la
+         * réutilisent. Si elle occupait plusieurs blocs, ils sont remplacés par un seul
+         * de leur taille totale, si bien que la même suite d'allocations ne demande
+         * ensuite plus rien au système
+         *
+         */
+        void reset();
+
+        /**
+         * @brief Libère tous les blocs
+         *
+         */
+        void release();
+
+        /**
+         * @brief Retourne le nombre d'octets occupés par les objets
+         *
+         * @return std::size_t
+         */
+        inline std::size_t getUsed() const { return _used; }
+
+        /**
+         * @brief Retourne le nombre de blocs alloués
+         *
+         * @return std::size_t
+         */
+        inline std::size_t getNbBlocks() const { return _blocks.size(); }
+
+    private:
+        /**
+         * @brief Un bloc de mémoire contiguë
+         *
+         */
+        struct Block {
+            char* data;
+            std::size_t size;
+            std::size_t offset;
+        };
+
+        /**
+         * @brief Ajoute un bloc d'au moins size octets
+         *
+         * @param size
+         */
+        void newBlock(std::size_t size);
+
+        std::vector<Block> _blocks;
+        std::size_t _blockSize;
+        std::size_t _used;
+};
+
+/**
+ * @brief Arena de travail du thread courant (tableaux temporaires du rendu)
+ *
+ * @return Arena&
+ */
+Arena& scratchArena();
+
+/**
+ * @brief Espace de travail temporaire pris dans l'Arena du thread courant, pour une
+ * ligne ou un pixel du rendu : la mémoire est rendue à l'Arena (remise à zéro) à la
+ * destruction du ScratchScope le plus extérieur. Une fois l'Arena à sa taille, les
+ * tableaux temporaires ne coûtent plus aucune allocation
+ *
+ */
+class ScratchScope {
+
+    public:
+        ScratchScope();
+        ~ScratchScope();
+
+        ScratchScope(const ScratchScope&) = delete;
+        ScratchScope& operator=(const ScratchScope&) = delete;
+
+        /**
+         * @brief Tableau temporaire de n valeurs initialisées à value
+         */
+        template<class T>
+        T* array(std::size_t n, const T& value = T()) {
+            return _arena.createArray<T>(n, value);
+        }
+
+    private:
+        Arena& _arena;
+};
+
+#endif
@@ -0,0 +1,804 @@
+/**
+ * @file bvh.cpp
+ * @brief Implémentation de la classe Bvh
+ */
+
+#include "bvh.h"
+#include "costmap.h"
+#include "parallel.h"
+#include "perfcounters.h"
+#include <algorithm>
+#include <limits>
+
+const int NB_CLASSES = 12;          // Classes de centres testées pour chaque découpage
+const int PROFONDEUR_PILE = 64;     // Profondeur maximale de la pile de parcours
+const std::size_t REFIT_PARALLELE = 1024;   // Noeuds à recalculer à partir desquels le calcul est parallèle
+
+/**
+ * @brief Découpage en cours de construction : noeud, objets [first, first+count[ et
+ * profondeur du noeud
+ */
+struct Intervalle {
+    int node, first, count, depth;
+};
+
+static void setBounds(BvhNode& node, const Aabb& bounds) {
+    for (int a = 0; a < 3; a++) {
+        node.min[a] = bounds.getMin()[a];
+        node.max[a] = bounds.getMax()[a];
+    }
+}
+
+static Aabb boite(const BvhNode& node) {
+    return Aabb(Vector3f(node.min[0], node.min[1], node.min[2]), Vector3f(node.max[0], node.max[1], node.max[2]));
+}
+
+static Real aire(const BvhNode& node) {
+    Real dx = node.max[0] - node.min[0], dy = node.max[1] - node.min[1], dz = node.max[2] - node.min[2];
+    return 2 * (dx * dy + dy * dz + dz * dx);
+}
+
+static bool contient(const BvhNode& node, const Vector3f& p) {
+    for (int a = 0; a < 3; a++) {
+        if (p[a] < node.min[a] || p[a] > node.max[a])
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Construit la hiérarchie des boîtes bounds (de centres centers), en commençant à
+ * la profondeur donnée : nodes reçoit les noeuds (racine en 0) et indices l'ordre des
+ * boîtes dans les feuilles
+ */
+static void construit(const std::vector<Aabb>& bounds, const std::vector<Vector3f>& centers, int profondeur,
+                      std::vector<BvhNode>& nodes, std::vector<int32_t>& indices) {
+    int n = bounds.size();
+    indices.resize(n);
+    for (int k = 0; k < n; k++)
+        indices[k] = k;
+    nodes.reserve(2 * n);
+    nodes.push_back(BvhNode());
+
+    std::vector<Intervalle> pile = {{0, 0, n, profondeur}};
+    while (!pile.empty()) {
+        Intervalle iv = pile.back();
+        pile.pop_back();
+        int32_t* idx = indices.data() + iv.first;
+
+        Aabb boite, boiteCentres;
+        for (int k = 0; k < iv.count; k++) {
+            boite.extend(bounds[idx[k]]);
+            boiteCentres.extend(centers[idx[k]]);
+        }
+        setBounds(nodes[iv.node], boite);
+        nodes[iv.node].first = iv.first;
+        nodes[iv.node].count = iv.count;
+        // La profondeur est bornée par celle des piles de parcours
+        if (iv.count <= Bvh::FEUILLE_MAX || iv.depth >= PROFONDEUR_PILE - 1)
+            continue;
+
+        // Axe où les centres sont le plus étalés
+        Vector3f etendue = boiteCentres.getMax() - boiteCentres.getMin();
+        int axe = 0;
+        if (etendue[1] > etendue[axe]) axe = 1;
+        if (etendue[2] > etendue[axe]) axe = 2;
+        if (etendue[axe] <= 0)
+            continue;
+        Real origine = boiteCentres.getMin()[axe];
+        Real echelle = NB_CLASSES / etendue[axe];
+        auto classe = [&](int k) {
+            return std::min(NB_CLASSES - 1, int((centers[k][axe] - origine) * echelle));
+        };
+
+        // Répartition des objets dans les classes, puis coût SAH de chaque séparation
+        Aabb boitesClasses[NB_CLASSES];
+        int nbClasses[NB_CLASSES] = {0};
+        for (int k = 0; k < iv.count; k++) {
+            int c = classe(idx[k]);
+            boitesClasses[c].extend(bounds[idx[k]]);
+            nbClasses[c]++;
+        }
+        Real coutsGauche[NB_CLASSES];
+        int nbGauche[NB_CLASSES];
+        Aabb cumul;
+        int nb = 0;
+        for (int c = 0; c < NB_CLASSES - 1; c++) {
+            cumul.extend(boitesClasses[c]);
+            nb += nbClasses[c];
+            coutsGauche[c] = cumul.surfaceArea() * nb;
+            nbGauche[c] = nb;
+        }
+        int meilleure = -1;
+        Real meilleurCout = std::numeric_limits<Real>::max();
+        cumul = Aabb();
+        nb = 0;
+        for (int c = NB_CLASSES - 1; c > 0; c--) {
+            cumul.extend(boitesClasses[c]);
+            nb += nbClasses[c];
+            Real cout = coutsGauche[c - 1] + cumul.surfaceArea() * nb;
+            if (nbGauche[c - 1] > 0 && nb > 0 && cout < meilleurCout) {
+                meilleurCout = cout;
+                meilleure = c;
+            }
+        }
+        // On garde la feuille si aucun découpage n'est moins coûteux que de tout tester
+        if (meilleure == -1 || meilleurCout >= boite.surfaceArea() * iv.count)
+            continue;
+
+        int nbG = std::partition(idx, idx + iv.count, [&](int k) { return classe(k) < meilleure; }) - idx;
+        int gauche = nodes.size();
+        nodes.push_back(BvhNode());
+        nodes.push_back(BvhNode());
+        nodes[iv.node].first = gauche;
+        nodes[iv.node].count = 0;
+        pile.push_back({gauche, iv.first, nbG, iv.depth + 1});
+        pile.push_back({gauche + 1, iv.first + nbG, iv.count - nbG, iv.depth + 1});
+    }
+}
+
+void Bvh::build(const std::vector<Shape*>& shapes) {
+    clear();
+    int n = shapes.size();
+    if (n == 0)
+        return;
+
+    std::vector<Aabb> bounds(n);
+    std::vector<Vector3f> centers(n);
+    for (int k = 0; k < n; k++) {
+        bounds[k] = shapes[k]->getBounds();
+        centers[k] = bounds[k].center();
+    }
+    construit(bounds, centers, 0, _ownedNodes, _ownedIndices);
+    majPointeurs();
+}
+
+void Bvh::majPointeurs() {
+    _nodes = _ownedNodes.data();
+    _nbNodes = _ownedNodes.size();
+    _indices = _ownedIndices.data();
+    _nbIndices = _ownedIndices.size();
+}
+
+void Bvh::view(const BvhNode* nodes, int nbNodes, const int32_t* indices, int nbIndices) {
+    clear();
+    _nodes = nodes;
+    _nbNodes = nbNodes;
+    _indices = indices;
+    _nbIndices = nbIndices;
+}
+
+void Bvh::clear() {
+    _ownedNodes.clear();
+    _ownedIndices.clear();
+    _nodes = nullptr;
+    _nbNodes = 0;
+    _indices = nullptr;
+    _nbIndices = 0;
+    _editable = false;
+    _infos.clear();
+    _feuilles.clear();
+    _modifie.clear();
+    _nouveaux.clear();
+    _touches.clear();
+    _sales.clear();
+    _cout = _coutConstruction = 0;
+    _nbMorts = _nbIndicesMorts = 0;
+}
+
+Real Bvh::contribution(int n) const {
+    const BvhNode& node = _nodes[n];
+    if (node.count < 0)
+        return 0;
+    return aire(node) * std::max(node.count, 1);
+}
+
+Real Bvh::getCost() const {
+    if (!isBuilt())
+        return 0;
+    double cout = _cout;
+    if (!_editable) {
+        cout = 0;
+        for (int n = 0; n < _nbNodes; n++)
+            cout += contribution(n);
+    }
+    return cout / std::max(aire(_nodes[0]), std::numeric_limits<Real>::min());
+}
+
+void Bvh::prepareEdits(int nbShapes) {
+    if (_editable)
+        return;
+    // Une hiérarchie lue sur place est d'abord recopiée
+    if (_ownedNodes.empty()) {
+        _ownedNodes.assign(_nodes, _nodes + _nbNodes);
+        _ownedIndices.assign(_indices, _indices + _nbIndices);
+        majPointeurs();
+    }
+    _infos.resize(_nbNodes);
+    _feuilles.assign(nbShapes, -1);
+    _modifie.assign(nbShapes, 0);
+    _cout = 0;
+    _infos[0].parent = -1;
+    for (int n = 0; n < _nbNodes; n++) {
+        const BvhNode& node = _ownedNodes[n];
+        _infos[n].aireConstruction = aire(node);
+        _infos[n].sale = false;
+        if (node.count > 0) {
+            for (int c = node.first; c < node.first + node.count; c++)
+                _feuilles[_ownedIndices[c]] = n;
+        } else {
+            _infos[node.first].parent = _infos[node.first + 1].parent = n;
+        }
+        _cout += contribution(n);
+    }
+    _coutConstruction = getCost();
+    _nbMorts = _nbIndicesMorts = 0;
+    _editable = true;
+}
+
+void Bvh::marque(int n) {
+    if (!_infos[n].sale) {
+        _infos[n].sale = true;
+        _sales.push_back(n);
+    }
+}
+
+void Bvh::tue(int n) {
+    _cout -= contribution(n);
+    _ownedNodes[n].count = -1;
+    _nbMorts++;
+}
+
+bool Bvh::recalcule(int n, const std::vector<Shape*>& shapes) {
+    BvhNode& node = _ownedNodes[n];
+    Aabb b;
+    if (node.count > 0) {
+        for (int c = node.first; c < node.first + node.count; c++)
+            b.extend(shapes[_ownedIndices[c]]->getBounds());
+    } else {
+        b = boite(_ownedNodes[node.first]);
+        b.extend(boite(_ownedNodes[node.first + 1]));
+    }
+    BvhNode ancien = node;
+    setBounds(node, b);
+    if (std::equal(node.min, node.min + 3, ancien.min) && std::equal(node.max, node.max + 3, ancien.max))
+        return false;
+    _cout += (aire(node) - aire(ancien)) * std::max(node.count, 1);
+    return true;
+}
+
+void Bvh::detache(int k) {
+    int f = _feuilles[k];
+    BvhNode& feuille = _ownedNodes[f];
+    _feuilles[k] = -1;
+    if (feuille.count == 1) {
+        fusionne(f);
+        return;
+    }
+    int dernier = feuille.first + feuille.count - 1;
+    std::swap(*std::find(_ownedIndices.begin() + feuille.first, _ownedIndices.begin() + dernier, k), _ownedIndices[dernier]);
+    _cout -= contribution(f);
+    feuille.count--;
+    _cout += contribution(f);
+    marque(f);
+}
+
+void Bvh::fusionne(int feuille) {
+    // La dernière feuille vidée : il n'y a plus de hiérarchie, update la reconstruira
+    if (feuille == 0) {
+        clear();
+        return;
+    }
+    // Le frère remplace le parent
+    int p = _infos[feuille].parent;
+    int frere = (_ownedNodes[p].first == feuille) ? feuille + 1 : feuille - 1;
+    BvhNode copie = _ownedNodes[frere];
+    _cout -= contribution(p);
+    tue(feuille);
+    tue(frere);
+    _ownedNodes[p] = copie;
+    _cout += contribution(p);
+    _infos[p].aireConstruction = _infos[frere].aireConstruction;
+    if (copie.count > 0) {
+        for (int c = copie.first; c < copie.first + copie.count; c++)
+            _feuilles[_ownedIndices[c]] = p;
+    } else {
+        _infos[copie.first].parent = _infos[copie.first + 1].parent = p;
+    }
+    marque(p);
+}
+
+void Bvh::insert(const std::vector<Shape*>& shapes) {
+    if (!isBuilt())
+        return;
+    int k = shapes.size() - 1;
+    prepareEdits(k);
+    _feuilles.push_back(-1);
+    _modifie.push_back(0);
+    _nouveaux.push_back(k);
+}
+
+void Bvh::remove(const std::vector<Shape*>& shapes, int k) {
+    if (!isBuilt())
+        return;
+    int n = shapes.size();
+    prepareEdits(n);
+    if (_feuilles[k] != -1) {
+        detache(k);
+        if (!_editable)
+            return;
+    }
+    // Le dernier objet prend l'indice k (les notes périmées sont ignorées par update)
+    int dernier = n - 1;
+    if (dernier != k) {
+        int f = _feuilles[dernier];
+        if (f != -1) {
+            const BvhNode& feuille = _ownedNodes[f];
+            *std::find(_ownedIndices.begin() + feuille.first, _ownedIndices.begin() + feuille.first + feuille.count, dernier) = k;
+        } else {
+            _nouveaux.push_back(k);
+        }
+        _feuilles[k] = f;
+        _modifie[k] = _modifie[dernier];
+        if (_modifie[k])
+            _touches.push_back(k);
+    }
+    _feuilles.pop_back();
+    _modifie.pop_back();
+}
+
+void Bvh::touch(const std::vector<Shape*>& shapes, int k) {
+    if (!isBuilt())
+        return;
+    prepareEdits(shapes.size());
+    if (!_modifie[k]) {
+        _modifie[k] = 1;
+        _touches.push_back(k);
+    }
+}
+
+void Bvh::insereDescente(int k, const std::vector<Shape*>& shapes) {
+    // Descente vers le fils dont la boîte grossit le moins
+    Aabb b = shapes[k]->getBounds();
+    int n = 0;
+    while (_ownedNodes[n].count == 0) {
+        int gauche = _ownedNodes[n].first;
+        Real croissance[2];
+        for (int c = 0; c < 2; c++) {
+            Aabb union_ = boite(_ownedNodes[gauche + c]);
+            union_.extend(b);
+            croissance[c] = union_.surfaceArea() - aire(_ownedNodes[gauche + c]);
+        }
+        n = (croissance[1] < croissance[0]) ? gauche + 1 : gauche;
+    }
+
+    BvhNode& feuille = _ownedNodes[n];
+    if (feuille.count >= FEUILLE_MAX) {
+        // Feuille pleine : elle devient un petit sous-arbre avec le nouvel objet
+        SousArbre sa;
+        rassemble(sa, n, std::numeric_limits<int>::max());
+        sa.objets.push_back(k);
+        construitSousArbre(sa, shapes);
+        raccorde(sa);
+        return;
+    }
+    // Les indices de la feuille passent à la fin du tableau, où elle peut grandir
+    _cout -= contribution(n);
+    if (feuille.first + feuille.count != int(_ownedIndices.size())) {
+        int premier = _ownedIndices.size();
+        for (int c = 0; c < feuille.count; c++) {
+            int32_t objet = _ownedIndices[feuille.first + c];
+            _ownedIndices.push_back(objet);
+        }
+        _nbIndicesMorts += feuille.count;
+        feuille.first = premier;
+    }
+    _ownedIndices.push_back(k);
+    feuille.count++;
+    _cout += contribution(n);
+    _feuilles[k] = n;
+    marque(n);
+}
+
+bool Bvh::rassemble(SousArbre& sa, int racine, int maxObjets) {
+    sa.racine = racine;
+    sa.profondeur = 0;
+    for (int p = _infos[racine].parent; p != -1; p = _infos[p].parent)
+        sa.profondeur++;
+    std::vector<int> pile = {racine};
+    while (!pile.empty()) {
+        int n = pile.back();
+        pile.pop_back();
+        const BvhNode& node = _ownedNodes[n];
+        if (n != racine)
+            sa.anciens.push_back(n);
+        if (node.count > 0) {
+            sa.objets.insert(sa.objets.end(), _ownedIndices.begin() + node.first, _ownedIndices.begin() + node.first + node.count);
+            if (int(sa.objets.size()) > maxObjets)
+                return false;
+        } else {
+            pile.push_back(node.first);
+            pile.push_back(node.first + 1);
+        }
+    }
+    sa.nbIndicesAnciens = sa.objets.size();
+    return true;
+}
+
+void Bvh::construitSousArbre(SousArbre& sa, const std::vector<Shape*>& shapes) const {
+    int n = sa.objets.size();
+    std::vector<Aabb> bounds(n);
+    std::vector<Vector3f> centers(n);
+    for (int k = 0; k < n; k++) {
+        bounds[k] = shapes[sa.objets[k]]->getBounds();
+        centers[k] = bounds[k].center();
+    }
+    construit(bounds, centers, sa.profondeur, sa.nodes, sa.indices);
+    for (int32_t& i : sa.indices)
+        i = sa.objets[i];
+}
+
+void Bvh::raccorde(SousArbre& sa) {
+    for (int n : sa.anciens)
+        tue(n);
+    _nbIndicesMorts += sa.nbIndicesAnciens;
+    _cout -= contribution(sa.racine);
+
+    // La racine garde sa place, les autres noeuds et les indices sont ajoutés à la fin
+    int base = _ownedNodes.size(), baseIndices = _ownedIndices.size();
+    auto place = [&](int j) { return j == 0 ? sa.racine : base + j - 1; };
+    _ownedIndices.insert(_ownedIndices.end(), sa.indices.begin(), sa.indices.end());
+    _ownedNodes.resize(base + sa.nodes.size() - 1);
+    _infos.resize(_ownedNodes.size());
+    majPointeurs();
+    for (int j = 0; j < int(sa.nodes.size()); j++) {
+        BvhNode node = sa.nodes[j];
+        int n = place(j);
+        if (node.count > 0) {
+            node.first += baseIndices;
+            for (int c = node.first; c < node.first + node.count; c++)
+                _feuilles[_ownedIndices[c]] = n;
+        } else {
+            node.first = place(node.first);
+            _infos[node.first].parent = _infos[node.first + 1].parent = n;
+        }
+        _ownedNodes[n] = node;
+        if (j > 0)
+            _infos[n].sale = false;
+        _infos[n].aireConstruction = aire(node);
+        _cout += contribution(n);
+    }
+    marque(sa.racine);
+}
+
+int Bvh::refit(const std::vector<Shape*>& shapes, int nbThreads, std::vector<int>* candidats) {
+    std::vector<int> sales;
+    sales.swap(_sales);
+    int nbRecalcules = 0;
+    auto recalculeNoeud = [&](int n) {
+        bool change = recalcule(n, shapes);
+        nbRecalcules++;
+        if (candidats != nullptr && _ownedNodes[n].count == 0 && aire(_ownedNodes[n]) > GROSSISSEMENT_MAX * _infos[n].aireConstruction)
+            candidats->push_back(n);
+        return change;
+    };
+
+    // Boîtes des noeuds notés : celles des feuilles, qui lisent leurs objets, sont
+    // calculées en parallèle quand elles sont nombreuses
+    std::vector<Aabb> boites(sales.size());
+    parallelFor(sales.size(), sales.size() >= REFIT_PARALLELE ? nbThreads : 1, [&](int s) {
+        const BvhNode& node = _ownedNodes[sales[s]];
+        for (int c = node.first; c < node.first + node.count; c++)
+            boites[s].extend(shapes[_ownedIndices[c]]->getBounds());
+    });
+    for (std::size_t s = 0; s < sales.size(); s++) {
+        int n = sales[s];
+        _infos[n].sale = false;
+        const BvhNode& node = _ownedNodes[n];
+        if (node.count > 0) {
+            BvhNode ancien = node;
+            setBounds(_ownedNodes[n], boites[s]);
+            _cout += (aire(_ownedNodes[n]) - aire(ancien)) * node.count;
+            nbRecalcules++;
+        } else if (node.count == 0) {
+            recalculeNoeud(n);
+        }
+    }
+
+    // Remontée vers la racine depuis chaque noeud noté, arrêtée dès qu'une boîte ne
+    // change plus : chaque ancêtre est recalculé une dernière fois après ses fils
+    for (int n : sales) {
+        if (_ownedNodes[n].count < 0)
+            continue;
+        for (int p = _infos[n].parent; p != -1 && recalculeNoeud(p); p = _infos[p].parent)
+            ;
+    }
+    return nbRecalcules;
+}
+
+BvhUpdate Bvh::update(const std::vector<Shape*>& shapes, int nbThreads) {
+    BvhUpdate bilan;
+    int n = shapes.size();
+    if (!isBuilt() || (_editable && 2 * _nouveaux.size() > std::size_t(n))) {
+        // Pas de hiérarchie, ou tant d'ajouts qu'une construction coûte moins cher
+        if (n > 0) {
+            build(shapes);
+            bilan.full = true;
+        }
+        return bilan;
+    }
+    if (!_editable)
+        return bilan;
+
+    // Objets modifiés : ceux dont le centre est sorti de la boîte du parent de leur
+    // feuille sont réinsérés, les boîtes des autres feuilles sont seulement recalculées
+    for (int k : _touches) {
+        if (k >= n || !_modifie[k])
+            continue;
+        _modifie[k] = 0;
+        int f = _feuilles[k];
+        if (f == -1)
+            continue;
+        int p = _infos[f].parent;
+        if (p != -1 && !contient(_ownedNodes[p], shapes[k]->getBounds().center())) {
+            detache(k);
+            _nouveaux.push_back(k);
+            bilan.reinserted++;
+        } else {
+            marque(f);
+        }
+    }
+    _touches.clear();
+    for (int k : _nouveaux) {
+        if (k < n && _feuilles[k] == -1) {
+            insereDescente(k, shapes);
+            bilan.inserted++;
+        }
+    }
+    _nouveaux.clear();
+
+    std::vector<int> candidats;
+    bilan.refitted = refit(shapes, nbThreads, &candidats);
+
+    // Reconstruction en parallèle des plus hauts sous-arbres dont la boîte a trop grossi
+    std::sort(candidats.begin(), candidats.end());
+    candidats.erase(std::unique(candidats.begin(), candidats.end()), candidats.end());
+    std::vector<SousArbre> sousArbres;
+    for (int c : candidats) {
+        bool plusHaut = true;
+        for (int p = _infos[c].parent; p != -1 && plusHaut; p = _infos[p].parent)
+            plusHaut = !std::binary_search(candidats.begin(), candidats.end(), p);
+        SousArbre sa;
+        if (plusHaut && rassemble(sa, c, RECONSTRUCTION_MAX))
+            sousArbres.push_back(std::move(sa));
+    }
+    parallelFor(sousArbres.size(), nbThreads, [&](int s) { construitSousArbre(sousArbres[s], shapes); });
+    for (SousArbre& sa : sousArbres)
+        raccorde(sa);
+    bilan.rebuilt = sousArbres.size();
+    if (!sousArbres.empty())
+        bilan.refitted += refit(shapes, nbThreads, nullptr);
+    majPointeurs();
+
+    // Reconstruction complète si la qualité s'est trop dégradée ou si la moitié des
+    // noeuds ou des indices ne sert plus
+    if (getCost() > DEGRADATION_MAX * _coutConstruction || 2 * _nbMorts > _nbNodes || 2 * _nbIndicesMorts > _nbIndices) {
+        build(shapes);
+        bilan.full = true;
+    }
+    return bilan;
+}
+
+int Bvh::closestHit(const Ray3f& ray, const std::vector<Shape*>& shapes, Real& t) const {
+    PerfStage etape(STAGE_CLOSEST_HIT, 1);
+    int indexPlusProche = -1;
+    t = std::numeric_limits<Real>::max();
+    if (!isBuilt()) {
+        int nbObjets = shapes.size();
+        for (int k = 0; k < nbObjets; k++) {
+            Real tk = shapes[k]->is_hit(ray);
+            if (tk > 0 && tk < t) {
+                t = tk;
+                indexPlusProche = k;
+            }
+        }
+        countRay(nbObjets, 0);
+        return indexPlusProche;
+    }
+
+    RayonBoite rb(ray);
+    if (rb.entree(_nodes[0], t) == std::numeric_limits<Real>::infinity()) {
+        countRay(0, 1);
+        return -1;
+    }
+    int pile[PROFONDEUR_PILE];
+    int sommet = 0;
+    int courant = 0;
+    uint32_t nbTests = 0, nbNoeuds = 0;
+    while (true) {
+        const BvhNode& node = _nodes[courant];
+        nbNoeuds++;
+        if (node.count > 0) {
+            nbTests += node.count;
+            for (int c = node.first; c < node.first + node.count; c++) {
+                int k = _indices[c];
+                Real tk = shapes[k]->is_hit(ray);
+                if (tk > 0 && (tk < t || (tk == t && k < indexPlusProche))) {
+                    t = tk;
+                    indexPlusProche = k;
+                }
+            }
+        } else {
+            // On descend d'abord dans le fils le plus proche
+            Real e0 = rb.entree(_nodes[node.first], t);
+            Real e1 = rb.entree(_nodes[node.first + 1], t);
+            int proche = node.first, loin = node.first + 1;
+            if (e1 < e0) {
+                std::swap(e0, e1);
+                std::swap(proche, loin);
+            }
+            if (e0 != std::numeric_limits<Real>::infinity()) {
+                if (e1 != std::numeric_limits<Real>::infinity() && sommet < PROFONDEUR_PILE)
+                    pile[sommet++] = loin;
+                courant = proche;
+                continue;
+            }
+        }
+        if (sommet == 0)
+            break;
+        courant = pile[--sommet];
+    }
+    countRay(nbTests, nbNoeuds);
+    return indexPlusProche;
+}
+
+/**
+ * @brief Cache d'ombre du thread : l'objet qui a coupé son dernier rayon d'ombre (-1 si
+ * ce rayon était libre). Les points voisins (pixels voisins, vues d'un même rendu) sont
+ * souvent cachés de la source par le même objet, que l'on teste alors avant de parcourir
+ * la hiérarchie ; dans les zones éclairées, le cache est vide et ne coûte rien. Ce n'est
+ * qu'un indice, vérifié à chaque usage : le résultat des requêtes ne dépend pas du cache
+ */
+static thread_local int dernierOccultant = -1;
+
+bool Bvh::occluded(const Ray3f& ray, const std::vector<Shape*>& shapes, Real distance) const {
+    PerfStage etape(STAGE_SHADOW, 1);
+    uint32_t nbTests = 0, nbNoeuds = 0;
+    int cache = dernierOccultant;
+    if (cache >= 0 && cache < int(shapes.size())) {
+        nbTests++;
+        if (shapes[cache]->occludes(ray, distance)) {
+            countRay(nbTests, 0);
+            return true;
+        }
+    }
+    if (!isBuilt()) {
+        for (int k = 0; k < int(shapes.size()); k++) {
+            nbTests++;
+            if (shapes[k]->occludes(ray, distance)) {
+                dernierOccultant = k;
+                countRay(nbTests, 0);
+                return true;
+            }
+        }
+        dernierOccultant = -1;
+        countRay(nbTests, 0);
+        return false;
+    }
+
+    RayonBoite rb(ray);
+    int pile[PROFONDEUR_PILE];
+    int sommet = 0;
+    pile[sommet++] = 0;
+    while (sommet > 0) {
+        const BvhNode& node = _nodes[pile[--sommet]];
+        nbNoeuds++;
+        if (rb.entree(node, distance) == std::numeric_limits<Real>::infinity())
+            continue;
+        if (node.count > 0) {
+            for (int c = node.first; c < node.first + node.count; c++) {
+                nbTests++;
+                if (shapes[_indices[c]]->occludes(ray, distance)) {
+                    dernierOccultant = _indices[c];
+                    countRay(nbTests, nbNoeuds);
+                    return true;
+                }
+            }
+        } else if (sommet + 2 <= PROFONDEUR_PILE) {
+            pile[sommet++] = node.first + 1;
+            pile[sommet++] = node.first;
+        }
+    }
+    dernierOccultant = -1;
+    countRay(nbTests, nbNoeuds);
+    return false;
+}
+
+int Bvh::occludedPacket(const Ray3f* rays, const std::vector<Shape*>& shapes, const Real* distances, int count, bool* occluded) const {
+    PerfStage etape(STAGE_SHADOW, count);
+    uint32_t nbTests = 0, nbNoeuds = 0;
+    int nbOccultes = 0;
+    for (int r = 0; r < count; r++)
+        occluded[r] = false;
+    if (!isBuilt()) {
+        for (int r = 0; r < count; r++) {
+            for (const Shape* s : shapes) {
+                nbTests++;
+                if (s->occludes(rays[r], distances[r])) {
+                    occluded[r] = true;
+                    nbOccultes++;
+                    break;
+                }
+            }
+        }
+        countRay(nbTests, 0, count);
+        return nbOccultes;
+    }
+
+    // Comme occluded : le dernier objet occultant du thread est essayé d'abord, pour tous
+    // les rayons (dans l'ombre franche, il les arrête souvent tous sans parcours)
+    uint64_t libres = (count == 64) ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+    int cache = dernierOccultant;
+    if (cache >= 0 && cache < int(shapes.size())) {
+        for (int r = 0; r < count; r++) {
+            nbTests++;
+            if (shapes[cache]->occludes(rays[r], distances[r])) {
+                occluded[r] = true;
+                nbOccultes++;
+                libres &= ~(uint64_t(1) << r);
+            }
+        }
+        if (libres == 0) {
+            countRay(nbTests, 0, count);
+            return nbOccultes;
+        }
+    }
+
+    // Masque des rayons encore libres, et pile de (noeud, rayons qui l'atteignent peut-être)
+    RayonBoite boites[PAQUET_MAX];
+    for (int r = 0; r < count; r++)
+        boites[r] = RayonBoite(rays[r]);
+    int pile[PROFONDEUR_PILE];
+    uint64_t masques[PROFONDEUR_PILE];
+    int sommet = 0;
+    pile[sommet] = 0;
+    masques[sommet++] = libres;
+    while (sommet > 0 && libres != 0) {
+        sommet--;
+        const BvhNode& node = _nodes[pile[sommet]];
+        uint64_t masque = masques[sommet] & libres, atteints = 0;
+        nbNoeuds++;
+        for (int r = 0; r < count; r++) {
+            if ((masque >> r & 1) && boites[r].entree(node, distances[r]) != std::numeric_limits<Real>::infinity())
+                atteints |= uint64_t(1) << r;
+        }
+        if (atteints == 0)
+            continue;
+        if (node.count > 0) {
+            for (int c = node.first; c < node.first + node.count && atteints != 0; c++) {
+                const Shape* s = shapes[_indices[c]];
+                for (int r = 0; r < count; r++) {
+                    if (!(atteints >> r & 1))
+                        continue;
+                    nbTests++;
+                    if (s->occludes(rays[r], distances[r])) {
+                        occluded[r] = true;
+                        nbOccultes++;
+                        atteints &= ~(uint64_t(1) << r);
+                        libres &= ~(uint64_t(1) << r);
+                        dernierOccultant = _indices[c];
+                    }
+                }
+            }
+        } else if (sommet + 2 <= PROFONDEUR_PILE) {
+            pile[sommet] = node.first + 1;
+            masques[sommet++] = atteints;
+            pile[sommet] = node.first;
+            masques[sommet++] = atteints;
+        }
+    }
+    if (nbOccultes == 0)
+        dernierOccultant = -1;
+    countRay(nbTests, nbNoeuds, count);
+    return nbOccultes;
+}
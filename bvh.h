@@ -0,0 +1,340 @@
+/**
+ * @file bvh.h
+ * @brief Création de la classe Bvh (hiérarchie de boîtes englobantes)
+ */
+#ifndef BVH_H
+#define BVH_H
+
+#include "shape.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * @brief Noeud de la hiérarchie, rangé à plat (32 octets en simple précision). Les
+ * références sont des indices, le tableau peut donc être enregistré et relu tel quel
+ */
+struct BvhNode {
+    Real min[3], max[3];  // Boîte englobante du noeud
+    int32_t first;        // Noeud interne : indice du fils gauche (le droit suit) ; feuille : premier indice d'objet
+    int32_t count;        // Nombre d'objets de la feuille (0 pour un noeud interne)
+};
+
+/**
+ * @brief Rayon préparé pour les tests de boîtes (méthode des dalles)
+ */
+struct RayonBoite {
+    Real origine[3], inverse[3];
+
+    RayonBoite() = default;
+    RayonBoite(const Ray3f& ray) {
+        for (int a = 0; a < 3; a++) {
+            origine[a] = ray.getOrigin()[a];
+            inverse[a] = 1 / ray.getDirection()[a];
+        }
+    }
+
+    /**
+     * @brief Distance d'entrée dans la boîte du noeud si le rayon la traverse avant
+     * tMax, l'infini sinon
+     */
+    inline Real entree(const BvhNode& node, Real tMax) const {
+        Real tNear = 0, tFar = tMax;
+        for (int a = 0; a < 3; a++) {
+            Real t1 = (node.min[a] - origine[a]) * inverse[a];
+            Real t2 = (node.max[a] - origine[a]) * inverse[a];
+            tNear = std::max(tNear, std::min(t1, t2));
+            tFar = std::min(tFar, std::max(t1, t2));
+        }
+        // Marge relative pour ne pas manquer les impacts sur les bords de la boîte
+        if (tNear <= tFar * (1 + 4 * std::numeric_limits<Real>::epsilon()))
+            return tNear;
+        return std::numeric_limits<Real>::infinity();
+    }
+};
+
+/**
+ * @brief Bilan d'une mise à jour incrémentale de la hiérarchie (Bvh::update)
+ */
+struct BvhUpdate {
+    int inserted = 0;       // Objets placés dans une feuille (nouveaux ou réinsérés)
+    int reinserted = 0;     // Objets déplacés hors de leur sous-arbre, retirés puis réinsérés
+    int refitted = 0;       // Boîtes de noeuds recalculées
+    int rebuilt = 0;        // Sous-arbres reconstruits localement
+    bool full = false;      // Reconstruction complète (qualité trop dégradée)
+};
+
+/**
+ * @brief Hiérarchie de boîtes englobantes des objets, construite par découpage selon
+ * l'heuristique des surfaces (SAH) sur des classes de centres. Les noeuds et les indices
+ * d'objets sont soit possédés (après build), soit lus dans une mémoire extérieure (cache
+ * de scène projeté en mémoire, après view). Tant qu'elle n'est pas construite, les
+ * requêtes testent tous les objets.
+ *
+ * La hiérarchie suit les modifications de la scène sans reconstruction : insert, remove
+ * et touch notent les objets ajoutés, retirés ou modifiés, et update les prend en compte
+ * en recalculant les boîtes de leurs seuls ancêtres, en réinsérant les objets sortis de
+ * leur sous-arbre et en reconstruisant en parallèle les sous-arbres dont la boîte a trop
+ * grossi. Les noeuds et indices remplacés restent en place, inutilisés, jusqu'à la
+ * reconstruction complète, faite quand le coût SAH dépasse DEGRADATION_MAX fois celui de
+ * la construction. Le coût d'une mise à jour dépend du nombre d'objets modifiés, pas de
+ * la taille de la scène (la première modification d'une hiérarchie construite ou lue dans
+ * un cache prépare, une fois, les parents des noeuds et les feuilles des objets)
+ *
+ */
+class Bvh {
+
+    public:
+        /**
+         * @brief Nombre maximal d'objets d'une feuille
+         */
+        static const int FEUILLE_MAX = 4;
+
+        /**
+         * @brief Rapport maximal entre le coût SAH courant et celui de la construction
+         * avant une reconstruction complète
+         */
+        static constexpr Real DEGRADATION_MAX = 1.5;
+
+        /**
+         * @brief Grossissement de la boîte d'un noeud (rapport des aires) au-delà duquel
+         * son sous-arbre est reconstruit
+         */
+        static constexpr Real GROSSISSEMENT_MAX = 2;
+
+        /**
+         * @brief Nombre maximal d'objets d'un sous-arbre reconstruit localement
+         */
+        static const int RECONSTRUCTION_MAX = 4096;
+
+        Bvh() : _nodes(nullptr), _nbNodes(0), _indices(nullptr), _nbIndices(0) {}
+
+        Bvh(const Bvh&) = delete;
+        Bvh& operator=(const Bvh&) = delete;
+
+        /**
+         * @brief Construit la hiérarchie des objets
+         *
+         * @param shapes
+         */
+        void build(const std::vector<Shape*>& shapes);
+
+        /**
+         * @brief Utilise une hiérarchie déjà construite, rangée dans une mémoire qui doit
+         * rester valide (aucune copie)
+         *
+         * @param nodes
+         * @param nbNodes
+         * @param indices
+         * @param nbIndices
+         */
+        void view(const BvhNode* nodes, int nbNodes, const int32_t* indices, int nbIndices);
+
+        /**
+         * @brief Oublie la hiérarchie (les requêtes testent alors tous les objets)
+         */
+        void clear();
+
+        /**
+         * @brief Note l'ajout de l'objet shapes.back(), inséré par le prochain update
+         *
+         * @param shapes les objets, nouvel objet compris
+         */
+        void insert(const std::vector<Shape*>& shapes);
+
+        /**
+         * @brief Retire l'objet k de la hiérarchie, tout de suite : l'appelant remplace
+         * ensuite k par le dernier objet, dont l'indice devient k
+         *
+         * @param shapes les objets, avant le retrait
+         * @param k
+         */
+        void remove(const std::vector<Shape*>& shapes, int k);
+
+        /**
+         * @brief Note que l'objet k a changé de forme ou de place (sa boîte est recalculée
+         * par le prochain update)
+         *
+         * @param shapes
+         * @param k
+         */
+        void touch(const std::vector<Shape*>& shapes, int k);
+
+        /**
+         * @brief Prend en compte les modifications notées depuis le dernier update (ou
+         * construit la hiérarchie si elle ne l'est pas)
+         *
+         * @param shapes
+         * @param nbThreads nombre de threads des reconstructions locales (<= 0 : tous les coeurs)
+         * @return BvhUpdate
+         */
+        BvhUpdate update(const std::vector<Shape*>& shapes, int nbThreads = 0);
+
+        /**
+         * @brief Vrai si des modifications attendent update (les requêtes ne voient alors
+         * pas encore les objets ajoutés et utilisent les anciennes boîtes des objets modifiés)
+         */
+        inline bool hasPendingEdits() const {return !_nouveaux.empty() || !_touches.empty() || !_sales.empty();};
+
+        /**
+         * @brief Vrai si la hiérarchie sort d'une construction (ou d'une lecture) sans
+         * modification : les objets de chaque sous-arbre y sont contigus et aucun noeud
+         * n'est inutilisé, comme l'attendent les enregistrements en cache et en pages
+         */
+        inline bool isCompact() const {return !_editable;};
+
+        /**
+         * @brief Coût SAH de la hiérarchie, relatif à l'aire de la racine (noeuds internes
+         * pour 1, objets des feuilles pour 1 chacun)
+         *
+         * @return Real
+         */
+        Real getCost() const;
+
+        inline bool isBuilt() const {return _nbNodes > 0;};
+        inline const BvhNode* getNodes() const {return _nodes;};
+        inline int getNbNodes() const {return _nbNodes;};
+        inline const int32_t* getIndices() const {return _indices;};
+        inline int getNbIndices() const {return _nbIndices;};
+
+        /**
+         * @brief Retourne l'indice de l'objet touché le plus près de l'origine du rayon
+         * (à distance égale, le plus petit indice), -1 si aucun
+         *
+         * @param ray
+         * @param shapes les objets avec lesquels la hiérarchie a été construite
+         * @param t reçoit la distance de l'impact
+         * @return int
+         */
+        int closestHit(const Ray3f& ray, const std::vector<Shape*>& shapes, Real& t) const;
+
+        /**
+         * @brief Teste si un objet coupe le rayon entre son origine et la distance donnée
+         * (rayons d'ombre : s'arrête au premier objet trouvé, par Shape::occludes). L'objet qui a coupé le
+         * dernier rayon d'ombre du thread est testé en premier (cache d'ombre)
+         *
+         * @param ray
+         * @param shapes les objets avec lesquels la hiérarchie a été construite
+         * @param distance
+         * @return bool
+         */
+        bool occluded(const Ray3f& ray, const std::vector<Shape*>& shapes, Real distance) const;
+
+        /**
+         * @brief Rayons d'ombre en paquet : la hiérarchie est parcourue une seule fois
+         * pour tous les rayons, chaque noeud n'étant testé que pour les rayons encore
+         * libres qui l'atteignent (rayons cohérents, par exemple vers une même source).
+         * Comme pour occluded, le dernier objet occultant du thread est essayé d'abord
+         * pour tous les rayons
+         *
+         * @param rays
+         * @param shapes les objets avec lesquels la hiérarchie a été construite
+         * @param distances distance maximale de chaque rayon
+         * @param count nombre de rayons (au plus PAQUET_MAX)
+         * @param occluded reçoit, pour chaque rayon, s'il est coupé avant sa distance
+         * @return int nombre de rayons coupés
+         */
+        int occludedPacket(const Ray3f* rays, const std::vector<Shape*>& shapes, const Real* distances, int count, bool* occluded) const;
+
+        /**
+         * @brief Nombre maximal de rayons d'un paquet
+         */
+        static const int PAQUET_MAX = 64;
+
+    private:
+        /**
+         * @brief Etat d'un noeud pendant les modifications
+         */
+        struct InfoNoeud {
+            int32_t parent;         // -1 pour la racine
+            Real aireConstruction;  // Aire de la boîte à la construction du noeud
+            bool sale;              // Boîte à recalculer par le prochain update
+        };
+
+        /**
+         * @brief Sous-arbre reconstruit par update : objets rassemblés, puis noeuds et
+         * indices construits à part (en parallèle) avant d'être raccordés
+         */
+        struct SousArbre {
+            int racine, profondeur;
+            std::vector<int> anciens;       // Noeuds remplacés (racine exceptée)
+            int nbIndicesAnciens;
+            std::vector<int32_t> objets;
+            std::vector<BvhNode> nodes;
+            std::vector<int32_t> indices;
+        };
+
+        /**
+         * @brief Prépare les modifications (une fois) : recopie une hiérarchie lue sur
+         * place, calcule les parents, les feuilles des objets et le coût initial
+         */
+        void prepareEdits(int nbShapes);
+
+        void majPointeurs();
+
+        /**
+         * @brief Part du noeud n dans le coût SAH (aire, multipliée par le nombre
+         * d'objets pour une feuille ; 0 pour un noeud inutilisé)
+         */
+        Real contribution(int n) const;
+
+        /**
+         * @brief Note la boîte du noeud n à recalculer / rend le noeud n inutilisé
+         */
+        void marque(int n);
+        void tue(int n);
+
+        /**
+         * @brief Recalcule la boîte du noeud n (objets ou fils) ; vrai si elle a changé
+         */
+        bool recalcule(int n, const std::vector<Shape*>& shapes);
+
+        /**
+         * @brief Sort l'objet k de sa feuille ; une feuille vidée est remplacée par sa soeur
+         */
+        void detache(int k);
+        void fusionne(int feuille);
+
+        /**
+         * @brief Place l'objet k dans la feuille atteinte en descendant vers le fils dont
+         * la boîte grossit le moins (une feuille pleine devient un sous-arbre)
+         */
+        void insereDescente(int k, const std::vector<Shape*>& shapes);
+
+        /**
+         * @brief Etapes d'une reconstruction locale : rassemble (faux si le sous-arbre a
+         * plus de maxObjets objets), construitSousArbre (sans toucher à la hiérarchie),
+         * raccorde
+         */
+        bool rassemble(SousArbre& sa, int racine, int maxObjets);
+        void construitSousArbre(SousArbre& sa, const std::vector<Shape*>& shapes) const;
+        void raccorde(SousArbre& sa);
+
+        /**
+         * @brief Recalcule les boîtes des noeuds notés et de leurs ancêtres ; candidats
+         * (si non nul) reçoit les noeuds internes dont la boîte a trop grossi
+         *
+         * @return int nombre de boîtes recalculées
+         */
+        int refit(const std::vector<Shape*>& shapes, int nbThreads, std::vector<int>* candidats);
+
+        std::vector<BvhNode> _ownedNodes;
+        std::vector<int32_t> _ownedIndices;
+        const BvhNode* _nodes;
+        int _nbNodes;
+        const int32_t* _indices;
+        int _nbIndices;
+
+        // Etat des modifications (vide tant que la hiérarchie n'a pas été modifiée)
+        bool _editable = false;
+        std::vector<InfoNoeud> _infos;
+        std::vector<int32_t> _feuilles;     // Feuille de chaque objet (-1 : insertion en attente)
+        std::vector<char> _modifie;         // Objets notés par touch
+        std::vector<int> _nouveaux, _touches, _sales;
+        double _cout = 0;                   // Somme des aires des noeuds, pondérées par les objets des feuilles
+        double _coutConstruction = 0;       // Coût relatif (getCost) à la construction
+        int _nbMorts = 0, _nbIndicesMorts = 0;
+};
+
+#endif
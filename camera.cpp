@@ -17,7 +17,44 @@ Camera::Camera(const Vector3f& position, const Vector3f& direction, const Vector
 Camera::~Camera() {
 }
 
-Ray3f Camera::getRay(float u, float v) {
+Ray3f Camera::getRay(Real u, Real v) const {
     Vector3f point = _position + _direction + _right*u + _up*v;
     return Ray3f(_position, (point - _position).normalized());
 }
+
+/**
+ * @brief Rotation de v autour de l'axe unitaire k d'un angle a (formule de Rodrigues)
+ */
+static Vector3f rotateAround(const Vector3f& v, const Vector3f& k, Real a) {
+    Real c = std::cos(a), s = std::sin(a);
+    return v*c + k.cross(v)*s + k*(k.dot(v)*(1-c));
+}
+
+void Camera::translate(Real forward, Real right, Real up) {
+    _position = _position + _direction.normalized()*forward + _right*right + _up*up;
+}
+
+void Camera::rotate(Real yaw, Real pitch) {
+    _direction = rotateAround(_direction, _up, yaw);
+    _right = rotateAround(_right, _up, yaw).normalized();
+    _direction = rotateAround(_direction, _right, pitch);
+    _up = rotateAround(_up, _right, pitch).normalized();
+}
+
+std::vector<Camera> cubeMapCameras(const Vector3f& position, int faceSize) {
+    // Le plan image est à une demi-largeur d'image de la caméra : 90 degrés de champ
+    Real d = Real(faceSize) / 2;
+    const Vector3f directions[6] = {Vector3f(1,0,0), Vector3f(-1,0,0), Vector3f(0,1,0), Vector3f(0,-1,0), Vector3f(0,0,1), Vector3f(0,0,-1)};
+    const Vector3f hauts[6] = {Vector3f(0,1,0), Vector3f(0,1,0), Vector3f(0,0,-1), Vector3f(0,0,1), Vector3f(0,1,0), Vector3f(0,1,0)};
+    std::vector<Camera> faces;
+    for (int f = 0; f < 6; f++)
+        faces.push_back(Camera(position, directions[f] * d, hauts[f]));
+    return faces;
+}
+
+std::vector<Camera> stereoCameras(const Camera& camera, Real eyeDistance) {
+    Camera gauche = camera, droite = camera;
+    gauche.translate(0, -eyeDistance / 2, 0);
+    droite.translate(0, eyeDistance / 2, 0);
+    return {gauche, droite};
+}
@@ -10,6 +10,7 @@
 
 #include "vector3f.h" // Pour les attributs de la classe
 #include "ray3f.h"    // Pour la méthode getRay
+#include <vector>     // Pour les ensembles de vues
 
 
 /**
@@ -57,7 +58,45 @@ class Camera {
          * @param v
          * @return Ray3f
          */
-        Ray3f getRay(float u, float v);
+        Ray3f getRay(Real u, Real v) const;
+
+        /**
+         * @brief Déplace la caméra dans son propre repère
+         *
+         * @param forward déplacement selon la direction
+         * @param right déplacement selon la droite
+         * @param up déplacement selon le haut
+         */
+        void translate(Real forward, Real right, Real up);
+
+        /**
+         * @brief Tourne la caméra : lacet autour de l'axe haut, tangage autour de
+         * l'axe droit (angles en radians)
+         *
+         * @param yaw
+         * @param pitch
+         */
+        void rotate(Real yaw, Real pitch);
 };
 
+/**
+ * @brief Caméras des 6 faces d'une cube map centrée en position, dans l'ordre +x, -x,
+ * +y, -y, +z, -z : chacune voit 90 degrés sur une image carrée de faceSize pixels
+ *
+ * @param position
+ * @param faceSize côté des images des faces (en pixels)
+ * @return std::vector<Camera>
+ */
+std::vector<Camera> cubeMapCameras(const Vector3f& position, int faceSize);
+
+/**
+ * @brief Couple stéréo : la caméra décalée à gauche puis à droite d'une demi-distance
+ * entre les yeux, mêmes directions
+ *
+ * @param camera
+ * @param eyeDistance distance entre les deux caméras
+ * @return std::vector<Camera>
+ */
+std::vector<Camera> stereoCameras(const Camera& camera, Real eyeDistance);
+
 #endif
@@ -0,0 +1,135 @@
+/**
+ * @file costmap.cpp
+ * @brief Implémentation de la classe CostMap
+ */
+
+#include "costmap.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <stdexcept>
+
+const std::size_t BLOC_MAX = 65535;    // Taille maximale d'un bloc deflate non compressé
+
+CostMap::CostMap(int width, int height)
+    : intersections(std::size_t(width) * height), traversals(intersections.size()), rays(intersections.size()),
+      cycles(intersections.size()), _width(width), _height(height) {}
+
+void CostMap::writeRaw(const std::string& filename) const {
+    std::vector<float> pixels(getSize() * 4);
+    for (std::size_t k = 0; k < getSize(); k++) {
+        pixels[4*k] = intersections[k];
+        pixels[4*k + 1] = traversals[k];
+        pixels[4*k + 2] = rays[k];
+        pixels[4*k + 3] = cycles[k];
+    }
+    FILE* f = std::fopen(filename.c_str(), "wb");
+    if (f == nullptr)
+        throw std::runtime_error("Impossible de créer le fichier " + filename);
+    bool ok = std::fwrite(pixels.data(), sizeof(float), pixels.size(), f) == pixels.size();
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok)
+        throw std::runtime_error("Erreur d'écriture de " + filename);
+}
+
+/**
+ * @brief CRC-32 (polynôme 0xedb88320) des octets, à partir d'une valeur précédente
+ */
+static uint32_t crc32(const unsigned char* data, std::size_t size, uint32_t crc = 0) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t;
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (std::size_t k = 0; k < size; k++)
+        crc = table[(crc ^ data[k]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void ajoute32(std::vector<unsigned char>& out, uint32_t v) {
+    out.push_back(v >> 24);
+    out.push_back(v >> 16);
+    out.push_back(v >> 8);
+    out.push_back(v);
+}
+
+/**
+ * @brief Ajoute un bloc PNG : longueur, type, données et CRC du type et des données
+ */
+static void ajouteBloc(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data) {
+    ajoute32(out, data.size());
+    std::size_t debut = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    ajoute32(out, crc32(out.data() + debut, out.size() - debut));
+}
+
+void CostMap::writeHeatmap(const std::string& filename) const {
+    // Echelle : de 0 au 99e centile des cycles
+    std::vector<float> tri(cycles);
+    float echelle = 1;
+    if (!tri.empty()) {
+        std::size_t centile = std::min(tri.size() - 1, tri.size() * 99 / 100);
+        std::nth_element(tri.begin(), tri.begin() + centile, tri.end());
+        echelle = std::max(tri[centile], 1.f);
+    }
+
+    // Lignes de l'image, chacune précédée de son filtre (0 : aucun)
+    std::size_t ligne = 1 + std::size_t(_width) * 3;
+    std::vector<unsigned char> brut(ligne * _height);
+    for (int j = 0; j < _height; j++) {
+        unsigned char* p = brut.data() + ligne * j;
+        *p++ = 0;
+        for (int i = 0; i < _width; i++) {
+            // Palette « corps noir » : noir, rouge, jaune puis blanc
+            float t = std::min(cycles[std::size_t(j) * _width + i] / echelle, 1.f) * 3;
+            *p++ = 255 * std::min(std::max(t, 0.f), 1.f);
+            *p++ = 255 * std::min(std::max(t - 1, 0.f), 1.f);
+            *p++ = 255 * std::min(std::max(t - 2, 0.f), 1.f);
+        }
+    }
+
+    // Flux zlib en blocs deflate non compressés (la carte est un outil d'analyse,
+    // sa taille importe peu), suivi de la somme Adler-32
+    std::vector<unsigned char> zlib = {0x78, 0x01};
+    std::size_t pos = 0;
+    do {
+        std::size_t n = std::min(BLOC_MAX, brut.size() - pos);
+        zlib.push_back(pos + n == brut.size() ? 1 : 0);
+        zlib.push_back(n & 0xff);
+        zlib.push_back(n >> 8);
+        zlib.push_back(~n & 0xff);
+        zlib.push_back((~n >> 8) & 0xff);
+        zlib.insert(zlib.end(), brut.begin() + pos, brut.begin() + pos + n);
+        pos += n;
+    } while (pos < brut.size());
+    uint32_t a = 1, b = 0;
+    for (unsigned char c : brut) {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    ajoute32(zlib, (b << 16) | a);
+
+    std::vector<unsigned char> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    std::vector<unsigned char> entete;
+    ajoute32(entete, _width);
+    ajoute32(entete, _height);
+    entete.insert(entete.end(), {8, 2, 0, 0, 0});    // 8 bits par composante, RGB, sans entrelacement
+    ajouteBloc(png, "IHDR", entete);
+    ajouteBloc(png, "IDAT", zlib);
+    ajouteBloc(png, "IEND", {});
+
+    FILE* f = std::fopen(filename.c_str(), "wb");
+    if (f == nullptr)
+        throw std::runtime_error("Impossible de créer le fichier " + filename);
+    bool ok = std::fwrite(png.data(), 1, png.size(), f) == png.size();
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok)
+        throw std::runtime_error("Erreur d'écriture de " + filename);
+}
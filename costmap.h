@@ -0,0 +1,125 @@
+/**
+ * @file costmap.h
+ * @brief Création de la classe CostMap (coût de calcul de chaque pixel)
+ */
+#ifndef COSTMAP_H
+#define COSTMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+/**
+ * @brief Compteurs des requêtes de rayons d'un pixel
+ */
+struct RayCost {
+    uint32_t intersections = 0;     // Tests d'intersection rayon/objet
+    uint32_t traversals = 0;        // Noeuds de la hiérarchie visités
+    uint32_t rays = 0;              // Rayons lancés (primaires, réfléchis, d'ombre, rebonds)
+};
+
+/**
+ * @brief Compteurs du pixel en cours sur ce thread, nul quand aucune carte de coût n'est
+ * demandée : les requêtes de rayons comptent dans des variables locales et ne les
+ * ajoutent ici qu'une fois terminées, le coût est donc un test par rayon
+ */
+inline thread_local RayCost* rayCostCounters = nullptr;
+
+/**
+ * @brief Ajoute une requête de rayons aux compteurs du pixel en cours, s'il y en a
+ *
+ * @param intersections tests d'intersection effectués
+ * @param traversals noeuds visités
+ * @param rays nombre de rayons de la requête (paquets)
+ */
+inline void countRay(uint32_t intersections, uint32_t traversals, uint32_t rays = 1) {
+    if (rayCostCounters != nullptr) {
+        rayCostCounters->intersections += intersections;
+        rayCostCounters->traversals += traversals;
+        rayCostCounters->rays += rays;
+    }
+}
+
+/**
+ * @brief Compteur de cycles du processeur (nanosecondes sur les autres architectures)
+ *
+ * @return uint64_t
+ */
+inline uint64_t readCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+ * @brief Carte de coût : pour chaque pixel, les compteurs de ses rayons et les cycles
+ * passés à le calculer, rangés par plans comme le Framebuffer. Elle s'enregistre en
+ * fausses couleurs (PNG) pour repérer les zones coûteuses, et en flottants bruts pour
+ * l'analyse
+ *
+ */
+class CostMap {
+
+    public:
+        /**
+         * @brief Construit une carte nulle de dimensions width x height
+         *
+         * @param width
+         * @param height
+         */
+        CostMap(int width, int height);
+
+        inline int getWidth() const {return _width;};
+        inline int getHeight() const {return _height;};
+        inline std::size_t getSize() const {return std::size_t(_width) * _height;};
+
+        /**
+         * @brief Enregistre le coût du pixel d'indice k (j*width + i)
+         *
+         * @param k
+         * @param cost
+         * @param nbCycles
+         */
+        inline void set(std::size_t k, const RayCost& cost, uint64_t nbCycles) {
+            intersections[k] = cost.intersections;
+            traversals[k] = cost.traversals;
+            rays[k] = cost.rays;
+            cycles[k] = nbCycles;
+        }
+
+        /**
+         * @brief Ecrit les plans en flottants 32 bits (boutisme de la machine), entrelacés
+         * pixel par pixel dans l'ordre intersections, noeuds, rayons, cycles, ligne par
+         * ligne depuis le haut, sans en-tête
+         *
+         * @param filename
+         */
+        void writeRaw(const std::string& filename) const;
+
+        /**
+         * @brief Ecrit les cycles en fausses couleurs dans une image PNG (du noir pour
+         * les pixels les moins chers au blanc pour les plus chers, la couleur saturant
+         * au 99e centile pour que quelques pixels extrêmes n'écrasent pas l'échelle)
+         *
+         * @param filename
+         */
+        void writeHeatmap(const std::string& filename) const;
+
+        /**
+         * @brief Plans des compteurs
+         */
+        std::vector<float> intersections, traversals, rays, cycles;
+
+    private:
+        int _width, _height;
+};
+
+#endif
@@ -8,31 +8,34 @@
 #include <limits>
 #include <cmath>
 #include <iostream>
-
-Vector3f CubeQuad::projectVector(const Vector3f& v) const {
-    float newX = v.dot(basis[0]) / basis[0].squaredNorm();
-    float newY = v.dot(basis[1]) / basis[1].squaredNorm();
-    float newZ = v.dot(basis[2]) / basis[2].squaredNorm();
-    return Vector3f(newX,newY,newZ);
+#include <algorithm>
+
+template <typename T>
+Vector3<T> projectOnBasis(const Vector3<T>& v, const std::array<Vector3<T>, 3>& basis) {
+    T newX = v.dot(basis[0]) / basis[0].squaredNorm();
+    T newY = v.dot(basis[1]) / basis[1].squaredNorm();
+    T newZ = v.dot(basis[2]) / basis[2].squaredNorm();
+    return Vector3<T>(newX,newY,newZ);
 }
 
-float CubeQuad::is_hit(const Ray3f& ray) const {
+template <typename T>
+T intersectBox(const Ray3<T>& ray, const Vector3<T>& center, const Vector3<T>& halfSize, const std::array<Vector3<T>, 3>& basis) {
     // Projection du rayon sur la base de l'OBB (oriented bounding box)
-    Vector3f ray_origin = this->projectVector(ray.getOrigin());
-    Vector3f ray_direction = this->projectVector(ray.getDirection()).normalized();
+    Vector3<T> ray_origin = projectOnBasis(ray.getOrigin(), basis);
+    Vector3<T> ray_direction = projectOnBasis(ray.getDirection(), basis).normalized();
 
     // Calcul de l'intervalle de validité du rayon
-    float tmin = 0, tmax = std::numeric_limits<float>::max();
+    T tmin = 0, tmax = std::numeric_limits<T>::max();
 
     // Vérification de l'intersection sur chaque axe
     for (int i = 0; i < 3; i++) {
       // Calcul des limites de l'OBB sur l'axe i
-      float vmin = this->getCenter()[i] - this->getHalfSize()[i];
-      float vmax = this->getCenter()[i] + this->getHalfSize()[i];
+      T vmin = center[i] - halfSize[i];
+      T vmax = center[i] + halfSize[i];
 
       // Calcul du coefficient de proportionnalité du rayon sur l'axe i
-      float t1 = (vmin - ray_origin[i]) / ray_direction[i];
-      float t2 = (vmax - ray_origin[i]) / ray_direction[i];
+      T t1 = (vmin - ray_origin[i]) / ray_direction[i];
+      T t2 = (vmax - ray_origin[i]) / ray_direction[i];
 
       // Mise à jour de l'intervalle de validité
       tmin = std::max(tmin, std::min(t1, t2));
@@ -52,43 +55,64 @@ float CubeQuad::is_hit(const Ray3f& ray) const {
     return -1;
 }
 
-Vector3f CubeQuad::getNormal(const Vector3f& v) const {
-    Vector3f nv= this->projectVector(v);
-    Vector3f normal(0);
+template <typename T>
+Vector3<T> boxNormal(const Vector3<T>& v, const Vector3<T>& center, const Vector3<T>& halfSize, const std::array<Vector3<T>, 3>& basis) {
+    Vector3<T> nv = projectOnBasis(v, basis);
       
-    double epsilon = 1e-2;
-    double boxMinX = Vector3f(center - halfSize).getX();
-    double boxMinY = Vector3f(center - halfSize).getY();
-    double boxMinZ = Vector3f(center - halfSize).getZ();
-    double boxMaxX = Vector3f(center + halfSize).getX();
-    double boxMaxY = Vector3f(center + halfSize).getY();
-    double boxMaxZ = Vector3f(center + halfSize).getZ();
-
-    double cx = std::abs(nv.getX() - boxMinX);
-    double fx = std::abs(nv.getX() - boxMaxX);
-    double cy = std::abs(nv.getY() - boxMinY);
-    double fy = std::abs(nv.getY() - boxMaxY);
-    double cz = std::abs(nv.getZ() - boxMinZ);
-    double fz = std::abs(nv.getZ() - boxMaxZ);
+    const T epsilon = Epsilon<T>::SURFACE;
+    Vector3<T> boxMin = center - halfSize;
+    Vector3<T> boxMax = center + halfSize;
+
+    T cx = std::abs(nv.getX() - boxMin.getX());
+    T fx = std::abs(nv.getX() - boxMax.getX());
+    T cy = std::abs(nv.getY() - boxMin.getY());
+    T fy = std::abs(nv.getY() - boxMax.getY());
+    T cz = std::abs(nv.getZ() - boxMin.getZ());
+    T fz = std::abs(nv.getZ() - boxMax.getZ());
 
     if (cx < epsilon) 
-        return Vector3f(0) - basis[0];
+        return Vector3<T>(0) - basis[0];
     else if (fx < epsilon)
-        return Vector3f(0) + basis[0];
+        return Vector3<T>(0) + basis[0];
     else if (cy < epsilon)
-        return Vector3f(0) - basis[1];
+        return Vector3<T>(0) - basis[1];
     else if (fy < epsilon)
-        return Vector3f(0) + basis[1];
+        return Vector3<T>(0) + basis[1];
     else if (cz < epsilon)
-        return Vector3f(0) - basis[2];
+        return Vector3<T>(0) - basis[2];
     else if (fz < epsilon)
-        return Vector3f(0) + basis[2];
-    return Vector3f(0);
+        return Vector3<T>(0) + basis[2];
+    return Vector3<T>(0);
+}
+
+// Instanciations explicites pour les deux précisions
+template Vector3<float> projectOnBasis(const Vector3<float>&, const std::array<Vector3<float>, 3>&);
+template Vector3<double> projectOnBasis(const Vector3<double>&, const std::array<Vector3<double>, 3>&);
+template float intersectBox(const Ray3<float>&, const Vector3<float>&, const Vector3<float>&, const std::array<Vector3<float>, 3>&);
+template double intersectBox(const Ray3<double>&, const Vector3<double>&, const Vector3<double>&, const std::array<Vector3<double>, 3>&);
+template Vector3<float> boxNormal(const Vector3<float>&, const Vector3<float>&, const Vector3<float>&, const std::array<Vector3<float>, 3>&);
+template Vector3<double> boxNormal(const Vector3<double>&, const Vector3<double>&, const Vector3<double>&, const std::array<Vector3<double>, 3>&);
+
+Vector3f CubeQuad::projectVector(const Vector3f& v) const {
+    return projectOnBasis(v, basis);
+}
+
+Real CubeQuad::is_hit(const Ray3f& ray) const {
+    return intersectBox(ray, center, halfSize, basis);
+}
+
+bool CubeQuad::occludes(const Ray3f& ray, Real distance) const {
+    Real t = intersectBox(ray, center, halfSize, basis);
+    return t > 0 && t < distance;
+}
+
+Vector3f CubeQuad::getNormal(const Vector3f& v) const {
+    return boxNormal(v, center, halfSize, basis);
 }
 
 Ray3f CubeQuad::reflect(const Ray3f& ray) const {
     // Calcul de la position de l'intersection sur le rayon
-    float t = this->is_hit(ray);
+    Real t = this->is_hit(ray);
 
     // Calcul du point d'intersection (= origine du rayon réfléchi)
     Vector3f intersection = ray.pointAt(t);
@@ -111,3 +135,43 @@ bool CubeQuad::isInside(const Vector3f &v) const {
     }
     return true;
 }
+
+Aabb CubeQuad::getBounds() const {
+    // Les coins sont exprimés dans la base du CubeQuad : on les ramène dans le repère du monde
+    Aabb bounds;
+    for (int k = 0; k < 8; k++) {
+        Vector3f local = center + Vector3f((k & 1) ? halfSize[0] : -halfSize[0],
+                                           (k & 2) ? halfSize[1] : -halfSize[1],
+                                           (k & 4) ? halfSize[2] : -halfSize[2]);
+        bounds.extend(basis[0] * local[0] + basis[1] * local[1] + basis[2] * local[2]);
+    }
+    return bounds;
+}
+
+ShapeRecord CubeQuad::getRecord() const {
+    ShapeRecord r = {ShapeRecord::CUBEQUAD, getMaterial(), 0, {}};
+    for (int a = 0; a < 3; a++) {
+        r.params[a] = center[a];
+        r.params[3 + a] = halfSize[a];
+        for (int b = 0; b < 3; b++)
+            r.params[6 + 3*b + a] = basis[b][a];
+    }
+    return r;
+}
+
+SurfaceUV CubeQuad::getUV(const Vector3f& v) const {
+    // Position relative au centre, dans la base de la boîte et en demi-tailles
+    Vector3f local = projectVector(v) - center;
+    Real rel[3];
+    for (int i = 0; i < 3; i++)
+        rel[i] = local[i] / halfSize[i];
+    // La face qui contient le point est celle de l'axe où il est le plus loin du centre
+    int axe = 0;
+    if (std::abs(rel[1]) > std::abs(rel[axe])) axe = 1;
+    if (std::abs(rel[2]) > std::abs(rel[axe])) axe = 2;
+    int a = (axe + 1) % 3, b = (axe + 2) % 3;
+    Real u = (rel[a] + 1) / 2;
+    if (rel[axe] < 0)
+        u = 1 - u;
+    return {u, (rel[b] + 1) / 2, 1 / (2 * std::min(std::abs(halfSize[a]), std::abs(halfSize[b])))};
+}
@@ -14,6 +14,29 @@
 #include "vector3f.h"
 #include "ray3f.h"
 
+// Noyaux de calcul des boîtes orientées, de précision T (instanciés pour float et double).
+// La boîte est définie par son centre et sa moitié de taille exprimés dans sa base basis
+
+/**
+ * @brief Retourne le projeté du vecteur v sur la base basis
+ */
+template <typename T>
+Vector3<T> projectOnBasis(const Vector3<T>& v, const std::array<Vector3<T>, 3>& basis);
+
+/**
+ * @brief Retourne -1 si le rayon ne touche pas la boîte, la distance entre l'origine du
+ * rayon et l'intersection sinon
+ */
+template <typename T>
+T intersectBox(const Ray3<T>& ray, const Vector3<T>& center, const Vector3<T>& halfSize, const std::array<Vector3<T>, 3>& basis);
+
+/**
+ * @brief Retourne la normale sortante de la face sur laquelle se trouve v (à
+ * Epsilon<T>::SURFACE près), le vecteur nul si v n'est sur aucune face
+ */
+template <typename T>
+Vector3<T> boxNormal(const Vector3<T>& v, const Vector3<T>& center, const Vector3<T>& halfSize, const std::array<Vector3<T>, 3>& basis);
+
 /**
  * @brief Classe pour représenter les parallélépipèdes rectangle et les cubes
  *
@@ -48,9 +71,9 @@ class CubeQuad : public Shape {
          *
          * @param center
          * @param halfSize
-         * @param mat
+         * @param mat indice du matériau dans la table de la Scene
          */
-        CubeQuad(const Vector3f &center, const Vector3f &halfSize, Material mat)
+        CubeQuad(const Vector3f &center, const Vector3f &halfSize, MaterialHandle mat)
             : Shape(mat), center(center), halfSize(halfSize), basis(Vector3f::basis()) {}
         
         /**
@@ -58,10 +81,10 @@ class CubeQuad : public Shape {
          * 
          * @param center 
          * @param halfSize 
-         * @param mat
+         * @param mat indice du matériau dans la table de la Scene
          * @param basis 
          */
-        CubeQuad(const Vector3f &center, const Vector3f &halfSize, Material mat, const std::array<Vector3f, 3>& basis)
+        CubeQuad(const Vector3f &center, const Vector3f &halfSize, MaterialHandle mat, const std::array<Vector3f, 3>& basis)
             : Shape(mat), center(center), halfSize(halfSize), basis(basis) {}
 
         /**
@@ -72,7 +95,7 @@ class CubeQuad : public Shape {
          * @param height 
          * @param depth 
          */
-        CubeQuad(const Vector3f &center, float width, float height, float depth, Material mat)
+        CubeQuad(const Vector3f &center, Real width, Real height, Real depth, MaterialHandle mat)
             : CubeQuad(center,Vector3f(width/2,height/2,depth/2), mat) {}
 
         /**
@@ -109,9 +132,18 @@ class CubeQuad : public Shape {
          * la distance entre l'origine du rayon et l'intersection sinon
          * 
          * @param ray 
-         * @return float 
+         * @return Real 
          */
-        float is_hit(const Ray3f &ray) const override;
+        Real is_hit(const Ray3f &ray) const override;
+
+        /**
+         * @brief Retourne vrai si le rayon coupe le CubeQuad avant la distance donnée
+         *
+         * @param ray
+         * @param distance
+         * @return bool
+         */
+        bool occludes(const Ray3f &ray, Real distance) const override;
 
         /**
          * @brief Méthode qui calcule le vecteur normal à un point situé sur une des faces du cube
@@ -129,6 +161,29 @@ class CubeQuad : public Shape {
          */
         bool isInside(const Vector3f &v) const override;
 
+        /**
+         * @brief Retourne la boîte englobante de le CubeQuad dans le repère du monde
+         *
+         * @return Aabb
+         */
+        Aabb getBounds() const override;
+
+        /**
+         * @brief Retourne la description à plat du CubeQuad (centre, demi-taille, base)
+         *
+         * @return ShapeRecord
+         */
+        ShapeRecord getRecord() const override;
+
+        /**
+         * @brief Coordonnées du point sur la face de la boîte qui le contient, de 0 à 1
+         * d'un bord à l'autre de la face
+         *
+         * @param v
+         * @return SurfaceUV
+         */
+        SurfaceUV getUV(const Vector3f& v) const override;
+
         /**
          * @brief Retourne le Ray3f réfléchi par l'intersection avec le CubeQuad (on
          * suppose qu'il y a bien intersection)
@@ -0,0 +1,192 @@
+/**
+ * @file denoiser.cpp
+ * @brief Implémentation du filtre à trous
+ */
+
+#include "denoiser.h"
+#include "parallel.h"
+#include "fastmath.h"
+#include "arena.h"
+#include "alloctracker.h"
+#include <algorithm>
+#include <cmath>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+const int NB_ITERATIONS = 5;          // Pas de 1, 2, 4, 8 puis 16 pixels
+const float SIGMA_LUMINANCE = 6.0;    // Ecart de luminance toléré, en écarts-types du bruit estimé
+const float EPSILON_LUMINANCE = 1e-4; // Ecart toléré dans une zone sans bruit (éclairement ramené vers [0,1])
+const float SIGMA_NORMALE = 0.15;     // Ecart de normales toléré
+const float SIGMA_PROFONDEUR = 0.02;  // Ecart relatif de profondeur toléré
+const float SIGMA_ALBEDO = 0.1;       // Ecart d'albédo toléré
+const float ALBEDO_MIN = 0.01;        // En dessous, la couleur n'est pas divisée par l'albédo
+
+/**
+ * @brief Noyau B3-spline 1D (1/16, 1/4, 3/8, 1/4, 1/16)
+ */
+static const float NOYAU[5] = {1.f/16, 1.f/4, 3.f/8, 1.f/4, 1.f/16};
+
+/**
+ * @brief Plans utilisés par une itération du filtre
+ */
+struct Guides {
+    const float *nx, *ny, *nz, *ar, *ag, *ab, *z, *invZ;
+    const float *lum;       // Luminance de l'éclairement à filtrer
+    const float *var;       // Sa variance
+    const float *invSigma;  // Inverse de l'écart de luminance toléré au pixel
+    float kn, kz, ka;       // Inverses des sigmas au carré
+};
+
+/**
+ * @brief Accumule la contribution du voisin q = p + decalage pour les pixels p de [x0, x1[
+ * de la ligne commençant en l'indice ligne (somme des poids, de l'éclairement pondéré et
+ * de la variance pondérée par le carré des poids)
+ */
+static void accumuleTap(const Guides& g, const float* inR, const float* inG, const float* inB,
+                        std::size_t ligne, long decalage, int x0, int x1, float h,
+                        float* sw, float* sr, float* sg, float* sb, float* sv) {
+    int x = x0;
+#if defined(__SSE2__)
+    const __m128 kn = _mm_set1_ps(g.kn), kz = _mm_set1_ps(g.kz), ka = _mm_set1_ps(g.ka);
+    const __m128 vh = _mm_set1_ps(h), signe = _mm_set1_ps(-0.f);
+    for (; x + 4 <= x1; x += 4) {
+        std::size_t p = ligne + x, q = p + decalage;
+        __m128 d;
+        d = _mm_andnot_ps(signe, _mm_sub_ps(_mm_loadu_ps(g.lum + p), _mm_loadu_ps(g.lum + q)));
+        __m128 dl = _mm_mul_ps(d, _mm_loadu_ps(g.invSigma + p));
+        d = _mm_sub_ps(_mm_loadu_ps(g.nx + p), _mm_loadu_ps(g.nx + q)); __m128 dn = _mm_mul_ps(d, d);
+        d = _mm_sub_ps(_mm_loadu_ps(g.ny + p), _mm_loadu_ps(g.ny + q)); dn = _mm_add_ps(dn, _mm_mul_ps(d, d));
+        d = _mm_sub_ps(_mm_loadu_ps(g.nz + p), _mm_loadu_ps(g.nz + q)); dn = _mm_add_ps(dn, _mm_mul_ps(d, d));
+        d = _mm_sub_ps(_mm_loadu_ps(g.ar + p), _mm_loadu_ps(g.ar + q)); __m128 da = _mm_mul_ps(d, d);
+        d = _mm_sub_ps(_mm_loadu_ps(g.ag + p), _mm_loadu_ps(g.ag + q)); da = _mm_add_ps(da, _mm_mul_ps(d, d));
+        d = _mm_sub_ps(_mm_loadu_ps(g.ab + p), _mm_loadu_ps(g.ab + q)); da = _mm_add_ps(da, _mm_mul_ps(d, d));
+        d = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(g.z + p), _mm_loadu_ps(g.z + q)), _mm_loadu_ps(g.invZ + p));
+        __m128 dz = _mm_mul_ps(d, d);
+        __m128 e = _mm_add_ps(_mm_add_ps(dl, _mm_mul_ps(dn, kn)), _mm_add_ps(_mm_mul_ps(dz, kz), _mm_mul_ps(da, ka)));
+        __m128 w = _mm_mul_ps(vh, mathExp4(_mm_sub_ps(_mm_setzero_ps(), e), MATH_FAST));
+        _mm_storeu_ps(sw + x, _mm_add_ps(_mm_loadu_ps(sw + x), w));
+        _mm_storeu_ps(sr + x, _mm_add_ps(_mm_loadu_ps(sr + x), _mm_mul_ps(w, _mm_loadu_ps(inR + q))));
+        _mm_storeu_ps(sg + x, _mm_add_ps(_mm_loadu_ps(sg + x), _mm_mul_ps(w, _mm_loadu_ps(inG + q))));
+        _mm_storeu_ps(sb + x, _mm_add_ps(_mm_loadu_ps(sb + x), _mm_mul_ps(w, _mm_loadu_ps(inB + q))));
+        _mm_storeu_ps(sv + x, _mm_add_ps(_mm_loadu_ps(sv + x), _mm_mul_ps(_mm_mul_ps(w, w), _mm_loadu_ps(g.var + q))));
+    }
+#endif
+    for (; x < x1; x++) {
+        std::size_t p = ligne + x, q = p + decalage;
+        float dl = std::abs(g.lum[p] - g.lum[q]) * g.invSigma[p];
+        float dnx = g.nx[p] - g.nx[q], dny = g.ny[p] - g.ny[q], dnz = g.nz[p] - g.nz[q];
+        float dar = g.ar[p] - g.ar[q], dag = g.ag[p] - g.ag[q], dab = g.ab[p] - g.ab[q];
+        float dz = (g.z[p] - g.z[q]) * g.invZ[p];
+        float e = dl + (dnx*dnx + dny*dny + dnz*dnz) * g.kn + dz*dz * g.kz + (dar*dar + dag*dag + dab*dab) * g.ka;
+        float w = h * mathExp(-e, MATH_FAST);
+        sw[x] += w;
+        sr[x] += w * inR[q];
+        sg[x] += w * inG[q];
+        sb[x] += w * inB[q];
+        sv[x] += w * w * g.var[q];
+    }
+}
+
+/**
+ * @brief Luminance des plans r, g, b
+ */
+static inline float luminance(float r, float g, float b) {
+    return 0.2126f * r + 0.7152f * g + 0.0722f * b;
+}
+
+void denoise(Framebuffer& fb, int nbThreads) {
+    int width = fb.getWidth(), height = fb.getHeight();
+    std::size_t n = fb.getSize();
+
+    // Démodulation : on filtre l'éclairement (couleur / albédo), ramené vers [0,1], et
+    // sa variance (celle de la luminance du pixel, divisée par le carré de la luminance
+    // de l'albédo)
+    std::vector<float> modR(n), modG(n), modB(n), invZ(n), lum(n), invSigma(n);
+    std::vector<float> pingR(n), pingG(n), pingB(n), pingV(n), pongR(n), pongG(n), pongB(n), pongV(n);
+    for (std::size_t k = 0; k < n; k++) {
+        modR[k] = (fb.albedoR[k] > ALBEDO_MIN ? fb.albedoR[k] : 1.f) * 255;
+        modG[k] = (fb.albedoG[k] > ALBEDO_MIN ? fb.albedoG[k] : 1.f) * 255;
+        modB[k] = (fb.albedoB[k] > ALBEDO_MIN ? fb.albedoB[k] : 1.f) * 255;
+        pingR[k] = fb.r[k] / modR[k];
+        pingG[k] = fb.g[k] / modG[k];
+        pingB[k] = fb.b[k] / modB[k];
+        float l = luminance(modR[k], modG[k], modB[k]);
+        pingV[k] = fb.variance[k] / (l * l);
+        invZ[k] = 1 / std::max(fb.depth[k], 1e-6f);
+    }
+
+    Guides g = {fb.normalX.data(), fb.normalY.data(), fb.normalZ.data(),
+                fb.albedoR.data(), fb.albedoG.data(), fb.albedoB.data(),
+                fb.depth.data(), invZ.data(), lum.data(), nullptr, invSigma.data(), 0, 0, 0};
+    g.kn = 1 / (SIGMA_NORMALE * SIGMA_NORMALE);
+    g.kz = 1 / (SIGMA_PROFONDEUR * SIGMA_PROFONDEUR);
+    g.ka = 1 / (SIGMA_ALBEDO * SIGMA_ALBEDO);
+
+    for (int it = 0; it < NB_ITERATIONS; it++) {
+        int pas = 1 << it;
+        g.var = pingV.data();
+
+        // Ecart toléré : la variance, lissée sur les 3x3 voisins pour être moins bruitée,
+        // diminue à chaque itération avec le filtrage
+        parallelFor(height, nbThreads, [&](int y) {
+            std::size_t ligne = std::size_t(y) * width;
+            for (int x = 0; x < width; x++) {
+                float v = 0, poids = 0;
+                for (int dy = -1; dy <= 1; dy++) {
+                    int yq = std::min(std::max(y + dy, 0), height - 1);
+                    for (int dx = -1; dx <= 1; dx++) {
+                        int xq = std::min(std::max(x + dx, 0), width - 1);
+                        float h = (dx == 0 ? 0.5f : 0.25f) * (dy == 0 ? 0.5f : 0.25f);
+                        v += h * pingV[std::size_t(yq) * width + xq];
+                        poids += h;
+                    }
+                }
+                std::size_t p = ligne + x;
+                lum[p] = luminance(pingR[p], pingG[p], pingB[p]);
+                invSigma[p] = 1 / (SIGMA_LUMINANCE * std::sqrt(v / poids) + EPSILON_LUMINANCE);
+            }
+        });
+
+        parallelFor(height, nbThreads, [&](int y) {
+            HotPathScope critique;
+            ScratchScope travail;
+            float *sw = travail.array<float>(width), *sr = travail.array<float>(width);
+            float *sg = travail.array<float>(width), *sb = travail.array<float>(width);
+            float *sv = travail.array<float>(width);
+            std::size_t ligne = std::size_t(y) * width;
+            for (int dy = -2; dy <= 2; dy++) {
+                int yq = y + dy * pas;
+                if (yq < 0 || yq >= height)
+                    continue;
+                for (int dx = -2; dx <= 2; dx++) {
+                    int ox = dx * pas;
+                    // Pixels de la ligne dont le voisin est dans l'image
+                    int x0 = std::max(0, -ox), x1 = std::min(width, width - ox);
+                    if (x0 >= x1)
+                        continue;
+                    long decalage = long(yq - y) * width + ox;
+                    accumuleTap(g, pingR.data(), pingG.data(), pingB.data(), ligne, decalage, x0, x1,
+                                NOYAU[dy + 2] * NOYAU[dx + 2], sw, sr, sg, sb, sv);
+                }
+            }
+            for (int x = 0; x < width; x++) {
+                pongR[ligne + x] = sr[x] / sw[x];
+                pongG[ligne + x] = sg[x] / sw[x];
+                pongB[ligne + x] = sb[x] / sw[x];
+                pongV[ligne + x] = sv[x] / (sw[x] * sw[x]);
+            }
+        });
+        std::swap(pingR, pongR);
+        std::swap(pingG, pongG);
+        std::swap(pingB, pongB);
+        std::swap(pingV, pongV);
+    }
+
+    // Remodulation par l'albédo
+    for (std::size_t k = 0; k < n; k++) {
+        fb.r[k] = std::min(pingR[k] * modR[k], 255.f);
+        fb.g[k] = std::min(pingG[k] * modG[k], 255.f);
+        fb.b[k] = std::min(pingB[k] * modB[k], 255.f);
+    }
+}
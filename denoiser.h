@@ -0,0 +1,27 @@
+/**
+ * @file denoiser.h
+ * @brief Débruitage des images du tracé de chemins
+ */
+#ifndef DENOISER_H
+#define DENOISER_H
+
+#include "framebuffer.h"
+
+/**
+ * @brief Débruite la couleur du Framebuffer avec un filtre en ondelettes "à trous"
+ * (Dammertz et al. 2010) guidé par l'albédo, la normale et la profondeur, et par la
+ * variance de chaque pixel à la manière de SVGF (Schied et al. 2017). La couleur est
+ * d'abord divisée par l'albédo pour ne filtrer que l'éclairement (les textures et les
+ * bords de couleur restent nets), puis filtrée 5 fois par un noyau 5x5 dont le pas
+ * double à chaque itération. Un voisin est écarté quand sa luminance s'éloigne de
+ * celle du pixel de plus de quelques écarts-types du bruit estimé au pixel ; la
+ * variance est filtrée avec l'image, si bien que le filtre s'adoucit au fil des
+ * itérations là où le bruit a été réduit. Les lignes sont réparties sur plusieurs
+ * threads et les pixels d'une ligne sont traités 4 par 4 (SSE)
+ *
+ * @param fb image à débruiter (tampons auxiliaires et variance remplis)
+ * @param nbThreads nombre de threads (<= 0 : tous les coeurs)
+ */
+void denoise(Framebuffer& fb, int nbThreads = 0);
+
+#endif
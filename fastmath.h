@@ -0,0 +1,297 @@
+/**
+ * @file fastmath.h
+ * @brief Fonctions mathématiques de l'ombrage (exp, pow, rsqrt, normalisation) en trois
+ * niveaux de précision, scalaires et SSE
+ */
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+#include "vector3f.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief Niveau de précision des calculs d'ombrage, choisi pour chaque rendu. Les bornes
+ * sont des erreurs relatives maximales mesurées sur tout le domaine indiqué :
+ *
+ * MATH_EXACT : bibliothèque standard (std::exp, std::pow, 1/std::sqrt), pour les rendus
+ * de référence.
+ * MATH_FAST : exp < 1e-7 sur [-80, 80], pow < 2e-6 pour x dans [1e-6, 1] et y dans
+ * [0, 1] (shininess des matériaux), < 1.1e-5 pour y jusqu'à 16, rsqrt < 3e-7 :
+ * invisible sur une image 8 bits.
+ * MATH_FASTEST : exp < 3.3e-3, pow < 8.5e-3 pour y dans [0, 1] (1e-1 pour y jusqu'à 16),
+ * rsqrt < 3.3e-4 : pour la prévisualisation, l'écart sur une couleur reste de l'ordre
+ * d'un à deux niveaux sur 255.
+ *
+ * Les versions SSE (suffixe 4) font les mêmes calculs que les versions scalaires,
+ * 4 valeurs à la fois, et donnent les mêmes résultats
+ */
+enum MathTier { MATH_EXACT, MATH_FAST, MATH_FASTEST };
+
+/**
+ * @brief 2^e pour e entier dans [-126, 127] (exposant IEEE)
+ */
+inline float puissanceDeux(int32_t e) {
+    int32_t bits = (e + 127) << 23;
+    float r;
+    std::memcpy(&r, &bits, sizeof(float));
+    return r;
+}
+
+/**
+ * @brief exp(x), x ramené à [-80, 80] pour les niveaux approchés. MATH_FAST : réduction
+ * de Cody et Waite x = n ln2 + r, |r| <= ln2/2, et polynôme de degré 7 en r (celui de
+ * expf de Cephes) ; MATH_FASTEST : 2^x = 2^partie entière * 2^partie fractionnaire,
+ * polynôme de degré 2. 2^n est posé directement dans l'exposant IEEE
+ *
+ * @param x
+ * @param tier
+ * @return float
+ */
+inline float mathExp(float x, MathTier tier) {
+    if (tier == MATH_EXACT)
+        return std::exp(x);
+    x = std::min(std::max(x, -80.f), 80.f);
+    if (tier == MATH_FAST) {
+        float n = std::floor(x * 1.44269504f + 0.5f);
+        float r = x - n * 0.693359375f + n * 2.12194440e-4f;
+        float p = 1.9875691500e-4f;
+        p = p*r + 1.3981999507e-3f;
+        p = p*r + 8.3334519073e-3f;
+        p = p*r + 4.1665795894e-2f;
+        p = p*r + 1.6666665459e-1f;
+        p = p*r + 5.0000001201e-1f;
+        return (p*r*r + r + 1.f) * puissanceDeux(int32_t(n));
+    }
+    float t = x * 1.44269504f;
+    float e = std::floor(t);
+    float f = t - e;
+    return (1.f + f*(0.656366f + f*0.343634f)) * puissanceDeux(int32_t(e));
+}
+
+/**
+ * @brief log2(x) pour x > 0 normal : exposant IEEE, plus log2 de la mantisse m ramenée à
+ * [sqrt(2)/2, sqrt(2)[ par la série de atanh en (m-1)/(m+1) (MATH_FAST), ou un polynôme
+ * de degré 2 en m-1 sur [1, 2[ (MATH_FASTEST)
+ *
+ * @param x
+ * @param tier
+ * @return float erreur absolue < 1.1e-6 (MATH_FAST, arrondi de la somme finale), < 8e-3
+ * (MATH_FASTEST)
+ */
+inline float mathLog2(float x, MathTier tier) {
+    if (tier == MATH_EXACT)
+        return std::log2(x);
+    int32_t bits;
+    std::memcpy(&bits, &x, sizeof(float));
+    int32_t e = ((bits >> 23) & 0xff) - 127;
+    if (tier == MATH_FASTEST) {
+        bits = (bits & 0x007fffff) | 0x3f800000;
+        float m;
+        std::memcpy(&m, &bits, sizeof(float));
+        float u = m - 1.f;
+        return float(e) + u * (1.346944f - 0.346944f * u);
+    }
+    // Mantisse dans [sqrt(2)/2, sqrt(2)[ (le point de bascule est la mantisse de sqrt(2))
+    int32_t haute = (bits & 0x007fffff) > 0x3504f3;
+    e += haute;
+    bits = (bits & 0x007fffff) | ((127 - haute) << 23);
+    float m;
+    std::memcpy(&m, &bits, sizeof(float));
+    float y = (m - 1.f) / (m + 1.f), y2 = y * y;
+    return float(e) + y * (2.88539008f + y2*(0.961796694f + y2*(0.577078016f + y2*0.412198583f)));
+}
+
+/**
+ * @brief x^y pour x >= 0 (0^y vaut 0 pour y > 0 et 1 pour y = 0), calculé en 2^(y log2 x)
+ * en float pour les niveaux approchés (les x sous-normaux sont ramenés à 0), dans la
+ * précision de Real pour MATH_EXACT
+ *
+ * @param x
+ * @param y
+ * @param tier
+ * @return Real
+ */
+inline Real mathPow(Real x, Real y, MathTier tier) {
+    if (tier == MATH_EXACT)
+        return std::pow(x, y);
+    if (y == 0)
+        return 1;
+    if (!(x >= Real(1.17549435e-38f)))
+        return 0;
+    return mathExp(float(y) * mathLog2(float(x), tier) * 0.693147181f, tier);
+}
+
+/**
+ * @brief 1/sqrt(x) pour x > 0 : estimation matérielle (rsqrtss, 12 bits) seule pour
+ * MATH_FASTEST, suivie d'une itération de Newton pour MATH_FAST. Sans SSE, l'estimation
+ * vient de la constante 0x5f375a86 et d'une itération de Newton de plus
+ *
+ * @param x
+ * @param tier
+ * @return float
+ */
+inline float mathRsqrt(float x, MathTier tier) {
+    if (tier == MATH_EXACT)
+        return 1.f / std::sqrt(x);
+#if defined(__SSE2__)
+    float r = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+#else
+    int32_t bits;
+    std::memcpy(&bits, &x, sizeof(float));
+    bits = 0x5f375a86 - (bits >> 1);
+    float r;
+    std::memcpy(&r, &bits, sizeof(float));
+    r = r * (1.5f - 0.5f * x * r * r);
+#endif
+    if (tier == MATH_FAST)
+        r = r * (1.5f - 0.5f * x * r * r);
+    return r;
+}
+
+/**
+ * @brief Vecteur normalisé (le vecteur nul reste nul). Avec -DRAYTRACER_DOUBLE, les
+ * niveaux approchés ajoutent une itération de Newton en double, leur erreur reste
+ * celle de float
+ *
+ * @param v
+ * @param tier
+ * @return Vector3f
+ */
+inline Vector3f mathNormalize(const Vector3f& v, MathTier tier) {
+    if (tier == MATH_EXACT)
+        return v.normalized();
+    Real n2 = v.squaredNorm();
+    if (!(n2 > 0))
+        return v;
+    Real r = mathRsqrt(float(n2), tier);
+#ifdef RAYTRACER_DOUBLE
+    r = r * (1.5 - 0.5 * n2 * r * r);
+#endif
+    return v * r;
+}
+
+#if defined(__SSE2__)
+/**
+ * @brief Version SSE de mathExp (niveaux approchés)
+ */
+inline __m128 mathExp4(__m128 x, MathTier tier) {
+    if (tier == MATH_EXACT) {
+        alignas(16) float v[4];
+        _mm_store_ps(v, x);
+        for (float& c : v)
+            c = std::exp(c);
+        return _mm_load_ps(v);
+    }
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-80.f)), _mm_set1_ps(80.f));
+    __m128 t, e, p;
+    if (tier == MATH_FAST)
+        t = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504f)), _mm_set1_ps(0.5f));
+    else
+        t = _mm_mul_ps(x, _mm_set1_ps(1.44269504f));
+    // Partie entière par défaut (on corrige la troncature vers zéro des t négatifs)
+    e = _mm_cvtepi32_ps(_mm_cvttps_epi32(t));
+    e = _mm_sub_ps(e, _mm_and_ps(_mm_cmpgt_ps(e, t), _mm_set1_ps(1.f)));
+    if (tier == MATH_FAST) {
+        __m128 r = _mm_add_ps(_mm_sub_ps(x, _mm_mul_ps(e, _mm_set1_ps(0.693359375f))), _mm_mul_ps(e, _mm_set1_ps(2.12194440e-4f)));
+        p = _mm_set1_ps(1.9875691500e-4f);
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(1.3981999507e-3f));
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(8.3334519073e-3f));
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(4.1665795894e-2f));
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(1.6666665459e-1f));
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(5.0000001201e-1f));
+        p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, r), r), r), _mm_set1_ps(1.f));
+    } else {
+        __m128 f = _mm_sub_ps(t, e);
+        p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.343634f), f), _mm_set1_ps(0.656366f));
+        p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.f));
+    }
+    __m128i bits = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(e), _mm_set1_epi32(127)), 23);
+    return _mm_mul_ps(p, _mm_castsi128_ps(bits));
+}
+
+/**
+ * @brief Version SSE de mathLog2 (niveaux approchés)
+ */
+inline __m128 mathLog24(__m128 x, MathTier tier) {
+    if (tier == MATH_EXACT) {
+        alignas(16) float v[4];
+        _mm_store_ps(v, x);
+        for (float& c : v)
+            c = std::log2(c);
+        return _mm_load_ps(v);
+    }
+    __m128i bits = _mm_castps_si128(x);
+    __m128i mantisse = _mm_and_si128(bits, _mm_set1_epi32(0x007fffff));
+    __m128i e = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(bits, 23), _mm_set1_epi32(0xff)), _mm_set1_epi32(127));
+    if (tier == MATH_FASTEST) {
+        __m128 u = _mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(mantisse, _mm_set1_epi32(0x3f800000))), _mm_set1_ps(1.f));
+        __m128 p = _mm_sub_ps(_mm_set1_ps(1.346944f), _mm_mul_ps(_mm_set1_ps(0.346944f), u));
+        return _mm_add_ps(_mm_cvtepi32_ps(e), _mm_mul_ps(u, p));
+    }
+    // haute vaut -1 (tous les bits) quand la mantisse dépasse celle de sqrt(2)
+    __m128i haute = _mm_cmpgt_epi32(mantisse, _mm_set1_epi32(0x3504f3));
+    e = _mm_sub_epi32(e, haute);
+    __m128i exposant = _mm_add_epi32(_mm_set1_epi32(127 << 23), _mm_slli_epi32(haute, 23));
+    __m128 m = _mm_castsi128_ps(_mm_or_si128(mantisse, exposant));
+    __m128 y = _mm_div_ps(_mm_sub_ps(m, _mm_set1_ps(1.f)), _mm_add_ps(m, _mm_set1_ps(1.f)));
+    __m128 y2 = _mm_mul_ps(y, y);
+    __m128 p = _mm_set1_ps(0.412198583f);
+    p = _mm_add_ps(_mm_mul_ps(p, y2), _mm_set1_ps(0.577078016f));
+    p = _mm_add_ps(_mm_mul_ps(p, y2), _mm_set1_ps(0.961796694f));
+    p = _mm_add_ps(_mm_mul_ps(p, y2), _mm_set1_ps(2.88539008f));
+    return _mm_add_ps(_mm_cvtepi32_ps(e), _mm_mul_ps(y, p));
+}
+
+/**
+ * @brief Version SSE de mathPow (niveaux approchés)
+ */
+inline __m128 mathPow4(__m128 x, __m128 y, MathTier tier) {
+    if (tier == MATH_EXACT) {
+        alignas(16) float vx[4], vy[4];
+        _mm_store_ps(vx, x);
+        _mm_store_ps(vy, y);
+        for (int k = 0; k < 4; k++)
+            vx[k] = std::pow(vx[k], vy[k]);
+        return _mm_load_ps(vx);
+    }
+    __m128 r = mathExp4(_mm_mul_ps(_mm_mul_ps(y, mathLog24(x, tier)), _mm_set1_ps(0.693147181f)), tier);
+    // x trop petit (ou négatif) : 0, y nul : 1
+    r = _mm_and_ps(r, _mm_cmpge_ps(x, _mm_set1_ps(1.17549435e-38f)));
+    __m128 nul = _mm_cmpeq_ps(y, _mm_setzero_ps());
+    return _mm_or_ps(_mm_andnot_ps(nul, r), _mm_and_ps(nul, _mm_set1_ps(1.f)));
+}
+
+/**
+ * @brief Version SSE de mathRsqrt
+ */
+inline __m128 mathRsqrt4(__m128 x, MathTier tier) {
+    if (tier == MATH_EXACT)
+        return _mm_div_ps(_mm_set1_ps(1.f), _mm_sqrt_ps(x));
+    __m128 r = _mm_rsqrt_ps(x);
+    if (tier == MATH_FAST) {
+        __m128 xrr = _mm_mul_ps(_mm_mul_ps(x, r), r);
+        r = _mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_set1_ps(0.5f), xrr)));
+    }
+    return r;
+}
+
+/**
+ * @brief Normalise 4 vecteurs rangés par composantes (x, y, z), sur place ; les vecteurs
+ * nuls restent nuls
+ */
+inline void mathNormalize4(__m128& x, __m128& y, __m128& z, MathTier tier) {
+    __m128 n2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+    __m128 r = _mm_and_ps(mathRsqrt4(n2, tier), _mm_cmpgt_ps(n2, _mm_setzero_ps()));
+    x = _mm_mul_ps(x, r);
+    y = _mm_mul_ps(y, r);
+    z = _mm_mul_ps(z, r);
+}
+#endif
+
+#endif
@@ -0,0 +1,40 @@
+/**
+ * @file framebuffer.cpp
+ * @brief Implémentation de la classe Framebuffer
+ */
+
+#include "framebuffer.h"
+#include <algorithm>
+
+Framebuffer::Framebuffer(int width, int height)
+    : r(std::size_t(width) * height), g(r.size()), b(r.size()),
+      albedoR(r.size()), albedoG(r.size()), albedoB(r.size()),
+      normalX(r.size()), normalY(r.size()), normalZ(r.size()),
+      depth(r.size(), PROFONDEUR_FOND), variance(r.size()), shape(r.size(), -1), _width(width), _height(height) {}
+
+void Framebuffer::getRGB(int y0, int rows, float* rgb) const {
+    std::size_t begin = std::size_t(y0) * _width;
+    std::size_t end = begin + std::size_t(rows) * _width;
+    for (std::size_t k = begin; k < end; k++) {
+        *rgb++ = r[k];
+        *rgb++ = g[k];
+        *rgb++ = b[k];
+    }
+}
+
+void Framebuffer::copyRect(const Framebuffer& src, int x0, int y0, int x1, int y1) {
+    std::vector<float> Framebuffer::* plans[] = {&Framebuffer::r, &Framebuffer::g, &Framebuffer::b,
+                                                 &Framebuffer::albedoR, &Framebuffer::albedoG, &Framebuffer::albedoB,
+                                                 &Framebuffer::normalX, &Framebuffer::normalY, &Framebuffer::normalZ,
+                                                 &Framebuffer::depth, &Framebuffer::variance};
+    for (auto plan : plans) {
+        for (int j = y0; j < y1; j++) {
+            std::size_t k = std::size_t(j) * _width;
+            std::copy((src.*plan).begin() + k + x0, (src.*plan).begin() + k + x1, (this->*plan).begin() + k + x0);
+        }
+    }
+    for (int j = y0; j < y1; j++) {
+        std::size_t k = std::size_t(j) * _width;
+        std::copy(src.shape.begin() + k + x0, src.shape.begin() + k + x1, shape.begin() + k + x0);
+    }
+}
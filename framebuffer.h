@@ -0,0 +1,88 @@
+/**
+ * @file framebuffer.h
+ * @brief Création de la classe Framebuffer (image et tampons auxiliaires)
+ */
+
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Image complète rangée par plans (un tableau par composante) : la couleur,
+ * et les tampons auxiliaires écrits par les rayons primaires (albédo, normale,
+ * profondeur, objet) qui guident le débruitage et la reconstruction des pixels non tracés. Le rangement par plans permet de traiter
+ * plusieurs pixels consécutifs à la fois (SIMD)
+ *
+ */
+class Framebuffer {
+
+    public:
+        /**
+         * @brief Profondeur enregistrée quand le rayon primaire ne touche rien
+         */
+        static constexpr float PROFONDEUR_FOND = 1e10f;
+
+        /**
+         * @brief Construit un Framebuffer noir de dimensions width x height
+         *
+         * @param width
+         * @param height
+         */
+        Framebuffer(int width, int height);
+
+        inline int getWidth() const {return _width;};
+        inline int getHeight() const {return _height;};
+        inline std::size_t getSize() const {return std::size_t(_width) * _height;};
+
+        /**
+         * @brief Recopie les lignes [y0, y0+rows[ de la couleur en RGB entrelacé
+         *
+         * @param y0
+         * @param rows
+         * @param rgb tampon de rows*width*3 flottants
+         */
+        void getRGB(int y0, int rows, float* rgb) const;
+
+        /**
+         * @brief Recopie tous les plans du rectangle [x0, x1[ x [y0, y1[ d'un Framebuffer
+         * de mêmes dimensions
+         *
+         * @param src
+         * @param x0
+         * @param y0
+         * @param x1
+         * @param y1
+         */
+        void copyRect(const Framebuffer& src, int x0, int y0, int x1, int y1);
+
+        /**
+         * @brief Plans de couleur (entre 0 et 255)
+         */
+        std::vector<float> r, g, b;
+
+        /**
+         * @brief Plans auxiliaires : albédo (entre 0 et 1), normale et profondeur
+         * au premier impact
+         */
+        std::vector<float> albedoR, albedoG, albedoB;
+        std::vector<float> normalX, normalY, normalZ;
+        std::vector<float> depth;
+
+        /**
+         * @brief Variance de la luminance du pixel, estimée sur ses échantillons (tracé de
+         * chemins, 0 sinon) : règle la force du débruitage pixel par pixel
+         */
+        std::vector<float> variance;
+
+        /**
+         * @brief Objet touché au premier impact (indice dans Scene::getShapes(), -1 : fond)
+         */
+        std::vector<int> shape;
+
+    private:
+        int _width, _height;
+};
+
+#endif
@@ -0,0 +1,26 @@
+/**
+ * @file gbuffer.cpp
+ * @brief Implémentation de la classe GBuffer
+ */
+
+#include "gbuffer.h"
+
+void GBufferLayer::resize(std::size_t n) {
+    shape.assign(n, -1);
+    material.assign(n, -1);
+    px.assign(n, 0);
+    py.assign(n, 0);
+    pz.assign(n, 0);
+    nx.assign(n, 0);
+    ny.assign(n, 0);
+    nz.assign(n, 0);
+    u.assign(n, 0);
+    v.assign(n, 0);
+    footprint.assign(n, 0);
+    lit.assign(n, 0);
+}
+
+GBuffer::GBuffer(int width, int height, int nbLayers) : _width(width), _height(height), _layers(nbLayers) {
+    for (GBufferLayer& layer : _layers)
+        layer.resize(getSize());
+}
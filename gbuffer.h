@@ -0,0 +1,70 @@
+/**
+ * @file gbuffer.h
+ * @brief Création de la classe GBuffer (impacts conservés pour l'éclairage différé)
+ */
+
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+#include "precision.h"
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Impacts d'un niveau de rayons (primaires, puis réfléchis), rangés par plans.
+ * Un objet -1 indique que le rayon du pixel ne touche rien à ce niveau
+ */
+struct GBufferLayer {
+    std::vector<int> shape;             // Indice de l'objet touché dans Scene::getShapes()
+    std::vector<int> material;          // Handle de son matériau
+    std::vector<Real> px, py, pz;       // Point d'intersection
+    std::vector<Real> nx, ny, nz;       // Normale orientée utilisée pour l'ombrage
+    std::vector<Real> u, v, footprint;  // Coordonnées de texture et empreinte du pixel (matériaux texturés)
+    std::vector<float> lit;             // Fraction visible de la source depuis le point
+
+    /**
+     * @brief Dimensionne les plans pour n pixels, sans impact
+     *
+     * @param n
+     */
+    void resize(std::size_t n);
+};
+
+/**
+ * @brief G-buffer de l'éclairage différé : pour chaque pixel, l'impact du rayon primaire
+ * et ceux des rayons réfléchis successifs (autant que de niveaux de récursion). La
+ * géométrie ne dépendant ni des matériaux ni de la source, une modification de matériau
+ * ou des coefficients d'ombrage se recalcule sans aucun rayon, et un déplacement de la
+ * source ne relance que les rayons d'ombre
+ *
+ */
+class GBuffer {
+
+    public:
+        /**
+         * @brief Construit un G-buffer vide de dimensions width x height, avec nbLayers
+         * niveaux (le rayon primaire et nbLayers-1 réflexions)
+         *
+         * @param width
+         * @param height
+         * @param nbLayers
+         */
+        GBuffer(int width, int height, int nbLayers);
+
+        inline int getWidth() const {return _width;};
+        inline int getHeight() const {return _height;};
+        inline std::size_t getSize() const {return std::size_t(_width) * _height;};
+        inline int getNbLayers() const {return _layers.size();};
+
+        /**
+         * @brief Accès au niveau n (0 : rayons primaires)
+         */
+        inline GBufferLayer& getLayer(int n) {return _layers[n];};
+        inline const GBufferLayer& getLayer(int n) const {return _layers[n];};
+
+    private:
+        int _width, _height;
+        std::vector<GBufferLayer> _layers;
+};
+
+#endif
@@ -0,0 +1,158 @@
+/**
+ * @file imagefile.cpp
+ * @brief Implémentation des classes ImageFile et BandWriter
+ */
+
+#include "imagefile.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+ImageFile::Format ImageFile::formatFromName(const std::string& filename) {
+    std::size_t dot = filename.rfind('.');
+    std::string extension = dot == std::string::npos ? "" : filename.substr(dot);
+    if (extension == ".pfm" || extension == ".PFM")
+        return PFM;
+    if (extension == ".ppm" || extension == ".PPM")
+        return PPM;
+    throw std::runtime_error("Extension inconnue pour " + filename + " (.ppm ou .pfm attendu)");
+}
+
+ImageFile::ImageFile(const std::string& filename, int width, int height, Format format)
+    : _width(width), _height(height), _format(format), _fd(-1), _data(nullptr) {
+    // En-tête : le PFM indique le boutisme par le signe de l'échelle
+    std::string header;
+    if (format == PPM) {
+        header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+        _pixelSize = 3;
+    } else {
+        uint16_t one = 1;
+        bool littleEndian = *reinterpret_cast<unsigned char*>(&one) == 1;
+        header = "PF\n" + std::to_string(width) + " " + std::to_string(height) + "\n" + (littleEndian ? "-1.0\n" : "1.0\n");
+        _pixelSize = 3 * sizeof(float);
+    }
+    _headerSize = header.size();
+    _size = _headerSize + std::size_t(width) * height * _pixelSize;
+
+    _fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (_fd < 0)
+        throw std::runtime_error("Impossible de créer le fichier " + filename);
+    // Préallocation à la taille finale (fichier creux)
+    if (ftruncate(_fd, _size) != 0) {
+        close(_fd);
+        throw std::runtime_error("Impossible de dimensionner le fichier " + filename);
+    }
+    void* p = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (p == MAP_FAILED) {
+        close(_fd);
+        throw std::runtime_error("La projection en mémoire de " + filename + " a échoué");
+    }
+    _data = static_cast<unsigned char*>(p);
+    std::memcpy(_data, header.data(), _headerSize);
+}
+
+ImageFile::~ImageFile() {
+    if (_data != nullptr) {
+        msync(_data, _size, MS_SYNC);
+        munmap(_data, _size);
+    }
+    if (_fd >= 0)
+        close(_fd);
+}
+
+void ImageFile::writeRows(int y0, int rows, const float* rgb) {
+    std::size_t rowSize = std::size_t(_width) * _pixelSize;
+    for (int r = 0; r < rows; r++) {
+        // Le PFM range les lignes de bas en haut
+        int y = (_format == PFM) ? _height - 1 - (y0 + r) : y0 + r;
+        unsigned char* dst = _data + _headerSize + std::size_t(y) * rowSize;
+        const float* src = rgb + std::size_t(r) * _width * 3;
+        if (_format == PPM) {
+            for (int k = 0; k < _width * 3; k++)
+                dst[k] = (unsigned char) std::min(std::max(src[k], 0.f), 255.f);
+        } else {
+            float* fdst = reinterpret_cast<float*>(dst);
+            for (int k = 0; k < _width * 3; k++)
+                fdst[k] = src[k] / 255;
+        }
+    }
+
+    // On rend au système les pages entièrement écrites de la bande
+    int yFirst = (_format == PFM) ? _height - y0 - rows : y0;
+    std::size_t begin = _headerSize + std::size_t(yFirst) * rowSize;
+    std::size_t end = begin + std::size_t(rows) * rowSize;
+    std::size_t page = sysconf(_SC_PAGESIZE);
+    begin = (begin + page - 1) / page * page;
+    end = end / page * page;
+    if (end > begin) {
+        msync(_data + begin, end - begin, MS_ASYNC);
+        madvise(_data + begin, end - begin, MADV_DONTNEED);
+    }
+}
+
+BandWriter::BandWriter(ImageFile& file, int bandHeight, int nbBuffers, int nbWriters)
+    : _file(file), _buffers(nbBuffers), _done(false) {
+    for (std::vector<float>& b : _buffers) {
+        b.resize(std::size_t(bandHeight) * file.getWidth() * 3);
+        _free.push_back(&b);
+    }
+    for (int k = 0; k < nbWriters; k++)
+        _writers.emplace_back(&BandWriter::writerLoop, this);
+}
+
+BandWriter::~BandWriter() {
+    finish();
+}
+
+std::vector<float>* BandWriter::acquire() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _freeCond.wait(lock, [this] { return !_free.empty(); });
+    std::vector<float>* b = _free.back();
+    _free.pop_back();
+    return b;
+}
+
+void BandWriter::submit(int y0, int rows, std::vector<float>* buffer) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pending.push_back({y0, rows, buffer});
+    }
+    _pendingCond.notify_one();
+}
+
+void BandWriter::writerLoop() {
+    for (;;) {
+        Band band;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _pendingCond.wait(lock, [this] { return _done || !_pending.empty(); });
+            if (_pending.empty())
+                return;
+            band = _pending.front();
+            _pending.pop_front();
+        }
+        _file.writeRows(band.y0, band.rows, band.buffer->data());
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _free.push_back(band.buffer);
+        }
+        _freeCond.notify_one();
+    }
+}
+
+void BandWriter::finish() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_done)
+            return;
+        _done = true;
+    }
+    _pendingCond.notify_all();
+    for (std::thread& t : _writers)
+        t.join();
+    _writers.clear();
+}
@@ -0,0 +1,147 @@
+/**
+ * @file imagefile.h
+ * @brief Création des classes ImageFile (image PPM/PFM projetée en mémoire) et
+ * BandWriter (écriture des bandes de lignes en arrière-plan)
+ */
+
+#ifndef IMAGEFILE_H
+#define IMAGEFILE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fichier image de taille fixe projeté en mémoire (mmap). Le fichier est
+ * préalloué à sa taille finale, puis chaque bande de lignes terminée est recopiée
+ * directement à sa place et rendue au système : la mémoire utilisée ne dépend pas
+ * de la taille de l'image
+ *
+ */
+class ImageFile {
+
+    public:
+        /**
+         * @brief Format du fichier : PPM binaire (8 bits) ou PFM (flottants)
+         */
+        enum Format { PPM, PFM };
+
+        /**
+         * @brief Crée le fichier filename de dimensions width x height
+         *
+         * @param filename
+         * @param width
+         * @param height
+         * @param format
+         */
+        ImageFile(const std::string& filename, int width, int height, Format format);
+
+        /**
+         * @brief Destructeur : synchronise et ferme le fichier
+         */
+        ~ImageFile();
+
+        ImageFile(const ImageFile&) = delete;
+        ImageFile& operator=(const ImageFile&) = delete;
+
+        /**
+         * @brief Déduit le format de l'extension du fichier (.pfm ou .ppm)
+         *
+         * @param filename
+         * @return Format
+         * @throw std::runtime_error si l'extension n'est ni .ppm ni .pfm
+         */
+        static Format formatFromName(const std::string& filename);
+
+        /**
+         * @brief Ecrit les lignes [y0, y0+rows[ à partir de couleurs RGB entre 0 et 255
+         * (3 flottants par pixel, ligne par ligne) puis libère les pages correspondantes
+         *
+         * @param y0
+         * @param rows
+         * @param rgb
+         */
+        void writeRows(int y0, int rows, const float* rgb);
+
+        inline int getWidth() const {return _width;};
+        inline int getHeight() const {return _height;};
+
+    private:
+        int _width, _height;
+        Format _format;
+        int _fd;
+        unsigned char* _data;
+        std::size_t _size;
+        std::size_t _headerSize;
+        std::size_t _pixelSize;
+};
+
+/**
+ * @brief Pipeline d'écriture : les threads de rendu remplissent des tampons de bande
+ * et les soumettent, des threads en arrière-plan les convertissent et les écrivent
+ * dans l'ImageFile pendant que le tracé continue. Le nombre de tampons est borné,
+ * la mémoire est donc O(taille de bande x nombre de threads)
+ *
+ */
+class BandWriter {
+
+    public:
+        /**
+         * @brief Construit le pipeline
+         *
+         * @param file fichier de sortie
+         * @param bandHeight nombre de lignes par bande
+         * @param nbBuffers nombre de tampons de bande
+         * @param nbWriters nombre de threads d'écriture
+         */
+        BandWriter(ImageFile& file, int bandHeight, int nbBuffers, int nbWriters);
+
+        /**
+         * @brief Destructeur : attend la fin des écritures
+         */
+        ~BandWriter();
+
+        /**
+         * @brief Récupère un tampon libre (bloque si tous sont utilisés)
+         *
+         * @return std::vector<float>* tampon de bandHeight*width*3 flottants
+         */
+        std::vector<float>* acquire();
+
+        /**
+         * @brief Soumet une bande terminée à l'écriture, le tampon est rendu ensuite
+         *
+         * @param y0 première ligne de la bande
+         * @param rows nombre de lignes
+         * @param buffer tampon obtenu par acquire()
+         */
+        void submit(int y0, int rows, std::vector<float>* buffer);
+
+        /**
+         * @brief Attend que toutes les bandes soumises soient écrites
+         */
+        void finish();
+
+    private:
+        struct Band {
+            int y0, rows;
+            std::vector<float>* buffer;
+        };
+
+        void writerLoop();
+
+        ImageFile& _file;
+        std::vector<std::vector<float>> _buffers;
+        std::vector<std::vector<float>*> _free;
+        std::deque<Band> _pending;
+        std::vector<std::thread> _writers;
+        std::mutex _mutex;
+        std::condition_variable _freeCond, _pendingCond;
+        bool _done;
+};
+
+#endif
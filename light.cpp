@@ -0,0 +1,118 @@
+/**
+ * @file light.cpp
+ * @brief Implémentation de la classe AreaLight
+ */
+
+#include "light.h"
+#include "rng.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Pas de la suite R2 (inverses du nombre plastique et de son carré)
+const Real R2_U = 0.7548776662466927;
+const Real R2_V = 0.5698402909980532;
+
+int AreaLight::getNbSamples(int maxSamples) const {
+    if (isPoint())
+        return 1;
+    return std::min(std::max(maxSamples, 1), MAX_SAMPLES);
+}
+
+/**
+ * @brief Complète n (unitaire) en un repère orthonormé (Duff et al. 2017)
+ */
+static void repere(const Vector3f& n, Vector3f& tangent, Vector3f& bitangent) {
+    Real sign = std::copysign(Real(1), n.getZ());
+    Real a = -1 / (sign + n.getZ());
+    Real b = n.getX() * n.getY() * a;
+    tangent = Vector3f(1 + sign * n.getX() * n.getX() * a, sign * b, -sign * n.getX());
+    bitangent = Vector3f(b, sign + n.getY() * n.getY() * a, -n.getY());
+}
+
+Vector3f AreaLight::samplePoint(const Ray3f& source, const Vector3f& from, Real u, Real v) const {
+    const Vector3f& centre = source.getOrigin();
+    Vector3f tangent, bitangent;
+    switch (_type) {
+        case RECTANGLE:
+            repere(source.getDirection().normalized(), tangent, bitangent);
+            return centre + tangent * ((2 * u - 1) * _sizeU) + bitangent * ((2 * v - 1) * _sizeV);
+        case DISK: {
+            repere(source.getDirection().normalized(), tangent, bitangent);
+            Real r = _sizeU * std::sqrt(u), phi = 2 * M_PI * v;
+            return centre + tangent * (r * std::cos(phi)) + bitangent * (r * std::sin(phi));
+        }
+        case SPHERE: {
+            // Hémisphère tourné vers le point éclairé, uniformément
+            Vector3f w = from - centre;
+            if (w.squaredNorm() == 0)
+                return centre;
+            w = w.normalized();
+            repere(w, tangent, bitangent);
+            Real r = std::sqrt(std::max(Real(0), 1 - u * u)), phi = 2 * M_PI * v;
+            return centre + (tangent * (r * std::cos(phi)) + bitangent * (r * std::sin(phi)) + w * u) * _sizeU;
+        }
+        default:
+            return centre;
+    }
+}
+
+Ray3f shadowRay(const Vector3f& point, const Vector3f& target, Real& distance) {
+    Vector3f dir = target - point;
+    distance = dir.norm();
+    return Ray3f(point + dir*Epsilon<Real>::OMBRE, distance > 0 ? dir / distance : dir);
+}
+
+/**
+ * @brief Hachage des coordonnées du point (rotation de la suite d'échantillons)
+ */
+static uint32_t hachePoint(const Vector3f& p) {
+    uint32_t h = 0;
+    for (int a = 0; a < 3; a++) {
+        Real c = p[a];
+        uint32_t mots[sizeof(Real) / 4];
+        std::memcpy(mots, &c, sizeof(Real));
+        for (uint32_t m : mots)
+            h = Rng::hash(h ^ m);
+    }
+    return h;
+}
+
+void AreaLight::shadowRays(const Vector3f& point, const Ray3f& source, int first, int count, Ray3f* rays, Real* distances) const {
+    if (isPoint()) {
+        for (int k = 0; k < count; k++)
+            rays[k] = shadowRay(point, source.getOrigin(), distances[k]);
+        return;
+    }
+    Rng rng(hachePoint(point), 0, 0);
+    Real du = rng.next(), dv = rng.next();
+    for (int k = 0; k < count; k++) {
+        Real u = du + (first + k) * R2_U, v = dv + (first + k) * R2_V;
+        u -= std::floor(u);
+        v -= std::floor(v);
+        rays[k] = shadowRay(point, samplePoint(source, point, u, v), distances[k]);
+    }
+}
+
+Real lightVisibility(const Vector3f& point, const Ray3f& source, const AreaLight& light, int maxSamples,
+                     const std::vector<Shape*>& objets, const Bvh& bvh) {
+    int n = light.getNbSamples(maxSamples);
+    Ray3f rayons[AreaLight::MAX_SAMPLES];
+    Real distances[AreaLight::MAX_SAMPLES];
+    bool occultes[AreaLight::MAX_SAMPLES];
+
+    if (n == 1) {
+        light.shadowRays(point, source, 0, 1, rayons, distances);
+        return bvh.occluded(rayons[0], objets, distances[0]) ? 0 : 1;
+    }
+
+    // Premier paquet, puis le reste seulement si les rayons ne sont pas d'accord
+    int premier = (n > AreaLight::FIRST_SAMPLES) ? AreaLight::FIRST_SAMPLES : n;
+    light.shadowRays(point, source, 0, premier, rayons, distances);
+    int nbOccultes = bvh.occludedPacket(rayons, objets, distances, premier, occultes);
+    if (premier == n || nbOccultes == 0 || nbOccultes == premier)
+        return Real(premier - nbOccultes) / premier;
+    light.shadowRays(point, source, premier, n - premier, rayons, distances);
+    nbOccultes += bvh.occludedPacket(rayons, objets, distances, n - premier, occultes);
+    return Real(n - nbOccultes) / n;
+}
@@ -0,0 +1,122 @@
+/**
+ * @file light.h
+ * @brief Création de la classe AreaLight (forme de la source de lumière)
+ */
+#ifndef LIGHT_H
+#define LIGHT_H
+
+#include "bvh.h"
+#include "ray3f.h"
+#include "shape.h"
+#include <vector>
+
+/**
+ * @brief Forme de la source de lumière : ponctuelle (ombres dures), ou étendue
+ * (rectangle, disque ou sphère, ombres douces). La position et l'orientation restent
+ * celles du rayon source de la scène : son origine est le centre de la source et sa
+ * direction la normale du rectangle ou du disque. L'éclairage est celui d'un ensemble
+ * de sources ponctuelles de même puissance totale réparties sur la surface
+ *
+ */
+class AreaLight {
+
+    public:
+        /**
+         * @brief Formes de source
+         */
+        enum Type { POINT, RECTANGLE, DISK, SPHERE };
+
+        /**
+         * @brief Nombre maximal de rayons d'ombre par point (un paquet)
+         */
+        static constexpr int MAX_SAMPLES = 64;
+
+        /**
+         * @brief Rayons d'ombre du premier essai : s'ils sont tous bloqués ou tous libres,
+         * le point est considéré entièrement dans l'ombre ou entièrement éclairé
+         */
+        static constexpr int FIRST_SAMPLES = 4;
+
+        /**
+         * @brief Construit une source
+         *
+         * @param type
+         * @param sizeU demi-largeur du rectangle, rayon du disque ou de la sphère
+         * @param sizeV demi-hauteur du rectangle
+         */
+        explicit AreaLight(Type type = POINT, Real sizeU = 0, Real sizeV = 0) : _type(type), _sizeU(sizeU), _sizeV(sizeV) {}
+
+        inline Type getType() const {return _type;};
+        inline Real getSizeU() const {return _sizeU;};
+        inline Real getSizeV() const {return _sizeV;};
+        inline bool isPoint() const {return _type == POINT || _sizeU <= 0;};
+
+        /**
+         * @brief Nombre de rayons d'ombre d'un point (1 pour une source ponctuelle)
+         *
+         * @param maxSamples nombre demandé
+         * @return int entre 1 et MAX_SAMPLES
+         */
+        int getNbSamples(int maxSamples) const;
+
+        /**
+         * @brief Point de la surface de la source associé à (u, v) dans [0,1[². Pour la
+         * sphère, seul l'hémisphère tourné vers le point éclairé est échantillonné
+         *
+         * @param source centre et normale de la source
+         * @param from point éclairé
+         * @param u
+         * @param v
+         * @return Vector3f
+         */
+        Vector3f samplePoint(const Ray3f& source, const Vector3f& from, Real u, Real v) const;
+
+        /**
+         * @brief Rayons d'ombre first à first+count-1 du point : les échantillons suivent
+         * une suite à faible discrépance (R2) décalée d'une rotation propre au point, si
+         * bien que chaque début de suite couvre toute la source et que le bruit reste fixe
+         * d'une image à l'autre
+         *
+         * @param point point éclairé
+         * @param source centre et normale de la source
+         * @param first indice du premier échantillon
+         * @param count nombre de rayons
+         * @param rays reçoit les rayons
+         * @param distances reçoit la distance de chaque rayon à son point de la source
+         */
+        void shadowRays(const Vector3f& point, const Ray3f& source, int first, int count, Ray3f* rays, Real* distances) const;
+
+    private:
+        Type _type;
+        Real _sizeU, _sizeV;
+};
+
+/**
+ * @brief Rayon d'ombre du point vers une cible (un point de la source), dont l'origine est
+ * avancée d'une fraction de la distance pour ne pas toucher la surface de départ
+ *
+ * @param point
+ * @param target
+ * @param distance reçoit la distance du point à la cible
+ * @return Ray3f
+ */
+Ray3f shadowRay(const Vector3f& point, const Vector3f& target, Real& distance);
+
+/**
+ * @brief Fraction de la source visible depuis le point. Les rayons d'ombre sont lancés
+ * en paquets (un seul parcours de la hiérarchie) : d'abord FIRST_SAMPLES, puis le reste
+ * seulement s'ils ne sont pas d'accord (pénombre). Moins de premiers rayons rendraient
+ * les points hors pénombre moins chers, au prix d'une pénombre plus souvent manquée
+ *
+ * @param point point éclairé
+ * @param source centre et normale de la source
+ * @param light forme de la source
+ * @param maxSamples nombre maximal de rayons d'ombre
+ * @param objets objets de la scène
+ * @param bvh hiérarchie des objets
+ * @return Real entre 0 (dans l'ombre) et 1 (entièrement éclairé)
+ */
+Real lightVisibility(const Vector3f& point, const Ray3f& source, const AreaLight& light, int maxSamples,
+                     const std::vector<Shape*>& objets, const Bvh& bvh);
+
+#endif
@@ -6,71 +6,380 @@
  */ 
 
 #include "scene.h"
-#include "cubequad.h"
-#include "sphere.h"
-#include "camera.h"
-#include "ray3f.h"
-#include "vector3f.h"
-#include "sdl.h"
-#include "material.h"
+#include "scenes.h"
+#include "regression.h"
+#include "viewer.h"
+#include "alloctracker.h"
+#include "imagefile.h"
 #include <vector>
 #include <iostream>
 #include <cmath>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
 
 const int WIDTH = 853;
 const int HEIGHT = 853;
+const Real ECART_YEUX = 30;     // Distance entre les caméras d'un couple stéréo
+const uint64_t CLE_SCENE = 1;   // Version de la scène décrite par construitSceneDemo, à incrémenter à chaque modification
 
-int main() {
-    // Initialisation des matériaux
-    Material rouge = Material(255,10,10,0.5);
-    Material vert = Material(30,255,30,0);
-    Material bleu = Material(30,30,255,0.8);
-    Material jaune = Material(255,255,30,0.8);
-    Material violet = Material(255,20,255,0.5);
-    Material cyan = Material(20,255,255,0);
-    Material blanc = Material(255,255,255,0);
-    Material noir = Material(0,0,0,0);
-    Material gris = Material(70,70,70,0);
-    Material brillant = Material(255,255,255,1);
+/**
+ * @brief Affiche l'aide de la ligne de commande
+ */
+void usage(const char* prog) {
+    std::cerr << "Usage : " << prog << " [options]\n"
+              << "  -i           prévisualisation interactive (caméra au clavier et à la souris)\n"
+              << "  -o fichier   rendu dans un fichier .ppm ou .pfm au lieu de la fenêtre SDL\n"
+              << "  -W largeur   largeur de l'image (" << WIDTH << " par défaut)\n"
+              << "  -H hauteur   hauteur de l'image (" << HEIGHT << " par défaut)\n"
+              << "  -j threads   nombre de threads de rendu (tous les coeurs par défaut)\n"
+              << "  -b lignes    nombre de lignes par bande pour le rendu dans un fichier\n"
+              << "  -m mode      intégrateur : whitted (par défaut) ou path (tracé de chemins)\n"
+              << "  -s nombre    échantillons par pixel du tracé de chemins (16 par défaut)\n"
+              << "  -d nombre    nombre maximal de rebonds du tracé de chemins (8 par défaut)\n"
+              << "  -r graine    graine des tirages aléatoires (0 par défaut)\n"
+              << "  -n           débruitage de l'image du tracé de chemins\n"
+              << "  -l forme     forme de la source : point (par défaut), rect:LxH (demi-côtés),\n"
+              << "               disk:R ou sphere:R (rayon), ombres douces pour les sources étendues\n"
+              << "  -S nombre    rayons d'ombre par point d'une source étendue (16 par défaut)\n"
+              << "  -e mode      pixels tracés : full (par défaut), checker (un sur deux en damier), half\n"
+              << "               ou quarter (demi ou quart de résolution), les autres sont reconstruits\n"
+              << "  -V vues      plusieurs vues en un rendu, dans des fichiers suffixés : cube (6 faces\n"
+              << "               de largeur x largeur, _px à _nz) ou stereo (_gauche et _droite), avec -o\n"
+              << "  -f           brouillard et nappes de brume dans la scène de démonstration\n"
+              << "  -c fichier   cache de la scène compilée (relu s'il est valide, recréé sinon)\n"
+              << "  -x image     texture (PPM binaire) de la sphère et des murs\n"
+              << "  -T Mo        taille du cache des tuiles de textures (64 par défaut)\n"
+              << "  -g nombre    grille de nombre x nombre sphères au lieu de la scène de démonstration\n"
+              << "  -k           surfaces implicites (boîte arrondie, tore, union lisse) au lieu de la\n"
+              << "               scène de démonstration\n"
+              << "  -P fichier   mode hors mémoire : objets lus page par page dans ce fichier (recréé\n"
+              << "               s'il est absent ou périmé), tracé de Whitted seulement ; la scène\n"
+              << "               n'est construite que pour réécrire les pages, et -c est sans effet\n"
+              << "  -M Mo        mémoire maximale des pages du mode hors mémoire (256 par défaut)\n"
+              << "  -C prefixe   carte du coût de chaque pixel : prefixe.png (cycles en fausses couleurs)\n"
+              << "               et prefixe.raw (intersections, noeuds, rayons, cycles en float32)\n"
+              << "  -p           profil des étapes du rendu (temps, IPC et défauts de cache et de\n"
+              << "               prédiction par rayon, par les compteurs matériels) et allocations de\n"
+              << "               l'image sur la sortie d'erreur\n"
+              << "  -R dossier   contrôle de non-régression (images et budgets de temps de référence)\n"
+              << "  -u           avec -R, réenregistre les références à partir du rendu courant\n";
+}
+
+/**
+ * @brief Lit la forme de la source (point, rect:LxH, disk:R ou sphere:R)
+ *
+ * @param texte
+ * @param light reçoit la source
+ * @return true si la description est valide
+ */
+bool litSource(const std::string& texte, AreaLight& light) {
+    if (texte == "point") {
+        light = AreaLight();
+        return true;
+    }
+    std::size_t sep = texte.find(':');
+    if (sep == std::string::npos)
+        return false;
+    std::string forme = texte.substr(0, sep);
+    const char* tailles = texte.c_str() + sep + 1;
+    char* fin;
+    Real u = std::strtod(tailles, &fin), v = 0;
+    if (fin == tailles || u <= 0)
+        return false;
+    if (forme == "rect") {
+        if (*fin != 'x')
+            return false;
+        const char* hauteur = fin + 1;
+        v = std::strtod(hauteur, &fin);
+        if (fin == hauteur || v <= 0 || *fin != '\0')
+            return false;
+        light = AreaLight(AreaLight::RECTANGLE, u, v);
+        return true;
+    }
+    if (*fin != '\0')
+        return false;
+    if (forme == "disk")
+        light = AreaLight(AreaLight::DISK, u);
+    else if (forme == "sphere")
+        light = AreaLight(AreaLight::SPHERE, u);
+    else
+        return false;
+    return true;
+}
+
+/**
+ * @brief Nom du fichier d'une vue : suffixe inséré avant l'extension
+ */
+std::string nomVue(const std::string& output, const std::string& suffixe) {
+    std::size_t point = output.rfind('.');
+    if (point == std::string::npos || output.find('/', point) != std::string::npos)
+        return output + suffixe;
+    return output.substr(0, point) + suffixe + output.substr(point);
+}
+
+/**
+ * @brief Calcule les vues demandées (cube ou stereo) en un seul rendu et les écrit
+ */
+void rendVues(const Scene& sc, const std::string& vues, int width, int height, const std::string& output, int nbThreads) {
+    std::vector<Camera> cameras;
+    std::vector<std::string> suffixes;
+    if (vues == "cube") {
+        cameras = cubeMapCameras(sc.getCamera().getPos(), width);
+        suffixes = {"_px", "_nx", "_py", "_ny", "_pz", "_nz"};
+        height = width;
+    } else {
+        cameras = stereoCameras(sc.getCamera(), ECART_YEUX);
+        suffixes = {"_gauche", "_droite"};
+    }
+    std::vector<Framebuffer> fbs(cameras.size(), Framebuffer(width, height));
+    sc.renderViews(fbs, cameras, nbThreads);
+    std::vector<float> rgb(std::size_t(width) * height * 3);
+    for (std::size_t v = 0; v < fbs.size(); v++) {
+        std::string nom = nomVue(output, suffixes[v]);
+        ImageFile file(nom, width, height, ImageFile::formatFromName(nom));
+        fbs[v].getRGB(0, height, rgb.data());
+        file.writeRows(0, height, rgb.data());
+    }
+}
 
-    // Les rectangles délimitant la scène / boîte
-    CubeQuad walls(Vector3f(0,500,0), Vector3f(1000,500,500), gris);
+int main(int argc, char** argv) {
+    // Lecture des options
+    std::string output, cache, texture, regression, costs, pages, vues;
+    int width = WIDTH, height = HEIGHT, nbThreads = 0, bandHeight = 16, textureCache = 64, pageCache = 256, grille = 0;
+    bool interactive = false, update = false, profil = false, brouillard = false, implicite = false;
+    RenderSettings settings;
+    AreaLight light;
+    for (int k = 1; k < argc; k++) {
+        std::string arg = argv[k];
+        if (arg == "-i") {
+            interactive = true;
+            continue;
+        }
+        if (arg == "-n") {
+            settings.denoise = true;
+            continue;
+        }
+        if (arg == "-u") {
+            update = true;
+            continue;
+        }
+        if (arg == "-p") {
+            profil = true;
+            continue;
+        }
+        if (arg == "-f") {
+            brouillard = true;
+            continue;
+        }
+        if (arg == "-k") {
+            implicite = true;
+            continue;
+        }
+        if (k + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        if (arg == "-o") output = argv[++k];
+        else if (arg == "-c") cache = argv[++k];
+        else if (arg == "-g") grille = std::max(0, std::atoi(argv[++k]));
+        else if (arg == "-P") pages = argv[++k];
+        else if (arg == "-M") pageCache = std::max(1, std::atoi(argv[++k]));
+        else if (arg == "-C") costs = argv[++k];
+        else if (arg == "-V") {
+            vues = argv[++k];
+            if (vues != "cube" && vues != "stereo") {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "-R") regression = argv[++k];
+        else if (arg == "-x") texture = argv[++k];
+        else if (arg == "-T") textureCache = std::max(1, std::atoi(argv[++k]));
+        else if (arg == "-W" || arg == "-H") {
+            int taille = std::atoi(argv[++k]);
+            if (taille <= 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            (arg == "-W" ? width : height) = taille;
+        }
+        else if (arg == "-j") nbThreads = std::atoi(argv[++k]);
+        else if (arg == "-b") bandHeight = std::max(1, std::atoi(argv[++k]));
+        else if (arg == "-m") {
+            std::string mode = argv[++k];
+            if (mode == "path") settings.integrator = RenderSettings::PATH_TRACING;
+            else if (mode == "whitted") settings.integrator = RenderSettings::WHITTED;
+            else {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "-s") settings.samplesPerPixel = std::max(1, std::atoi(argv[++k]));
+        else if (arg == "-d") settings.maxDepth = std::max(0, std::atoi(argv[++k]));
+        else if (arg == "-r") settings.seed = std::strtoul(argv[++k], nullptr, 10);
+        else if (arg == "-e") {
+            std::string mode = argv[++k];
+            if (mode == "full") settings.sampling = SAMPLING_FULL;
+            else if (mode == "checker") settings.sampling = SAMPLING_CHECKERBOARD;
+            else if (mode == "half") settings.sampling = SAMPLING_HALF;
+            else if (mode == "quarter") settings.sampling = SAMPLING_QUARTER;
+            else {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "-S") settings.shadowSamples = std::max(1, std::atoi(argv[++k]));
+        else if (arg == "-l") {
+            if (!litSource(argv[++k], light)) {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
 
-    // Initialisation de la caméra 
-    const Vector3f& camCenter = Vector3f(100,600,-400);
-    const Vector3f& camDirection = Vector3f(0,0,200);
-    const Vector3f& camUp = Vector3f(0,1,0);
-    Camera cam = Camera(camCenter, camDirection, camUp);
-    
-    // Initialisation de la source de lumière (dirigée vers le bas)
-    const Vector3f& sourceOrigin = Vector3f(100,500,0);
-    const Vector3f& sourceDirection = Vector3f(0,1,0);
-    Ray3f source = Ray3f(sourceOrigin, sourceDirection);
+    if (!pages.empty() && (interactive || !costs.empty() || profil || brouillard || settings.sampling != SAMPLING_FULL ||
+                           settings.integrator != RenderSettings::WHITTED)) {
+        std::cerr << "Le mode hors mémoire (-P) ne permet ni -i, ni -C, ni -p, ni -f, ni -e, ni le tracé de chemins" << std::endl;
+        return 1;
+    }
+    if (!vues.empty() && (output.empty() || interactive || !costs.empty())) {
+        std::cerr << "Les vues multiples (-V) demandent -o et ne permettent ni -i, ni -C" << std::endl;
+        return 1;
+    }
+    if (!regression.empty()) {
+        try {
+            return runRegression(regression, update, nbThreads);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
 
-    // Initialisation de la liste des objets
-    std::vector<Shape*> shapes;
-    Sphere sph(Vector3f(50,400,150),100,rouge);     // Sphère en rouge
-    CubeQuad cube1(Vector3f(700,700,40),Vector3f(100),bleu);   // Cube en bleu
-    CubeQuad cube2(Vector3f(300,1000,300),Vector3f(20,600,20),vert);   // Cube en bleu
-    float theta = 0.75;
-    std::array<Vector3f, 3> rotatedBasis = {
-        Vector3f(std::cos(theta),std::sin(theta),0),
-        Vector3f(-std::sin(theta),std::cos(theta),0),
-        Vector3f(0,0,1)
+    // Remplit la scène décrite par les options (objets : sinon seulement les matériaux)
+    auto construit = [&](Scene& scene, bool objets) {
+        if (implicite)
+            construitSceneImplicite(scene, objets);
+        else if (grille > 0)
+            construitSceneSpheres(scene, grille, grille, objets);
+        else
+            construitSceneDemo(scene, texture, objets);
     };
-    CubeQuad cube3(Vector3f(400,700,40),Vector3f(100),jaune,rotatedBasis);
 
-    shapes.push_back(&sph);
-    shapes.push_back(&cube1);
-    shapes.push_back(&cube2);
-    shapes.push_back(&cube3);
-    shapes.push_back(&walls);
+    // Initialisation de la scène, qui possède les matériaux et les objets
+    Scene sc(cameraDemo(),sourceDemo());
+    sc.setSettings(settings);
+    sc.setLight(light);
+    sc.setTextureCacheSize(std::size_t(textureCache) << 20);
+    // La clé du cache identifie la description de la scène, texture, grille et surfaces implicites comprises
+    uint64_t cle = CLE_SCENE + (texture.empty() ? 0 : std::hash<std::string>()(texture)) + uint64_t(grille) * 0x9E3779B97F4A7C15ull
+                   + (implicite ? 0xC2B2AE3D27D4EB4Full : 0);
+    if (!pages.empty()) {
+        // Mode hors mémoire : les objets ne sont lus que depuis le fichier de pages, la scène
+        // ne reçoit que ses matériaux. Des pages absentes ou périmées sont réécrites depuis
+        // une scène complète, libérée avant le rendu
+        try {
+            construit(sc, false);
+            try {
+                sc.loadPages(pages, cle, std::size_t(pageCache) << 20);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << " : les pages sont réécrites" << std::endl;
+                {
+                    Scene source(cameraDemo(),sourceDemo());
+                    construit(source, true);
+                    source.savePages(pages, cle);
+                }
+                sc.loadPages(pages, cle, std::size_t(pageCache) << 20);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    } else {
+        // Relue depuis le cache s'il est valide, construite (puis enregistrée dans le cache) sinon
+        bool chargee = false;
+        if (!cache.empty()) {
+            try {
+                sc.loadCache(cache, cle);
+                chargee = true;
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << " : la scène est reconstruite" << std::endl;
+            }
+        }
+        if (!chargee) {
+            try {
+                construit(sc, true);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+            sc.buildBvh();
+            if (!cache.empty()) {
+                try {
+                    sc.saveCache(cache, cle);
+                } catch (const std::exception& e) {
+                    std::cerr << e.what() << std::endl;
+                }
+            }
+        }
+    }
 
-    // Initialisation de la scène
-    Scene sc = Scene(cam,shapes,source);
+    // Les milieux ne font pas partie du cache : ils sont ajoutés à la scène relue
+    if (brouillard)
+        ajouteBrouillardDemo(sc);
 
-    // Fonction principale : rendu de la scène
-    sc.render(WIDTH,HEIGHT);
+    std::unique_ptr<CostMap> carteCout;
+    if (!costs.empty())
+        carteCout.reset(new CostMap(width, height));
+    PerfProfiler profiler;
+    AllocationTracker allocations;
+    if (profil)
+        sc.setProfiler(&profiler);
+    allocations.beginFrame();
+    if (interactive) {
+        Viewer viewer(sc,width,height,nbThreads);
+        viewer.run();
+    } else if (!vues.empty()) {
+        try {
+            rendVues(sc, vues, width, height, output, nbThreads);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    } else if (output.empty())
+        sc.render(width,height,carteCout.get());
+    else {
+        try {
+            sc.renderToFile(width,height,output,nbThreads,bandHeight,carteCout.get());
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+    allocations.endFrame();
+
+    if (profil && !interactive) {
+        profiler.report(std::cerr);
+        allocations.report(std::cerr);
+    }
+
+    // Carte de coût, à côté de l'image
+    if (carteCout && !interactive) {
+        try {
+            carteCout->writeHeatmap(costs + ".png");
+            carteCout->writeRaw(costs + ".raw");
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
     return 0;
 }
-
@@ -17,13 +17,13 @@ Material::Material(float r, float g, float b, float shininess) {
     this->correctRange();
 }
 
-Material Material::operator+(const Material& other) {
+Material Material::operator+(const Material& other) const {
     Material m = Material(_r + other._r, _g + other._g, _b + other._b, _shininess + other._shininess);
     m.correctRange();
     return m;
 }
 
-Material Material::operator*(float k) {
+Material Material::operator*(float k) const {
     Material m = Material(_r*k, _g*k, _b*k, _shininess);
     m.correctRange();
     return m;
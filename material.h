@@ -36,7 +36,7 @@ class Material {
          * @param other
          * @return Material 
          */
-        Material operator+(const Material& other);
+        Material operator+(const Material& other) const;
 
         /**
          * @brief Surcharge d'opérateur * pour les Material, à droite
@@ -44,7 +44,7 @@ class Material {
          * @param k 
          * @return Material 
          */
-        Material operator*(float k);
+        Material operator*(float k) const;
 
         /**
          * @brief Destructeur
@@ -74,4 +74,9 @@ class Material {
         inline void setShininess(float s) {_shininess=s;};
 };
 
+/**
+ * @brief Identifiant stable (indice) d'un matériau dans la table de la Scene
+ */
+typedef int MaterialHandle;
+
 #endif
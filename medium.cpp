@@ -0,0 +1,300 @@
+/**
+ * @file medium.cpp
+ * @brief Implémentation de la classe Medium
+ */
+
+#include "medium.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+const Real SEUIL_ROULETTE = 0.1;    // Transmittance en deçà de laquelle le suivi par rapports joue à la roulette russe
+const Real PAS_OPTIQUE = 0.25;        // Epaisseur optique d'un pas d'intégration, au majorant du bloc
+const Real EPAISSEUR_MAX = 10;      // Epaisseur optique au-delà de laquelle l'intégration s'arrête
+
+Medium::Medium(const Aabb& bounds, float density, const Vector3f& albedo)
+    : _bounds(bounds), _albedo(albedo), _homogene(true), _nx(1), _ny(1), _nz(1), _densites(1, std::max(0.f, density)) {
+    construitMajorants();
+}
+
+Medium::Medium(const Aabb& bounds, int nx, int ny, int nz, const std::vector<float>& densities, float scale, const Vector3f& albedo)
+    : _bounds(bounds), _albedo(albedo), _homogene(false), _nx(nx), _ny(ny), _nz(nz), _densites(densities) {
+    if (nx <= 0 || ny <= 0 || nz <= 0 || densities.size() != std::size_t(nx) * ny * nz)
+        throw std::runtime_error("Grille de densités du milieu invalide");
+    for (float& d : _densites) {
+        if (!(d >= 0))
+            throw std::runtime_error("Densité négative dans la grille du milieu");
+        d *= scale;
+    }
+    construitMajorants();
+}
+
+void Medium::construitMajorants() {
+    const int n[3] = {_nx, _ny, _nz};
+    for (int a = 0; a < 3; a++) {
+        _min[a] = _bounds.getMin()[a];
+        _max[a] = _bounds.getMax()[a];
+        _echelle[a] = n[a] / (_max[a] - _min[a]);
+    }
+    _mx = (_nx + BLOC_MAJORANT - 1) / BLOC_MAJORANT;
+    _my = (_ny + BLOC_MAJORANT - 1) / BLOC_MAJORANT;
+    _mz = (_nz + BLOC_MAJORANT - 1) / BLOC_MAJORANT;
+    _majorants.assign(std::size_t(_mx) * _my * _mz, 0);
+    // L'interpolation trilinéaire dans un bloc lit aussi les cellules voisines du bloc :
+    // chaque majorant couvre le bloc élargi d'une cellule
+    for (int bz = 0; bz < _mz; bz++) {
+        for (int by = 0; by < _my; by++) {
+            for (int bx = 0; bx < _mx; bx++) {
+                float m = 0;
+                for (int z = std::max(0, bz * BLOC_MAJORANT - 1); z <= std::min(_nz - 1, (bz + 1) * BLOC_MAJORANT); z++) {
+                    for (int y = std::max(0, by * BLOC_MAJORANT - 1); y <= std::min(_ny - 1, (by + 1) * BLOC_MAJORANT); y++) {
+                        for (int x = std::max(0, bx * BLOC_MAJORANT - 1); x <= std::min(_nx - 1, (bx + 1) * BLOC_MAJORANT); x++)
+                            m = std::max(m, _densites[(std::size_t(z) * _ny + y) * _nx + x]);
+                    }
+                }
+                _majorants[(std::size_t(bz) * _my + by) * _mx + bx] = m;
+            }
+        }
+    }
+
+    // Boîte des blocs non vides (vide si le milieu l'est)
+    int actifMin[3] = {_mx, _my, _mz}, actifMax[3] = {-1, -1, -1};
+    for (int bz = 0; bz < _mz; bz++) {
+        for (int by = 0; by < _my; by++) {
+            for (int bx = 0; bx < _mx; bx++) {
+                if (_majorants[(std::size_t(bz) * _my + by) * _mx + bx] <= 0)
+                    continue;
+                const int b[3] = {bx, by, bz};
+                for (int a = 0; a < 3; a++) {
+                    actifMin[a] = std::min(actifMin[a], b[a]);
+                    actifMax[a] = std::max(actifMax[a], b[a]);
+                }
+            }
+        }
+    }
+    const int dims[3] = {_mx, _my, _mz};
+    for (int a = 0; a < 3; a++) {
+        _tailleBloc[a] = (_max[a] - _min[a]) / dims[a];
+        _blocsParUnite[a] = dims[a] / (_max[a] - _min[a]);
+        _actifMin[a] = _min[a] + actifMin[a] * _tailleBloc[a];
+        _actifMax[a] = _min[a] + (actifMax[a] + 1) * _tailleBloc[a];
+    }
+}
+
+float Medium::density(const Vector3f& p) const {
+    const Real q[3] = {p.getX(), p.getY(), p.getZ()};
+    for (int a = 0; a < 3; a++) {
+        if (q[a] < _min[a] || q[a] > _max[a])
+            return 0;
+    }
+    return densite(q[0], q[1], q[2]);
+}
+
+float Medium::densite(Real x, Real y, Real z) const {
+    if (_homogene)
+        return _densites[0];
+
+    // Coordonnées continues dans la grille, les densités étant au centre des cellules
+    const int n[3] = {_nx, _ny, _nz};
+    const Real q[3] = {x, y, z};
+    int i0[3], i1[3];
+    float f[3];
+    for (int a = 0; a < 3; a++) {
+        // c >= -1 dans la boîte : la troncature de c + 1 donne la partie entière sans floor
+        float c = float((q[a] - _min[a]) * _echelle[a]) - 0.5f;
+        int c0 = int(c + 1) - 1;
+        f[a] = c - c0;
+        i0[a] = std::min(std::max(c0, 0), n[a] - 1);
+        i1[a] = std::min(std::max(c0 + 1, 0), n[a] - 1);
+    }
+    auto d = [&](int x, int y, int z) { return _densites[(std::size_t(z) * _ny + y) * _nx + x]; };
+    float d00 = d(i0[0], i0[1], i0[2]) * (1 - f[0]) + d(i1[0], i0[1], i0[2]) * f[0];
+    float d10 = d(i0[0], i1[1], i0[2]) * (1 - f[0]) + d(i1[0], i1[1], i0[2]) * f[0];
+    float d01 = d(i0[0], i0[1], i1[2]) * (1 - f[0]) + d(i1[0], i0[1], i1[2]) * f[0];
+    float d11 = d(i0[0], i1[1], i1[2]) * (1 - f[0]) + d(i1[0], i1[1], i1[2]) * f[0];
+    return (d00 * (1 - f[1]) + d10 * f[1]) * (1 - f[2]) + (d01 * (1 - f[1]) + d11 * f[1]) * f[2];
+}
+
+template <class Fn>
+void Medium::parcourt(const Ray3f& ray, Real tMax, Fn fn) const {
+    const Real o[3] = {ray.getOrigin().getX(), ray.getOrigin().getY(), ray.getOrigin().getZ()};
+    const Real d[3] = {ray.getDirection().getX(), ray.getDirection().getY(), ray.getDirection().getZ()};
+    const Real* mn = _min;
+
+    // Segment du rayon dans la boîte des blocs non vides (une direction nulle sur un axe
+    // donne NaN, ignoré par min et max)
+    Real t0 = 0, t1 = tMax;
+    Real inverse[3];
+    for (int a = 0; a < 3; a++) {
+        inverse[a] = 1 / d[a];
+        Real ta = (_actifMin[a] - o[a]) * inverse[a], tb = (_actifMax[a] - o[a]) * inverse[a];
+        if (ta > tb)
+            std::swap(ta, tb);
+        t0 = std::max(t0, ta);
+        t1 = std::min(t1, tb);
+    }
+    if (!(t0 < t1))
+        return;
+    if (_majorants.size() == 1) {
+        fn(t0, t1, _majorants[0]);
+        return;
+    }
+
+    // Parcours des blocs (Amanatides et Woo) depuis le point d'entrée
+    const int dims[3] = {_mx, _my, _mz};
+    const int ecarts[3] = {1, _mx, _mx * _my};
+    int bloc[3], pas[3];
+    Real tSuivant[3], tPas[3];
+    int indice = 0;
+    for (int a = 0; a < 3; a++) {
+        Real entree = o[a] + d[a] * t0;
+        bloc[a] = std::min(std::max(int((entree - mn[a]) * _blocsParUnite[a]), 0), dims[a] - 1);
+        indice += bloc[a] * ecarts[a];
+        if (d[a] > 0) {
+            pas[a] = 1;
+            tSuivant[a] = (mn[a] + (bloc[a] + 1) * _tailleBloc[a] - o[a]) * inverse[a];
+            tPas[a] = _tailleBloc[a] * inverse[a];
+        } else if (d[a] < 0) {
+            pas[a] = -1;
+            tSuivant[a] = (mn[a] + bloc[a] * _tailleBloc[a] - o[a]) * inverse[a];
+            tPas[a] = -_tailleBloc[a] * inverse[a];
+        } else {
+            pas[a] = 0;
+            tSuivant[a] = tPas[a] = std::numeric_limits<Real>::infinity();
+        }
+    }
+    Real t = t0;
+    while (t < t1) {
+        int axe = (tSuivant[0] < tSuivant[1]) ? (tSuivant[0] < tSuivant[2] ? 0 : 2) : (tSuivant[1] < tSuivant[2] ? 1 : 2);
+        Real fin = std::min(tSuivant[axe], t1);
+        if (fin > t && !fn(t, fin, _majorants[indice]))
+            return;
+        t = fin;
+        bloc[axe] += pas[axe];
+        if (bloc[axe] < 0 || bloc[axe] >= dims[axe])
+            return;
+        indice += pas[axe] * ecarts[axe];
+        tSuivant[axe] += tPas[axe];
+    }
+}
+
+Real Medium::transmittance(const Ray3f& ray, Real tMax, Rng& rng) const {
+    const Vector3f& o = ray.getOrigin();
+    const Vector3f& d = ray.getDirection();
+    Real transmittance = 1;
+    parcourt(ray, tMax, [&](Real ta, Real tb, float majorant) {
+        if (majorant <= 0)
+            return true;
+        if (_homogene) {
+            transmittance *= std::exp(-majorant * (tb - ta));
+            return true;
+        }
+        // Suivi par rapports : chaque collision fictive tirée selon le majorant multiplie
+        // la transmittance par la part de collisions fictives en ce point
+        Real t = ta;
+        while (true) {
+            t -= std::log(1 - rng.next()) / majorant;
+            if (t >= tb)
+                return true;
+            transmittance *= 1 - densite(o.getX() + d.getX() * t, o.getY() + d.getY() * t, o.getZ() + d.getZ() * t) / majorant;
+            if (transmittance < SEUIL_ROULETTE) {
+                if (rng.next() >= 0.5f) {
+                    transmittance = 0;
+                    return false;
+                }
+                transmittance *= 2;
+            }
+        }
+    });
+    return transmittance;
+}
+
+Real Medium::opticalDepth(const Ray3f& ray, Real tMax, float offset) const {
+    const Vector3f& o = ray.getOrigin();
+    const Vector3f& d = ray.getDirection();
+    Real epaisseur = 0;
+    parcourt(ray, tMax, [&](Real ta, Real tb, float majorant) {
+        if (majorant <= 0)
+            return true;
+        if (_homogene)
+            epaisseur += majorant * (tb - ta);
+        else {
+            int n = int((tb - ta) * majorant / PAS_OPTIQUE) + 1;
+            Real pas = (tb - ta) / n;
+            for (int i = 0; i < n; i++) {
+                Real t = ta + (i + offset) * pas;
+                epaisseur += densite(o.getX() + d.getX() * t, o.getY() + d.getY() * t, o.getZ() + d.getZ() * t) * pas;
+            }
+        }
+        return epaisseur < EPAISSEUR_MAX;
+    });
+    return epaisseur;
+}
+
+bool Medium::sampleCollision(const Ray3f& ray, Real tMax, Rng& rng, Real& t) const {
+    const Vector3f& o = ray.getOrigin();
+    const Vector3f& d = ray.getDirection();
+    bool collision = false;
+    parcourt(ray, tMax, [&](Real ta, Real tb, float majorant) {
+        if (majorant <= 0)
+            return true;
+        // Suivi delta : une collision tirée selon le majorant est réelle avec la probabilité
+        // densité / majorant (toujours pour un milieu homogène)
+        Real s = ta;
+        while (true) {
+            s -= std::log(1 - rng.next()) / majorant;
+            if (s >= tb)
+                return true;
+            if (_homogene || rng.next() * majorant < densite(o.getX() + d.getX() * s, o.getY() + d.getY() * s, o.getZ() + d.getZ() * s)) {
+                t = s;
+                collision = true;
+                return false;
+            }
+        }
+    });
+    return collision;
+}
+
+Real mediaTransmittance(const std::vector<Medium>& media, const Ray3f& ray, Real tMax, Rng& rng) {
+    Real transmittance = 1;
+    for (const Medium& m : media) {
+        transmittance *= m.transmittance(ray, tMax, rng);
+        if (transmittance == 0)
+            break;
+    }
+    return transmittance;
+}
+
+int sampleMediaCollision(const std::vector<Medium>& media, const Ray3f& ray, Real tMax, Rng& rng, Real& t) {
+    int milieu = -1;
+    for (int k = 0; k < int(media.size()); k++) {
+        Real tk;
+        // Les collisions au-delà de la plus proche déjà trouvée ne comptent pas
+        if (media[k].sampleCollision(ray, tMax, rng, tk)) {
+            tMax = tk;
+            t = tk;
+            milieu = k;
+        }
+    }
+    return milieu;
+}
+
+/**
+ * @brief Bits d'un scalaire
+ */
+static inline uint32_t bits(Real x) {
+    float f = float(x);
+    uint32_t b;
+    std::memcpy(&b, &f, sizeof(b));
+    return b;
+}
+
+Rng rayRng(const Ray3f& ray, uint32_t seed) {
+    const Vector3f& o = ray.getOrigin();
+    const Vector3f& d = ray.getDirection();
+    uint32_t origine = Rng::hash(Rng::hash(Rng::hash(bits(o[0])) ^ bits(o[1])) ^ bits(o[2]));
+    uint32_t direction = Rng::hash(Rng::hash(Rng::hash(bits(d[0])) ^ bits(d[1])) ^ bits(d[2]));
+    return Rng(seed, origine, direction);
+}
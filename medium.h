@@ -0,0 +1,172 @@
+/**
+ * @file medium.h
+ * @brief Création de la classe Medium (milieux participants : brouillard, fumée)
+ */
+#ifndef MEDIUM_H
+#define MEDIUM_H
+
+#include "aabb.h"
+#include "rng.h"
+#include <vector>
+
+/**
+ * @brief Milieu participant borné par une boîte : homogène (densité constante) ou
+ * hétérogène (grille de densités interpolées trilinéairement). La densité est le
+ * coefficient d'extinction, par unité de longueur le long d'un rayon de direction normée.
+ *
+ * Les rayons traversent une grille grossière de majorants (densité maximale de chaque
+ * bloc de 8x8x8 cellules) : le suivi delta (collisions) et le suivi par rapports
+ * (transmittance) tirent des distances exponentielles selon le majorant du bloc
+ * traversé, si bien que les blocs vides sont sautés d'un pas et les blocs peu denses à
+ * grands pas ; les rayons sont d'abord coupés à la boîte des blocs non vides.
+ * L'épaisseur optique (tracé de Whitted, sans bruit de Monte-Carlo) est intégrée sur les
+ * mêmes blocs, à pas réglé par leur majorant. Un milieu homogène est traité analytiquement
+ */
+class Medium {
+
+    public:
+        /**
+         * @brief Construit un milieu homogène
+         *
+         * @param bounds boîte du milieu
+         * @param density densité (coefficient d'extinction)
+         * @param albedo albédo de diffusion (entre 0 et 1 par composante) ; en tracé de
+         * Whitted, couleur du brouillard
+         */
+        Medium(const Aabb& bounds, float density, const Vector3f& albedo);
+
+        /**
+         * @brief Construit un milieu hétérogène
+         *
+         * @param bounds boîte du milieu, découpée en nx x ny x nz cellules
+         * @param nx
+         * @param ny
+         * @param nz
+         * @param densities densités au centre des cellules (x le plus rapide, puis y, puis z),
+         * positives ou nulles
+         * @param scale facteur appliqué aux densités
+         * @param albedo albédo de diffusion ; en tracé de Whitted, couleur du brouillard
+         */
+        Medium(const Aabb& bounds, int nx, int ny, int nz, const std::vector<float>& densities, float scale, const Vector3f& albedo);
+
+        inline const Aabb& getBounds() const {return _bounds;};
+        inline const Vector3f& getAlbedo() const {return _albedo;};
+        inline bool isHomogeneous() const {return _homogene;};
+
+        /**
+         * @brief Densité au point p (nulle hors de la boîte)
+         *
+         * @param p
+         * @return float
+         */
+        float density(const Vector3f& p) const;
+
+        /**
+         * @brief Estime la transmittance du milieu entre l'origine du rayon et la distance
+         * tMax (suivi par rapports, roulette russe quand elle devient faible ; exacte pour un
+         * milieu homogène)
+         *
+         * @param ray rayon de direction normée
+         * @param tMax
+         * @param rng
+         * @return Real estimation sans biais de la transmittance
+         */
+        Real transmittance(const Ray3f& ray, Real tMax, Rng& rng) const;
+
+        /**
+         * @brief Epaisseur optique du milieu entre l'origine du rayon et la distance tMax
+         * (intégrale de la densité), estimée de manière déterministe : les blocs vides sont
+         * sautés et les autres échantillonnés à pas réguliers, d'autant plus courts que leur
+         * majorant est grand (exacte pour un milieu homogène). Le calcul s'arrête au-delà
+         * d'une épaisseur de 10 (transmittance négligeable)
+         *
+         * @param ray rayon de direction normée
+         * @param tMax
+         * @param offset position des échantillons dans leur pas (entre 0 et 1), à varier d'un
+         * rayon à l'autre pour changer le crénelage en bruit
+         * @return Real
+         */
+        Real opticalDepth(const Ray3f& ray, Real tMax, float offset = 0.5f) const;
+
+        /**
+         * @brief Tire la distance de la première collision avec le milieu le long du rayon,
+         * avant tMax (suivi delta)
+         *
+         * @param ray rayon de direction normée
+         * @param tMax
+         * @param rng
+         * @param t reçoit la distance de la collision
+         * @return true s'il y a une collision avant tMax
+         */
+        bool sampleCollision(const Ray3f& ray, Real tMax, Rng& rng, Real& t) const;
+
+    private:
+        static const int BLOC_MAJORANT = 8;     // Cellules de densité par bloc de majorant (par axe)
+
+        /**
+         * @brief Calcule la grille des majorants et les coefficients de passage aux
+         * coordonnées de la grille
+         */
+        void construitMajorants();
+
+        /**
+         * @brief Densité au point (x, y, z), supposé dans la boîte à l'erreur d'arrondi près
+         */
+        float densite(Real x, Real y, Real z) const;
+
+        /**
+         * @brief Parcourt les blocs de majorants traversés par le rayon entre 0 et tMax, dans
+         * l'ordre : fn(ta, tb, majorant) reçoit chaque segment et renvoie false pour arrêter
+         */
+        template <class Fn>
+        void parcourt(const Ray3f& ray, Real tMax, Fn fn) const;
+
+        Aabb _bounds;
+        Vector3f _albedo;
+        bool _homogene;
+        int _nx, _ny, _nz;
+        std::vector<float> _densites;
+        int _mx, _my, _mz;                  // Taille de la grille des majorants
+        std::vector<float> _majorants;
+        Real _min[3], _max[3];              // Coins de la boîte
+        Real _actifMin[3], _actifMax[3];    // Coins de la boîte des blocs non vides, à laquelle les rayons sont coupés
+        Real _echelle[3];                   // Cellules de densité par unité de longueur
+        Real _tailleBloc[3], _blocsParUnite[3];
+};
+
+/**
+ * @brief Transmittance de tous les milieux entre l'origine du rayon et tMax
+ *
+ * @param media
+ * @param ray rayon de direction normée
+ * @param tMax
+ * @param rng
+ * @return Real
+ */
+Real mediaTransmittance(const std::vector<Medium>& media, const Ray3f& ray, Real tMax, Rng& rng);
+
+/**
+ * @brief Première collision avec l'un des milieux avant tMax : la plus proche des
+ * collisions tirées dans chaque milieu
+ *
+ * @param media
+ * @param ray rayon de direction normée
+ * @param tMax
+ * @param rng
+ * @param t reçoit la distance de la collision
+ * @return int indice du milieu touché, -1 si aucun
+ */
+int sampleMediaCollision(const std::vector<Medium>& media, const Ray3f& ray, Real tMax, Rng& rng, Real& t);
+
+/**
+ * @brief Générateur propre à un rayon, dérivé de son origine et de sa direction : les
+ * estimations d'un intégrateur déterministe (Whitted) sont reproductibles, sans motif
+ * d'un pixel à l'autre
+ *
+ * @param ray
+ * @param seed graine du rendu
+ * @return Rng
+ */
+Rng rayRng(const Ray3f& ray, uint32_t seed);
+
+#endif
@@ -0,0 +1,542 @@
+/**
+ * @file pagedgeometry.cpp
+ * @brief Implémentation de la classe PagedGeometry
+ */
+
+#include "pagedgeometry.h"
+#include "sphere.h"
+#include "cubequad.h"
+#include "sdfshape.h"
+#include "parallel.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const std::size_t ALIGNEMENT_PAGE = 4096;   // Les pages commencent sur une page du système
+const char MAGIQUE_PAGES[8] = "RTPAGES";
+const uint32_t BOUTISME_PAGES = 0x01020304;
+const int RAYONS_PAR_PAQUET = 1024;         // Rayons traités par tâche lors du premier parcours
+const int PROFONDEUR_ARBRE = 64;            // Profondeur maximale de l'arbre des pages
+
+/**
+ * @brief En-tête du fichier de pages
+ */
+struct EnTetePages {
+    char magic[8];
+    uint32_t version, realSize, endianness;
+    uint32_t shapeSize, nodeSize, pageSize;     // Tailles des enregistrements
+    int32_t nbTop, nbPages, nbShapes, maxMaterial;
+    uint64_t sourceKey, fileSize;
+};
+
+bool isKnownShape(const ShapeRecord& record) {
+    if (record.type == ShapeRecord::SDF) {
+        int a = record.variant & 0xff, b = record.variant >> 8;
+        return (a == SdfPrimitive::ROUNDED_BOX || a == SdfPrimitive::TORUS)
+               && (b == SdfPrimitive::NONE || b == SdfPrimitive::ROUNDED_BOX || b == SdfPrimitive::TORUS);
+    }
+    return record.type == ShapeRecord::SPHERE || record.type == ShapeRecord::CUBEQUAD;
+}
+
+Shape* createShape(Arena& arena, const ShapeRecord& record) {
+    if (record.type == ShapeRecord::SPHERE)
+        return createShape(arena.allocate(sizeof(Sphere), alignof(Sphere)), record);
+    if (record.type == ShapeRecord::SDF)
+        return createShape(arena.allocate(sizeof(SdfShape), alignof(SdfShape)), record);
+    return createShape(arena.allocate(sizeof(CubeQuad), alignof(CubeQuad)), record);
+}
+
+Shape* createShape(void* memory, const ShapeRecord& record) {
+    const Real* p = record.params;
+    Vector3f center(p[0], p[1], p[2]);
+    if (record.type == ShapeRecord::SPHERE)
+        return new (memory) Sphere(center, p[3], record.material);
+    if (record.type == ShapeRecord::SDF) {
+        SdfPrimitive a = {record.variant & 0xff, {p[0], p[1], p[2]}, {p[3], p[4], p[5], p[6]}};
+        SdfPrimitive b = {record.variant >> 8, {p[7], p[8], p[9]}, {p[10], p[11], p[12], p[13]}};
+        return new (memory) SdfShape(a, b, p[14], record.material);
+    }
+    std::array<Vector3f, 3> basis = {Vector3f(p[6], p[7], p[8]), Vector3f(p[9], p[10], p[11]), Vector3f(p[12], p[13], p[14])};
+    return new (memory) CubeQuad(center, Vector3f(p[3], p[4], p[5]), record.material, basis);
+}
+
+static inline std::size_t alignePage(std::size_t n) {
+    return (n + ALIGNEMENT_PAGE - 1) / ALIGNEMENT_PAGE * ALIGNEMENT_PAGE;
+}
+
+static void ecrit(int fd, const void* data, std::size_t size, std::size_t offset, const std::string& filename) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = pwrite(fd, p, size, offset);
+        if (n <= 0)
+            throw std::runtime_error("Erreur d'écriture de " + filename);
+        p += n;
+        size -= n;
+        offset += n;
+    }
+}
+
+void PagedGeometry::write(const std::string& filename, uint64_t sourceKey, const std::vector<Shape*>& shapes, const Bvh& bvh,
+                          int shapesPerPage) {
+    if (!bvh.isBuilt() || bvh.getNbIndices() != int(shapes.size()))
+        throw std::runtime_error("La hiérarchie doit être construite avant la pagination");
+    const BvhNode* nodes = bvh.getNodes();
+    const int32_t* indices = bvh.getIndices();
+
+    // Intervalle d'indices d'objets de chaque sous-arbre (les fils suivent leur parent)
+    std::vector<std::pair<int, int>> intervalles(bvh.getNbNodes());
+    for (int k = bvh.getNbNodes() - 1; k >= 0; k--) {
+        const BvhNode& n = nodes[k];
+        if (n.count > 0)
+            intervalles[k] = {n.first, n.count};
+        else
+            intervalles[k] = {std::min(intervalles[n.first].first, intervalles[n.first + 1].first),
+                              intervalles[n.first].second + intervalles[n.first + 1].second};
+    }
+
+    // Arbre des pages : le haut de la hiérarchie, coupé aux sous-arbres assez petits
+    std::vector<BvhNode> top(1);
+    std::vector<std::pair<int, int>> pages;
+    std::vector<std::pair<int, int>> pile = {{0, 0}};     // (noeud de la hiérarchie, noeud de l'arbre des pages)
+    while (!pile.empty()) {
+        auto [n, t] = pile.back();
+        pile.pop_back();
+        std::copy(nodes[n].min, nodes[n].min + 3, top[t].min);
+        std::copy(nodes[n].max, nodes[n].max + 3, top[t].max);
+        if (nodes[n].count > 0 || intervalles[n].second <= shapesPerPage) {
+            top[t].first = pages.size();
+            top[t].count = 1;
+            pages.push_back(intervalles[n]);
+        } else {
+            int gauche = top.size();
+            top.resize(top.size() + 2);
+            top[t].first = gauche;
+            top[t].count = 0;
+            pile.push_back({nodes[n].first + 1, gauche + 1});
+            pile.push_back({nodes[n].first, gauche});
+        }
+    }
+
+    EnTetePages e;
+    std::memset(&e, 0, sizeof(e));
+    std::memcpy(e.magic, MAGIQUE_PAGES, sizeof(MAGIQUE_PAGES));
+    e.version = VERSION;
+    e.realSize = sizeof(Real);
+    e.endianness = BOUTISME_PAGES;
+    e.shapeSize = sizeof(ShapeRecord);
+    e.nodeSize = sizeof(BvhNode);
+    e.pageSize = sizeof(PageRecord);
+    e.nbTop = top.size();
+    e.nbPages = pages.size();
+    e.nbShapes = shapes.size();
+    e.maxMaterial = -1;
+    e.sourceKey = sourceKey;
+
+    std::string temporaire = filename + ".tmp";
+    int fd = open(temporaire.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw std::runtime_error("Impossible de créer le fichier de pages " + temporaire);
+    try {
+        // Pages une à une : seule la page en cours d'écriture est en mémoire
+        std::vector<PageRecord> table(pages.size());
+        std::size_t offset = alignePage(sizeof(EnTetePages) + top.size() * sizeof(BvhNode) + pages.size() * sizeof(PageRecord));
+        int premier = 0;
+        for (std::size_t p = 0; p < pages.size(); p++) {
+            std::vector<Shape*> objets(pages[p].second);
+            std::vector<ShapeRecord> records(objets.size());
+            for (std::size_t k = 0; k < objets.size(); k++) {
+                objets[k] = shapes[indices[pages[p].first + k]];
+                records[k] = objets[k]->getRecord();
+                e.maxMaterial = std::max(e.maxMaterial, records[k].material);
+            }
+            Bvh locale;
+            locale.build(objets);
+            table[p] = {offset, premier, int32_t(objets.size()), locale.getNbNodes(), 0};
+
+            std::size_t taille = records.size() * sizeof(ShapeRecord);
+            ecrit(fd, records.data(), taille, offset, temporaire);
+            ecrit(fd, locale.getNodes(), locale.getNbNodes() * sizeof(BvhNode), offset + taille, temporaire);
+            taille += locale.getNbNodes() * sizeof(BvhNode);
+            ecrit(fd, locale.getIndices(), locale.getNbIndices() * sizeof(int32_t), offset + taille, temporaire);
+            taille += locale.getNbIndices() * sizeof(int32_t);
+            offset = alignePage(offset + taille);
+            premier += objets.size();
+        }
+        e.fileSize = offset;
+        if (ftruncate(fd, e.fileSize) != 0)
+            throw std::runtime_error("Impossible de dimensionner le fichier de pages " + temporaire);
+        ecrit(fd, top.data(), top.size() * sizeof(BvhNode), sizeof(EnTetePages), temporaire);
+        ecrit(fd, table.data(), table.size() * sizeof(PageRecord), sizeof(EnTetePages) + top.size() * sizeof(BvhNode), temporaire);
+        ecrit(fd, &e, sizeof(EnTetePages), 0, temporaire);
+        if (fsync(fd) != 0)
+            throw std::runtime_error("Erreur d'écriture de " + temporaire);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    if (std::rename(temporaire.c_str(), filename.c_str()) != 0)
+        throw std::runtime_error("Impossible de renommer le fichier de pages " + temporaire);
+}
+
+PagedGeometry::PagedGeometry(const std::string& filename, uint64_t sourceKey, std::size_t capacity)
+    : _filename(filename), _fd(-1), _nbShapes(0), _maxMaterial(-1), _capacity(capacity), _bytes(0), _loads(0), _deferred(0) {
+    _fd = open(filename.c_str(), O_RDONLY);
+    if (_fd < 0)
+        throw std::runtime_error("Fichier de pages absent : " + filename);
+    try {
+        struct stat st;
+        EnTetePages e;
+        if (fstat(_fd, &st) != 0 || pread(_fd, &e, sizeof(e), 0) != ssize_t(sizeof(e)))
+            throw std::runtime_error("Fichier de pages tronqué : " + filename);
+        if (std::memcmp(e.magic, MAGIQUE_PAGES, sizeof(MAGIQUE_PAGES)) != 0)
+            throw std::runtime_error(filename + " n'est pas un fichier de pages");
+        if (e.version != VERSION)
+            throw std::runtime_error("Version du fichier de pages différente (" + std::to_string(e.version) + ")");
+        if (e.endianness != BOUTISME_PAGES)
+            throw std::runtime_error("Fichier de pages écrit sur une machine d'un autre boutisme");
+        if (e.realSize != sizeof(Real))
+            throw std::runtime_error("Fichier de pages écrit avec une autre précision (" + std::to_string(e.realSize) + " octets)");
+        if (e.shapeSize != sizeof(ShapeRecord) || e.nodeSize != sizeof(BvhNode) || e.pageSize != sizeof(PageRecord))
+            throw std::runtime_error("Disposition du fichier de pages différente");
+        if (e.sourceKey != sourceKey)
+            throw std::runtime_error("Fichier de pages périmé (scène source modifiée)");
+        if (e.fileSize != uint64_t(st.st_size))
+            throw std::runtime_error("Fichier de pages tronqué : " + filename);
+        if (e.nbTop < 1 || e.nbPages < 1 || e.nbShapes < 0 || uint64_t(e.nbTop) * sizeof(BvhNode) + uint64_t(e.nbPages) * sizeof(PageRecord) > e.fileSize)
+            throw std::runtime_error("Fichier de pages corrompu (en-tête)");
+
+        _top.resize(e.nbTop);
+        _pages.resize(e.nbPages);
+        std::size_t tailleTop = _top.size() * sizeof(BvhNode), tailleTable = _pages.size() * sizeof(PageRecord);
+        if (pread(_fd, _top.data(), tailleTop, sizeof(EnTetePages)) != ssize_t(tailleTop)
+            || pread(_fd, _pages.data(), tailleTable, sizeof(EnTetePages) + tailleTop) != ssize_t(tailleTable))
+            throw std::runtime_error("Fichier de pages tronqué : " + filename);
+        for (int k = 0; k < e.nbTop; k++) {
+            const BvhNode& n = _top[k];
+            bool valide = (n.count == 0) ? (n.first > k && n.first + 1 < e.nbTop)
+                                         : (n.count > 0 && n.first >= 0 && n.first <= e.nbPages - n.count);
+            if (!valide)
+                throw std::runtime_error("Fichier de pages corrompu (noeud " + std::to_string(k) + ")");
+        }
+        for (int p = 0; p < e.nbPages; p++) {
+            const PageRecord& r = _pages[p];
+            uint64_t taille = uint64_t(r.nbShapes) * (sizeof(ShapeRecord) + sizeof(int32_t)) + uint64_t(r.nbNodes) * sizeof(BvhNode);
+            if (r.nbShapes < 0 || r.nbNodes < 0 || r.first < 0 || r.first > e.nbShapes - r.nbShapes
+                || r.offset % ALIGNEMENT_PAGE != 0 || r.offset > e.fileSize || taille > e.fileSize - r.offset)
+                throw std::runtime_error("Fichier de pages corrompu (page " + std::to_string(p) + ")");
+        }
+        _nbShapes = e.nbShapes;
+        _maxMaterial = e.maxMaterial;
+    } catch (...) {
+        close(_fd);
+        throw;
+    }
+}
+
+PagedGeometry::~PagedGeometry() {
+    close(_fd);
+}
+
+PagedGeometry::Page::~Page() {
+    for (Shape* s : shapes)
+        s->~Shape();
+}
+
+std::shared_ptr<PagedGeometry::Page> PagedGeometry::load(int page) const {
+    const PageRecord& r = _pages[page];
+    std::shared_ptr<Page> p = std::make_shared<Page>();
+    std::vector<ShapeRecord> records(r.nbShapes);
+    p->nodes.resize(r.nbNodes);
+    p->indices.resize(r.nbShapes);
+    std::size_t tailleObjets = records.size() * sizeof(ShapeRecord), tailleNoeuds = p->nodes.size() * sizeof(BvhNode);
+    std::size_t tailleIndices = p->indices.size() * sizeof(int32_t);
+    bool valide = pread(_fd, records.data(), tailleObjets, r.offset) == ssize_t(tailleObjets)
+                  && pread(_fd, p->nodes.data(), tailleNoeuds, r.offset + tailleObjets) == ssize_t(tailleNoeuds)
+                  && pread(_fd, p->indices.data(), tailleIndices, r.offset + tailleObjets + tailleNoeuds) == ssize_t(tailleIndices);
+
+    // Mêmes vérifications que le cache de scène, pour ne jamais suivre un indice invalide
+    for (int k = 0; valide && k < r.nbShapes; k++)
+        valide = isKnownShape(records[k]) && records[k].material >= 0 && records[k].material <= _maxMaterial;
+    for (int k = 0; valide && k < r.nbNodes; k++) {
+        const BvhNode& n = p->nodes[k];
+        valide = (n.count == 0) ? (n.first > k && n.first + 1 < r.nbNodes)
+                                : (n.count > 0 && n.first >= 0 && n.first <= r.nbShapes - n.count);
+    }
+    for (int k = 0; valide && k < r.nbShapes; k++)
+        valide = p->indices[k] >= 0 && p->indices[k] < r.nbShapes;
+    if (!valide) {
+        // Fichier modifié pendant le rendu : la page est vide, bien visible
+        static std::once_flag avertissement;
+        std::call_once(avertissement, [&] { std::cerr << "Lecture de la page " << page << " de " << _filename << " impossible" << std::endl; });
+        p->nodes.clear();
+        p->indices.clear();
+        return p;
+    }
+
+    p->arena.reserve(records.size() * (std::max({sizeof(Sphere), sizeof(CubeQuad), sizeof(SdfShape)}) + alignof(SdfShape)));
+    p->shapes.reserve(records.size());
+    for (const ShapeRecord& record : records)
+        p->shapes.push_back(createShape(p->arena, record));
+    p->bvh.view(p->nodes.data(), p->nodes.size(), p->indices.data(), p->indices.size());
+    p->bytes = sizeof(Page) + p->arena.getUsed() + p->shapes.size() * sizeof(Shape*) + tailleNoeuds + tailleIndices;
+    _loads++;
+    return p;
+}
+
+void PagedGeometry::evict(std::size_t capacity) const {
+    // On garde au moins la page la plus récente, quelle que soit la capacité
+    while (_bytes > capacity && _lru.size() > 1) {
+        auto it = _resident.find(_lru.back());
+        _bytes -= it->second.first->bytes;
+        _resident.erase(it);
+        _lru.pop_back();
+    }
+}
+
+void PagedGeometry::setCapacity(std::size_t capacity) {
+    _capacity = capacity;
+    std::lock_guard<std::mutex> lock(_mutex);
+    evict(capacity);
+}
+
+std::size_t PagedGeometry::getResidentBytes() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _bytes;
+}
+
+std::vector<PagedGeometry::PagePtr> PagedGeometry::residentPages() const {
+    std::vector<PagePtr> pages(_pages.size());
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto& r : _resident)
+        pages[r.first] = r.second.first;
+    return pages;
+}
+
+void PagedGeometry::touch(const std::vector<int>& pages) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (int p : pages) {
+        auto it = _resident.find(p);
+        if (it != _resident.end())
+            _lru.splice(_lru.begin(), _lru, it->second.second);
+    }
+}
+
+PagedGeometry::PagePtr PagedGeometry::getPage(int page) const {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _resident.find(page);
+        if (it != _resident.end()) {
+            _lru.splice(_lru.begin(), _lru, it->second.second);
+            return it->second.first;
+        }
+    }
+
+    // Lecture hors verrou : les autres threads continuent de traiter leurs pages
+    PagePtr p = load(page);
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _resident.find(page);
+    if (it != _resident.end())
+        return it->second.first;
+    _lru.push_front(page);
+    _resident[page] = {p, _lru.begin()};
+    _bytes += p->bytes;
+    evict(_capacity);
+    return p;
+}
+
+std::vector<std::vector<PagedGeometry::Attente>> PagedGeometry::regroupe(std::vector<std::vector<Attente>>& attentes) const {
+    std::vector<std::vector<Attente>> parPage(_pages.size());
+    for (std::vector<Attente>& liste : attentes) {
+        for (const Attente& a : liste)
+            parPage[a.page].push_back(a);
+        _deferred += liste.size();
+        std::vector<Attente>().swap(liste);
+    }
+    return parPage;
+}
+
+/**
+ * @brief Premier parcours de l'arbre des pages pour un rayon, du plus proche au plus
+ * loin : visite(page, entrée) est appelée pour chaque page dont la boîte est atteinte
+ * avant tMax() et retourne faux pour arrêter le parcours
+ */
+template<class Visite, class Limite>
+static void parcourtPages(const std::vector<BvhNode>& top, const Ray3f& ray, Limite tMax, Visite visite) {
+    RayonBoite rb(ray);
+    int pile[PROFONDEUR_ARBRE];
+    Real entrees[PROFONDEUR_ARBRE];
+    int sommet = 0;
+    Real e = rb.entree(top[0], tMax());
+    if (e == std::numeric_limits<Real>::infinity())
+        return;
+    pile[sommet] = 0;
+    entrees[sommet++] = e;
+    while (sommet > 0) {
+        sommet--;
+        const BvhNode& node = top[pile[sommet]];
+        if (entrees[sommet] > tMax())
+            continue;
+        if (node.count > 0) {
+            for (int p = node.first; p < node.first + node.count; p++) {
+                if (!visite(p, entrees[sommet]))
+                    return;
+            }
+            continue;
+        }
+        Real e0 = rb.entree(top[node.first], tMax());
+        Real e1 = rb.entree(top[node.first + 1], tMax());
+        int proche = node.first, loin = node.first + 1;
+        if (e1 < e0) {
+            std::swap(e0, e1);
+            std::swap(proche, loin);
+        }
+        if (e1 != std::numeric_limits<Real>::infinity() && sommet < PROFONDEUR_ARBRE) {
+            pile[sommet] = loin;
+            entrees[sommet++] = e1;
+        }
+        if (e0 != std::numeric_limits<Real>::infinity() && sommet < PROFONDEUR_ARBRE) {
+            pile[sommet] = proche;
+            entrees[sommet++] = e0;
+        }
+    }
+}
+
+void PagedGeometry::closestHits(const std::vector<Ray3f>& rays, std::vector<Hit>& hits, int nbThreads) const {
+    int nbRayons = rays.size();
+    hits.assign(nbRayons, Hit{std::numeric_limits<Real>::max(), -1, ShapeRecord()});
+    if (nbRayons == 0)
+        return;
+
+    // 1) Pages déjà en mémoire : testées tout de suite, les autres mettent le rayon en attente
+    int nbPaquets = (nbRayons + RAYONS_PAR_PAQUET - 1) / RAYONS_PAR_PAQUET;
+    std::vector<std::vector<Attente>> attentes(nbPaquets);
+    {
+        std::vector<PagePtr> residentes = residentPages();
+        std::vector<std::atomic<char>> utilisees(_pages.size());
+        parallelFor(nbPaquets, nbThreads, [&](int paquet) {
+            int fin = std::min(nbRayons, (paquet + 1) * RAYONS_PAR_PAQUET);
+            for (int r = paquet * RAYONS_PAR_PAQUET; r < fin; r++) {
+                Hit& h = hits[r];
+                parcourtPages(_top, rays[r], [&] { return h.t; }, [&](int p, Real entree) {
+                    const Page* page = residentes[p].get();
+                    if (page == nullptr) {
+                        attentes[paquet].push_back({p, r, entree});
+                        return true;
+                    }
+                    utilisees[p].store(1, std::memory_order_relaxed);
+                    Real t;
+                    int k = page->bvh.closestHit(rays[r], page->shapes, t);
+                    int id = (k == -1) ? -1 : _pages[p].first + k;
+                    if (k != -1 && (t < h.t || (t == h.t && id < h.shape)))
+                        h = {t, id, page->shapes[k]->getRecord()};
+                    return true;
+                });
+            }
+        });
+        std::vector<int> pages;
+        for (std::size_t p = 0; p < _pages.size(); p++) {
+            if (utilisees[p])
+                pages.push_back(p);
+        }
+        touch(pages);
+    }
+
+    // 2) Chaque page attendue est lue une fois pour tous ses rayons ; les impacts trouvés
+    // sont fusionnés ensuite, une page ne voit donc que les distances du premier parcours
+    std::vector<std::vector<Attente>> parPage = regroupe(attentes);
+    std::vector<int> pagesAttendues;
+    for (std::size_t p = 0; p < parPage.size(); p++) {
+        if (!parPage[p].empty())
+            pagesAttendues.push_back(p);
+    }
+    std::vector<std::vector<std::pair<int, Hit>>> trouves(pagesAttendues.size());
+    parallelFor(pagesAttendues.size(), nbThreads, [&](int n) {
+        int p = pagesAttendues[n];
+        PagePtr page = getPage(p);
+        for (const Attente& a : parPage[p]) {
+            if (a.entry > hits[a.ray].t)
+                continue;
+            Real t;
+            int k = page->bvh.closestHit(rays[a.ray], page->shapes, t);
+            if (k != -1)
+                trouves[n].push_back({a.ray, Hit{t, _pages[p].first + k, page->shapes[k]->getRecord()}});
+        }
+    });
+    for (const auto& liste : trouves) {
+        for (const auto& [r, hit] : liste) {
+            Hit& h = hits[r];
+            if (hit.t < h.t || (hit.t == h.t && hit.shape < h.shape))
+                h = hit;
+        }
+    }
+}
+
+void PagedGeometry::occluded(const std::vector<Ray3f>& rays, const std::vector<Real>& distances, std::vector<char>& result,
+                             int nbThreads) const {
+    int nbRayons = rays.size();
+    result.assign(nbRayons, 0);
+    if (nbRayons == 0)
+        return;
+
+    int nbPaquets = (nbRayons + RAYONS_PAR_PAQUET - 1) / RAYONS_PAR_PAQUET;
+    std::vector<std::vector<Attente>> attentes(nbPaquets);
+    {
+        std::vector<PagePtr> residentes = residentPages();
+        std::vector<std::atomic<char>> utilisees(_pages.size());
+        parallelFor(nbPaquets, nbThreads, [&](int paquet) {
+            int fin = std::min(nbRayons, (paquet + 1) * RAYONS_PAR_PAQUET);
+            for (int r = paquet * RAYONS_PAR_PAQUET; r < fin; r++) {
+                std::size_t debut = attentes[paquet].size();
+                parcourtPages(_top, rays[r], [&] { return distances[r]; }, [&](int p, Real entree) {
+                    const Page* page = residentes[p].get();
+                    if (page == nullptr) {
+                        attentes[paquet].push_back({p, r, entree});
+                        return true;
+                    }
+                    utilisees[p].store(1, std::memory_order_relaxed);
+                    if (!page->bvh.occluded(rays[r], page->shapes, distances[r]))
+                        return true;
+                    result[r] = 1;
+                    return false;
+                });
+                // Un rayon déjà occulté n'attend plus aucune page
+                if (result[r])
+                    attentes[paquet].resize(debut);
+            }
+        });
+        std::vector<int> pages;
+        for (std::size_t p = 0; p < _pages.size(); p++) {
+            if (utilisees[p])
+                pages.push_back(p);
+        }
+        touch(pages);
+    }
+
+    std::vector<std::vector<Attente>> parPage = regroupe(attentes);
+    std::vector<int> pagesAttendues;
+    for (std::size_t p = 0; p < parPage.size(); p++) {
+        if (!parPage[p].empty())
+            pagesAttendues.push_back(p);
+    }
+    std::vector<std::vector<int>> occultes(pagesAttendues.size());
+    parallelFor(pagesAttendues.size(), nbThreads, [&](int n) {
+        int p = pagesAttendues[n];
+        PagePtr page = getPage(p);
+        for (const Attente& a : parPage[p]) {
+            if (page->bvh.occluded(rays[a.ray], page->shapes, distances[a.ray]))
+                occultes[n].push_back(a.ray);
+        }
+    });
+    for (const std::vector<int>& liste : occultes) {
+        for (int r : liste)
+            result[r] = 1;
+    }
+}
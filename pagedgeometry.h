@@ -0,0 +1,216 @@
+/**
+ * @file pagedgeometry.h
+ * @brief Création de la classe PagedGeometry (géométrie hors mémoire, lue par pages)
+ */
+#ifndef PAGEDGEOMETRY_H
+#define PAGEDGEOMETRY_H
+
+#include "arena.h"
+#include "bvh.h"
+#include "ray3f.h"
+#include "shape.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Vérifie qu'un enregistrement relu d'un fichier décrit un objet connu (type, et
+ * primitives d'un SdfShape), avant de le construire
+ *
+ * @param record
+ * @return bool
+ */
+bool isKnownShape(const ShapeRecord& record);
+
+/**
+ * @brief Construit dans l'Arena l'objet décrit par un enregistrement
+ *
+ * @param arena
+ * @param record
+ * @return Shape*
+ */
+Shape* createShape(Arena& arena, const ShapeRecord& record);
+
+/**
+ * @brief Construit l'objet décrit par un enregistrement dans une mémoire libre, prise à
+ * un objet du même type détruit (même taille et même alignement)
+ *
+ * @param memory
+ * @param record
+ * @return Shape*
+ */
+Shape* createShape(void* memory, const ShapeRecord& record);
+
+/**
+ * @brief Géométrie hors mémoire. Les objets sont regroupés en pages spatialement
+ * cohérentes (sous-arbres de la hiérarchie de la scène), enregistrées sur le disque
+ * avec leur propre hiérarchie ; seul l'arbre des pages reste en mémoire. Une page n'est
+ * lue qu'au moment où un parcours l'atteint, et les pages sont évincées dans l'ordre
+ * LRU au-delà d'une capacité fixée. Les requêtes se font par lots de rayons : un rayon
+ * qui atteint une page absente est mis en attente sur cette page, puis chaque page
+ * attendue est lue une seule fois pour tous les rayons du lot
+ *
+ * en-tête | BvhNode[] (arbre des pages) | PageRecord[] | pages (alignées sur 4 Ko)
+ * page : ShapeRecord[] | BvhNode[] | int32 (indices locaux)
+ *
+ */
+class PagedGeometry {
+
+    public:
+        /**
+         * @brief Nombre maximal d'objets par page par défaut
+         */
+        static const int SHAPES_PER_PAGE = 4096;
+
+        /**
+         * @brief Version du format, à incrémenter à chaque modification de la disposition
+         */
+        static const uint32_t VERSION = 2;
+
+        /**
+         * @brief Impact d'un rayon : distance, indice de l'objet dans la géométrie paginée
+         * (-1 si aucun) et copie de l'objet, qui reste utilisable après l'éviction de sa page
+         */
+        struct Hit {
+            Real t;
+            int32_t shape;
+            ShapeRecord record;
+        };
+
+        /**
+         * @brief Découpe les objets en pages et les enregistre (fichier temporaire renommé
+         * à la fin, comme le cache de scène). Lève une exception en cas d'erreur d'écriture
+         *
+         * @param filename
+         * @param sourceKey clé de la scène source
+         * @param shapes objets de la scène
+         * @param bvh hiérarchie construite sur ces objets (elle donne le découpage spatial)
+         * @param shapesPerPage nombre maximal d'objets par page
+         */
+        static void write(const std::string& filename, uint64_t sourceKey, const std::vector<Shape*>& shapes, const Bvh& bvh,
+                          int shapesPerPage = SHAPES_PER_PAGE);
+
+        /**
+         * @brief Ouvre un fichier de pages : lit et vérifie l'en-tête, l'arbre et la table
+         * des pages (aucune page n'est lue). Lève une exception si le fichier est absent,
+         * périmé ou incohérent
+         *
+         * @param filename
+         * @param sourceKey clé attendue de la scène source
+         * @param capacity taille maximale des pages en mémoire, en octets
+         */
+        PagedGeometry(const std::string& filename, uint64_t sourceKey, std::size_t capacity);
+
+        /**
+         * @brief Ferme le fichier
+         */
+        ~PagedGeometry();
+
+        PagedGeometry(const PagedGeometry&) = delete;
+        PagedGeometry& operator=(const PagedGeometry&) = delete;
+
+        /**
+         * @brief Impact le plus proche de chaque rayon du lot (à distance égale, le plus
+         * petit indice d'objet)
+         *
+         * @param rays
+         * @param hits reçoit un impact par rayon
+         * @param nbThreads nombre de threads (<= 0 : tous les coeurs)
+         */
+        void closestHits(const std::vector<Ray3f>& rays, std::vector<Hit>& hits, int nbThreads = 0) const;
+
+        /**
+         * @brief Teste pour chaque rayon du lot si un objet le coupe avant sa distance
+         *
+         * @param rays
+         * @param distances
+         * @param result reçoit 1 pour un rayon occulté, 0 sinon
+         * @param nbThreads nombre de threads (<= 0 : tous les coeurs)
+         */
+        void occluded(const std::vector<Ray3f>& rays, const std::vector<Real>& distances, std::vector<char>& result,
+                      int nbThreads = 0) const;
+
+        /**
+         * @brief Modifie la capacité (les pages en trop sont libérées)
+         *
+         * @param capacity en octets
+         */
+        void setCapacity(std::size_t capacity);
+
+        inline std::size_t getCapacity() const {return _capacity;};
+        inline int getNbPages() const {return _pages.size();};
+        inline int getNbShapes() const {return _nbShapes;};
+        inline int getMaxMaterial() const {return _maxMaterial;};
+
+        /**
+         * @brief Statistiques : octets des pages en mémoire, pages lues sur le disque et
+         * rayons mis en attente d'une page
+         */
+        std::size_t getResidentBytes() const;
+        inline uint64_t getLoads() const {return _loads;};
+        inline uint64_t getDeferred() const {return _deferred;};
+
+        /**
+         * @brief Page telle qu'elle est décrite dans le fichier
+         */
+        struct PageRecord {
+            uint64_t offset;
+            int32_t first;      // Indice de son premier objet dans la géométrie paginée
+            int32_t nbShapes;
+            int32_t nbNodes;
+            int32_t reserve;
+        };
+
+    private:
+        /**
+         * @brief Page en mémoire : ses objets dans leur propre Arena et sa hiérarchie
+         */
+        struct Page {
+            Arena arena;
+            std::vector<Shape*> shapes;
+            std::vector<BvhNode> nodes;
+            std::vector<int32_t> indices;
+            Bvh bvh;
+            std::size_t bytes = 0;
+
+            ~Page();
+        };
+        typedef std::shared_ptr<const Page> PagePtr;    // Une page évincée reste valide pour ses lecteurs
+
+        /**
+         * @brief Rayon en attente d'une page : indice du rayon et distance d'entrée dans
+         * la boîte de la page
+         */
+        struct Attente {
+            int32_t page, ray;
+            Real entry;
+        };
+
+        std::string _filename;
+        int _fd;
+        std::vector<BvhNode> _top;
+        std::vector<PageRecord> _pages;
+        int _nbShapes, _maxMaterial;
+
+        std::atomic<std::size_t> _capacity;
+        mutable std::mutex _mutex;
+        mutable std::list<int> _lru;    // Pages, de la plus récemment utilisée à la plus ancienne
+        mutable std::unordered_map<int, std::pair<PagePtr, std::list<int>::iterator>> _resident;
+        mutable std::size_t _bytes;
+        mutable std::atomic<uint64_t> _loads, _deferred;
+
+        std::vector<PagePtr> residentPages() const;
+        void touch(const std::vector<int>& pages) const;
+        PagePtr getPage(int page) const;
+        std::shared_ptr<Page> load(int page) const;
+        void evict(std::size_t capacity) const;
+        std::vector<std::vector<Attente>> regroupe(std::vector<std::vector<Attente>>& attentes) const;
+};
+
+#endif
@@ -0,0 +1,62 @@
+/**
+ * @file parallel.cpp
+ * @brief Implémentation de la boucle parallèle
+ */
+
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+int defaultNbThreads() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void parallelFor(int count, int nbThreads, const std::function<void(int)>& fn) {
+    if (nbThreads <= 0)
+        nbThreads = defaultNbThreads();
+    nbThreads = std::min(nbThreads, count);
+    if (nbThreads <= 1) {
+        for (int k = 0; k < count; k++)
+            fn(k);
+        return;
+    }
+
+    // La première exception d'un thread arrête la distribution des indices ; elle est
+    // relancée dans le thread appelant quand tous les threads sont terminés
+    std::atomic<int> next(0);
+    std::exception_ptr erreur;
+    std::mutex mutexErreur;
+    auto arrete = [&](std::exception_ptr e) {
+        std::lock_guard<std::mutex> verrou(mutexErreur);
+        if (!erreur)
+            erreur = e;
+        next = count;
+    };
+    auto worker = [&]() {
+        try {
+            for (int k = next++; k < count; k = next++)
+                fn(k);
+        } catch (...) {
+            arrete(std::current_exception());
+        }
+    };
+
+    // Le thread appelant travaille aussi
+    std::vector<std::thread> threads;
+    try {
+        threads.reserve(nbThreads - 1);
+        for (int t = 1; t < nbThreads; t++)
+            threads.emplace_back(worker);
+    } catch (...) {
+        arrete(std::current_exception());
+    }
+    worker();
+    for (std::thread& t : threads)
+        t.join();
+    if (erreur)
+        std::rethrow_exception(erreur);
+}
@@ -0,0 +1,30 @@
+/**
+ * @file parallel.h
+ * @brief Boucle parallèle simple sur des std::thread
+ */
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <functional>
+
+/**
+ * @brief Retourne le nombre de threads matériels (au moins 1)
+ *
+ * @return int
+ */
+int defaultNbThreads();
+
+/**
+ * @brief Appelle fn(k) pour k de 0 à count-1 sur nbThreads threads. Les indices
+ * sont distribués dynamiquement (compteur atomique) pour équilibrer la charge. Si fn
+ * lève une exception (ou si un thread ne peut pas être créé), les indices pas encore
+ * distribués sont abandonnés et la première exception est relancée une fois tous les
+ * threads terminés
+ *
+ * @param count nombre d'itérations
+ * @param nbThreads nombre de threads (<= 0 : defaultNbThreads())
+ * @param fn corps de la boucle
+ */
+void parallelFor(int count, int nbThreads, const std::function<void(int)>& fn);
+
+#endif
@@ -0,0 +1,181 @@
+/**
+ * @file pathtracer.cpp
+ * @brief Implémentation du tracé de chemins de Monte-Carlo
+ */
+
+#include "pathtracer.h"
+#include "costmap.h"
+#include "perfcounters.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+const int PROFONDEUR_ROULETTE = 3;    // Rebond à partir duquel la roulette russe s'applique
+
+int closestHit(const Ray3f& rayon, const std::vector<Shape*>& objets, const Candidates& candidats, Real& t) {
+    PerfStage etape(STAGE_CLOSEST_HIT, 1);
+    int indexPlusProche = -1;
+    t = std::numeric_limits<Real>::max();
+    for (int c = 0; c < candidats.count; c++) {
+        int k = candidats.indices[c];
+        Real tk = objets[k]->is_hit(rayon);
+        if (tk > 0 && tk < t) {
+            t = tk;
+            indexPlusProche = k;
+        }
+    }
+    countRay(candidats.count, 0);
+    return indexPlusProche;
+}
+
+/**
+ * @brief Part de la lumière qui parcourt le segment [p, cible] : 0 s'il rencontre un objet,
+ * la transmittance des milieux sinon
+ */
+static Real transmission(const Vector3f& p, const Vector3f& cible, const std::vector<Shape*>& objets, const Bvh& bvh,
+                         const std::vector<Medium>& milieux, Rng& rng) {
+    Vector3f d = cible - p;
+    Real dist = d.norm();
+    Ray3f ray(p, d / dist);
+    if (bvh.occluded(ray, objets, dist))
+        return 0;
+    return milieux.empty() ? 1 : mediaTransmittance(milieux, ray, dist, rng);
+}
+
+/**
+ * @brief Tire une direction selon une densité proportionnelle au cosinus autour de n
+ * (repère orthonormé de Duff et al. 2017)
+ */
+static Vector3f sampleCosine(const Vector3f& n, Real u1, Real u2) {
+    Real sign = std::copysign(Real(1), n.getZ());
+    Real a = -1 / (sign + n.getZ());
+    Real b = n.getX() * n.getY() * a;
+    Vector3f tangent(1 + sign * n.getX() * n.getX() * a, sign * b, -sign * n.getX());
+    Vector3f bitangent(b, sign + n.getY() * n.getY() * a, -n.getY());
+
+    Real r = std::sqrt(u1), phi = 2 * M_PI * u2;
+    return tangent * (r * std::cos(phi)) + bitangent * (r * std::sin(phi)) + n * std::sqrt(std::max(Real(0), 1 - u1));
+}
+
+/**
+ * @brief Tire une direction uniforme sur la sphère (diffusion isotrope)
+ */
+static Vector3f sampleSphere(Real u1, Real u2) {
+    Real z = 1 - 2 * u1;
+    Real r = std::sqrt(std::max(Real(0), 1 - z * z)), phi = 2 * M_PI * u2;
+    return Vector3f(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+/**
+ * @brief Point visé sur la source pour l'estimation directe depuis p
+ */
+static Vector3f cibleSource(const Ray3f& source, const AreaLight& light, const Vector3f& p, Rng& rng) {
+    if (light.isPoint())
+        return source.getOrigin();
+    Real u = rng.next(), v = rng.next();
+    return light.samplePoint(source, p, u, v);
+}
+
+/**
+ * @brief Roulette russe au-delà de PROFONDEUR_ROULETTE rebonds : le chemin s'arrête avec
+ * une probabilité liée à son poids, qui est compensé s'il continue
+ *
+ * @return false si le chemin s'arrête
+ */
+static bool roulette(Vector3f& poids, int depth, Rng& rng) {
+    if (depth < PROFONDEUR_ROULETTE)
+        return true;
+    Real q = std::min(Real(0.95), std::max(poids.getX(), std::max(poids.getY(), poids.getZ())));
+    if (rng.next() >= q)
+        return false;
+    poids = poids / q;
+    return true;
+}
+
+Vector3f tracePath(const Ray3f& rayon, const std::vector<Shape*>& objets, const Bvh& bvh, const MaterialTable& materiaux, const Ray3f& source, const AreaLight& light,
+                   const std::vector<Medium>& milieux, int maxDepth, Rng& rng,
+                   PixelAov* aov, const Candidates* candidats, Real ouverture) {
+    Vector3f radiance(0), poids(1);
+    Ray3f ray = rayon;
+    Real largeur = 0;   // Largeur du cône de rayon à l'origine du rayon courant
+    if (aov != nullptr)
+        *aov = {Vector3f(0), Vector3f(0), -1};
+
+    for (int depth = 0; depth <= maxDepth; depth++) {
+        Real t;
+        int k = (depth == 0 && candidats != nullptr) ? closestHit(ray, objets, *candidats, t) : bvh.closestHit(ray, objets, t);
+
+        // Collision avec un milieu avant l'objet (suivi delta) : diffusion isotrope
+        Real tMilieu;
+        int m = milieux.empty() ? -1 : sampleMediaCollision(milieux, ray, (k == -1) ? std::numeric_limits<Real>::infinity() : t, rng, tMilieu);
+        if (m >= 0) {
+            Vector3f p = ray.pointAt(tMilieu);
+            const Vector3f& albedo = milieux[m].getAlbedo();
+            if (depth == 0 && aov != nullptr)
+                *aov = {albedo, ray.getDirection() * -1, float(tMilieu), -1};
+            // Fonction de phase 1 / (4 pi) : le quart de la réponse d'une surface blanche
+            // éclairée sous incidence normale
+            Vector3f cible = cibleSource(source, light, p, rng);
+            Real transmis = transmission(p, cible, objets, bvh, milieux, rng);
+            if (transmis > 0)
+                radiance = radiance + poids * albedo * (transmis * PUISSANCE_SOURCE / 4);
+            poids = poids * albedo;
+            if (!roulette(poids, depth, rng))
+                break;
+            ray = Ray3f(p, sampleSphere(rng.next(), rng.next()));
+            continue;
+        }
+        if (k == -1) // Fond noir
+            break;
+
+        const Shape& objet = *objets[k];
+        Vector3f p = ray.pointAt(t);
+        Vector3f normal = objet.getNormal(p);
+        if (normal.squaredNorm() == 0)
+            break;
+        // La normale est orientée du côté d'où vient le rayon
+        normal = normal.normalized();
+        if (normal.dot(ray.getDirection()) > 0)
+            normal = normal * -1;
+        largeur += ouverture * t;
+        Material mat = materiaux[objet.getMaterial()];
+        if (materiaux.isTextured(objet.getMaterial())) {
+            Vector3f uv = textureCoordinates(objet, p, ray.getDirection(), normal, largeur);
+            mat = materiaux.resolve(objet.getMaterial(), uv[0], uv[1], uv[2]);
+        }
+        Vector3f origine = p + normal * Epsilon<Real>::SURFACE;
+        // Albédo moyen du premier impact : la réflexion miroir, choisie avec la probabilité
+        // shininess, renvoie toute la lumière
+        if (depth == 0 && aov != nullptr) {
+            Real s = mat.getShininess();
+            *aov = {Vector3f(mat.getR(), mat.getG(), mat.getB()) / 255 * (1 - s) + Vector3f(s), normal, float(t), k};
+        }
+
+        // Réflexion miroir avec une probabilité égale à la shininess (poids 1)
+        if (rng.next() < mat.getShininess()) {
+            ray = Ray3f(origine, ray.getDirection().reflect(normal));
+            continue;
+        }
+
+        // Sinon rebond diffus (Lambert) d'albédo la couleur du matériau
+        Vector3f albedo = Vector3f(mat.getR(), mat.getG(), mat.getB()) / 255;
+
+        // Estimation directe de la source (next event estimation), vers un point tiré
+        // sur sa surface si elle est étendue
+        Vector3f cible = cibleSource(source, light, p, rng);
+        Vector3f dirVersSource = (cible - p).normalized();
+        Real cosSource = normal.dot(dirVersSource);
+        if (cosSource > 0) {
+            Real transmis = transmission(origine, cible, objets, bvh, milieux, rng);
+            if (transmis > 0)
+                radiance = radiance + poids * albedo * (cosSource * transmis * PUISSANCE_SOURCE);
+        }
+
+        // Echantillonnage en cosinus : brdf * cos / pdf = albédo
+        poids = poids * albedo;
+        if (!roulette(poids, depth, rng))
+            break;
+        ray = Ray3f(origine, sampleCosine(normal, rng.next(), rng.next()));
+    }
+    return radiance;
+}
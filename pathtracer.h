@@ -0,0 +1,73 @@
+/**
+ * @file pathtracer.h
+ * @brief Intégrateur par tracé de chemins de Monte-Carlo
+ */
+#ifndef PATHTRACER_H
+#define PATHTRACER_H
+
+#include "ray3f.h"
+#include "shape.h"
+#include "bvh.h"
+#include "texture.h"
+#include "rng.h"
+#include "tileculling.h"
+#include "light.h"
+#include "medium.h"
+#include <vector>
+
+/**
+ * @brief Puissance de la source ponctuelle, en unités de couleur (0-255) : une surface
+ * blanche éclairée sous incidence normale renvoie 255 en éclairage direct
+ */
+const float PUISSANCE_SOURCE = 255;
+
+/**
+ * @brief Informations du premier impact d'un rayon (tampons auxiliaires du débruitage et
+ * de la reconstruction des pixels non tracés)
+ */
+struct PixelAov {
+    Vector3f albedo;    // Couleur du matériau (entre 0 et 1 ; tracé de chemins : moyennée avec le blanc du miroir)
+    Vector3f normal;    // Normale orientée vers le rayon
+    float depth;        // Distance à l'origine du rayon (-1 si aucun impact)
+    int shape = -1;     // Objet touché (indice dans la liste des objets, -1 si aucun impact)
+    float variance = 0; // Variance de la luminance moyenne des échantillons du pixel (tracé de chemins)
+};
+
+/**
+ * @brief Cherche l'objet le plus proche le long du rayon parmi les candidats seulement
+ *
+ * @param rayon
+ * @param objets
+ * @param candidats indices des objets à tester
+ * @param t distance de l'intersection (sortie)
+ * @return int indice de l'objet dans objets, -1 si aucun
+ */
+int closestHit(const Ray3f& rayon, const std::vector<Shape*>& objets, const Candidates& candidats, Real& t);
+
+/**
+ * @brief Estime la radiance le long du rayon par un chemin aléatoire : échantillonnage
+ * en cosinus des rebonds diffus, réflexion miroir avec une probabilité égale à la
+ * shininess, estimation directe de la source à chaque rebond diffus et roulette
+ * russe au-delà de 3 rebonds
+ *
+ * @param rayon rayon primaire
+ * @param objets objets de la scène
+ * @param bvh hiérarchie de boîtes des objets
+ * @param materiaux table des matériaux de la scène et leurs textures
+ * @param source source de lumière (centre et normale)
+ * @param light forme de la source : l'estimation directe vise un point tiré sur sa surface
+ * @param milieux milieux participants : collisions tirées par suivi delta, diffusion
+ * isotrope, rayons d'ombre atténués par leur transmittance (suivi par rapports)
+ * @param maxDepth nombre maximal de rebonds
+ * @param rng générateur du pixel et de l'échantillon courants
+ * @param aov si non nul, reçoit les informations du premier impact
+ * @param candidats si non nul, seuls ces objets sont testés pour le rayon primaire
+ * @param ouverture angle d'ouverture du cône du rayon primaire (choix du niveau de mip-map
+ * des textures), gardé le long du chemin
+ * @return Vector3f radiance (composantes R, G, B entre 0 et 255, non bornées)
+ */
+Vector3f tracePath(const Ray3f& rayon, const std::vector<Shape*>& objets, const Bvh& bvh, const MaterialTable& materiaux, const Ray3f& source, const AreaLight& light,
+                   const std::vector<Medium>& milieux, int maxDepth, Rng& rng,
+                   PixelAov* aov = nullptr, const Candidates* candidats = nullptr, Real ouverture = 0);
+
+#endif
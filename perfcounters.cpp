@@ -0,0 +1,301 @@
+/**
+ * @file perfcounters.cpp
+ * @brief Implémentation des classes PerfThread et PerfProfiler
+ */
+
+#include "perfcounters.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+const char* NOMS_ETAPES[NB_STAGES] = {"génération", "impact", "ombre", "ombrage", "écriture"};
+
+static uint64_t horloge() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#ifdef __linux__
+/**
+ * @brief Ouvre le compteur d'un événement pour le thread appelant, dans le groupe du
+ * premier compteur ouvert (comptés ensemble) ou seul si le groupe le refuse
+ *
+ * @return int descripteur, -1 en cas d'échec (errno indique la raison)
+ */
+static int ouvre(PerfEvent e, int groupe) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    switch (e) {
+        case PERF_CYCLES: attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+        case PERF_INSTRUCTIONS: attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+        case PERF_L1_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case PERF_LLC_MISSES: attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+        default: attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+    }
+    int fd = syscall(SYS_perf_event_open, &attr, 0, -1, groupe, 0);
+    if (fd == -1 && groupe != -1)
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    return fd;
+}
+#endif
+
+PerfThread::PerfThread() : _dernierNs(horloge()), _profondeur(0) {
+    int groupe = -1;
+    for (int e = 0; e < NB_PERF_EVENTS; e++) {
+        _fds[e] = -1;
+        _pages[e] = nullptr;
+        _derniers[e] = 0;
+#ifdef __linux__
+        _fds[e] = ouvre(PerfEvent(e), groupe);
+        if (_fds[e] == -1) {
+            if (_error.empty())
+                _error = std::strerror(errno);
+            continue;
+        }
+        if (groupe == -1)
+            groupe = _fds[e];
+        void* page = mmap(nullptr, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, _fds[e], 0);
+        _pages[e] = (page == MAP_FAILED) ? nullptr : page;
+        _derniers[e] = lit(e);
+#endif
+    }
+#ifndef __linux__
+    _error = "compteurs matériels non pris en charge sur ce système";
+#endif
+}
+
+PerfThread::~PerfThread() {
+#ifdef __linux__
+    for (int e = 0; e < NB_PERF_EVENTS; e++) {
+        if (_pages[e] != nullptr)
+            munmap(_pages[e], sysconf(_SC_PAGESIZE));
+        if (_fds[e] != -1)
+            close(_fds[e]);
+    }
+#endif
+}
+
+uint64_t PerfThread::lit(int e) const {
+#ifdef __linux__
+#if defined(__x86_64__) || defined(__i386__)
+    // Lecture en espace utilisateur, recommencée si le noyau a changé la page entre-temps
+    const volatile perf_event_mmap_page* page = static_cast<const perf_event_mmap_page*>(_pages[e]);
+    if (page != nullptr && page->cap_user_rdpmc) {
+        while (true) {
+            uint32_t sequence = page->lock;
+            std::atomic_signal_fence(std::memory_order_acquire);
+            uint32_t index = page->index;
+            int64_t valeur = page->offset;
+            if (index == 0)
+                break;      // Compteur pas sur le processeur en ce moment
+            uint16_t largeur = page->pmc_width;
+            int64_t brut = __rdpmc(index - 1);
+            brut <<= 64 - largeur;
+            brut >>= 64 - largeur;
+            valeur += brut;
+            std::atomic_signal_fence(std::memory_order_acquire);
+            if (page->lock == sequence)
+                return valeur;
+        }
+    }
+#endif
+    uint64_t valeur = 0;
+    if (read(_fds[e], &valeur, sizeof(valeur)) != sizeof(valeur))
+        return _derniers[e];
+    return valeur;
+#else
+    (void)e;
+    return 0;
+#endif
+}
+
+void PerfThread::avance() {
+    uint64_t ns = horloge();
+    if (_profondeur > 0) {
+        StageReading& etape = readings[_pile[std::min(_profondeur, int(PROFONDEUR_MAX)) - 1]];
+        etape.nanoseconds += ns - _dernierNs;
+        for (int e = 0; e < NB_PERF_EVENTS; e++) {
+            if (_fds[e] == -1)
+                continue;
+            uint64_t valeur = lit(e);
+            etape.events[e] += valeur - _derniers[e];
+            _derniers[e] = valeur;
+        }
+    } else {
+        for (int e = 0; e < NB_PERF_EVENTS; e++) {
+            if (_fds[e] != -1)
+                _derniers[e] = lit(e);
+        }
+    }
+    _dernierNs = ns;
+}
+
+void PerfThread::push(RenderStage stage) {
+    avance();
+    // Au-delà de la profondeur maximale, les mesures restent à l'étape la plus profonde
+    if (_profondeur < PROFONDEUR_MAX)
+        _pile[_profondeur] = stage;
+    _profondeur++;
+}
+
+void PerfThread::enter(RenderStage stage, uint32_t rays) {
+    push(stage);
+    readings[stage].calls++;
+    readings[stage].rays += rays;
+}
+
+void PerfThread::leave() {
+    avance();
+    _profondeur--;
+}
+
+/**
+ * @brief Compteurs de chaque thread, ouverts à sa première mesure
+ */
+static thread_local std::unique_ptr<PerfThread> compteursThread;
+
+PerfThreadScope::PerfThreadScope(PerfProfiler* profiler) : _profiler(nullptr) {
+    if (profiler == nullptr || perfCounters != nullptr)
+        return;
+    if (!compteursThread)
+        compteursThread.reset(new PerfThread());
+    _profiler = profiler;
+    perfCounters = compteursThread.get();
+    perfCounters->push(STAGE_OUTPUT);
+}
+
+PerfThreadScope::~PerfThreadScope() {
+    if (_profiler == nullptr)
+        return;
+    perfCounters->leave();
+    _profiler->merge(*perfCounters);
+    perfCounters = nullptr;
+}
+
+PerfProfiler::PerfProfiler() {
+    reset();
+}
+
+void PerfProfiler::reset() {
+    std::lock_guard<std::mutex> verrou(_mutex);
+    for (StageReading& s : _stages)
+        s = StageReading();
+    for (bool& a : _available)
+        a = true;
+    _merged = false;
+    _error.clear();
+}
+
+void PerfProfiler::merge(PerfThread& thread) {
+    std::lock_guard<std::mutex> verrou(_mutex);
+    for (int s = 0; s < NB_STAGES; s++) {
+        StageReading& total = _stages[s];
+        StageReading& r = thread.readings[s];
+        for (int e = 0; e < NB_PERF_EVENTS; e++)
+            total.events[e] += r.events[e];
+        total.nanoseconds += r.nanoseconds;
+        total.calls += r.calls;
+        total.rays += r.rays;
+        r = StageReading();
+    }
+    // Un événement n'est rapporté que s'il a été compté sur tous les threads
+    for (int e = 0; e < NB_PERF_EVENTS; e++)
+        _available[e] = _available[e] && thread.isAvailable(PerfEvent(e));
+    if (_error.empty())
+        _error = thread.getError();
+    _merged = true;
+}
+
+StageReading PerfProfiler::getStage(RenderStage stage) const {
+    std::lock_guard<std::mutex> verrou(_mutex);
+    return _stages[stage];
+}
+
+bool PerfProfiler::isAvailable(PerfEvent e) const {
+    std::lock_guard<std::mutex> verrou(_mutex);
+    return _merged && _available[e];
+}
+
+std::string PerfProfiler::getError() const {
+    std::lock_guard<std::mutex> verrou(_mutex);
+    return _error;
+}
+
+uint64_t PerfProfiler::getRays() const {
+    std::lock_guard<std::mutex> verrou(_mutex);
+    uint64_t rays = 0;
+    for (const StageReading& s : _stages)
+        rays += s.rays;
+    return rays;
+}
+
+void PerfProfiler::report(std::ostream& out) const {
+    StageReading etapes[NB_STAGES + 1];
+    bool disponibles[NB_PERF_EVENTS];
+    for (int s = 0; s < NB_STAGES; s++) {
+        etapes[s] = getStage(RenderStage(s));
+        for (int e = 0; e < NB_PERF_EVENTS; e++)
+            etapes[NB_STAGES].events[e] += etapes[s].events[e];
+        etapes[NB_STAGES].nanoseconds += etapes[s].nanoseconds;
+        etapes[NB_STAGES].calls += etapes[s].calls;
+        etapes[NB_STAGES].rays += etapes[s].rays;
+    }
+    for (int e = 0; e < NB_PERF_EVENTS; e++)
+        disponibles[e] = isAvailable(PerfEvent(e));
+    std::string erreur = getError();
+    if (!erreur.empty())
+        out << "Compteurs matériels indisponibles (" << erreur << ") : les colonnes concernées sont vides" << std::endl;
+
+    // Défauts rapportés au nombre total de rayons : les lignes s'additionnent
+    double rayons = std::max<uint64_t>(1, etapes[NB_STAGES].rays);
+    double total = std::max<uint64_t>(1, etapes[NB_STAGES].nanoseconds);
+    auto colonne = [&](const StageReading& s, PerfEvent e, double diviseur, int largeur) {
+        if (disponibles[e])
+            out << std::setw(largeur) << s.events[e] / diviseur;
+        else
+            out << std::setw(largeur) << "-";
+    };
+    out << std::left << std::setw(12) << "étape" << std::right << std::setw(12) << "temps (ms)" << std::setw(8) << "%"
+        << std::setw(12) << "appels" << std::setw(12) << "rayons" << std::setw(8) << "IPC" << std::setw(12) << "L1/rayon"
+        << std::setw(12) << "LLC/rayon" << std::setw(16) << "branches/rayon" << std::endl;
+    out << std::fixed;
+    for (int s = 0; s <= NB_STAGES; s++) {
+        const StageReading& r = etapes[s];
+        // Le nom de la ligne peut contenir des caractères sur deux octets : on complète à la main
+        std::string nom = (s < NB_STAGES) ? NOMS_ETAPES[s] : "total";
+        int largeur = 0;
+        for (unsigned char c : nom)
+            largeur += (c & 0xC0) != 0x80;
+        out << nom << std::string(std::max(1, 12 - largeur), ' ');
+        out << std::setprecision(1) << std::setw(12) << r.nanoseconds * 1e-6 << std::setw(8) << 100 * r.nanoseconds / total
+            << std::setw(12) << r.calls << std::setw(12) << r.rays << std::setprecision(2);
+        if (disponibles[PERF_CYCLES] && disponibles[PERF_INSTRUCTIONS] && r.events[PERF_CYCLES] > 0)
+            out << std::setw(8) << double(r.events[PERF_INSTRUCTIONS]) / r.events[PERF_CYCLES];
+        else
+            out << std::setw(8) << "-";
+        colonne(r, PERF_L1_MISSES, rayons, 12);
+        colonne(r, PERF_LLC_MISSES, rayons, 12);
+        colonne(r, PERF_BRANCH_MISSES, rayons, 16);
+        out << std::endl;
+    }
+    out << std::defaultfloat;
+}
@@ -0,0 +1,211 @@
+/**
+ * @file perfcounters.h
+ * @brief Création des classes PerfThread et PerfProfiler (compteurs matériels par étape du rendu)
+ */
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+/**
+ * @brief Etapes du rendu auxquelles les mesures sont attribuées
+ */
+enum RenderStage {
+    STAGE_RAY_GENERATION,   // Rayons primaires (caméra, candidats de la tuile)
+    STAGE_CLOSEST_HIT,      // Recherche de l'impact le plus proche (primaires, réfléchis, rebonds)
+    STAGE_SHADOW,           // Rayons d'ombre
+    STAGE_SHADING,          // Reste du calcul d'un pixel (normales, matériaux, textures, éclairage)
+    STAGE_OUTPUT,           // Ecriture des pixels dans l'image ou le fichier
+    NB_STAGES
+};
+
+/**
+ * @brief Evénements matériels comptés
+ */
+enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1_MISSES,         // Défauts de lecture du cache L1 de données
+    PERF_LLC_MISSES,        // Défauts du dernier niveau de cache
+    PERF_BRANCH_MISSES,     // Branchements mal prédits
+    NB_PERF_EVENTS
+};
+
+/**
+ * @brief Mesures cumulées d'une étape
+ */
+struct StageReading {
+    uint64_t events[NB_PERF_EVENTS] = {0};
+    uint64_t nanoseconds = 0;
+    uint64_t calls = 0;     // Entrées dans l'étape
+    uint64_t rays = 0;      // Rayons traités par l'étape (impacts et ombres)
+};
+
+/**
+ * @brief Compteurs du thread courant, ouverts par perf_event_open (hors noyau) à sa
+ * première mesure et fermés à sa fin. Ils sont lus sans appel système (instruction rdpmc)
+ * quand le noyau le permet, par read sinon. Les mesures entre deux changements d'étape
+ * vont à l'étape en cours : une étape imbriquée (une ombre pendant l'ombrage) est
+ * retirée de celle qui l'englobe
+ *
+ */
+class PerfThread {
+
+    public:
+        PerfThread();
+        ~PerfThread();
+
+        PerfThread(const PerfThread&) = delete;
+        PerfThread& operator=(const PerfThread&) = delete;
+
+        /**
+         * @brief Entre dans une étape
+         *
+         * @param stage
+         * @param rays rayons traités par l'étape
+         */
+        void enter(RenderStage stage, uint32_t rays);
+
+        /**
+         * @brief Sort de l'étape en cours
+         */
+        void leave();
+
+        inline bool isAvailable(PerfEvent e) const {return _fds[e] != -1;};
+        inline const std::string& getError() const {return _error;};
+
+        /**
+         * @brief Mesures depuis la dernière remise à zéro
+         */
+        StageReading readings[NB_STAGES];
+
+    private:
+        friend class PerfThreadScope;
+
+        static const int PROFONDEUR_MAX = 16;
+
+        /**
+         * @brief Entre dans une étape sans la compter (étape de base d'une mesure)
+         */
+        void push(RenderStage stage);
+
+        /**
+         * @brief Lit les compteurs et l'horloge, et ajoute leur avance depuis la lecture
+         * précédente à l'étape en cours
+         */
+        void avance();
+
+        uint64_t lit(int e) const;
+
+        int _fds[NB_PERF_EVENTS];
+        void* _pages[NB_PERF_EVENTS];   // Pages projetées des compteurs (lecture par rdpmc)
+        uint64_t _derniers[NB_PERF_EVENTS];
+        uint64_t _dernierNs;
+        RenderStage _pile[PROFONDEUR_MAX];
+        int _profondeur;
+        std::string _error;
+};
+
+/**
+ * @brief Compteurs du thread courant pendant une mesure, nul sinon : une étape coûte
+ * alors un test
+ */
+inline thread_local PerfThread* perfCounters = nullptr;
+
+/**
+ * @brief Etape mesurée pendant la durée de vie de l'objet
+ */
+class PerfStage {
+
+    public:
+        explicit PerfStage(RenderStage stage, uint32_t rays = 0) : _counters(perfCounters) {
+            if (_counters != nullptr)
+                _counters->enter(stage, rays);
+        }
+        ~PerfStage() {
+            if (_counters != nullptr)
+                _counters->leave();
+        }
+
+        PerfStage(const PerfStage&) = delete;
+        PerfStage& operator=(const PerfStage&) = delete;
+
+    private:
+        PerfThread* _counters;
+};
+
+/**
+ * @brief Profil d'un ou plusieurs rendus : mesures de chaque étape, cumulées sur tous les
+ * threads de rendu, rapportées en IPC et en défauts par rayon. Quand les compteurs
+ * matériels sont indisponibles (hors Linux, machine virtuelle, droits insuffisants), seuls
+ * les temps et les appels sont mesurés et le rapport en donne la raison
+ *
+ */
+class PerfProfiler {
+
+    public:
+        PerfProfiler();
+
+        /**
+         * @brief Ajoute les mesures d'un thread et les remet à zéro
+         *
+         * @param thread
+         */
+        void merge(PerfThread& thread);
+
+        /**
+         * @brief Oublie les mesures
+         */
+        void reset();
+
+        StageReading getStage(RenderStage stage) const;
+        bool isAvailable(PerfEvent e) const;
+        std::string getError() const;
+
+        /**
+         * @brief Rayons de toutes les étapes (impacts et ombres)
+         *
+         * @return uint64_t
+         */
+        uint64_t getRays() const;
+
+        /**
+         * @brief Ecrit le tableau des étapes : temps, appels, IPC et, par rayon, défauts de
+         * cache et de prédiction
+         *
+         * @param out
+         */
+        void report(std::ostream& out) const;
+
+    private:
+        mutable std::mutex _mutex;
+        StageReading _stages[NB_STAGES];
+        bool _available[NB_PERF_EVENTS];
+        bool _merged;
+        std::string _error;
+};
+
+/**
+ * @brief Mesure les étapes du thread courant pendant la durée de vie de l'objet (pour le
+ * profil donné, s'il est non nul) : les mesures hors de toute étape vont à l'écriture,
+ * et elles rejoignent le profil à la destruction. Sans effet si une mesure est déjà en
+ * cours sur le thread
+ *
+ */
+class PerfThreadScope {
+
+    public:
+        explicit PerfThreadScope(PerfProfiler* profiler);
+        ~PerfThreadScope();
+
+        PerfThreadScope(const PerfThreadScope&) = delete;
+        PerfThreadScope& operator=(const PerfThreadScope&) = delete;
+
+    private:
+        PerfProfiler* _profiler;
+};
+
+#endif
@@ -0,0 +1,41 @@
+/**
+ * @file precision.h
+ * @brief Choix à la compilation du type des scalaires du calcul géométrique
+ */
+#ifndef PRECISION_H
+#define PRECISION_H
+
+/**
+ * @brief Scalaire utilisé par les vecteurs, les rayons et les intersections : float par
+ * défaut, double si le programme est compilé avec -DRAYTRACER_DOUBLE (scènes aux
+ * coordonnées très grandes). Le choix est fait à la compilation, sans coût à l'exécution
+ */
+#ifdef RAYTRACER_DOUBLE
+typedef double Real;
+#else
+typedef float Real;
+#endif
+
+/**
+ * @brief Tolérances géométriques adaptées à la précision du type T
+ *
+ * SURFACE : distance en deçà de laquelle un point est considéré sur une face, et décalage
+ * des rayons secondaires le long de la normale.
+ * OMBRE : fraction de la distance à la source dont on avance l'origine des rayons d'ombre
+ */
+template <typename T>
+struct Epsilon;
+
+template <>
+struct Epsilon<float> {
+    static constexpr float SURFACE = 1e-2f;
+    static constexpr float OMBRE = 1e-3f;
+};
+
+template <>
+struct Epsilon<double> {
+    static constexpr double SURFACE = 1e-6;
+    static constexpr double OMBRE = 1e-7;
+};
+
+#endif
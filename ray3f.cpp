@@ -1,12 +1,17 @@
 /**
  * @file ray3f.cpp
  * @author Arthur BABIN
- * @brief Implémentation de la classe Ray3f
+ * @brief Implémentation de la classe Ray3
  * @date Décembre 2022
  */
 
 #include "ray3f.h"
 
-Vector3f Ray3f::pointAt(float t) const {
+template <typename T>
+Vector3<T> Ray3<T>::pointAt(T t) const {
     return origin + direction * t;
-}
\ No newline at end of file
+}
+
+// Instanciations explicites pour les deux précisions
+template class Ray3<float>;
+template class Ray3<double>;
@@ -1,67 +1,74 @@
 /**
  * @file ray3f.h
  * @author Arthur BABIN
- * @brief Création de la classe Ray3f (rayon dans un espace à 3 dimensions de
- * flottants)
+ * @brief Création de la classe Ray3 (rayon dans un espace à 3 dimensions de
+ * scalaires T) et de Ray3f (scalaires Real)
  * @date Décembre 2022
  */
 #ifndef RAY3F_H
 #define RAY3F_H
 
-#include "vector3f.h" // Pour inclure la définition de la classe Vector3f
+#include "vector3f.h" // Pour inclure la définition de la classe Vector3
 
 /**
- * @brief Classe pour représenter un rayon optique
+ * @brief Classe pour représenter un rayon optique, de précision T (instanciée pour
+ * float et double)
  * 
  */
-class Ray3f {
+template <typename T>
+class Ray3 {
 
     private:
         /**
          * @brief Origine et direction du rayon
          *
          */
-        Vector3f origin, direction;
+        Vector3<T> origin, direction;
 
     public:
         /**
-         * @brief Constructeur par défaut de Ray3f
+         * @brief Constructeur par défaut de Ray3
          *
          */
-        Ray3f() : origin(0, 0, 0), direction(0, 0, 0) {}
+        Ray3() : origin(0, 0, 0), direction(0, 0, 0) {}
 
         /**
-         * @brief Constructeur avec une origine et une direction données pour Ray3f
+         * @brief Constructeur avec une origine et une direction données pour Ray3
          *
          * @param origin
          * @param direction
          */
-        Ray3f(const Vector3f &origin, const Vector3f &direction)
+        Ray3(const Vector3<T> &origin, const Vector3<T> &direction)
             : origin(origin), direction(direction) {}
 
         /**
-         * @brief Retourne l'origine du Ray3f
+         * @brief Retourne l'origine du Ray3
          *
-         * @return const Vector3f&
+         * @return const Vector3<T>&
          */
-        inline const Vector3f &getOrigin() const { return origin; }
+        inline const Vector3<T> &getOrigin() const { return origin; }
 
         /**
-         * @brief Retourne la direction du Ray3f
+         * @brief Retourne la direction du Ray3
          *
-         * @return const Vector3f&
+         * @return const Vector3<T>&
          */
-        inline const Vector3f &getDirection() const { return direction; }
+        inline const Vector3<T> &getDirection() const { return direction; }
 
         /**
-         * @brief Calcule le point sur le Ray3f à une distance donnée du point
+         * @brief Calcule le point sur le Ray3 à une distance donnée du point
          * d'origine suivant la direction
          *
          * @param t
-         * @return Vector3f
+         * @return Vector3<T>
          */
-        Vector3f pointAt(float t) const;
+        Vector3<T> pointAt(T t) const;
 
 };
 
+/**
+ * @brief Rayon de la précision choisie à la compilation
+ */
+typedef Ray3<Real> Ray3f;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,346 @@
+/**
+ * @file regression.cpp
+ * @brief Implémentation du contrôle de non-régression
+ */
+
+#include "regression.h"
+#include "scene.h"
+#include "scenes.h"
+#include "framebuffer.h"
+#include "gbuffer.h"
+#include "imagefile.h"
+#include "alloctracker.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <sys/stat.h>
+
+const int NB_MESURES = 7;               // Rendus chronométrés par scène, au moins (on garde la médiane)
+const double DUREE_MESURES = 2.0;       // Durée minimale (s) des rendus chronométrés d'une scène
+const double TOLERANCE_TEMPS = 1.25;    // Dépassement relatif du budget toléré
+const int ITERATIONS_ETALON = 1 << 21;  // Calcul étalon chronométré avant chaque rendu
+const char* FICHIER_BUDGETS = "budgets.txt";
+
+/**
+ * @brief Scène du catalogue : construction, paramètres de rendu et seuils de qualité
+ */
+struct CasRegression {
+    const char* nom;
+    int width, height;
+    RenderSettings settings;
+    bool differe;           // Rendu par G-buffer (éclairage différé) plutôt que direct
+    double psnrMin;         // PSNR minimal par rapport à la référence (dB)
+    double ecartMax;        // Ecart perceptuel moyen maximal
+    std::function<void(Scene&, const std::string&)> construit;
+};
+
+/**
+ * @brief Image de texture du catalogue (damier), créée dans le dossier des références
+ * si elle n'y est pas encore
+ */
+static std::string textureCatalogue(const std::string& dir) {
+    std::string chemin = dir + "/damier.ppm";
+    struct stat st;
+    if (stat(chemin.c_str(), &st) == 0)
+        return chemin;
+    const int taille = 512;
+    ImageFile image(chemin, taille, taille, ImageFile::PPM);
+    std::vector<float> ligne(taille * 3);
+    for (int y = 0; y < taille; y++) {
+        for (int x = 0; x < taille; x++) {
+            bool clair = ((x / 32) + (y / 32)) % 2 == 0;
+            ligne[3*x] = clair ? 250 : 40;
+            ligne[3*x + 1] = clair ? 250 : 110;
+            ligne[3*x + 2] = clair ? 250 : 190;
+        }
+        image.writeRows(y, 1, ligne.data());
+    }
+    return chemin;
+}
+
+static std::vector<CasRegression> catalogue() {
+    RenderSettings whitted;
+    RenderSettings chemins;
+    chemins.integrator = RenderSettings::PATH_TRACING;
+    chemins.samplesPerPixel = 8;
+    chemins.maxDepth = 4;
+    chemins.seed = 1;
+    RenderSettings debruite = chemins;
+    debruite.denoise = true;
+    RenderSettings apercu;
+    apercu.math = MATH_FASTEST;
+
+    auto demo = [](Scene& sc, const std::string&) { construitSceneDemo(sc); };
+    return {
+        {"whitted", 320, 320, whitted, false, 45, 0.5, demo},
+        {"differe", 320, 320, whitted, true, 45, 0.5, demo},
+        {"apercu", 320, 320, apercu, true, 45, 0.5, demo},
+        {"chemins", 160, 160, chemins, false, 35, 1.5, demo},
+        {"debruite", 160, 160, debruite, false, 35, 1.5, demo},
+        {"texture", 320, 320, whitted, false, 40, 1.0,
+            [](Scene& sc, const std::string& dir) { construitSceneDemo(sc, textureCatalogue(dir)); }},
+        {"ombres", 320, 320, whitted, false, 40, 1.0,
+            [](Scene& sc, const std::string&) {
+                construitSceneDemo(sc);
+                sc.setLight(AreaLight(AreaLight::RECTANGLE, 60, 60));
+            }},
+        {"spheres", 320, 320, whitted, false, 45, 0.5,
+            [](Scene& sc, const std::string&) { construitSceneSpheres(sc, 40, 30); }},
+        {"implicites", 320, 320, whitted, false, 45, 0.5,
+            [](Scene& sc, const std::string&) { construitSceneImplicite(sc); }},
+    };
+}
+
+/**
+ * @brief Lit une image PPM binaire (8 bits) en flottants, false si elle est illisible
+ */
+static bool lisPPM(const std::string& chemin, int& width, int& height, std::vector<float>& rgb) {
+    std::ifstream f(chemin, std::ios::binary);
+    std::string magique;
+    int maxval;
+    if (!(f >> magique >> width >> height >> maxval) || magique != "P6" || maxval != 255 || width <= 0 || height <= 0)
+        return false;
+    f.get();
+    std::vector<unsigned char> octets(std::size_t(width) * height * 3);
+    if (!f.read(reinterpret_cast<char*>(octets.data()), octets.size()))
+        return false;
+    rgb.assign(octets.begin(), octets.end());
+    return true;
+}
+
+static std::map<std::string, double> lisBudgets(const std::string& chemin) {
+    std::map<std::string, double> budgets;
+    std::ifstream f(chemin);
+    std::string ligne;
+    while (std::getline(f, ligne)) {
+        if (ligne.empty() || ligne[0] == '#')
+            continue;
+        std::istringstream champs(ligne);
+        std::string nom;
+        double duree;
+        if (champs >> nom >> duree)
+            budgets[nom] = duree;
+    }
+    return budgets;
+}
+
+/**
+ * @brief Convertit une image RGB (0-255, sRGB) en CIELAB après un flou gaussien
+ * (sigma d'un pixel) qui tient lieu de filtre de sensibilité aux contrastes
+ */
+static std::vector<float> versLab(const std::vector<float>& rgb, int width, int height) {
+    std::size_t n = std::size_t(width) * height;
+    std::vector<float> lineaire(3 * n), tmp(3 * n);
+    for (std::size_t k = 0; k < 3 * n; k++) {
+        float c = std::min(std::max(rgb[k], 0.f), 255.f) / 255;
+        lineaire[k] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    const float poids[5] = {0.054f, 0.244f, 0.404f, 0.244f, 0.054f};
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < 3; c++) {
+                float s = 0;
+                for (int d = -2; d <= 2; d++)
+                    s += poids[d + 2] * lineaire[3 * (std::size_t(y) * width + std::min(std::max(x + d, 0), width - 1)) + c];
+                tmp[3 * (std::size_t(y) * width + x) + c] = s;
+            }
+        }
+    }
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < 3; c++) {
+                float s = 0;
+                for (int d = -2; d <= 2; d++)
+                    s += poids[d + 2] * tmp[3 * (std::size_t(std::min(std::max(y + d, 0), height - 1)) * width + x) + c];
+                lineaire[3 * (std::size_t(y) * width + x) + c] = s;
+            }
+        }
+    }
+
+    // RGB linéaire -> XYZ -> CIELAB (blanc D65)
+    std::vector<float> lab(3 * n);
+    auto f = [](float t) { return (t > 0.008856f) ? std::cbrt(t) : 7.787f * t + 16.f / 116; };
+    for (std::size_t k = 0; k < n; k++) {
+        float r = lineaire[3*k], g = lineaire[3*k + 1], b = lineaire[3*k + 2];
+        float fx = f((0.4124f * r + 0.3576f * g + 0.1805f * b) / 0.9505f);
+        float fy = f(0.2126f * r + 0.7152f * g + 0.0722f * b);
+        float fz = f((0.0193f * r + 0.1192f * g + 0.9505f * b) / 1.089f);
+        lab[3*k] = 116 * fy - 16;
+        lab[3*k + 1] = 500 * (fx - fy);
+        lab[3*k + 2] = 200 * (fy - fz);
+    }
+    return lab;
+}
+
+ImageComparison compareImages(const std::vector<float>& a, const std::vector<float>& b, int width, int height) {
+    std::size_t n = std::size_t(width) * height;
+    double somme = 0;
+    for (std::size_t k = 0; k < 3 * n; k++) {
+        double d = double(a[k]) - b[k];
+        somme += d * d;
+    }
+    double mse = somme / (3 * n);
+    ImageComparison res;
+    res.psnr = (mse > 0) ? std::min(99., 10 * std::log10(255. * 255. / mse)) : 99;
+
+    std::vector<float> labA = versLab(a, width, height), labB = versLab(b, width, height);
+    std::vector<float> ecarts(n);
+    double total = 0;
+    for (std::size_t k = 0; k < n; k++) {
+        float dl = labA[3*k] - labB[3*k], da = labA[3*k + 1] - labB[3*k + 1], db = labA[3*k + 2] - labB[3*k + 2];
+        ecarts[k] = std::abs(dl) + std::sqrt(da * da + db * db);
+        total += ecarts[k];
+    }
+    res.meanError = total / n;
+    std::size_t centile = std::min(n - 1, n * 99 / 100);
+    std::nth_element(ecarts.begin(), ecarts.begin() + centile, ecarts.end());
+    res.maxError = ecarts[centile];
+    return res;
+}
+
+/**
+ * @brief Durée (s) d'un calcul fixe sur un thread (suite de racines et de divisions
+ * dépendantes), qui mesure la vitesse de la machine au moment du rendu
+ */
+static double dureeEtalon() {
+    auto debut = std::chrono::steady_clock::now();
+    volatile double graine = 1.5;
+    double x = graine;
+    for (int k = 0; k < ITERATIONS_ETALON; k++)
+        x = std::sqrt(x + k) / (1 + x * 1e-3);
+    graine = x;
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - debut).count();
+}
+
+/**
+ * @brief Rend un cas du catalogue et retourne l'image telle qu'elle serait écrite
+ * (valeurs entières entre 0 et 255) ; temps reçoit le temps de rendu médian, relatif la
+ * médiane des rapports entre chaque rendu et le calcul étalon qui le précède, et
+ * critiques le nombre d'allocations faites dans le chemin critique par tous les rendus
+ */
+static std::vector<float> rendCas(const CasRegression& cas, const std::string& dir, int nbThreads, double& temps, double& relatif,
+                                  uint64_t& critiques) {
+    Scene sc(cameraDemo(), sourceDemo());
+    cas.construit(sc, dir);
+    sc.buildBvh();
+    sc.setSettings(cas.settings);
+
+    Framebuffer fb(cas.width, cas.height);
+    AllocationTracker allocations;
+    // Les rendus courts sont répétés davantage, jusqu'à DUREE_MESURES
+    std::vector<double> durees, rapports;
+    double total = 0;
+    while (int(durees.size()) < NB_MESURES || total < DUREE_MESURES) {
+        double etalon = dureeEtalon();
+        allocations.beginFrame();
+        auto debut = std::chrono::steady_clock::now();
+        if (cas.differe) {
+            GBuffer gb(cas.width, cas.height, sc.getNbGBufferLayers());
+            sc.buildGBuffer(gb, sc.getCamera(), nbThreads);
+            sc.shadeGBuffer(gb, fb, nbThreads);
+        } else
+            sc.renderFrame(fb, sc.getCamera(), nbThreads);
+        durees.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - debut).count());
+        rapports.push_back(durees.back() / etalon);
+        total += durees.back();
+        allocations.endFrame();
+    }
+    // La médiane écarte le premier rendu (caches froids) et les rendus ralentis par la
+    // machine ; le rapport à l'étalon suit les variations de vitesse de la machine
+    std::size_t milieu = durees.size() / 2;
+    std::nth_element(durees.begin(), durees.begin() + milieu, durees.end());
+    std::nth_element(rapports.begin(), rapports.begin() + milieu, rapports.end());
+    temps = durees[milieu];
+    relatif = rapports[milieu];
+    critiques = allocations.getHotPathTotal().count;
+
+    std::vector<float> rgb(fb.getSize() * 3);
+    fb.getRGB(0, cas.height, rgb.data());
+    for (float& c : rgb)
+        c = (unsigned char) std::min(std::max(c, 0.f), 255.f);
+    return rgb;
+}
+
+int runRegression(const std::string& dir, bool update, int nbThreads) {
+    mkdir(dir.c_str(), 0755);
+    std::string cheminBudgets = dir + "/" + FICHIER_BUDGETS;
+    std::map<std::string, double> budgets = lisBudgets(cheminBudgets);
+    std::map<std::string, double> mesures;
+    int nbEchecs = 0;
+
+    std::printf("%-10s %9s %7s %7s %9s %9s %10s %7s  %s\n", "scène", "PSNR(dB)", "écart", "99e", "temps(s)", "budget(s)", "Mrayons/s", "alloc",
+                "résultat");
+    for (const CasRegression& cas : catalogue()) {
+        double temps, relatif;
+        uint64_t critiques;
+        std::vector<float> image = rendCas(cas, dir, nbThreads, temps, relatif, critiques);
+        mesures[cas.nom] = relatif;
+        int spp = (cas.settings.integrator == RenderSettings::PATH_TRACING) ? cas.settings.samplesPerPixel : 1;
+        double mrayons = double(cas.width) * cas.height * spp / temps / 1e6;
+        std::string chemin = dir + "/" + cas.nom + ".ppm";
+
+        if (update) {
+            ImageFile reference(chemin, cas.width, cas.height, ImageFile::PPM);
+            reference.writeRows(0, cas.height, image.data());
+            std::printf("%-10s %9s %7s %7s %9.3f %9s %10.2f %7llu  référence enregistrée\n", cas.nom, "-", "-", "-", temps, "-", mrayons,
+                        (unsigned long long) critiques);
+            continue;
+        }
+
+        // Qualité
+        std::string resultat;
+        int width, height;
+        std::vector<float> reference;
+        ImageComparison c = {0, 0, 0};
+        if (!lisPPM(chemin, width, height, reference) || width != cas.width || height != cas.height)
+            resultat = "référence absente (relancer avec -u)";
+        else {
+            c = compareImages(reference, image, width, height);
+            if (c.psnr < cas.psnrMin)
+                resultat = "qualité : PSNR < " + std::to_string(int(cas.psnrMin)) + " dB";
+            else if (c.meanError > cas.ecartMax)
+                resultat = "qualité : écart perceptuel trop grand";
+        }
+
+        // Vitesse
+        auto budget = budgets.find(cas.nom);
+        char texteBudget[32] = "-";
+        if (budget == budgets.end()) {
+            if (resultat.empty())
+                resultat = "budget absent (relancer avec -u)";
+        } else {
+            // Budget ramené en secondes à la vitesse de la machine pendant ce cas
+            std::snprintf(texteBudget, sizeof(texteBudget), "%.3f", budget->second * temps / relatif);
+            if (resultat.empty() && relatif > budget->second * TOLERANCE_TEMPS)
+                resultat = "vitesse : budget dépassé";
+        }
+
+        // Aucune allocation par rayon ou par pixel
+        if (resultat.empty() && critiques > 0)
+            resultat = "allocations dans le chemin critique";
+
+        if (!resultat.empty())
+            nbEchecs++;
+        std::printf("%-10s %9.2f %7.3f %7.3f %9.3f %9s %10.2f %7llu  %s\n", cas.nom, c.psnr, c.meanError, c.maxError, temps, texteBudget, mrayons,
+                    (unsigned long long) critiques, resultat.empty() ? "ok" : ("ECHEC " + resultat).c_str());
+    }
+
+    if (update) {
+        std::ofstream f(cheminBudgets);
+        f << "# scène temps médian de référence, en durées du calcul étalon ; échec au-delà de " << TOLERANCE_TEMPS << " x budget\n";
+        for (const auto& m : mesures)
+            f << m.first << " " << m.second << "\n";
+        if (!f)
+            std::cerr << "Impossible d'écrire " << cheminBudgets << std::endl;
+        return f ? 0 : 1;
+    }
+    if (nbEchecs > 0)
+        std::printf("%d scène(s) en échec\n", nbEchecs);
+    return nbEchecs > 0 ? 1 : 0;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file regression.h
+ * @brief Contrôle de non-régression (images de référence et budgets de temps)
+ */
+#ifndef REGRESSION_H
+#define REGRESSION_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Ecart entre deux images : PSNR, et écart perceptuel à la manière de FLIP
+ * (filtrage spatial des deux images, puis distance HyAB dans l'espace CIELAB, pour
+ * laquelle 2 correspond à peu près à une différence tout juste visible)
+ */
+struct ImageComparison {
+    double psnr;        // En dB (99 pour des images identiques)
+    double meanError;   // Ecart perceptuel moyen
+    double maxError;    // 99e centile de l'écart perceptuel (différences localisées)
+};
+
+/**
+ * @brief Compare deux images RGB (3 flottants par pixel entre 0 et 255, ligne par ligne)
+ *
+ * @param a
+ * @param b
+ * @param width
+ * @param height
+ * @return ImageComparison
+ */
+ImageComparison compareImages(const std::vector<float>& a, const std::vector<float>& b, int width, int height);
+
+/**
+ * @brief Rend sans fenêtre chaque scène d'un catalogue fixe (Whitted, éclairage différé,
+ * tracé de chemins avec et sans débruitage, textures, nombreux objets), compare l'image
+ * à sa référence (dir/nom.ppm) et la médiane de plusieurs temps de rendu à son budget
+ * (dir/budgets.txt, tolérance relative). Une scène échoue aussi si ses rendus font une allocation dans le
+ * chemin critique (voir HotPathScope). Avec update, les références et les budgets sont réenregistrés
+ * à partir du rendu courant
+ *
+ * @param dir dossier des références
+ * @param update vrai pour réenregistrer les références au lieu de comparer
+ * @param nbThreads nombre de threads de rendu (<= 0 : tous les coeurs)
+ * @return int 0 si toutes les scènes respectent leurs seuils, 1 sinon (code de sortie)
+ */
+int runRegression(const std::string& dir, bool update, int nbThreads = 0);
+
+#endif
@@ -0,0 +1,222 @@
+/**
+ * @file renderjob.cpp
+ * @brief Implémentation des classes ThreadPool, RenderJob et RenderQueue
+ */
+
+#include "renderjob.h"
+#include "parallel.h"
+#include "denoiser.h"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+ThreadPool::ThreadPool(int nbThreads) : _nbSubmitted(0), _done(false) {
+    if (nbThreads <= 0)
+        nbThreads = defaultNbThreads();
+    for (int t = 0; t < nbThreads; t++)
+        _threads.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _done = true;
+    }
+    _cond.notify_all();
+    for (std::thread& t : _threads)
+        t.join();
+}
+
+void ThreadPool::submit(int priority, std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push({priority, _nbSubmitted++, std::move(task)});
+    }
+    _cond.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    for (;;) {
+        std::function<void()> fn;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait(lock, [this] { return _done || !_tasks.empty(); });
+            if (_tasks.empty())
+                return;
+            fn = std::move(const_cast<Task&>(_tasks.top()).fn);
+            _tasks.pop();
+        }
+        fn();
+    }
+}
+
+/**
+ * @brief Instant courant en nanosecondes de steady_clock
+ */
+static int64_t maintenant() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+RenderJob::RenderJob(const Scene& scene, const Camera& camera, int width, int height, int priority, ProgressCallback progress)
+    : _scene(scene), _camera(camera), _priority(priority), _progress(std::move(progress)), _fb(width, height),
+      _tilesX(scene.isPaged() ? 1 : (width + TILE_SIZE - 1) / TILE_SIZE),
+      _tilesY(scene.isPaged() ? 1 : (height + TILE_SIZE - 1) / TILE_SIZE),
+      _tilesReady(_tilesX * _tilesY), _tilesDone(0), _tilesFinished(0), _cancelled(false), _status(PENDING), _start(0),
+      _future(_promise.get_future().share()) {
+    for (std::atomic<char>& prete : _tilesReady)
+        prete = 0;
+}
+
+void RenderJob::start(ThreadPool& pool, const std::shared_ptr<RenderJob>& self) {
+    pool.submit(_priority, [this, self, &pool] {
+        if (_cancelled) {
+            finish();
+            return;
+        }
+        _status = RUNNING;
+        _start = maintenant();
+        if (!_scene.isPaged()) {
+            try {
+                // Un thread de la file : les candidats sont construits sur un seul thread
+                _culling.reset(new TileCulling(_camera, _scene.getShapes(), _scene.getBvh(), getWidth(), getHeight(), 1));
+            } catch (...) {
+                fail(std::current_exception());
+                finish();
+                return;
+            }
+        }
+        for (int t = 0; t < getNbTiles(); t++)
+            pool.submit(_priority, [this, self, t] { renderTile(t); });
+    });
+}
+
+void RenderJob::renderTile(int t) {
+    if (_cancelled) {
+        tileFinished(false);
+        return;
+    }
+    try {
+        if (_scene.isPaged())
+            _scene.renderFrame(_fb, _camera, 1);
+        else {
+            int x0 = (t % _tilesX) * TILE_SIZE, y0 = (t / _tilesX) * TILE_SIZE;
+            _scene.renderTile(_fb, _camera, _culling.get(), x0, y0, std::min(x0 + TILE_SIZE, getWidth()),
+                              std::min(y0 + TILE_SIZE, getHeight()));
+        }
+    } catch (...) {
+        fail(std::current_exception());
+        tileFinished(false);
+        return;
+    }
+    _tilesReady[t].store(1, std::memory_order_release);
+    tileFinished(true);
+}
+
+void RenderJob::tileFinished(bool rendered) {
+    if (rendered) {
+        ++_tilesDone;
+        if (_progress) {
+            // Le compte est relu sous le verrou du suivi : les appels successifs le voient
+            // croître. Ce n'est pas celui de snapshot, que la fonction de suivi peut appeler
+            std::lock_guard<std::mutex> lock(_progressMutex);
+            _progress(getProgress());
+        }
+    }
+    if (++_tilesFinished == getNbTiles())
+        finish();
+}
+
+void RenderJob::fail(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_error)
+        _error = error;
+    _cancelled = true;
+}
+
+void RenderJob::finish() {
+    _culling.reset();
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        error = _error;
+    }
+    if (error) {
+        _status = FAILED;
+        _promise.set_exception(error);
+        return;
+    }
+    if (_cancelled) {
+        _status = CANCELLED;
+        _promise.set_value(CANCELLED);
+        return;
+    }
+    const RenderSettings& settings = _scene.getSettings();
+    if (settings.sampling != SAMPLING_FULL && !_scene.isPaged()) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        upsample(_fb, settings.sampling, 1);
+    }
+    if (settings.denoise && settings.integrator == RenderSettings::PATH_TRACING && !_scene.isPaged()) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        denoise(_fb, 1);
+    }
+    _status = DONE;
+    _promise.set_value(DONE);
+}
+
+RenderProgress RenderJob::getProgress() const {
+    RenderProgress p;
+    p.tilesDone = _tilesDone;
+    p.tilesTotal = getNbTiles();
+    int64_t debut = _start;
+    p.elapsed = debut == 0 ? 0 : (maintenant() - debut) * 1e-9;
+    p.remaining = p.tilesDone == 0 ? -1 : p.elapsed / p.tilesDone * (p.tilesTotal - p.tilesDone);
+    return p;
+}
+
+RenderJob::Status RenderJob::wait() const {
+    return _future.get();
+}
+
+int RenderJob::snapshot(Framebuffer& out) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    int nbCopiees = 0;
+    for (int t = 0; t < getNbTiles(); t++) {
+        if (!_tilesReady[t].load(std::memory_order_acquire))
+            continue;
+        int x0 = (t % _tilesX) * TILE_SIZE, y0 = (t / _tilesX) * TILE_SIZE;
+        int x1 = _scene.isPaged() ? getWidth() : std::min(x0 + TILE_SIZE, getWidth());
+        int y1 = _scene.isPaged() ? getHeight() : std::min(y0 + TILE_SIZE, getHeight());
+        out.copyRect(_fb, x0, y0, x1, y1);
+        nbCopiees++;
+    }
+    return nbCopiees;
+}
+
+RenderQueue::RenderQueue(int nbThreads) : _pool(nbThreads) {}
+
+RenderQueue::~RenderQueue() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (std::weak_ptr<RenderJob>& w : _jobs) {
+        if (std::shared_ptr<RenderJob> job = w.lock())
+            job->cancel();
+    }
+    // Le destructeur du ThreadPool exécute ensuite les tâches restantes, qui s'arrêtent aussitôt
+}
+
+std::shared_ptr<RenderJob> RenderQueue::submit(const Scene& scene, const Camera& camera, int width, int height, int priority,
+                                               RenderJob::ProgressCallback progress) {
+    // Une image vide n'aurait aucune tuile, et rien ne terminerait le travail
+    if (width <= 0 || height <= 0)
+        throw std::runtime_error("Taille d'image invalide pour un travail de rendu : " + std::to_string(width) + " x "
+                                 + std::to_string(height));
+    std::shared_ptr<RenderJob> job(new RenderJob(scene, camera, width, height, priority, std::move(progress)));
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.erase(std::remove_if(_jobs.begin(), _jobs.end(), [](const std::weak_ptr<RenderJob>& w) { return w.expired(); }),
+                    _jobs.end());
+        _jobs.push_back(job);
+    }
+    job->start(_pool, job);
+    return job;
+}
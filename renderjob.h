@@ -0,0 +1,257 @@
+/**
+ * @file renderjob.h
+ * @brief Création des classes ThreadPool, RenderJob et RenderQueue (rendus asynchrones)
+ */
+#ifndef RENDERJOB_H
+#define RENDERJOB_H
+
+#include "scene.h"
+#include "framebuffer.h"
+#include "tileculling.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Groupe de threads partagé par plusieurs travaux : les tâches attendent dans une
+ * file de priorité (la plus haute d'abord, dans l'ordre d'arrivée à priorité égale)
+ *
+ */
+class ThreadPool {
+
+    public:
+        /**
+         * @brief Démarre les threads
+         *
+         * @param nbThreads nombre de threads (<= 0 : tous les coeurs)
+         */
+        explicit ThreadPool(int nbThreads = 0);
+
+        /**
+         * @brief Destructeur : exécute les tâches encore en attente, puis arrête les threads
+         */
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        inline int getNbThreads() const {return _threads.size();};
+
+        /**
+         * @brief Ajoute une tâche à la file. Elle ne doit pas lever d'exception
+         *
+         * @param priority
+         * @param task
+         */
+        void submit(int priority, std::function<void()> task);
+
+    private:
+        struct Task {
+            int priority;
+            uint64_t order;
+            std::function<void()> fn;
+
+            bool operator<(const Task& other) const {
+                return priority != other.priority ? priority < other.priority : order > other.order;
+            }
+        };
+
+        void workerLoop();
+
+        std::priority_queue<Task> _tasks;
+        uint64_t _nbSubmitted;
+        std::vector<std::thread> _threads;
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        bool _done;
+};
+
+/**
+ * @brief Avancement d'un travail, passé à sa fonction de suivi après chaque tuile
+ */
+struct RenderProgress {
+    int tilesDone;          // Tuiles calculées
+    int tilesTotal;         // Tuiles de l'image
+    double elapsed;         // Secondes depuis le début du calcul
+    double remaining;       // Secondes restantes estimées au rythme moyen des tuiles faites (-1 avant la première)
+};
+
+/**
+ * @brief Travail de rendu d'une image, découpée en tuiles calculées par les threads d'une
+ * RenderQueue. Le travail est annulable (l'annulation est testée avant chaque tuile), suivi
+ * par une fonction appelée après chaque tuile, et son image se lit pendant le calcul :
+ * snapshot recopie les tuiles terminées (en ne traçant qu'une partie des pixels, les autres
+ * restent à reconstruire jusqu'à la fin du travail). En mode hors mémoire, l'image est calculée d'un
+ * bloc (une seule tuile). La scène doit rester inchangée jusqu'à la fin du travail
+ *
+ */
+class RenderJob {
+
+    public:
+        /**
+         * @brief Etat d'un travail
+         */
+        enum Status { PENDING, RUNNING, DONE, CANCELLED, FAILED };
+
+        /**
+         * @brief Côté des tuiles (en pixels)
+         */
+        static const int TILE_SIZE = 32;
+
+        /**
+         * @brief Fonction de suivi, appelée sur un thread de rendu (jamais deux à la fois
+         * pour un même travail) ; elle peut appeler snapshot ou cancel
+         */
+        typedef std::function<void(const RenderProgress&)> ProgressCallback;
+
+        /**
+         * @brief Demande l'arrêt : les tuiles pas encore commencées sont abandonnées
+         */
+        inline void cancel() {_cancelled = true;};
+        inline bool isCancelled() const {return _cancelled;};
+
+        inline Status getStatus() const {return _status;};
+        inline int getPriority() const {return _priority;};
+        inline int getWidth() const {return _fb.getWidth();};
+        inline int getHeight() const {return _fb.getHeight();};
+        inline int getNbTiles() const {return _tilesX * _tilesY;};
+
+        /**
+         * @brief Avancement courant
+         *
+         * @return RenderProgress
+         */
+        RenderProgress getProgress() const;
+
+        /**
+         * @brief Résultat du travail : DONE ou CANCELLED une fois terminé, l'exception
+         * levée par le rendu s'il a échoué
+         *
+         * @return std::shared_future<Status>
+         */
+        inline std::shared_future<Status> getFuture() const {return _future;};
+
+        /**
+         * @brief Attend la fin du travail
+         *
+         * @return Status DONE ou CANCELLED (l'exception du rendu est relancée s'il a échoué)
+         */
+        Status wait() const;
+
+        /**
+         * @brief Recopie dans out (mêmes dimensions) les tuiles terminées, tous plans compris
+         * (le débruitage éventuel est attendu)
+         *
+         * @param out
+         * @return int nombre de tuiles recopiées
+         */
+        int snapshot(Framebuffer& out) const;
+
+        /**
+         * @brief Image finale, à lire une fois le travail terminé (DONE)
+         *
+         * @return const Framebuffer&
+         */
+        inline const Framebuffer& getFramebuffer() const {return _fb;};
+
+    private:
+        friend class RenderQueue;
+
+        RenderJob(const Scene& scene, const Camera& camera, int width, int height, int priority, ProgressCallback progress);
+
+        /**
+         * @brief Prépare le travail (candidats des tuiles) puis soumet ses tuiles
+         */
+        void start(ThreadPool& pool, const std::shared_ptr<RenderJob>& self);
+
+        /**
+         * @brief Calcule la tuile t, sauf si le travail est annulé ou a échoué
+         */
+        void renderTile(int t);
+
+        /**
+         * @brief Compte une tuile traitée (calculée ou abandonnée) et termine le travail
+         * après la dernière
+         */
+        void tileFinished(bool rendered);
+
+        /**
+         * @brief Enregistre l'exception du rendu (la première) et abandonne les tuiles suivantes
+         */
+        void fail(std::exception_ptr error);
+
+        void finish();
+
+        const Scene& _scene;
+        Camera _camera;
+        int _priority;
+        ProgressCallback _progress;
+        Framebuffer _fb;
+        std::unique_ptr<TileCulling> _culling;
+        int _tilesX, _tilesY;
+        std::vector<std::atomic<char>> _tilesReady;
+        std::atomic<int> _tilesDone, _tilesFinished;
+        std::atomic<bool> _cancelled;
+        std::atomic<Status> _status;
+        std::atomic<int64_t> _start;    // Début du calcul (nanosecondes de steady_clock)
+        std::exception_ptr _error;
+        mutable std::mutex _mutex;      // Erreur, image pendant l'upsampling et le débruitage
+        std::mutex _progressMutex;      // Appels de la fonction de suivi, un à la fois
+        std::promise<Status> _promise;
+        std::shared_future<Status> _future;
+};
+
+/**
+ * @brief File de travaux de rendu partageant un même ThreadPool : chaque travail soumis
+ * découpe son image en tuiles qui passent dans la file avec la priorité du travail, si
+ * bien qu'un travail urgent double les tuiles en attente des autres sans interrompre
+ * celles en cours
+ *
+ */
+class RenderQueue {
+
+    public:
+        /**
+         * @brief Construit la file et ses threads
+         *
+         * @param nbThreads nombre de threads (<= 0 : tous les coeurs)
+         */
+        explicit RenderQueue(int nbThreads = 0);
+
+        /**
+         * @brief Destructeur : annule les travaux encore en cours et attend leur fin
+         */
+        ~RenderQueue();
+
+        /**
+         * @brief Soumet le rendu d'une image de la scène (paramètres de rendu courants de
+         * la scène) et rend la main aussitôt
+         *
+         * @param scene scène, qui doit rester inchangée jusqu'à la fin du travail
+         * @param camera caméra utilisée (copiée)
+         * @param width largeur de l'image (strictement positive, sinon std::runtime_error)
+         * @param height hauteur de l'image (idem)
+         * @param priority priorité des tuiles du travail (la plus haute passe d'abord)
+         * @param progress fonction de suivi (facultative)
+         * @return std::shared_ptr<RenderJob>
+         */
+        std::shared_ptr<RenderJob> submit(const Scene& scene, const Camera& camera, int width, int height, int priority = 0,
+                                          RenderJob::ProgressCallback progress = nullptr);
+
+        inline int getNbThreads() const {return _pool.getNbThreads();};
+
+    private:
+        std::vector<std::weak_ptr<RenderJob>> _jobs;
+        std::mutex _mutex;
+        ThreadPool _pool;
+};
+
+#endif
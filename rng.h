@@ -0,0 +1,106 @@
+/**
+ * @file rng.h
+ * @brief Création de la classe Rng (générateur pseudo-aléatoire à compteur)
+ */
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+
+/**
+ * @brief Générateur pseudo-aléatoire basé sur un compteur : le n-ième tirage est un
+ * hachage de (graine, pixel, échantillon, n). Il n'a pas d'état partagé, chaque
+ * thread en crée un par pixel et par échantillon, et le résultat ne dépend ni de
+ * l'ordre de calcul ni du nombre de threads
+ *
+ */
+class Rng {
+
+    private:
+        /**
+         * @brief Clé du flux (dérivée de la graine, du pixel et de l'échantillon)
+         * et compteur du prochain tirage
+         */
+        uint32_t key, counter;
+
+    public:
+        /**
+         * @brief Mélange 32 bits (lowbias32 de C. Wellons)
+         *
+         * @param x
+         * @return uint32_t
+         */
+        static inline uint32_t hash(uint32_t x) {
+            x ^= x >> 16;
+            x *= 0x7feb352dU;
+            x ^= x >> 15;
+            x *= 0x846ca68bU;
+            x ^= x >> 16;
+            return x;
+        }
+
+        /**
+         * @brief Permutation pseudo-aléatoire de [0, l[ sans tableau (A. Kensler, Correlated
+         * Multi-Jittered Sampling, 2013) : i est envoyé sur son image par la permutation de clé p
+         *
+         * @param i indice à permuter (< l)
+         * @param l taille de la permutation
+         * @param p clé de la permutation
+         * @return uint32_t
+         */
+        static inline uint32_t permute(uint32_t i, uint32_t l, uint32_t p) {
+            uint32_t w = l - 1;
+            w |= w >> 1;
+            w |= w >> 2;
+            w |= w >> 4;
+            w |= w >> 8;
+            w |= w >> 16;
+            do {
+                i ^= p;
+                i *= 0xe170893d;
+                i ^= p >> 16;
+                i ^= (i & w) >> 4;
+                i ^= p >> 8;
+                i *= 0x0929eb3f;
+                i ^= p >> 23;
+                i ^= (i & w) >> 1;
+                i *= 1 | p >> 27;
+                i *= 0x6935fa69;
+                i ^= (i & w) >> 11;
+                i *= 0x74dcb303;
+                i ^= (i & w) >> 2;
+                i *= 0x9e501cc3;
+                i ^= (i & w) >> 2;
+                i *= 0xc860a3df;
+                i &= w;
+                i ^= i >> 5;
+            } while (i >= l);
+            return (i + p) % l;
+        }
+
+        /**
+         * @brief Construit le flux associé à un pixel et un échantillon
+         *
+         * @param seed graine du rendu
+         * @param pixel indice du pixel
+         * @param sample indice de l'échantillon dans le pixel
+         */
+        Rng(uint32_t seed, uint32_t pixel, uint32_t sample)
+            : key(hash(hash(hash(seed) ^ pixel) ^ sample)), counter(0) {}
+
+        /**
+         * @brief Retourne un entier uniforme sur 32 bits
+         *
+         * @return uint32_t
+         */
+        inline uint32_t nextUInt() { return hash(key ^ hash(counter++)); }
+
+        /**
+         * @brief Retourne un flottant uniforme dans [0,1[
+         *
+         * @return float
+         */
+        inline float next() { return (nextUInt() >> 8) * (1.f / 16777216.f); }
+};
+
+#endif
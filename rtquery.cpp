@@ -0,0 +1,196 @@
+/**
+ * @file rtquery.cpp
+ * @brief Implémentation de l'interface C de requêtes de rayons par lots
+ */
+
+#include "rtquery.h"
+#include "arena.h"
+#include "bvh.h"
+#include "cubequad.h"
+#include "parallel.h"
+#include "sphere.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+const int RAYONS_PAR_TACHE = 256;     // Rayons traités d'un bloc par un thread
+const int RAYONS_PAR_THREAD = 2048;   // Rayons par thread lancé au moins : la création d'un thread coûte autant qu'une dizaine de rayons
+const Real TOLERANCE_BASE = 1e-4;     // Ecart toléré des produits scalaires d'une base de boîte à ceux d'une base orthonormée
+
+/**
+ * @brief Scène de la bibliothèque : les objets (dans une Arena) et leur hiérarchie
+ */
+struct RtqScene {
+    Arena arena;
+    std::vector<Shape*> shapes;
+    Bvh bvh;
+};
+
+static thread_local std::string derniereErreur;
+
+/**
+ * @brief Appelle fn et convertit ses exceptions en code d'erreur : aucune exception ne
+ * doit traverser l'interface C
+ */
+template <class Fn>
+static int32_t protege(Fn fn) {
+    try {
+        derniereErreur.clear();
+        return fn();
+    } catch (const std::exception& e) {
+        derniereErreur = e.what();
+    } catch (...) {
+        derniereErreur = "Erreur inconnue";
+    }
+    return -1;
+}
+
+/**
+ * @brief Lit le rayon k, de direction normée comme celles du moteur
+ *
+ * @param norme reçoit la norme de la direction donnée, qui convertit les distances du
+ * moteur en paramètres du rayon de l'appelant
+ */
+static inline Ray3f litRayon(const RtqRays* rays, int k, Real& norme) {
+    Vector3f direction(rays->directionX[k], rays->directionY[k], rays->directionZ[k]);
+    norme = direction.norm();
+    return Ray3f(Vector3f(rays->originX[k], rays->originY[k], rays->originZ[k]), direction / norme);
+}
+
+static void verifieRayons(const RtqScene* scene, const RtqRays* rays, int32_t count) {
+    if (scene == nullptr || rays == nullptr || count < 0)
+        throw std::runtime_error("Scène ou rayons invalides");
+    if (count > 0 && (rays->originX == nullptr || rays->originY == nullptr || rays->originZ == nullptr ||
+                      rays->directionX == nullptr || rays->directionY == nullptr || rays->directionZ == nullptr))
+        throw std::runtime_error("Tampon de rayons manquant");
+}
+
+/**
+ * @brief Répartit les rayons par blocs sur les threads et retourne la somme des
+ * résultats des blocs. Les petits lots sont traités par le thread appelant, sans créer
+ * de thread ; une exception d'un bloc est relancée par parallelFor
+ */
+template <class Fn>
+static int32_t parBlocs(int32_t count, int32_t nbThreads, Fn fn) {
+    if (nbThreads <= 0)
+        nbThreads = defaultNbThreads();
+    nbThreads = std::max(1, std::min(nbThreads, count / RAYONS_PAR_THREAD));
+    std::atomic<int32_t> total(0);
+    int nbBlocs = (count + RAYONS_PAR_TACHE - 1) / RAYONS_PAR_TACHE;
+    parallelFor(nbBlocs, nbThreads, [&](int b) {
+        int debut = b * RAYONS_PAR_TACHE;
+        int fin = std::min(debut + RAYONS_PAR_TACHE, int(count));
+        total.fetch_add(fn(debut, fin), std::memory_order_relaxed);
+    });
+    return total.load();
+}
+
+extern "C" {
+
+RtqScene* rtqCreateScene(const RtqSphere* spheres, int32_t nbSpheres, const RtqBox* boxes, int32_t nbBoxes) {
+    RtqScene* scene = nullptr;
+    int32_t ok = protege([&]() -> int32_t {
+        if (nbSpheres < 0 || nbBoxes < 0 || (nbSpheres > 0 && spheres == nullptr) || (nbBoxes > 0 && boxes == nullptr))
+            throw std::runtime_error("Description de scène invalide");
+        std::unique_ptr<RtqScene> s(new RtqScene());
+        s->shapes.reserve(std::size_t(nbSpheres) + nbBoxes);
+        for (int k = 0; k < nbSpheres; k++) {
+            const RtqSphere& d = spheres[k];
+            if (!(d.radius > 0))
+                throw std::runtime_error("Sphère " + std::to_string(k) + " de rayon invalide");
+            s->shapes.push_back(s->arena.create<Sphere>(Vector3f(d.center[0], d.center[1], d.center[2]), d.radius, 0));
+        }
+        for (int k = 0; k < nbBoxes; k++) {
+            const RtqBox& d = boxes[k];
+            std::array<Vector3f, 3> basis = {Vector3f(d.basis[0], d.basis[1], d.basis[2]), Vector3f(d.basis[3], d.basis[4], d.basis[5]),
+                                             Vector3f(d.basis[6], d.basis[7], d.basis[8])};
+            if (basis[0].squaredNorm() == 0 && basis[1].squaredNorm() == 0 && basis[2].squaredNorm() == 0)
+                basis = Vector3f::basis();
+            for (int i = 0; i < 3; i++) {
+                if (!(d.halfSize[i] > 0) || !std::isfinite(d.halfSize[i]))
+                    throw std::runtime_error("Boîte " + std::to_string(k) + " de demi-taille invalide");
+                for (int j = 0; j < 3; j++) {
+                    if (!(std::abs(basis[i].dot(basis[j]) - (i == j ? 1 : 0)) <= TOLERANCE_BASE))
+                        throw std::runtime_error("Boîte " + std::to_string(k) + " de base non orthonormée");
+                }
+            }
+            // Le CubeQuad attend son centre dans sa base : coordonnées du centre donné sur
+            // chaque vecteur de la base (orthonormée)
+            Vector3f centre(d.center[0], d.center[1], d.center[2]);
+            s->shapes.push_back(s->arena.create<CubeQuad>(Vector3f(centre.dot(basis[0]), centre.dot(basis[1]), centre.dot(basis[2])),
+                                                          Vector3f(d.halfSize[0], d.halfSize[1], d.halfSize[2]), 0, basis));
+        }
+        if (!s->shapes.empty())
+            s->bvh.build(s->shapes);
+        scene = s.release();
+        return 0;
+    });
+    return ok == 0 ? scene : nullptr;
+}
+
+void rtqDestroyScene(RtqScene* scene) {
+    delete scene;
+}
+
+int32_t rtqIntersect(const RtqScene* scene, const RtqRays* rays, int32_t count, RtqHits* hits, int32_t nbThreads) {
+    return protege([&]() -> int32_t {
+        verifieRayons(scene, rays, count);
+        if (hits == nullptr || (count > 0 && (hits->t == nullptr || hits->shapeId == nullptr)))
+            throw std::runtime_error("Tampon d'impacts manquant");
+        bool normales = hits->normalX != nullptr && hits->normalY != nullptr && hits->normalZ != nullptr;
+        return parBlocs(count, nbThreads, [&](int debut, int fin) {
+            int nbImpacts = 0;
+            for (int k = debut; k < fin; k++) {
+                Real norme;
+                Ray3f ray = litRayon(rays, k, norme);
+                Real t = -1;
+                int objet = (scene->shapes.empty() || !(norme > 0)) ? -1 : scene->bvh.closestHit(ray, scene->shapes, t);
+                if (objet >= 0 && rays->tMax != nullptr && rays->tMax[k] > 0 && t > rays->tMax[k] * norme)
+                    objet = -1;
+                hits->t[k] = objet >= 0 ? float(t / norme) : -1.f;
+                hits->shapeId[k] = objet;
+                if (normales) {
+                    Vector3f n(0, 0, 0);
+                    if (objet >= 0)
+                        n = scene->shapes[objet]->getNormal(ray.getOrigin() + ray.getDirection() * t);
+                    hits->normalX[k] = n[0];
+                    hits->normalY[k] = n[1];
+                    hits->normalZ[k] = n[2];
+                }
+                nbImpacts += objet >= 0;
+            }
+            return nbImpacts;
+        });
+    });
+}
+
+int32_t rtqOccluded(const RtqScene* scene, const RtqRays* rays, int32_t count, uint8_t* occluded, int32_t nbThreads) {
+    return protege([&]() -> int32_t {
+        verifieRayons(scene, rays, count);
+        if (count > 0 && (rays->tMax == nullptr || occluded == nullptr))
+            throw std::runtime_error("Distances ou tampon de résultats manquants");
+        return parBlocs(count, nbThreads, [&](int debut, int fin) {
+            int nbCoupes = 0;
+            for (int k = debut; k < fin; k++) {
+                Real norme;
+                Ray3f ray = litRayon(rays, k, norme);
+                bool coupe = !scene->shapes.empty() && norme > 0 && scene->bvh.occluded(ray, scene->shapes, rays->tMax[k] * norme);
+                occluded[k] = coupe;
+                nbCoupes += coupe;
+            }
+            return nbCoupes;
+        });
+    });
+}
+
+const char* rtqGetLastError(void) {
+    return derniereErreur.c_str();
+}
+
+}
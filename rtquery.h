@@ -0,0 +1,135 @@
+/**
+ * @file rtquery.h
+ * @brief Interface C de la bibliothèque de requêtes de rayons par lots (moteur
+ * d'intersection sans le rendu, pour les outils qui l'intègrent)
+ *
+ * La bibliothèque partagée se compile sans le programme de rendu ni SDL :
+ * g++ -std=c++17 -O2 -fPIC -shared -fvisibility=hidden rtquery.cpp bvh.cpp aabb.cpp sphere.cpp
+ *     cubequad.cpp arena.cpp parallel.cpp costmap.cpp perfcounters.cpp vector3f.cpp ray3f.cpp
+ *     -o librtquery.so -pthread
+ * Seules les fonctions rtq* sont exportées. L'interface ne dépend pas de la précision du
+ * moteur (-DRAYTRACER_DOUBLE) : les tampons sont toujours en float.
+ */
+#ifndef RTQUERY_H
+#define RTQUERY_H
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define RTQ_API __declspec(dllexport)
+#else
+#define RTQ_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Version de l'interface, à incrémenter à chaque changement incompatible
+ */
+#define RTQ_VERSION 1
+
+/**
+ * @brief Sphère : centre et rayon
+ */
+typedef struct RtqSphere {
+    float center[3];
+    float radius;
+} RtqSphere;
+
+/**
+ * @brief Boîte orientée (CubeQuad) : centre dans le repère du monde, demi-taille sur chaque
+ * vecteur de la base (strictement positive) et base orthonormée (3 vecteurs à la suite, à
+ * 1e-4 près sur leurs produits scalaires) ; une base nulle désigne les axes du repère.
+ * rtqCreateScene échoue sur une boîte qui ne respecte pas ces conditions
+ */
+typedef struct RtqBox {
+    float center[3];
+    float halfSize[3];
+    float basis[9];
+} RtqBox;
+
+/**
+ * @brief Rayons en structure de tableaux, appartenant à l'appelant et lus sur place :
+ * origines, directions (non nulles, pas forcément normées) et paramètre maximal de
+ * chaque rayon (tMax nul : sans limite pour l'impact le plus proche). Les paramètres t
+ * sont ceux du rayon donné : l'impact est en origine + t * direction
+ */
+typedef struct RtqRays {
+    const float* originX;
+    const float* originY;
+    const float* originZ;
+    const float* directionX;
+    const float* directionY;
+    const float* directionZ;
+    const float* tMax;
+} RtqRays;
+
+/**
+ * @brief Impacts en structure de tableaux, appartenant à l'appelant et écrits sur place.
+ * Sans impact : t vaut -1, shapeId -1 et la normale est nulle. Les tampons de la normale
+ * peuvent être nuls s'ils ne servent pas
+ */
+typedef struct RtqHits {
+    float* t;
+    int32_t* shapeId;
+    float* normalX;
+    float* normalY;
+    float* normalZ;
+} RtqHits;
+
+/**
+ * @brief Scène opaque : objets et hiérarchie de boîtes englobantes
+ */
+typedef struct RtqScene RtqScene;
+
+/**
+ * @brief Construit une scène. Les objets sont numérotés dans l'ordre : les sphères
+ * (0 à nbSpheres - 1), puis les boîtes
+ *
+ * @return la scène, NULL en cas d'erreur (voir rtqGetLastError) : rayon de sphère, demi-taille
+ * ou base de boîte invalide
+ */
+RTQ_API RtqScene* rtqCreateScene(const RtqSphere* spheres, int32_t nbSpheres, const RtqBox* boxes, int32_t nbBoxes);
+
+/**
+ * @brief Détruit une scène (sans effet sur NULL)
+ */
+RTQ_API void rtqDestroyScene(RtqScene* scene);
+
+/**
+ * @brief Impact le plus proche de chaque rayon, calculé en parallèle
+ *
+ * @param scene
+ * @param rays
+ * @param count nombre de rayons
+ * @param hits reçoit les impacts
+ * @param nbThreads nombre de threads (<= 0 : tous les coeurs), au plus un par 2048 rayons
+ * @return nombre de rayons qui touchent un objet, -1 en cas d'erreur
+ */
+RTQ_API int32_t rtqIntersect(const RtqScene* scene, const RtqRays* rays, int32_t count, RtqHits* hits, int32_t nbThreads);
+
+/**
+ * @brief Teste pour chaque rayon si un objet le coupe avant sa distance maximale (tMax
+ * obligatoire), en parallèle : s'arrête au premier objet trouvé
+ *
+ * @param scene
+ * @param rays
+ * @param count nombre de rayons
+ * @param occluded reçoit 1 si le rayon est coupé, 0 sinon
+ * @param nbThreads nombre de threads (<= 0 : tous les coeurs), au plus un par 2048 rayons
+ * @return nombre de rayons coupés, -1 en cas d'erreur
+ */
+RTQ_API int32_t rtqOccluded(const RtqScene* scene, const RtqRays* rays, int32_t count, uint8_t* occluded, int32_t nbThreads);
+
+/**
+ * @brief Message de la dernière erreur du thread courant (chaîne vide sinon)
+ */
+RTQ_API const char* rtqGetLastError(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -7,176 +7,1083 @@
 
 #include "scene.h"
 #include "sdl.h"
+#include "sphere.h"
+#include "cubequad.h"
+#include "sdfshape.h"
+#include "imagefile.h"
+#include "parallel.h"
+#include "pathtracer.h"
+#include "denoiser.h"
+#include "gbuffer.h"
+#include "costmap.h"
+#include "perfcounters.h"
+#include "alloctracker.h"
 #include <iostream>
 #include <string>
 #include <vector>
 #include <limits>
 #include <cmath>
+#include <algorithm>
+#include <stdexcept>
 
-const float VIRTUAL_PIXEL_SIZE = 1.;
+const Real VIRTUAL_PIXEL_SIZE = 1.;
+const int TAILLE_TUILE_VUES = 32;     // Côté des tuiles d'un rendu de plusieurs vues (en pixels)
 const int NB_RECURSIONS_MAX = 1;
+const int RAYONS_PAR_LOT = 1 << 17;     // Rayons primaires d'un lot en mode hors mémoire
+const int PAQUET_SURFACES = 1024;       // Impacts traités par tâche en mode hors mémoire
 
 
+Scene::~Scene() {
+    clear();
+}
+
+void Scene::reserve(std::size_t nbShapes, std::size_t nbMaterials) {
+    // On prévoit la taille du plus gros objet pour chaque Shape
+    std::size_t shapeSize = std::max({sizeof(Sphere), sizeof(CubeQuad), sizeof(SdfShape)}) + alignof(SdfShape);
+    _arena.reserve(nbShapes * shapeSize);
+    _shapes.reserve(_shapes.size() + nbShapes);
+    _handles.reserve(_handles.size() + nbShapes);
+    _slots.reserve(_slots.size() + nbShapes);
+    _materials.reserve(_materials.size() + nbMaterials);
+    _materialTextures.reserve(_materialTextures.size() + nbMaterials);
+}
+
+MaterialHandle Scene::addMaterial(const Material& mat) {
+    _materials.push_back(mat);
+    _materialTextures.push_back(-1);
+    return _materials.size() - 1;
+}
+
+TextureHandle Scene::addTexture(const std::string& filename) {
+    return _textures->addTexture(filename);
+}
+
+void Scene::setMaterialTexture(MaterialHandle mat, TextureHandle texture) {
+    _materialTextures[mat] = texture;
+}
+
+ShapeHandle Scene::addShape(Shape* shape) {
+    _bvh.clear();
+    _slots.push_back(_shapes.size());
+    _handles.push_back(_slots.size() - 1);
+    _shapes.push_back(shape);
+    return _handles.back();
+}
+
+ShapeHandle Scene::addSphere(const Vector3f& center, Real radius, MaterialHandle mat) {
+    return addShape(_arena.create<Sphere>(center, radius, mat));
+}
+
+ShapeHandle Scene::addCubeQuad(const Vector3f& center, const Vector3f& halfSize, MaterialHandle mat) {
+    return addShape(_arena.create<CubeQuad>(center, halfSize, mat));
+}
+
+ShapeHandle Scene::addCubeQuad(const Vector3f& center, const Vector3f& halfSize, MaterialHandle mat, const std::array<Vector3f, 3>& basis) {
+    return addShape(_arena.create<CubeQuad>(center, halfSize, mat, basis));
+}
+
+ShapeHandle Scene::addSdf(const SdfPrimitive& a, MaterialHandle mat) {
+    return addShape(_arena.create<SdfShape>(a, mat));
+}
+
+ShapeHandle Scene::addSdf(const SdfPrimitive& a, const SdfPrimitive& b, Real blend, MaterialHandle mat) {
+    return addShape(_arena.create<SdfShape>(a, b, blend, mat));
+}
+
+ShapeHandle Scene::addShape(const ShapeRecord& record) {
+    return addShape(createShape(_arena, record));
+}
+
+Shape* Scene::makeShape(const ShapeRecord& record) {
+    std::vector<void*>& libres = _libres[record.type];
+    if (libres.empty())
+        return createShape(_arena, record);
+    void* memoire = libres.back();
+    libres.pop_back();
+    return createShape(memoire, record);
+}
+
+void Scene::destroyShape(Shape* shape, const ShapeRecord& record) {
+    shape->~Shape();
+    _libres[record.type].push_back(shape);
+}
+
+int Scene::getSlot(ShapeHandle h) const {
+    if (!hasShape(h))
+        throw std::runtime_error("Handle d'objet invalide : " + std::to_string(h));
+    return _slots[h];
+}
+
+ShapeHandle Scene::insertShape(const ShapeRecord& record) {
+    if (_paged)
+        throw std::runtime_error("Les objets d'une scène hors mémoire ne sont pas modifiables");
+    _slots.push_back(_shapes.size());
+    _handles.push_back(_slots.size() - 1);
+    _shapes.push_back(makeShape(record));
+    _bvh.insert(_shapes);
+    return _handles.back();
+}
+
+void Scene::removeShape(ShapeHandle h) {
+    int k = getSlot(h);
+    _bvh.remove(_shapes, k);
+    destroyShape(_shapes[k], _shapes[k]->getRecord());
+    // Le dernier objet prend la place libérée
+    int dernier = _shapes.size() - 1;
+    _shapes[k] = _shapes[dernier];
+    _handles[k] = _handles[dernier];
+    _slots[_handles[k]] = k;
+    _slots[h] = -1;
+    _shapes.pop_back();
+    _handles.pop_back();
+}
+
+void Scene::setShape(ShapeHandle h, const ShapeRecord& record) {
+    int k = getSlot(h);
+    destroyShape(_shapes[k], _shapes[k]->getRecord());
+    _shapes[k] = makeShape(record);
+    _bvh.touch(_shapes, k);
+}
+
+void Scene::transformShape(ShapeHandle h, const std::array<Vector3f, 3>& rotation, const Vector3f& translation) {
+    ShapeRecord r = _shapes[getSlot(h)]->getRecord();
+    if (r.type == ShapeRecord::CUBEQUAD) {
+        // Le centre d'une CubeQuad est exprimé dans sa base : on le translate dans le
+        // repère du monde, puis on le projette sur la base tournée
+        std::array<Vector3f, 3> base;
+        for (int b = 0; b < 3; b++) {
+            const Real* axe = r.params + 6 + 3*b;
+            base[b] = Vector3f(axe[0], axe[1], axe[2]);
+        }
+        Vector3f centre = base[0] * r.params[0] + base[1] * r.params[1] + base[2] * r.params[2] + translation;
+        for (int b = 0; b < 3; b++) {
+            Vector3f image = rotation[0] * base[b][0] + rotation[1] * base[b][1] + rotation[2] * base[b][2];
+            for (int a = 0; a < 3; a++)
+                r.params[6 + 3*b + a] = image[a];
+            r.params[b] = centre.dot(image);
+        }
+    } else {
+        for (int a = 0; a < 3; a++)
+            r.params[a] += translation[a];
+    }
+    if (r.type == ShapeRecord::SDF && (r.variant >> 8) != SdfPrimitive::NONE) {
+        // Le centre de la seconde primitive tourne autour de celui de la première (déjà
+        // translaté), les primitives restent alignées sur les axes
+        Vector3f c(r.params[0], r.params[1], r.params[2]);
+        Vector3f e = Vector3f(r.params[7], r.params[8], r.params[9]) - (c - translation);
+        Vector3f image = c + rotation[0] * e[0] + rotation[1] * e[1] + rotation[2] * e[2];
+        for (int a = 0; a < 3; a++)
+            r.params[7 + a] = image[a];
+    }
+    setShape(h, r);
+}
+
+BvhUpdate Scene::updateBvh(int nbThreads) {
+    return _bvh.update(_shapes, nbThreads);
+}
+
+void Scene::releaseShapes() {
+    // Les objets sont dans l'Arena : on appelle seulement leurs destructeurs
+    for (Shape* s : _shapes) {
+        s->~Shape();
+    }
+    _shapes.clear();
+    _handles.clear();
+    _slots.clear();
+    for (std::vector<void*>& libres : _libres)
+        libres.clear();
+    _arena.release();
+    _bvh.clear();
+    _cache.reset();
+}
+
+void Scene::clear() {
+    releaseShapes();
+    _materials.clear();
+    _materialTextures.clear();
+    _textures.reset(new TextureCache(_textures->getCapacity()));
+    _paged.reset();
+}
+
+void Scene::buildBvh() {
+    _bvh.build(_shapes);
+}
+
+void Scene::saveCache(const std::string& filename, uint64_t sourceKey) {
+    if (!_bvh.isBuilt() || !_bvh.isCompact())
+        buildBvh();
+    std::vector<ShapeRecord> shapes;
+    shapes.reserve(_shapes.size());
+    for (const Shape* s : _shapes)
+        shapes.push_back(s->getRecord());
+    std::vector<MaterialRecord> materials;
+    materials.reserve(_materials.size());
+    for (std::size_t k = 0; k < _materials.size(); k++) {
+        const Material& m = _materials[k];
+        materials.push_back({m.getR(), m.getG(), m.getB(), m.getShininess(), _materialTextures[k]});
+    }
+    std::vector<std::string> textures;
+    for (TextureHandle h = 0; h < _textures->getNbTextures(); h++)
+        textures.push_back(_textures->getFilename(h));
+    SceneCache::write(filename, sourceKey, shapes, materials, textures, _bvh);
+}
+
+void Scene::loadCache(const std::string& filename, uint64_t sourceKey) {
+    // Le cache est vérifié avant de toucher à la scène
+    std::unique_ptr<SceneCache> cache(new SceneCache(filename, sourceKey));
+    std::unique_ptr<TextureCache> textures(new TextureCache(_textures->getCapacity()));
+    for (int k = 0; k < cache->getNbTextures(); k++)
+        textures->addTexture(cache->getTextures()[k].path);
+    clear();
+    _textures = std::move(textures);
+    reserve(cache->getNbShapes(), cache->getNbMaterials());
+    for (int k = 0; k < cache->getNbMaterials(); k++) {
+        const MaterialRecord& m = cache->getMaterials()[k];
+        setMaterialTexture(addMaterial(Material(m.r, m.g, m.b, m.shininess)), m.texture);
+    }
+    for (int k = 0; k < cache->getNbShapes(); k++)
+        addShape(cache->getShapes()[k]);
+    _bvh.view(cache->getNodes(), cache->getNbNodes(), cache->getIndices(), cache->getNbIndices());
+    _cache = std::move(cache);
+}
+
+void Scene::savePages(const std::string& filename, uint64_t sourceKey, int shapesPerPage) {
+    if (!_bvh.isBuilt() || !_bvh.isCompact())
+        buildBvh();
+    PagedGeometry::write(filename, sourceKey, _shapes, _bvh, shapesPerPage);
+}
+
+void Scene::loadPages(const std::string& filename, uint64_t sourceKey, std::size_t capacity) {
+    // Le fichier est vérifié avant de libérer les objets
+    std::unique_ptr<PagedGeometry> paged(new PagedGeometry(filename, sourceKey, capacity));
+    if (paged->getMaxMaterial() >= getNbMaterials())
+        throw std::runtime_error("Le fichier de pages " + filename + " désigne un matériau inexistant");
+    releaseShapes();
+    _paged = std::move(paged);
+}
+
 /**
- * @brief Détermine l'objet le plus proche de la caméra en passant par le pixel courant
+ * @brief Détermine l'objet le plus proche de la caméra parmi les objets candidats de la
+ * tuile du pixel (rayons primaires)
  * 
  * @param rayon le rayon depuis la caméra vers le pixel courant
  * @param objets la liste des objets de la scène
+ * @param candidats les indices des objets à tester
  * @param camera la caméra d'où l'on regarde la scène
  * @return l'indice dans le tableau dynamique de l'objet le plus proche de la caméra
  */
-int plusProche(const Ray3f& rayon, std::vector<Shape*> objets, const Camera& camera) {
+int plusProche(const Ray3f& rayon, const std::vector<Shape*>& objets, const Candidates& candidats, const Camera& camera) {
+    PerfStage etape(STAGE_CLOSEST_HIT, 1);
     int indexPlusProche = -1;
-    int nbObjets = objets.size();
-    float distMin = std::numeric_limits<float>::max();
-    for (int k = 0; k < nbObjets; k++) {
-        // Le t qui correspond à l'intersection entre la Shape (Cube ou Sphere) et le rayon depuis la caméra
-        float t = objets[k]->is_hit(rayon);
-        if (t>0) { 
-            Vector3f pointIntersectionCur = rayon.pointAt(t); // Point d'intersection entre la shape et le rayon depuis la caméra
-            float dist = (camera.getPos() - pointIntersectionCur).norm();
+    Real distMin = std::numeric_limits<Real>::max();
+    for (int c = 0; c < candidats.count; c++) {
+        int k = candidats.indices[c];
+        Real t = objets[k]->is_hit(rayon);
+        if (t>0) {
+            // Distances au carré : même ordre, sans racine
+            Real dist = (camera.getPos() - rayon.pointAt(t)).squaredNorm();
             if (dist < distMin) {
-            // Si le point courant est plus proche que celui enregistré précédemment, on l'enregistre à son tour
                 distMin = dist;
                 indexPlusProche = k;
             }
         }
     }
+    countRay(candidats.count, 0);
     return indexPlusProche;
 }
 
 /**
- * @brief retourne la couleur ambiante de l'objet
+ * @brief Angle d'ouverture du cône d'un rayon primaire : un pixel virtuel vu depuis la caméra
+ *
+ * @param camera
+ * @return Real
+ */
+static Real ouverturePixel(const Camera& camera) {
+    return VIRTUAL_PIXEL_SIZE / camera.getDir().norm();
+}
+
+/**
+ * @brief Rayon primaire passant par le point (x, y) de la grille des pixels virtuels
+ *
+ * @param camera
+ * @param x
+ * @param y
+ * @return Ray3f
+ */
+static Ray3f rayonPrimaire(const Camera& camera, Real x, Real y) {
+    PerfStage etape(STAGE_RAY_GENERATION);
+    return camera.getRay(x, y);
+}
+
+/**
+ * @brief retourne la couleur ambiante d'un matériau
  *
- * @param s la shape correspondant à l'objet
+ * @param mat le matériau de l'objet
+ * @param ambiant le coefficient ambiant
  * @return Material
  */
-Material getAmbiantColor(const Shape& s){
-    Material ambiantColor = s.getMat()*0.2;
+Material getAmbiantColor(const Material& mat, float ambiant){
+    Material ambiantColor = mat*ambiant;
     ambiantColor.setShininess(0);
     return ambiantColor;
 }
 
+/**
+ * @brief retourne la normale de l'objet au point d'intersection, orientée vers l'intérieur
+ * si la caméra s'y trouve
+ *
+ * @param closestObject l'objet où se situe le point d'intersection
+ * @param camera la caméra
+ * @param intersection le point d'intersection
+ * @return Vector3f
+ */
+Vector3f getShadingNormal(const Shape& closestObject, const Camera& camera, const Vector3f& intersection){
+    //Calcul de la direction de la normale (vers l'intérieur -1 ou vers l'extérieur +1)
+    Real normalDir = (closestObject.isInside(camera.getPos())) ? -1 : 1;
+    return closestObject.getNormal(intersection)*normalDir;
+}
+
 /**
  * @brief retourne la somme de la couleur diffuse et de la couleur spéculaire sur le point
  * d'intersection (Phong Model)
  *
- * @param s la shape correspondant à l'objet où se situe le point d'intersection
- * @param camera la caméra
+ * @param mat le matériau de l'objet où se situe le point d'intersection
+ * @param normal la normale orientée au point d'intersection
  * @param source la source de lumière
  * @param intersection le point d'intersection
+ * @param speculaire le coefficient spéculaire
+ * @param tier la précision des calculs (normalisation, puissance)
  * @return Material
  */
-Material getDiffuseSpecularColor(const Shape& closestObject, const Camera& camera, const Ray3f& source, const Vector3f& intersection){
-    //Calcul de la direction de la normale (vers l'intérieur -1 ou vers l'extérieur +1)
-    float normalDir = (closestObject.isInside(camera.getPos())) ? -1 : 1;
-
-    //Calcul de la normale
-    Vector3f normal = closestObject.getNormal(intersection)*normalDir;
-
+Material getDiffuseSpecularColor(const Material& mat, const Vector3f& normal, const Ray3f& source, const Vector3f& intersection, float speculaire, MathTier tier){
     //Calcul du produit scalaire entre la normale et le rayon intersection -> source
     Vector3f dirVersSource = source.getOrigin() - intersection;
-    float dot = normal.dot(dirVersSource.normalized());
+    Real dot = normal.dot(mathNormalize(dirVersSource, tier));
 
     //Calcul de la couleur diffuse et de la couleur spéculaire
     if (dot>0) {
-        float specularCoef=std::pow(dot,closestObject.getMat().getShininess())*0.1;
-        Material diffuseColor = closestObject.getMat()*dot;
-        Material specularColor = closestObject.getMat()*specularCoef;
+        float specularCoef=mathPow(dot,mat.getShininess(),tier)*speculaire;
+        Material diffuseColor = mat*dot;
+        Material specularColor = mat*specularCoef;
         return specularColor + diffuseColor;
     }
     return Material(0,0,0,0);
 }
 
+/**
+ * @brief Fraction de la source visible depuis le point d'intersection, c'est-à-dire non
+ * cachée par un objet (rayons d'ombre) : 0 ou 1 pour une source ponctuelle
+ *
+ * @param pointIntersection le point d'intersection
+ * @param source la source de lumière
+ * @param light la forme de la source
+ * @param settings le nombre maximal de rayons d'ombre
+ * @param objets la liste des objets de la scène
+ * @param bvh la hiérarchie de boîtes des objets
+ * @return Real
+ */
+Real visibilite(const Vector3f& pointIntersection, const Ray3f& source, const AreaLight& light, const RenderSettings& settings,
+                const std::vector<Shape*>& objets, const Bvh& bvh) {
+    return lightVisibility(pointIntersection, source, light, settings.shadowSamples, objets, bvh);
+}
+
+/**
+ * @brief Couleur d'un point d'intersection : ambiante, plus diffuse, spéculaire et réfléchie
+ * pondérées par la part visible de la source
+ *
+ * @param mat le matériau de l'objet touché
+ * @param normal la normale orientée au point d'intersection
+ * @param pointIntersection le point d'intersection
+ * @param source la source de lumière
+ * @param visible fraction de la source visible depuis le point (0 : dans l'ombre)
+ * @param colorsReflect la couleur issue du rayon réfléchi (déjà pondérée par la shininess)
+ * @param settings les coefficients ambiant et spéculaire, la précision des calculs
+ * @return Material
+ */
+Material ombrage(const Material& mat, const Vector3f& normal, const Vector3f& pointIntersection, const Ray3f& source,
+                 Real visible, const Material& colorsReflect, const RenderSettings& settings) {
+    Material ambiantColor = getAmbiantColor(mat, settings.ambient);
+
+    // Si le pixel est éclairé par un objet, on l'affiche avec les propriétés de l'objet le plus proche (le Material associé)
+    if (visible > 0) {
+        Material diffAndSpecColor = getDiffuseSpecularColor(mat, normal, source, pointIntersection, settings.specular, settings.math);
+        return ambiantColor + diffAndSpecColor*visible + colorsReflect*visible;
+    }
+    return ambiantColor;
+}
+
+/**
+ * @brief Transmittance d'un milieu le long d'un segment de rayon (tracé de Whitted) :
+ * exponentielle de l'épaisseur optique, échantillonnée avec un décalage propre au rayon
+ */
+Real transmittanceWhitted(const Medium& milieu, const Ray3f& rayon, Real t, const RenderSettings& settings) {
+    Rng rng = rayRng(rayon, settings.seed);
+    return std::exp(-milieu.opticalDepth(rayon, t, rng.next()));
+}
+
+/**
+ * @brief Voile des milieux entre l'origine du rayon et la distance t (tracé de Whitted) :
+ * chaque milieu, dans l'ordre, atténue la couleur de sa transmittance et y ajoute sa
+ * couleur (l'albédo) en proportion de ce qu'il cache
+ *
+ * @param couleur la couleur vue au bout du segment
+ * @param rayon le rayon, de direction normée
+ * @param t la longueur du segment
+ * @param milieux les milieux participants
+ * @param settings la graine du décalage des échantillons
+ * @return Material
+ */
+Material traverseMilieux(const Material& couleur, const Ray3f& rayon, Real t, const std::vector<Medium>& milieux, const RenderSettings& settings) {
+    Material resultat = couleur;
+    for (const Medium& m : milieux) {
+        Real transmittance = transmittanceWhitted(m, rayon, t, settings);
+        if (transmittance >= 1)
+            continue;
+        const Vector3f& albedo = m.getAlbedo();
+        resultat = resultat*transmittance + Material(albedo[0]*255, albedo[1]*255, albedo[2]*255, 0)*(1-transmittance);
+    }
+    return resultat;
+}
+
+/**
+ * @brief Rayon réfléchi par l'objet au point d'impact déjà connu (Shape::reflect recalcule
+ * l'intersection, ce qui coûte une seconde marche pour un SdfShape)
+ */
+static inline Ray3f rayonReflechi(const Shape& objet, const Ray3f& rayon, const Vector3f& point) {
+    return Ray3f(point, rayon.getDirection().reflect(objet.getNormal(point)));
+}
+
 /**
  * @brief Effectue le tracé de rayon, et renvoie la couleur finale du pixel
  * 
  * @param rayon le rayon depuis la caméra vers le pixel courant
  * @param objets la liste des objets de la scène
+ * @param bvh la hiérarchie de boîtes des objets
+ * @param materiaux la table des matériaux de la scène et leurs textures
  * @param camera la caméra d'où l'on regarde la scène
  * @param source la source de lumière
+ * @param light la forme de la source
+ * @param milieux les milieux participants
+ * @param settings les coefficients d'ombrage
+ * @param cone largeur et angle d'ouverture du cône du rayon à son origine (mip-map des textures)
  * @param niveauRecursion indique la profondeur de récursion dans laquelle on est
+ * @param candidats si non nul, les seuls objets que peut toucher le rayon (rayon primaire)
+ * @param aov si non nul, reçoit les informations de l'impact (rayon primaire)
  * @return la couleur utilisée pour colorier le pixel virtuel courant
  */
-Material lanceRayon(const Ray3f& rayon, std::vector<Shape*> objets, const Camera& camera, const Ray3f& source, int niveauRecursion) {
+Material lanceRayon(const Ray3f& rayon, const std::vector<Shape*>& objets, const Bvh& bvh, const MaterialTable& materiaux, const Camera& camera, const Ray3f& source,
+                    const AreaLight& light, const std::vector<Medium>& milieux, const RenderSettings& settings, const RayCone& cone, int niveauRecursion, const Candidates* candidats = nullptr,
+                    PixelAov* aov = nullptr) {
     // Si on a excédé le niveau de récursion maximal, on renvoie la couleur de fond (noir complet)
     if (niveauRecursion > NB_RECURSIONS_MAX)
         return Material(0,0,0,0);
     
     // Sinon :
     // 2bi) Détermination de l'ensemble des objets qui passent par le rayon
-    // et 2bii) détermination de l'objet le plus proche de la caméra
-    int nbObjets = objets.size();
-    int indexPlusProche = plusProche(rayon, objets, camera); 
+    // et 2bii) détermination de l'objet le plus proche (de la caméra pour un rayon primaire,
+    // de l'origine du rayon sinon)
+    Real t;
+    int indexPlusProche = (candidats != nullptr) ? plusProche(rayon, objets, *candidats, camera) : bvh.closestHit(rayon, objets, t);
 
     // Calcul de la couleur finale
 
-    if (indexPlusProche == -1) // Si aucun objet n'est frappé par le rayon, on renvoie la couleur de fond
-        return Material(0,0,0,0);
+    if (indexPlusProche == -1) // Si aucun objet n'est frappé par le rayon, on renvoie la couleur de fond (voilée par les milieux)
+        return traverseMilieux(Material(0,0,0,0), rayon, std::numeric_limits<Real>::infinity(), milieux, settings);
     
+    // Sinon, indexPlusProche != -1, et c'est alors un indice valide ; closestHit a déjà
+    // donné la distance, plusProche (qui compare les distances à la caméra) non
+    if (candidats != nullptr)
+        t = objets[indexPlusProche]->is_hit(rayon);
+    Vector3f pointIntersection = rayon.pointAt(t);
+    Vector3f normal = getShadingNormal(*objets[indexPlusProche], camera, pointIntersection);
+    RayCone coneImpact = cone.propagate(t);
+    MaterialHandle h = objets[indexPlusProche]->getMaterial();
+    Material mat = materiaux[h];
+    if (materiaux.isTextured(h)) {
+        Vector3f uv = textureCoordinates(*objets[indexPlusProche], pointIntersection, rayon.getDirection(), normal, coneImpact.width);
+        mat = materiaux.resolve(h, uv[0], uv[1], uv[2]);
+    }
+    if (aov != nullptr)
+        *aov = {Vector3f(mat.getR(), mat.getG(), mat.getB()) / 255, normal, float(t), indexPlusProche};
+
     // 2biii) Si le rayon parvient à frapper un objet, et si cet objet n'est pas mat (shininess > 0), on suit son rayon réfléchi
     Material colorsReflect(0,0,0,0);
-    if (objets[indexPlusProche]->getMat().getShininess() > 0)
+    if (mat.getShininess() > 0)
         // On calcule récursivement la couleur issu du rayon réfléchi en le point d'intersection
-        colorsReflect = lanceRayon(objets[indexPlusProche]->reflect(rayon), objets, camera, source, niveauRecursion+1)*objets[indexPlusProche]->getMat().getShininess();
-    
-    // Sinon, indexPlusProche != -1, et c'est alors un indice valide
-    Vector3f pointIntersection = rayon.pointAt(objets[indexPlusProche]->is_hit(rayon));
-    // 2c) Calcul de la couleur : on teste déjà si le point est éclairé ou non
-    Vector3f dirVersSource = source.getOrigin() - pointIntersection;
-    Ray3f rayonVersSource = Ray3f(pointIntersection + dirVersSource*0.001, dirVersSource.normalized()); // Rayon dirigé vers la source de lumière
-    bool estEclaire = true;
-    float distVersSource = (source.getOrigin() - pointIntersection).norm();
-    int k = 0;
-    // On teste si ce rayon intersecte un objet ou pas
-    while (k < nbObjets && estEclaire) {
-        // On regarde si le rayon qui part de l'intersection vers la source intersecte la shape
-        float estObstrue = objets[k]->is_hit(rayonVersSource);
-        // S'il y a intersection avant la source alors le point n'est pas éclairé
-        if (estObstrue > 0 && (estObstrue < distVersSource))
-            estEclaire = false;
-        k++;
-    }
-
-    Material ambiantColor = getAmbiantColor(*objets[indexPlusProche]);
+        colorsReflect = lanceRayon(rayonReflechi(*objets[indexPlusProche], rayon, pointIntersection), objets, bvh, materiaux, camera, source, light, milieux, settings, coneImpact, niveauRecursion+1)*mat.getShininess();
 
-    // Si le pixel est éclairé par un objet, on l'affiche avec les propriétés de l'objet le plus proche (le Material associé)
-    if (estEclaire) {
-        Material diffAndSpecColor = getDiffuseSpecularColor(*objets[indexPlusProche],camera,source,pointIntersection);
-        return ambiantColor + diffAndSpecColor + colorsReflect;
+    // 2c) Calcul de la couleur : on teste déjà si le point est éclairé ou non (objets, puis
+    // milieux entre le point et la source), et les milieux voilent le point vu du rayon
+    Real visible = visibilite(pointIntersection, source, light, settings, objets, bvh);
+    if (visible > 0 && !milieux.empty()) {
+        Vector3f versSource = source.getOrigin() - pointIntersection;
+        Real distance = versSource.norm();
+        Ray3f ombre(pointIntersection, versSource / distance);
+        for (const Medium& m : milieux)
+            visible *= transmittanceWhitted(m, ombre, distance, settings);
     }
-    return ambiantColor;
+    return traverseMilieux(ombrage(mat, normal, pointIntersection, source, visible, colorsReflect, settings), rayon, t, milieux, settings);
+}
+
+Material Scene::tracePixel(int i, int j, int width, int height) const {
+    return tracePixel(_camera, i, j, width, height);
+}
+
+Material Scene::tracePixel(const Camera& camera, int i, int j, int width, int height) const {
+    PixelAov aov;
+    return tracePixel(camera, i, j, width, height, aov);
+}
+
+Material Scene::tracePixel(const Camera& camera, int i, int j, int width, int height, PixelAov& aov, const TileCulling* culling) const {
+    PerfStage etape(STAGE_SHADING);
+    aov = {Vector3f(0), Vector3f(0), -1};
+
+    // Dimensions des pixels virtuels (les cases de la grille)
+    Real px_width = VIRTUAL_PIXEL_SIZE;
+    Real px_height = px_width;
+    Real i_px = i*px_width;
+    Real j_px = j*px_height;
+
+    // Objets que peuvent toucher les rayons primaires du pixel
+    Candidates candidats;
+    if (culling != nullptr) {
+        PerfStage generation(STAGE_RAY_GENERATION);
+        candidats = culling->getCandidates(i, j);
+    }
+    const Candidates* pCandidats = (culling != nullptr) ? &candidats : nullptr;
+
+    // Tracé de chemins : moyenne de plusieurs échantillons répartis dans le pixel
+    if (_settings.integrator == RenderSettings::PATH_TRACING) {
+        Vector3f somme(0), albedo(0), normal(0);
+        float depth = 0, sommeL = 0, sommeL2 = 0;
+        int nbImpacts = 0;
+        int n = std::max(1, _settings.samplesPerPixel);
+        uint32_t cle = Rng(_settings.seed, j*width + i, n).nextUInt();
+        for (int s = 0; s < _settings.samplesPerPixel; s++) {
+            Rng rng(_settings.seed, j*width + i, s);
+            Real du = ((s + rng.next()) / n - 0.5f) * px_width;
+            Real dv = ((Rng::permute(s, n, cle) + rng.next()) / n - 0.5f) * px_height;
+            Ray3f rayFromCam = rayonPrimaire(camera, i_px-width/2 + du, j_px-height/2 + dv);
+            PixelAov echantillon;
+            Vector3f couleur = tracePath(rayFromCam, _shapes, _bvh, getMaterialTable(), _source, _light, _media, _settings.maxDepth, rng, &echantillon,
+                                         pCandidats, ouverturePixel(camera));
+            somme = somme + couleur;
+            float l = 0.2126f * couleur.getX() + 0.7152f * couleur.getY() + 0.0722f * couleur.getZ();
+            sommeL += l;
+            sommeL2 += l * l;
+            if (echantillon.depth > 0) {
+                albedo = albedo + echantillon.albedo;
+                normal = normal + echantillon.normal;
+                depth += echantillon.depth;
+                nbImpacts++;
+            }
+        }
+        if (nbImpacts > 0)
+            aov = {albedo / nbImpacts, normal.normalized(), depth / nbImpacts};
+        // Variance de la moyenne : variance des échantillons (sans biais) divisée par leur nombre
+        if (n > 1)
+            aov.variance = std::max(0.f, sommeL2 - sommeL * sommeL / n) / (n - 1) / n;
+        Vector3f moyenne = somme / n;
+        return Material(moyenne.getX(), moyenne.getY(), moyenne.getZ(), 0);
+    }
+
+    // 2a) : On calcule le rayon qui part de la caméra vers le pixel virtuel
+    Ray3f rayFromCam = rayonPrimaire(camera, i_px-width/2,j_px-height/2);
+
+    // 2b) et 2c) : On détermine les intersections, pour en déduire la couleur finale du pixel virtuel
+    return lanceRayon(rayFromCam, _shapes, _bvh, getMaterialTable(), camera, _source, _light, _media, _settings, RayCone{0, ouverturePixel(camera)}, 0, pCandidats, &aov);
+}
+
+Material Scene::measurePixel(const Camera& camera, int i, int j, int width, int height, PixelAov& aov,
+                             const TileCulling* culling, CostMap& costs) const {
+    RayCost cost;
+    rayCostCounters = &cost;
+    uint64_t debut = readCycles();
+    Material colors = tracePixel(camera, i, j, width, height, aov, culling);
+    uint64_t fin = readCycles();
+    rayCostCounters = nullptr;
+    costs.set(std::size_t(j) * width + i, cost, fin - debut);
+    return colors;
+}
+
+void Scene::renderFrame(Framebuffer& fb, const Camera& camera, int nbThreads, CostMap* costs) const {
+    if (_paged) {
+        renderPaged(fb, camera, nbThreads);
+        return;
+    }
+    int width = fb.getWidth(), height = fb.getHeight();
+    TileCulling culling(camera, _shapes, _bvh, width, height, nbThreads);
+    parallelFor(height, nbThreads, [&](int j) {
+        renderTile(fb, camera, &culling, 0, j, width, j + 1, costs);
+    });
+    if (_settings.sampling != SAMPLING_FULL)
+        upsample(fb, _settings.sampling, nbThreads);
+    if (_settings.denoise && _settings.integrator == RenderSettings::PATH_TRACING)
+        denoise(fb, nbThreads);
+}
+
+void Scene::renderViews(std::vector<Framebuffer>& fbs, const std::vector<Camera>& cameras, int nbThreads) const {
+    if (fbs.size() != cameras.size())
+        throw std::runtime_error("Il faut une image par caméra");
+    int nbVues = cameras.size();
+    if (_paged) {
+        for (int v = 0; v < nbVues; v++)
+            renderPaged(fbs[v], cameras[v], nbThreads);
+        return;
+    }
+
+    // Boîtes des objets calculées une fois pour toutes les vues
+    std::vector<Aabb> boites = TileCulling::shapeBounds(_shapes, nbThreads);
+    std::vector<std::unique_ptr<TileCulling>> culling(nbVues);
+    parallelFor(nbVues, nbThreads, [&](int v) {
+        culling[v].reset(new TileCulling(cameras[v], boites, _bvh, fbs[v].getWidth(), fbs[v].getHeight(),
+                                         0, fbs[v].getHeight(), 1));
+    });
+
+    // Tuiles entrelacées : la première tuile de chaque vue, puis la deuxième, etc.
+    std::vector<std::pair<int, int>> tuiles;
+    std::vector<int> tuilesX(nbVues), nbTuiles(nbVues);
+    int nbMax = 0;
+    for (int v = 0; v < nbVues; v++) {
+        tuilesX[v] = (fbs[v].getWidth() + TAILLE_TUILE_VUES - 1) / TAILLE_TUILE_VUES;
+        nbTuiles[v] = tuilesX[v] * ((fbs[v].getHeight() + TAILLE_TUILE_VUES - 1) / TAILLE_TUILE_VUES);
+        nbMax = std::max(nbMax, nbTuiles[v]);
+    }
+    for (int t = 0; t < nbMax; t++) {
+        for (int v = 0; v < nbVues; v++) {
+            if (t < nbTuiles[v])
+                tuiles.push_back({v, t});
+        }
+    }
+    parallelFor(tuiles.size(), nbThreads, [&](int k) {
+        int v = tuiles[k].first, t = tuiles[k].second;
+        Framebuffer& fb = fbs[v];
+        int x0 = (t % tuilesX[v]) * TAILLE_TUILE_VUES, y0 = (t / tuilesX[v]) * TAILLE_TUILE_VUES;
+        renderTile(fb, cameras[v], culling[v].get(), x0, y0, std::min(x0 + TAILLE_TUILE_VUES, fb.getWidth()),
+                   std::min(y0 + TAILLE_TUILE_VUES, fb.getHeight()));
+    });
+
+    for (Framebuffer& fb : fbs) {
+        if (_settings.sampling != SAMPLING_FULL)
+            upsample(fb, _settings.sampling, nbThreads);
+        if (_settings.denoise && _settings.integrator == RenderSettings::PATH_TRACING)
+            denoise(fb, nbThreads);
+    }
+}
+
+void Scene::renderTile(Framebuffer& fb, const Camera& camera, const TileCulling* culling, int x0, int y0, int x1, int y1,
+                       CostMap* costs) const {
+    if (_paged)
+        throw std::runtime_error("Le mode hors mémoire ne calcule que des images complètes");
+    PerfThreadScope mesure(_profiler);
+    HotPathScope critique;
+    int width = fb.getWidth(), height = fb.getHeight();
+    for (int j = y0; j < y1; j++) {
+        for (int i = x0; i < x1; i++) {
+            if (!isTracedPixel(_settings.sampling, i, j))
+                continue;
+            PixelAov aov;
+            Material colors = (costs != nullptr) ? measurePixel(camera, i, j, width, height, aov, culling, *costs)
+                                                 : tracePixel(camera, i, j, width, height, aov, culling);
+            std::size_t k = std::size_t(j) * width + i;
+            fb.r[k] = colors.getR();
+            fb.g[k] = colors.getG();
+            fb.b[k] = colors.getB();
+            fb.albedoR[k] = aov.albedo.getX();
+            fb.albedoG[k] = aov.albedo.getY();
+            fb.albedoB[k] = aov.albedo.getZ();
+            fb.normalX[k] = aov.normal.getX();
+            fb.normalY[k] = aov.normal.getY();
+            fb.normalZ[k] = aov.normal.getZ();
+            fb.depth[k] = aov.depth > 0 ? aov.depth : Framebuffer::PROFONDEUR_FOND;
+            fb.shape[k] = aov.shape;
+            fb.variance[k] = aov.variance;
+        }
+    }
+}
+
+int Scene::getNbGBufferLayers() const {
+    return NB_RECURSIONS_MAX + 1;
+}
+
+/**
+ * @brief Enregistre dans le niveau layer du G-buffer la surface touchée par le rayon au
+ * pixel p (objet k, à la distance t), sauf la visibilité de la source. Les coordonnées
+ * de texture sont toujours enregistrées, pour qu'une texture associée ensuite à un
+ * matériau n'ait pas à relancer les rayons ; cone devient le cône du rayon au point
+ * d'impact
+ *
+ * @return Vector3f le point d'impact
+ */
+static Vector3f enregistreSurface(GBufferLayer& layer, std::size_t p, const Ray3f& rayon, int k, const Shape& objet, Real t,
+                                  const Camera& camera, RayCone& cone) {
+    layer.shape[p] = k;
+    Vector3f point = rayon.pointAt(t);
+    Vector3f normal = getShadingNormal(objet, camera, point);
+    cone = cone.propagate(t);
+    Vector3f uv = textureCoordinates(objet, point, rayon.getDirection(), normal, cone.width);
+    layer.u[p] = uv[0];
+    layer.v[p] = uv[1];
+    layer.footprint[p] = uv[2];
+    layer.material[p] = objet.getMaterial();
+    layer.px[p] = point.getX();
+    layer.py[p] = point.getY();
+    layer.pz[p] = point.getZ();
+    layer.nx[p] = normal.getX();
+    layer.ny[p] = normal.getY();
+    layer.nz[p] = normal.getZ();
+    return point;
+}
+
+/**
+ * @brief Enregistre dans le niveau layer du G-buffer l'impact du rayon au pixel p
+ * (objet k, -1 si aucun) et la visibilité de la source ; cone devient le cône du rayon
+ * au point d'impact
+ */
+static Vector3f enregistreImpact(GBufferLayer& layer, std::size_t p, const Ray3f& rayon, int k, Real t, const std::vector<Shape*>& objets,
+                                 const Bvh& bvh, const Camera& camera, const Ray3f& source, const AreaLight& light,
+                                 const RenderSettings& settings, RayCone& cone) {
+    layer.shape[p] = k;
+    if (k == -1)
+        return Vector3f(0, 0, 0);
+    Vector3f point = enregistreSurface(layer, p, rayon, k, *objets[k], t, camera, cone);
+    layer.lit[p] = visibilite(point, source, light, settings, objets, bvh);
+    return point;
+}
+
+void Scene::buildGBuffer(GBuffer& gb, const Camera& camera, int nbThreads) const {
+    int width = gb.getWidth(), height = gb.getHeight();
+    TileCulling culling(camera, _shapes, _bvh, width, height, nbThreads);
+    parallelFor(height, nbThreads, [&](int j) {
+        HotPathScope critique;
+        for (int i = 0; i < width; i++) {
+            std::size_t p = std::size_t(j) * width + i;
+            Ray3f rayon = camera.getRay(i*VIRTUAL_PIXEL_SIZE-width/2, j*VIRTUAL_PIXEL_SIZE-height/2);
+            int k = plusProche(rayon, _shapes, culling.getCandidates(i, j), camera);
+            Real t = (k == -1) ? -1 : _shapes[k]->is_hit(rayon);
+            RayCone cone = {0, ouverturePixel(camera)};
+            Vector3f point = enregistreImpact(gb.getLayer(0), p, rayon, k, t, _shapes, _bvh, camera, _source, _light, _settings, cone);
+            // Comme dans lanceRayon, le rayon réfléchi n'est suivi que sur une surface
+            // réfléchissante (shininess > 0)
+            for (int n = 1; n < gb.getNbLayers(); n++) {
+                if (k == -1 || !(_materials[_shapes[k]->getMaterial()].getShininess() > 0)) {
+                    k = -1;
+                    gb.getLayer(n).shape[p] = -1;
+                    continue;
+                }
+                rayon = rayonReflechi(*_shapes[k], rayon, point);
+                k = _bvh.closestHit(rayon, _shapes, t);
+                point = enregistreImpact(gb.getLayer(n), p, rayon, k, t, _shapes, _bvh, camera, _source, _light, _settings, cone);
+            }
+        }
+    });
+}
+
+void Scene::renderPaged(Framebuffer& fb, const Camera& camera, int nbThreads) const {
+    if (_settings.integrator != RenderSettings::WHITTED)
+        throw std::runtime_error("Seul le tracé de Whitted est pris en charge en mode hors mémoire");
+    int width = fb.getWidth(), height = fb.getHeight();
+    std::size_t tailleObjet = std::max({sizeof(Sphere), sizeof(CubeQuad), sizeof(SdfShape)}) + alignof(SdfShape);
+
+    // Lots de lignes : chaque page attendue par un lot n'est lue qu'une fois pour tout le lot.
+    // Le G-buffer ne couvre que le lot, ombré avant de passer au suivant
+    int lignesParLot = std::max(1, RAYONS_PAR_LOT / std::max(1, width));
+    for (int y0 = 0; y0 < height; y0 += lignesParLot) {
+        int rows = std::min(lignesParLot, height - y0);
+        GBuffer gb(width, rows, getNbGBufferLayers());
+        std::vector<std::size_t> pixels(std::size_t(rows) * width);
+        std::vector<Ray3f> rayons(pixels.size());
+        std::vector<RayCone> cones(pixels.size(), RayCone{0, ouverturePixel(camera)});
+        for (int j = y0; j < y0 + rows; j++) {
+            for (int i = 0; i < width; i++) {
+                std::size_t q = std::size_t(j - y0) * width + i;
+                pixels[q] = q;     // Pixel du G-buffer du lot
+                rayons[q] = camera.getRay(i*VIRTUAL_PIXEL_SIZE-width/2, j*VIRTUAL_PIXEL_SIZE-height/2);
+            }
+        }
+
+        std::vector<PagedGeometry::Hit> impacts;
+        std::vector<char> occultes;
+        for (int n = 0; n < gb.getNbLayers() && !rayons.empty(); n++) {
+            GBufferLayer& layer = gb.getLayer(n);
+            _paged->closestHits(rayons, impacts, nbThreads);
+
+            // Surfaces touchées (recréées depuis leurs enregistrements, leurs pages ont pu
+            // être évincées), rayons d'ombre et rayons réfléchis du niveau suivant
+            std::vector<int> touches;
+            for (std::size_t q = 0; q < impacts.size(); q++) {
+                if (impacts[q].shape != -1)
+                    touches.push_back(q);
+            }
+            // Rayons d'ombre par lots comme les autres requêtes : d'abord les premiers
+            // échantillons de chaque point, puis le reste pour les points dont les premiers
+            // rayons ne sont pas d'accord (pénombre)
+            int nbEchantillons = _light.getNbSamples(_settings.shadowSamples);
+            int premier = std::min(nbEchantillons, int(AreaLight::FIRST_SAMPLES));
+            std::vector<Ray3f> ombres(touches.size() * premier), reflechis(touches.size());
+            std::vector<Real> distances(ombres.size());
+            std::vector<Vector3f> points(touches.size());
+            int nbPaquets = (touches.size() + PAQUET_SURFACES - 1) / PAQUET_SURFACES;
+            parallelFor(nbPaquets, nbThreads, [&](int paquet) {
+                Arena arena(PAQUET_SURFACES * tailleObjet);
+                int fin = std::min<int>(touches.size(), (paquet + 1) * PAQUET_SURFACES);
+                for (int c = paquet * PAQUET_SURFACES; c < fin; c++) {
+                    int q = touches[c];
+                    Shape* objet = createShape(arena, impacts[q].record);
+                    points[c] = enregistreSurface(layer, pixels[q], rayons[q], impacts[q].shape, *objet, impacts[q].t, camera, cones[q]);
+                    _light.shadowRays(points[c], _source, 0, premier, &ombres[c * premier], &distances[c * premier]);
+                    reflechis[c] = rayonReflechi(*objet, rayons[q], points[c]);
+                    objet->~Shape();
+                }
+            });
+            _paged->occluded(ombres, distances, occultes, nbThreads);
+
+            std::vector<int> nbOccultes(touches.size(), 0), nbRayons(touches.size(), premier);
+            std::vector<int> indecis;
+            for (std::size_t c = 0; c < touches.size(); c++) {
+                for (int e = 0; e < premier; e++)
+                    nbOccultes[c] += occultes[c * premier + e];
+                if (premier < nbEchantillons && nbOccultes[c] != 0 && nbOccultes[c] != premier) {
+                    indecis.push_back(c);
+                    nbRayons[c] = nbEchantillons;
+                }
+            }
+            if (!indecis.empty()) {
+                int reste = nbEchantillons - premier;
+                ombres.resize(indecis.size() * reste);
+                distances.resize(ombres.size());
+                parallelFor(indecis.size(), nbThreads, [&](int d) {
+                    _light.shadowRays(points[indecis[d]], _source, premier, reste, &ombres[d * reste], &distances[d * reste]);
+                });
+                _paged->occluded(ombres, distances, occultes, nbThreads);
+                for (std::size_t d = 0; d < indecis.size(); d++) {
+                    for (int e = 0; e < reste; e++)
+                        nbOccultes[indecis[d]] += occultes[d * reste + e];
+                }
+            }
+
+            // Seules les surfaces réfléchissantes passent leur rayon réfléchi au niveau suivant
+            std::vector<std::size_t> suivants;
+            std::vector<RayCone> conesSuivants;
+            std::vector<Ray3f> rayonsSuivants;
+            for (std::size_t c = 0; c < touches.size(); c++) {
+                std::size_t p = pixels[touches[c]];
+                layer.lit[p] = float(nbRayons[c] - nbOccultes[c]) / nbRayons[c];
+                if (_materials[layer.material[p]].getShininess() > 0) {
+                    suivants.push_back(p);
+                    conesSuivants.push_back(cones[touches[c]]);
+                    rayonsSuivants.push_back(reflechis[c]);
+                }
+            }
+            pixels.swap(suivants);
+            cones.swap(conesSuivants);
+            rayons.swap(rayonsSuivants);
+        }
+        shadeGBuffer(gb, fb, nbThreads, y0);
+    }
+}
+
+void Scene::updateShadows(GBuffer& gb, int nbThreads) const {
+    int width = gb.getWidth(), height = gb.getHeight();
+    parallelFor(height, nbThreads, [&](int j) {
+        HotPathScope critique;
+        for (int n = 0; n < gb.getNbLayers(); n++) {
+            GBufferLayer& layer = gb.getLayer(n);
+            for (std::size_t p = std::size_t(j) * width; p < std::size_t(j + 1) * width; p++) {
+                if (layer.shape[p] != -1)
+                    layer.lit[p] = visibilite(Vector3f(layer.px[p], layer.py[p], layer.pz[p]), _source, _light, _settings, _shapes, _bvh);
+            }
+        }
+    });
+}
+
+/**
+ * @brief Facteurs de Phong d'une ligne de pixels d'un niveau du G-buffer : cosinus entre
+ * la normale et la direction de la source, et coefficient spéculaire (mêmes calculs que
+ * getDiffuseSpecularColor). Les niveaux approchés traitent 4 pixels à la fois (SSE)
+ *
+ * @param layer le niveau du G-buffer
+ * @param debut l'indice du premier pixel de la ligne
+ * @param width le nombre de pixels
+ * @param source la position de la source
+ * @param shininess la shininess du matériau de chaque pixel
+ * @param speculaire le coefficient spéculaire
+ * @param tier la précision des calculs
+ * @param dots reçoit les cosinus
+ * @param specs reçoit les coefficients spéculaires (sans signification si le cosinus est négatif)
+ */
+static void facteursPhong(const GBufferLayer& layer, std::size_t debut, int width, const Vector3f& source, const float* shininess,
+                          float speculaire, MathTier tier, float* dots, float* specs) {
+    int i = 0;
+#if defined(__SSE2__) && !defined(RAYTRACER_DOUBLE)
+    if (tier != MATH_EXACT) {
+        const __m128 sx = _mm_set1_ps(source.getX()), sy = _mm_set1_ps(source.getY()), sz = _mm_set1_ps(source.getZ());
+        for (; i + 4 <= width; i += 4) {
+            std::size_t p = debut + i;
+            __m128 dx = _mm_sub_ps(sx, _mm_loadu_ps(&layer.px[p]));
+            __m128 dy = _mm_sub_ps(sy, _mm_loadu_ps(&layer.py[p]));
+            __m128 dz = _mm_sub_ps(sz, _mm_loadu_ps(&layer.pz[p]));
+            mathNormalize4(dx, dy, dz, tier);
+            __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&layer.nx[p]), dx), _mm_mul_ps(_mm_loadu_ps(&layer.ny[p]), dy)),
+                                    _mm_mul_ps(_mm_loadu_ps(&layer.nz[p]), dz));
+            __m128 spec = mathPow4(_mm_max_ps(dot, _mm_setzero_ps()), _mm_loadu_ps(shininess + i), tier);
+            _mm_storeu_ps(dots + i, dot);
+            _mm_storeu_ps(specs + i, _mm_mul_ps(spec, _mm_set1_ps(speculaire)));
+        }
+    }
+#endif
+    for (; i < width; i++) {
+        std::size_t p = debut + i;
+        Vector3f dirVersSource = source - Vector3f(layer.px[p], layer.py[p], layer.pz[p]);
+        Real dot = Vector3f(layer.nx[p], layer.ny[p], layer.nz[p]).dot(mathNormalize(dirVersSource, tier));
+        dots[i] = dot;
+        specs[i] = (dot > 0) ? mathPow(dot, shininess[i], tier) * speculaire : 0;
+    }
+}
+
+/**
+ * @brief Composante de couleur ramenée à [0, 255], comme après chaque opération sur un Material
+ */
+static inline float borne(float c) {
+    return std::min(std::max(c, 0.f), 255.f);
+}
+
+void Scene::shadeGBuffer(const GBuffer& gb, Framebuffer& fb, int nbThreads, int y0) const {
+    int width = gb.getWidth(), height = gb.getHeight();
+    MaterialTable materiaux = getMaterialTable();
+    parallelFor(height, nbThreads, [&](int j) {
+        // Même récursion que lanceRayon, déroulée depuis le niveau le plus profond, une
+        // ligne à la fois et par plans : matériaux, facteurs de Phong, puis couleurs
+        // (mêmes opérations et mêmes bornes que ombrage sur les Material)
+        HotPathScope critique;
+        ScratchScope travail;
+        std::size_t debut = std::size_t(j) * width;
+        float *r = travail.array<float>(width), *g = travail.array<float>(width), *b = travail.array<float>(width);
+        float *matR = travail.array<float>(width), *matG = travail.array<float>(width), *matB = travail.array<float>(width);
+        float *matS = travail.array<float>(width), *dots = travail.array<float>(width), *specs = travail.array<float>(width);
+        for (int n = gb.getNbLayers() - 1; n >= 0; n--) {
+            const GBufferLayer& layer = gb.getLayer(n);
+            for (int i = 0; i < width; i++) {
+                std::size_t p = debut + i;
+                if (layer.shape[p] == -1)
+                    continue;
+                MaterialHandle h = layer.material[p];
+                Material mat = materiaux.isTextured(h) ? materiaux.resolve(h, layer.u[p], layer.v[p], layer.footprint[p]) : materiaux[h];
+                matR[i] = mat.getR();
+                matG[i] = mat.getG();
+                matB[i] = mat.getB();
+                matS[i] = mat.getShininess();
+            }
+            facteursPhong(layer, debut, width, _source.getOrigin(), matS, _settings.specular, _settings.math, dots, specs);
+            for (int i = 0; i < width; i++) {
+                std::size_t p = debut + i;
+                if (layer.shape[p] == -1) {
+                    r[i] = g[i] = b[i] = 0;
+                    continue;
+                }
+                float ambiant = _settings.ambient, visible = layer.lit[p];
+                float cr = borne(matR[i] * ambiant), cg = borne(matG[i] * ambiant), cb = borne(matB[i] * ambiant);
+                if (visible > 0) {
+                    float dr = 0, dg = 0, db = 0;
+                    if (dots[i] > 0) {
+                        dr = borne(borne(matR[i] * specs[i]) + borne(matR[i] * dots[i]));
+                        dg = borne(borne(matG[i] * specs[i]) + borne(matG[i] * dots[i]));
+                        db = borne(borne(matB[i] * specs[i]) + borne(matB[i] * dots[i]));
+                    }
+                    // Couleur réfléchie (niveau suivant) pondérée par la shininess
+                    float rr = borne(r[i] * matS[i]), rg = borne(g[i] * matS[i]), rb = borne(b[i] * matS[i]);
+                    cr = borne(borne(cr + borne(dr * visible)) + borne(rr * visible));
+                    cg = borne(borne(cg + borne(dg * visible)) + borne(rg * visible));
+                    cb = borne(borne(cb + borne(db * visible)) + borne(rb * visible));
+                }
+                r[i] = cr;
+                g[i] = cg;
+                b[i] = cb;
+            }
+        }
+        std::size_t sortie = std::size_t(y0 + j) * width;
+        std::copy(r, r + width, fb.r.begin() + sortie);
+        std::copy(g, g + width, fb.g.begin() + sortie);
+        std::copy(b, b + width, fb.b.begin() + sortie);
+    });
+}
+
+void Scene::setMaterial(MaterialHandle h, const Material& mat) {
+    _materials[h] = mat;
 }
 
 /**
  * @brief On applique l'algorithme fourni dans l'énoncé
  */
-void Scene::render(int width, int height) {
+void Scene::render(int width, int height, CostMap* costs) {
     // Mise en place de la fenêtre SDL et du rendu
     Sdl sdl = Sdl();
     sdl.init(width, height, "raytracing.png");
-    
-    // Dimensions des pixels virtuels (les cases de la grille)
-    float px_width = VIRTUAL_PIXEL_SIZE;
-    float px_height = px_width;
-
 
     // Etape 2 : Pour chaque pixel de l'image ou point de la grille, qu'on suppose avec z = 0 pour
-    // tous les pixels
+    // tous les pixels (calcul de l'image complète sur tous les coeurs)
+    Framebuffer fb(width, height);
+    renderFrame(fb, _camera, 0, costs);
     for (int i = 0; i < width; i++) {
         for (int j = 0; j < height; j++) {
-            float i_px = i*px_width;
-            float j_px = j*px_height;
-
-            // 2a) : On calcule le rayon qui part de la caméra vers le pixel virtuel
-            Ray3f rayFromCam = _camera.getRay(i_px-width/2,j_px-height/2);
-
-            // 2b) et 2c) : On détermine les intersections, pour en déduire la couleur finale du pixel virtuel
-            Material colors = lanceRayon(rayFromCam, _shapes, _camera, _source, 0);
-            sdl.setColor(colors.getR(), colors.getG(), colors.getB(), colors.getShininess());
+            std::size_t k = std::size_t(j) * width + i;
+            sdl.setColor(fb.r[k], fb.g[k], fb.b[k], SDL_ALPHA_OPAQUE);
             sdl.drawPoint(i,j);
         }
     }
     sdl.update();
     sdl.~Sdl();
 }
+
+void Scene::renderToFile(int width, int height, const std::string& filename, int nbThreads, int bandHeight, CostMap* costs) const {
+    if (nbThreads <= 0)
+        nbThreads = defaultNbThreads();
+    ImageFile file(filename, width, height, ImageFile::formatFromName(filename));
+
+    // Le débruitage, la reconstruction des pixels non tracés et le mode hors mémoire (rayons
+    // lancés par lots) ont besoin de l'image complète : on la calcule puis on l'écrit par bandes
+    if ((_settings.denoise && _settings.integrator == RenderSettings::PATH_TRACING) || _settings.sampling != SAMPLING_FULL || _paged) {
+        Framebuffer fb(width, height);
+        renderFrame(fb, _camera, nbThreads, costs);
+        PerfThreadScope mesure(_profiler);
+        std::vector<float> rgb(std::size_t(bandHeight) * width * 3);
+        for (int y0 = 0; y0 < height; y0 += bandHeight) {
+            int rows = std::min(bandHeight, height - y0);
+            fb.getRGB(y0, rows, rgb.data());
+            file.writeRows(y0, rows, rgb.data());
+        }
+        return;
+    }
+
+    // Un tampon par thread de rendu, plus un par thread d'écriture pour ne pas bloquer le tracé
+    int nbWriters = std::max(1, nbThreads / 4);
+    BandWriter writer(file, bandHeight, nbThreads + nbWriters, nbWriters);
+
+    // Les candidats sont préparés bande par bande, pour que la mémoire reste bornée par
+    // la hauteur des bandes ; seules les boîtes des objets sont calculées une fois
+    std::vector<Aabb> boites = TileCulling::shapeBounds(_shapes, nbThreads);
+    int nbBands = (height + bandHeight - 1) / bandHeight;
+    parallelFor(nbBands, nbThreads, [&](int band) {
+        PerfThreadScope mesure(_profiler);
+        int y0 = band * bandHeight;
+        int rows = std::min(bandHeight, height - y0);
+        TileCulling culling(_camera, boites, _bvh, width, height, y0, rows, 1);
+        std::vector<float>* buffer = writer.acquire();
+        float* rgb = buffer->data();
+        {
+            HotPathScope critique;
+            for (int j = y0; j < y0 + rows; j++) {
+                for (int i = 0; i < width; i++) {
+                    PixelAov aov;
+                    Material colors = (costs != nullptr) ? measurePixel(_camera, i, j, width, height, aov, &culling, *costs)
+                                                         : tracePixel(_camera, i, j, width, height, aov, &culling);
+                    *rgb++ = colors.getR();
+                    *rgb++ = colors.getG();
+                    *rgb++ = colors.getB();
+                }
+            }
+        }
+        writer.submit(y0, rows, buffer);
+    });
+    writer.finish();
+}
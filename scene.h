@@ -10,11 +10,57 @@
 
 #include "camera.h"   // Pour les attributs
 #include "shape.h"    // Idem
+#include "sdfshape.h" // Pour les primitives des surfaces implicites
 #include "ray3f.h"    // Idem
+#include "arena.h"    // Pour le stockage des objets
+#include "bvh.h"      // Pour l'accélération des requêtes de rayons
+#include "scenecache.h"  // Pour la scène compilée
+#include "pagedgeometry.h" // Pour la géométrie hors mémoire
+#include "texture.h"     // Pour les textures des matériaux
+#include "framebuffer.h" // Pour le rendu d'une image complète
+#include "costmap.h"     // Pour le coût de chaque pixel
+#include "gbuffer.h"     // Pour l'éclairage différé
+#include "pathtracer.h"  // Pour les tampons auxiliaires
+#include "tileculling.h" // Pour les candidats des rayons primaires
+#include "light.h"       // Pour la forme de la source
+#include "fastmath.h"    // Pour la précision des calculs d'ombrage
+#include "perfcounters.h" // Pour le profil des étapes du rendu
+#include "upsampler.h"   // Pour les pixels tracés
+#include "medium.h"      // Pour les milieux participants
 #include "sdl.h"      // Pour la méthode render
+#include <array>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
+/**
+ * @brief Identifiant stable d'un objet d'une Scene, valide jusqu'au retrait de l'objet (MaterialHandle pour les matériaux)
+ */
+typedef int ShapeHandle;
+
+/**
+ * @brief Paramètres de rendu modifiables à l'exécution
+ */
+struct RenderSettings {
+    /**
+     * @brief Intégrateur : tracé de rayons de Whitted (ambiante fixe, une réflexion,
+     * ombres dures) ou tracé de chemins de Monte-Carlo (illumination globale)
+     */
+    enum Integrator { WHITTED, PATH_TRACING };
+
+    Integrator integrator = WHITTED;
+    int samplesPerPixel = 16;   // Echantillons par pixel (tracé de chemins)
+    int maxDepth = 8;           // Nombre maximal de rebonds (tracé de chemins)
+    uint32_t seed = 0;          // Graine des générateurs aléatoires
+    bool denoise = false;       // Débruitage de l'image (tracé de chemins)
+    float ambient = 0.2;        // Coefficient de la couleur ambiante (Whitted)
+    float specular = 0.1;       // Coefficient de la couleur spéculaire (Whitted)
+    int shadowSamples = 16;     // Rayons d'ombre au plus par point pour une source étendue (Whitted)
+    MathTier math = MATH_EXACT; // Précision des calculs d'ombrage (Whitted), exacte pour les rendus de référence
+    SamplingMode sampling = SAMPLING_FULL; // Pixels tracés, les autres sont reconstruits (pas en mode hors mémoire)
+};
+
 
 /**
  * @brief Classe pour représenter la scène, avec la caméra, les différents objets (Shapes) et la source de lumière
@@ -23,31 +69,485 @@
 class Scene {
 
     /**
-     * @brief Trois attributs de classe, une méthode pour la classe Scene
+     * @brief La Scene possède ses objets et ses matériaux : les objets sont rangés de
+     * façon contiguë dans une Arena, les matériaux dans une table partagée que les objets
+     * désignent par leur indice (handle). L'ombrage lit cette table par référence.
+     * Les requêtes de rayons passent par une hiérarchie de boîtes (Bvh), construite par
+     * buildBvh ou lue dans un cache de scène projeté en mémoire, que la Scene garde ouvert.
+     * Un matériau peut être texturé : ses textures sont lues par un TextureCache de taille bornée.
+     * En mode hors mémoire, les objets ne sont plus dans l'Arena mais dans une PagedGeometry
      */
     
     private:
         Camera _camera;
-        std::vector<Shape*> _shapes;
         Ray3f _source;
+        AreaLight _light;
+        std::vector<Medium> _media;
+        Arena _arena;
+        std::vector<Shape*> _shapes;
+        std::vector<ShapeHandle> _handles;      // Handle de chaque objet de _shapes
+        std::vector<int> _slots;                // Indice dans _shapes de chaque handle (-1 : objet retiré)
+        std::vector<void*> _libres[3];          // Mémoire des objets détruits, par type d'objet, pour les suivants
+        std::vector<Material> _materials;
+        std::vector<TextureHandle> _materialTextures;
+        std::unique_ptr<TextureCache> _textures;
+        RenderSettings _settings;
+        Bvh _bvh;
+        std::unique_ptr<SceneCache> _cache;
+        std::unique_ptr<PagedGeometry> _paged;
+        PerfProfiler* _profiler;
+
+        /**
+         * @brief Enregistre un objet construit dans l'Arena et retourne son handle
+         * (la hiérarchie devient invalide)
+         */
+        ShapeHandle addShape(Shape* shape);
+
+        /**
+         * @brief Détruit les objets et leur hiérarchie (les matériaux et textures restent)
+         */
+        void releaseShapes();
+
+        /**
+         * @brief Construit un objet, dans la mémoire d'un objet détruit du même type s'il
+         * y en a, sinon dans l'Arena
+         */
+        Shape* makeShape(const ShapeRecord& record);
+
+        /**
+         * @brief Détruit un objet en gardant sa mémoire pour le suivant du même type
+         */
+        void destroyShape(Shape* shape, const ShapeRecord& record);
+
+        /**
+         * @brief Indice dans _shapes de l'objet h (exception si h ne désigne aucun objet)
+         */
+        int getSlot(ShapeHandle h) const;
+
+        /**
+         * @brief Rendu (Whitted) de la géométrie paginée : les rayons de chaque niveau du
+         * G-buffer et leurs rayons d'ombre sont lancés par lots, puis l'image est ombrée
+         * depuis le G-buffer
+         */
+        void renderPaged(Framebuffer& fb, const Camera& camera, int nbThreads) const;
+
+        /**
+         * @brief Matériaux et textures tels que les lit l'ombrage
+         */
+        inline MaterialTable getMaterialTable() const {return {_materials, _materialTextures, *_textures};};
+
+        /**
+         * @brief Comme tracePixel, en enregistrant dans costs les requêtes de rayons et
+         * les cycles du pixel
+         */
+        Material measurePixel(const Camera& camera, int i, int j, int width, int height, PixelAov& aov,
+                              const TileCulling* culling, CostMap& costs) const;
     
     public:
         /**
-         * Constructeur valué
+         * Constructeur valué (la scène est vide, on la remplit avec les méthodes add*)
+         */
+        Scene(const Camera& camera, const Ray3f& source) : _camera(camera), _source(source), _textures(new TextureCache()), _profiler(nullptr) {}
+
+        /**
+         * Destructeur de la classe Scene : détruit les objets puis libère l'Arena
+         */
+        ~Scene();
+
+        Scene(const Scene&) = delete;
+        Scene& operator=(const Scene&) = delete;
+
+        /**
+         * @brief Prévoit la place pour nbShapes objets et nbMaterials matériaux :
+         * leur création ne coûte alors qu'une seule allocation
+         *
+         * @param nbShapes
+         * @param nbMaterials
+         */
+        void reserve(std::size_t nbShapes, std::size_t nbMaterials);
+
+        /**
+         * @brief Ajoute un matériau à la scène
+         *
+         * @param mat
+         * @return MaterialHandle
+         */
+        MaterialHandle addMaterial(const Material& mat);
+
+        /**
+         * @brief Ajoute une texture (image PPM) à la scène, sans en lire les texels
+         *
+         * @param filename
+         * @return TextureHandle
+         */
+        TextureHandle addTexture(const std::string& filename);
+
+        /**
+         * @brief Associe une texture à un matériau (-1 pour l'enlever) : la couleur du
+         * matériau est alors modulée par celle de la texture au point d'impact
+         *
+         * @param mat
+         * @param texture
+         */
+        void setMaterialTexture(MaterialHandle mat, TextureHandle texture);
+        inline TextureHandle getMaterialTexture(MaterialHandle mat) const {return _materialTextures[mat];};
+
+        /**
+         * @brief Cache des tuiles de textures et sa capacité (en octets)
+         */
+        inline const TextureCache& getTextures() const {return *_textures;};
+        inline void setTextureCacheSize(std::size_t bytes) {_textures->setCapacity(bytes);};
+
+        /**
+         * @brief Ajoute une Sphere à la scène
+         *
+         * @param center
+         * @param radius
+         * @param mat handle du matériau (déjà ajouté)
+         * @return ShapeHandle
+         */
+        ShapeHandle addSphere(const Vector3f& center, Real radius, MaterialHandle mat);
+
+        /**
+         * @brief Ajoute un CubeQuad aligné sur les axes à la scène
+         *
+         * @param center
+         * @param halfSize
+         * @param mat handle du matériau (déjà ajouté)
+         * @return ShapeHandle
+         */
+        ShapeHandle addCubeQuad(const Vector3f& center, const Vector3f& halfSize, MaterialHandle mat);
+
+        /**
+         * @brief Ajoute un CubeQuad orienté selon basis à la scène
+         *
+         * @param center
+         * @param halfSize
+         * @param mat handle du matériau (déjà ajouté)
+         * @param basis base orthonormée
+         * @return ShapeHandle
+         */
+        ShapeHandle addCubeQuad(const Vector3f& center, const Vector3f& halfSize, MaterialHandle mat, const std::array<Vector3f, 3>& basis);
+
+        /**
+         * @brief Ajoute une surface implicite (SdfShape) à une primitive à la scène
+         *
+         * @param a
+         * @param mat handle du matériau (déjà ajouté)
+         * @return ShapeHandle
+         */
+        ShapeHandle addSdf(const SdfPrimitive& a, MaterialHandle mat);
+
+        /**
+         * @brief Ajoute l'union lisse de deux primitives à la scène
+         *
+         * @param a
+         * @param b
+         * @param blend rayon du raccord (0 : union simple)
+         * @param mat handle du matériau (déjà ajouté)
+         * @return ShapeHandle
+         */
+        ShapeHandle addSdf(const SdfPrimitive& a, const SdfPrimitive& b, Real blend, MaterialHandle mat);
+
+        /**
+         * @brief Ajoute un objet décrit par un enregistrement à plat (ShapeRecord)
+         *
+         * @param record
+         * @return ShapeHandle
+         */
+        ShapeHandle addShape(const ShapeRecord& record);
+
+        /**
+         * @brief Détruit tous les objets, matériaux et textures en une seule libération
+         */
+        void clear();
+
+        /**
+         * @brief Construit la hiérarchie de boîtes des objets. A rappeler après tout ajout
+         * d'objet : en attendant, les requêtes testent tous les objets
          */
-        Scene(const Camera& camera, std::vector<Shape*> shapes, const Ray3f& source) : _camera(camera), _shapes(shapes), _source(source) {}
+        void buildBvh();
+        inline const Bvh& getBvh() const {return _bvh;};
 
         /**
-         * Destructeur de la classe Scene
+         * @brief Modifications de la scène d'une image à l'autre (animation, simulation
+         * physique). Contrairement aux méthodes add*, elles gardent la hiérarchie, que
+         * updateBvh met à jour d'après les seuls objets modifiés : il faut l'appeler après
+         * une série de modifications, avant le rendu suivant (les rendus en cours doivent
+         * être terminés). Les handles restent valides jusqu'au retrait de leur objet, mais
+         * l'ordre des objets dans getShapes() change à chaque retrait. Pas en mode hors mémoire
          */
-        ~Scene() {}
+
+        /**
+         * @brief Ajoute un objet
+         *
+         * @param record
+         * @return ShapeHandle
+         */
+        ShapeHandle insertShape(const ShapeRecord& record);
+
+        /**
+         * @brief Retire l'objet h (sa mémoire sert à l'objet suivant du même type)
+         *
+         * @param h
+         */
+        void removeShape(ShapeHandle h);
+
+        /**
+         * @brief Remplace l'objet h (forme, place, matériau), qui garde son handle
+         *
+         * @param h
+         * @param record
+         */
+        void setShape(ShapeHandle h, const ShapeRecord& record);
+
+        /**
+         * @brief Déplace l'objet h : il tourne autour de son centre, puis son centre est
+         * translaté (la rotation est sans effet sur une sphère ; pour un SdfShape, le centre
+         * de la seconde primitive tourne autour de celui de la première, sans les orienter)
+         *
+         * @param h
+         * @param rotation images des axes x, y et z par la rotation (base orthonormée directe)
+         * @param translation
+         */
+        void transformShape(ShapeHandle h, const std::array<Vector3f, 3>& rotation, const Vector3f& translation);
+
+        /**
+         * @brief Met la hiérarchie à jour après des modifications (la construit si elle
+         * ne l'est pas)
+         *
+         * @param nbThreads nombre de threads des reconstructions locales (<= 0 : tous les coeurs)
+         * @return BvhUpdate bilan de la mise à jour
+         */
+        BvhUpdate updateBvh(int nbThreads = 0);
+        inline bool hasPendingEdits() const {return _bvh.hasPendingEdits();};
+
+        /**
+         * @brief Enregistre la scène compilée (objets, matériaux et hiérarchie, construite
+         * si besoin) dans un cache que loadCache pourra projeter en mémoire
+         *
+         * @param filename
+         * @param sourceKey clé identifiant la scène source (version de sa description)
+         */
+        void saveCache(const std::string& filename, uint64_t sourceKey);
+
+        /**
+         * @brief Remplace le contenu de la scène par celui d'un cache : les objets sont
+         * recréés depuis leurs enregistrements et la hiérarchie est utilisée sur place,
+         * sans construction. Lève une exception (la scène est alors inchangée) si le cache
+         * est absent, périmé, corrompu ou d'une autre précision
+         *
+         * @param filename
+         * @param sourceKey clé attendue de la scène source
+         */
+        void loadCache(const std::string& filename, uint64_t sourceKey);
+
+        /**
+         * @brief Enregistre les objets (et la hiérarchie, construite si besoin) dans un
+         * fichier de pages que loadPages pourra lire à la demande
+         *
+         * @param filename
+         * @param sourceKey clé identifiant la scène source (version de sa description)
+         * @param shapesPerPage nombre maximal d'objets par page
+         */
+        void savePages(const std::string& filename, uint64_t sourceKey, int shapesPerPage = PagedGeometry::SHAPES_PER_PAGE);
+
+        /**
+         * @brief Passe en mode hors mémoire : les objets de la scène sont libérés et les
+         * rendus lisent ceux d'un fichier de pages, page par page, sans dépasser la capacité
+         * donnée. Les matériaux et textures restent ceux de la scène. Seul le tracé de
+         * Whitted est pris en charge dans ce mode. Lève une exception (la scène est alors
+         * inchangée) si le fichier est absent, périmé, corrompu ou désigne un matériau
+         * inexistant
+         *
+         * @param filename
+         * @param sourceKey clé attendue de la scène source
+         * @param capacity taille maximale des pages en mémoire, en octets
+         */
+        void loadPages(const std::string& filename, uint64_t sourceKey, std::size_t capacity);
+        inline bool isPaged() const {return _paged != nullptr;};
+        inline const PagedGeometry* getPagedGeometry() const {return _paged.get();};
+
+        /**
+         * @brief Accès aux objets et matériaux par handle
+         */
+        inline const Shape& getShape(ShapeHandle h) const {return *_shapes[_slots[h]];};
+        inline const Material& getMaterial(MaterialHandle h) const {return _materials[h];};
+        inline MaterialHandle getShapeMaterial(ShapeHandle h) const {return _shapes[_slots[h]]->getMaterial();};
+        inline bool hasShape(ShapeHandle h) const {return h >= 0 && h < int(_slots.size()) && _slots[h] != -1;};
+        inline ShapeHandle getShapeHandle(int k) const {return _handles[k];};
+        inline int getNbShapes() const {return _shapes.size();};
+        inline const std::vector<Shape*>& getShapes() const {return _shapes;};
+        inline int getNbMaterials() const {return _materials.size();};
+        inline const std::vector<Material>& getMaterials() const {return _materials;};
 
         /**
          * @brief : Méthode qui effectue l'affichage de la Scene avec les méthodes de la classe SDL
          * @param width : largeur de la fenêtre
          * @param height : hauteur de la fenêtre
+         * @param costs : si non nul, reçoit le coût de chaque pixel (mêmes dimensions)
+         */
+        void render(int width, int height, CostMap* costs = nullptr);
+
+        /**
+         * @brief Calcule la couleur du pixel (i,j) d'une image width x height
+         * @param i abscisse du pixel
+         * @param j ordonnée du pixel
+         * @param width largeur de l'image
+         * @param height hauteur de l'image
+         * @return Material la couleur du pixel
+         */
+        Material tracePixel(int i, int j, int width, int height) const;
+
+        /**
+         * @brief Calcule la couleur du pixel (i,j) vu depuis une autre caméra que celle de la scène
+         * @param camera la caméra utilisée
+         * @param i abscisse du pixel
+         * @param j ordonnée du pixel
+         * @param width largeur de l'image
+         * @param height hauteur de l'image
+         * @return Material la couleur du pixel
+         */
+        Material tracePixel(const Camera& camera, int i, int j, int width, int height) const;
+
+        /**
+         * @brief Calcule la couleur du pixel (i,j) et, pour le tracé de chemins, les informations
+         * moyennes du premier impact (albédo, normale, profondeur)
+         * @param camera la caméra utilisée
+         * @param i abscisse du pixel
+         * @param j ordonnée du pixel
+         * @param width largeur de l'image
+         * @param height hauteur de l'image
+         * @param aov reçoit les informations du premier impact (profondeur -1 si non calculées)
+         * @param culling si non nul, candidats par tuile des rayons primaires (construits pour
+         * la même caméra et la même taille d'image)
+         * @return Material la couleur du pixel
          */
-        void render(int width, int height);
+        Material tracePixel(const Camera& camera, int i, int j, int width, int height, PixelAov& aov,
+                            const TileCulling* culling = nullptr) const;
+
+        /**
+         * @brief Calcule l'image complète et ses tampons auxiliaires sur plusieurs threads,
+         * reconstruit les pixels non tracés (settings.sampling) puis débruite l'image si
+         * les paramètres le demandent
+         * @param fb image de sortie (ses dimensions sont celles du rendu)
+         * @param camera la caméra utilisée
+         * @param nbThreads nombre de threads (<= 0 : tous les coeurs)
+         * @param costs si non nul, reçoit le coût de chaque pixel (mêmes dimensions que fb ;
+         * non calculé en mode hors mémoire)
+         */
+        void renderFrame(Framebuffer& fb, const Camera& camera, int nbThreads = 0, CostMap* costs = nullptr) const;
+
+        /**
+         * @brief Calcule plusieurs vues de la scène en un seul rendu (couple stéréo, faces
+         * d'une cube map, réseau de caméras) : les boîtes des objets sont calculées une
+         * fois pour toutes les vues, les candidats des rayons primaires de chaque vue sont
+         * préparés en parallèle, puis les tuiles des vues, entrelacées, sont réparties sur
+         * les mêmes threads, qui gardent d'une vue à l'autre leur cache d'ombre et les
+         * tuiles de textures déjà lues. Chaque image est ensuite reconstruite et débruitée
+         * comme par renderFrame (en mode hors mémoire, les vues sont calculées l'une après
+         * l'autre). Le gain sur N appels de renderFrame ne vient que de cette préparation :
+         * le calcul des pixels reste le même
+         * @param fbs une image par caméra (les dimensions peuvent différer d'une vue à l'autre)
+         * @param cameras les caméras des vues
+         * @param nbThreads nombre de threads (<= 0 : tous les coeurs)
+         */
+        void renderViews(std::vector<Framebuffer>& fbs, const std::vector<Camera>& cameras, int nbThreads = 0) const;
+
+        /**
+         * @brief Calcule les pixels du rectangle [x0, x1[ x [y0, y1[ de l'image et leurs
+         * tampons auxiliaires, sur le thread appelant (sans débruitage ; pas en mode hors
+         * mémoire, dont les rayons sont lancés par lots sur toute l'image). Seuls les pixels
+         * tracés selon settings.sampling sont calculés : upsample reconstruit les autres
+         * une fois l'image complète
+         * @param fb image de sortie (ses dimensions sont celles du rendu)
+         * @param camera la caméra utilisée
+         * @param culling si non nul, candidats par tuile des rayons primaires (construits pour
+         * la même caméra et la même taille d'image)
+         * @param x0
+         * @param y0
+         * @param x1
+         * @param y1
+         * @param costs si non nul, reçoit le coût de chaque pixel
+         */
+        void renderTile(Framebuffer& fb, const Camera& camera, const TileCulling* culling, int x0, int y0, int x1, int y1,
+                        CostMap* costs = nullptr) const;
+
+        /**
+         * @brief Rendu directement dans un fichier PPM ou PFM (selon l'extension) projeté
+         * en mémoire, par bandes de lignes : la mémoire utilisée ne dépend que de la taille
+         * des bandes et du nombre de threads, quelle que soit la taille de l'image (sauf
+         * avec le débruitage et la reconstruction des pixels non tracés, qui ont besoin de
+         * l'image complète)
+         * @param width largeur de l'image
+         * @param height hauteur de l'image
+         * @param filename nom du fichier de sortie
+         * @param nbThreads nombre de threads de rendu (<= 0 : tous les coeurs)
+         * @param bandHeight nombre de lignes par bande
+         * @param costs si non nul, reçoit le coût de chaque pixel (dimensions de l'image)
+         */
+        void renderToFile(int width, int height, const std::string& filename, int nbThreads = 0, int bandHeight = 16,
+                          CostMap* costs = nullptr) const;
+
+        /**
+         * @brief Nombre de niveaux d'un G-buffer de la scène : le rayon primaire et
+         * chacune des réflexions suivies par le tracé de Whitted
+         */
+        int getNbGBufferLayers() const;
+
+        /**
+         * @brief Eclairage différé (Whitted), première étape : enregistre pour chaque pixel
+         * les impacts du rayon primaire et des rayons réfléchis (point, normale, objet,
+         * matériau) ainsi que la visibilité de la source. Comme pour le tracé direct, les
+         * réflexions s'arrêtent à la première surface non réfléchissante (shininess nulle) :
+         * un matériau qui devient réfléchissant impose de reconstruire le G-buffer
+         * @param gb G-buffer de sortie (ses dimensions sont celles du rendu, getNbGBufferLayers niveaux)
+         * @param camera la caméra utilisée
+         * @param nbThreads nombre de threads (<= 0 : tous les coeurs)
+         */
+        void buildGBuffer(GBuffer& gb, const Camera& camera, int nbThreads = 0) const;
+
+        /**
+         * @brief Relance uniquement les rayons d'ombre du G-buffer, après un déplacement
+         * de la source
+         * @param gb G-buffer construit par buildGBuffer
+         * @param nbThreads nombre de threads (<= 0 : tous les coeurs)
+         */
+        void updateShadows(GBuffer& gb, int nbThreads = 0) const;
+
+        /**
+         * @brief Calcule la couleur de chaque pixel à partir du G-buffer, avec les matériaux
+         * et les coefficients d'ombrage courants, sans lancer de rayon. Le résultat est
+         * identique à celui de renderFrame tant que la géométrie et la caméra n'ont pas changé
+         * @param gb G-buffer construit par buildGBuffer
+         * @param fb image de sortie (couleur seulement, même largeur que gb)
+         * @param nbThreads nombre de threads (<= 0 : tous les coeurs)
+         * @param y0 ligne de fb qui reçoit la première ligne de gb (G-buffer d'une bande de l'image)
+         */
+        void shadeGBuffer(const GBuffer& gb, Framebuffer& fb, int nbThreads = 0, int y0 = 0) const;
+
+        /**
+         * @brief Modifie un matériau de la table, et donc tous les objets qui l'utilisent
+         * (un G-buffer reste valide, sauf si la shininess du matériau devient positive)
+         *
+         * @param h
+         * @param mat
+         */
+        void setMaterial(MaterialHandle h, const Material& mat);
+
+        /**
+         * @brief Paramètres de rendu (intégrateur, échantillons par pixel, profondeur, graine)
+         */
+        inline void setSettings(const RenderSettings& settings) {_settings = settings;};
+        inline const RenderSettings& getSettings() const {return _settings;};
+
+        /**
+         * @brief Profil qui reçoit les mesures des étapes des rendus suivants (nul : aucune
+         * mesure). Mesurés : renderFrame, renderTile et renderToFile, hors débruitage et
+         * hors mode hors mémoire
+         */
+        inline void setProfiler(PerfProfiler* profiler) {_profiler = profiler;};
+        inline PerfProfiler* getProfiler() const {return _profiler;};
 
         /**
          * Getters sur la caméra et la source
@@ -55,6 +555,25 @@ class Scene {
         inline const Camera& getCamera() const {return _camera;};
 
         inline const Ray3f& getSource() const {return _source;};
+        inline void setSource(const Ray3f& source) {_source = source;};
+
+        /**
+         * @brief Forme de la source (ponctuelle par défaut) : une source étendue, centrée
+         * sur l'origine de la source et orientée selon sa direction, donne des ombres douces
+         */
+        inline const AreaLight& getLight() const {return _light;};
+        inline void setLight(const AreaLight& light) {_light = light;};
+
+        /**
+         * @brief Milieux participants (brouillard, fumée) : ils ne font partie ni du cache
+         * de la scène ni de ses pages, et seuls les rendus pixel par pixel (Whitted et tracé
+         * de chemins) en tiennent compte, pas l'éclairage différé ni le mode hors mémoire.
+         * En tracé de Whitted, chaque milieu voile ce qu'il cache de sa couleur (l'albédo)
+         * et atténue les rayons d'ombre ; le tracé de chemins y diffuse la lumière
+         */
+        inline const std::vector<Medium>& getMedia() const {return _media;};
+        inline void addMedium(const Medium& medium) {_media.push_back(medium);};
+        inline void clearMedia() {_media.clear();};
 };
 
 #endif
@@ -0,0 +1,225 @@
+/**
+ * @file scenecache.cpp
+ * @brief Implémentation de la classe SceneCache
+ */
+
+#include "scenecache.h"
+#include "pagedgeometry.h"
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const std::size_t ALIGNEMENT = 64;          // Alignement des sections (ligne de cache)
+const char MAGIQUE[8] = "RTSCENE";          // Signature du format
+const uint32_t BOUTISME = 0x01020304;       // Relu différemment sur une machine de l'autre boutisme
+
+/**
+ * @brief Section du fichier : décalage depuis le début et nombre d'éléments
+ */
+struct Section {
+    uint64_t offset, count;
+};
+
+/**
+ * @brief En-tête du cache
+ */
+struct EnTete {
+    char magic[8];
+    uint32_t version, realSize, endianness, reserve;
+    uint32_t shapeSize, materialSize, textureSize, nodeSize, indexSize;     // Tailles des enregistrements
+    uint32_t reserve2;
+    uint64_t sourceKey;
+    uint64_t fileSize;
+    uint64_t checksum;                                        // Somme de tout ce qui suit l'en-tête
+    Section shapes, materials, textures, nodes, indices;
+};
+
+static inline std::size_t aligne(std::size_t n) {
+    return (n + ALIGNEMENT - 1) / ALIGNEMENT * ALIGNEMENT;
+}
+
+/**
+ * @brief Somme de contrôle 64 bits (FNV-1a par mots de 8 octets)
+ */
+static uint64_t empreinte(const unsigned char* data, std::size_t size) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    std::size_t k = 0;
+    for (; k + 8 <= size; k += 8) {
+        uint64_t mot;
+        std::memcpy(&mot, data + k, 8);
+        h = (h ^ mot) * 0x100000001b3ull;
+        h ^= h >> 32;
+    }
+    for (; k < size; k++)
+        h = (h ^ data[k]) * 0x100000001b3ull;
+    return h;
+}
+
+void SceneCache::write(const std::string& filename, uint64_t sourceKey, const std::vector<ShapeRecord>& shapes,
+                       const std::vector<MaterialRecord>& materials, const std::vector<std::string>& textures, const Bvh& bvh) {
+    std::vector<TextureRecord> chemins(textures.size());
+    for (std::size_t k = 0; k < textures.size(); k++) {
+        if (textures[k].size() >= sizeof(chemins[k].path))
+            throw std::runtime_error("Chemin de texture trop long pour le cache : " + textures[k]);
+        std::memset(chemins[k].path, 0, sizeof(chemins[k].path));
+        std::memcpy(chemins[k].path, textures[k].data(), textures[k].size());
+    }
+
+    EnTete e;
+    std::memset(&e, 0, sizeof(e));
+    std::memcpy(e.magic, MAGIQUE, sizeof(MAGIQUE));
+    e.version = VERSION;
+    e.realSize = sizeof(Real);
+    e.endianness = BOUTISME;
+    e.shapeSize = sizeof(ShapeRecord);
+    e.materialSize = sizeof(MaterialRecord);
+    e.textureSize = sizeof(TextureRecord);
+    e.nodeSize = sizeof(BvhNode);
+    e.indexSize = sizeof(int32_t);
+    e.sourceKey = sourceKey;
+
+    // Disposition des sections
+    std::size_t offset = aligne(sizeof(EnTete));
+    auto place = [&](Section& s, std::size_t count, std::size_t taille) {
+        s.offset = offset;
+        s.count = count;
+        offset = aligne(offset + count * taille);
+    };
+    place(e.shapes, shapes.size(), sizeof(ShapeRecord));
+    place(e.materials, materials.size(), sizeof(MaterialRecord));
+    place(e.textures, chemins.size(), sizeof(TextureRecord));
+    place(e.nodes, bvh.getNbNodes(), sizeof(BvhNode));
+    place(e.indices, bvh.getNbIndices(), sizeof(int32_t));
+    e.fileSize = offset;
+
+    // Ecriture dans un fichier temporaire projeté en mémoire (les trous restent à zéro)
+    std::string temporaire = filename + ".tmp";
+    int fd = open(temporaire.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw std::runtime_error("Impossible de créer le cache " + temporaire);
+    if (ftruncate(fd, e.fileSize) != 0) {
+        close(fd);
+        throw std::runtime_error("Impossible de dimensionner le cache " + temporaire);
+    }
+    void* p = mmap(nullptr, e.fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        throw std::runtime_error("La projection en mémoire de " + temporaire + " a échoué");
+    unsigned char* data = static_cast<unsigned char*>(p);
+    if (!shapes.empty())
+        std::memcpy(data + e.shapes.offset, shapes.data(), shapes.size() * sizeof(ShapeRecord));
+    if (!materials.empty())
+        std::memcpy(data + e.materials.offset, materials.data(), materials.size() * sizeof(MaterialRecord));
+    if (!chemins.empty())
+        std::memcpy(data + e.textures.offset, chemins.data(), chemins.size() * sizeof(TextureRecord));
+    if (bvh.getNbNodes() > 0) {
+        std::memcpy(data + e.nodes.offset, bvh.getNodes(), bvh.getNbNodes() * sizeof(BvhNode));
+        std::memcpy(data + e.indices.offset, bvh.getIndices(), bvh.getNbIndices() * sizeof(int32_t));
+    }
+    e.checksum = empreinte(data + sizeof(EnTete), e.fileSize - sizeof(EnTete));
+    std::memcpy(data, &e, sizeof(EnTete));
+    msync(data, e.fileSize, MS_SYNC);
+    munmap(data, e.fileSize);
+
+    if (std::rename(temporaire.c_str(), filename.c_str()) != 0)
+        throw std::runtime_error("Impossible de renommer le cache " + temporaire);
+}
+
+/**
+ * @brief Vérifie qu'une section tient dans le fichier et retourne son nombre d'éléments
+ */
+static int verifieSection(const Section& s, std::size_t taille, std::size_t size, const char* nom) {
+    if (s.offset % ALIGNEMENT != 0 || s.offset > size || s.count > (size - s.offset) / taille || s.count > INT_MAX)
+        throw std::runtime_error(std::string("Cache de scène corrompu (section ") + nom + ")");
+    return s.count;
+}
+
+SceneCache::SceneCache(const std::string& filename, uint64_t sourceKey)
+    : _data(nullptr), _size(0), _shapes(nullptr), _materials(nullptr), _textures(nullptr), _nodes(nullptr), _indices(nullptr),
+      _nbShapes(0), _nbMaterials(0), _nbTextures(0), _nbNodes(0), _nbIndices(0) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Cache de scène absent : " + filename);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || std::size_t(st.st_size) < sizeof(EnTete)) {
+        close(fd);
+        throw std::runtime_error("Cache de scène tronqué : " + filename);
+    }
+    _size = st.st_size;
+    void* p = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        throw std::runtime_error("La projection en mémoire de " + filename + " a échoué");
+    _data = p;
+
+    try {
+        const unsigned char* data = static_cast<const unsigned char*>(_data);
+        EnTete e;
+        std::memcpy(&e, data, sizeof(EnTete));
+        if (std::memcmp(e.magic, MAGIQUE, sizeof(MAGIQUE)) != 0)
+            throw std::runtime_error(filename + " n'est pas un cache de scène");
+        if (e.version != VERSION)
+            throw std::runtime_error("Version du cache de scène différente (" + std::to_string(e.version) + ")");
+        if (e.endianness != BOUTISME)
+            throw std::runtime_error("Cache de scène écrit sur une machine d'un autre boutisme");
+        if (e.realSize != sizeof(Real))
+            throw std::runtime_error("Cache de scène écrit avec une autre précision (" + std::to_string(e.realSize) + " octets)");
+        if (e.shapeSize != sizeof(ShapeRecord) || e.materialSize != sizeof(MaterialRecord) || e.textureSize != sizeof(TextureRecord)
+            || e.nodeSize != sizeof(BvhNode) || e.indexSize != sizeof(int32_t))
+            throw std::runtime_error("Disposition du cache de scène différente");
+        if (e.sourceKey != sourceKey)
+            throw std::runtime_error("Cache de scène périmé (scène source modifiée)");
+        if (e.fileSize != _size)
+            throw std::runtime_error("Cache de scène tronqué : " + filename);
+        if (empreinte(data + sizeof(EnTete), _size - sizeof(EnTete)) != e.checksum)
+            throw std::runtime_error("Cache de scène corrompu (somme de contrôle)");
+
+        _nbShapes = verifieSection(e.shapes, sizeof(ShapeRecord), _size, "objets");
+        _nbMaterials = verifieSection(e.materials, sizeof(MaterialRecord), _size, "matériaux");
+        _nbTextures = verifieSection(e.textures, sizeof(TextureRecord), _size, "textures");
+        _nbNodes = verifieSection(e.nodes, sizeof(BvhNode), _size, "noeuds");
+        _nbIndices = verifieSection(e.indices, sizeof(int32_t), _size, "indices");
+        _shapes = reinterpret_cast<const ShapeRecord*>(data + e.shapes.offset);
+        _materials = reinterpret_cast<const MaterialRecord*>(data + e.materials.offset);
+        _textures = reinterpret_cast<const TextureRecord*>(data + e.textures.offset);
+        _nodes = reinterpret_cast<const BvhNode*>(data + e.nodes.offset);
+        _indices = reinterpret_cast<const int32_t*>(data + e.indices.offset);
+
+        // Les indices doivent rester dans leurs tableaux (les fils suivent leur parent)
+        for (int k = 0; k < _nbShapes; k++) {
+            if (!isKnownShape(_shapes[k]) || _shapes[k].material < 0 || _shapes[k].material >= _nbMaterials)
+                throw std::runtime_error("Cache de scène corrompu (objet " + std::to_string(k) + ")");
+        }
+        for (int k = 0; k < _nbMaterials; k++) {
+            if (_materials[k].texture < -1 || _materials[k].texture >= _nbTextures)
+                throw std::runtime_error("Cache de scène corrompu (matériau " + std::to_string(k) + ")");
+        }
+        for (int k = 0; k < _nbTextures; k++) {
+            if (std::memchr(_textures[k].path, 0, sizeof(_textures[k].path)) == nullptr)
+                throw std::runtime_error("Cache de scène corrompu (texture " + std::to_string(k) + ")");
+        }
+        for (int k = 0; k < _nbNodes; k++) {
+            const BvhNode& n = _nodes[k];
+            bool valide = (n.count == 0) ? (n.first > k && n.first + 1 < _nbNodes)
+                                         : (n.count > 0 && n.first >= 0 && n.first <= _nbIndices - n.count);
+            if (!valide)
+                throw std::runtime_error("Cache de scène corrompu (noeud " + std::to_string(k) + ")");
+        }
+        for (int k = 0; k < _nbIndices; k++) {
+            if (_indices[k] < 0 || _indices[k] >= _nbShapes)
+                throw std::runtime_error("Cache de scène corrompu (indice " + std::to_string(k) + ")");
+        }
+    } catch (...) {
+        munmap(_data, _size);
+        throw;
+    }
+}
+
+SceneCache::~SceneCache() {
+    munmap(_data, _size);
+}
@@ -0,0 +1,107 @@
+/**
+ * @file scenecache.h
+ * @brief Création de la classe SceneCache (scène compilée projetée en mémoire)
+ */
+#ifndef SCENECACHE_H
+#define SCENECACHE_H
+
+#include "bvh.h"
+#include "material.h"
+#include "shape.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Matériau tel qu'il est enregistré dans le cache
+ */
+struct MaterialRecord {
+    float r, g, b, shininess;
+    int32_t texture;    // Indice de la texture, -1 si aucune
+};
+
+/**
+ * @brief Texture telle qu'elle est enregistrée dans le cache : le chemin de son image
+ */
+struct TextureRecord {
+    char path[256];
+};
+
+/**
+ * @brief Cache de scène compilée : les objets à plat, la table des matériaux et la
+ * hiérarchie de boîtes déjà construite, dans un fichier que l'on projette en mémoire
+ * pour tracer immédiatement, sans lecture ni construction. Tous les décalages sont
+ * relatifs au début du fichier (projection possible à n'importe quelle adresse) et
+ * chaque section est alignée sur 64 octets :
+ *
+ * en-tête | ShapeRecord[] | MaterialRecord[] | TextureRecord[] | BvhNode[] | int32 (indices d'objets)
+ *
+ * A l'ouverture, le cache est refusé (exception) si le format, la version, la précision
+ * (taille de Real), le boutisme ou la clé de la scène source diffèrent, si la taille ou
+ * la somme de contrôle ne correspondent pas, ou si un indice sort de son tableau
+ */
+class SceneCache {
+
+    public:
+        /**
+         * @brief Version du format, à incrémenter à chaque changement de disposition
+         */
+        static const uint32_t VERSION = 3;
+
+        /**
+         * @brief Enregistre une scène compilée (dans un fichier temporaire renommé à la
+         * fin : un cache lisible est toujours complet)
+         *
+         * @param filename
+         * @param sourceKey clé de la scène source (un cache d'une autre clé est périmé)
+         * @param shapes
+         * @param materials
+         * @param textures chemins des images des textures
+         * @param bvh hiérarchie construite sur shapes
+         */
+        static void write(const std::string& filename, uint64_t sourceKey, const std::vector<ShapeRecord>& shapes,
+                          const std::vector<MaterialRecord>& materials, const std::vector<std::string>& textures, const Bvh& bvh);
+
+        /**
+         * @brief Projette le cache en mémoire (lecture seule) et vérifie son intégrité
+         *
+         * @param filename
+         * @param sourceKey clé attendue de la scène source
+         */
+        SceneCache(const std::string& filename, uint64_t sourceKey);
+
+        /**
+         * @brief Libère la projection
+         */
+        ~SceneCache();
+
+        SceneCache(const SceneCache&) = delete;
+        SceneCache& operator=(const SceneCache&) = delete;
+
+        /**
+         * @brief Sections du cache (pointeurs dans la projection)
+         */
+        inline const ShapeRecord* getShapes() const {return _shapes;};
+        inline int getNbShapes() const {return _nbShapes;};
+        inline const MaterialRecord* getMaterials() const {return _materials;};
+        inline int getNbMaterials() const {return _nbMaterials;};
+        inline const TextureRecord* getTextures() const {return _textures;};
+        inline int getNbTextures() const {return _nbTextures;};
+        inline const BvhNode* getNodes() const {return _nodes;};
+        inline int getNbNodes() const {return _nbNodes;};
+        inline const int32_t* getIndices() const {return _indices;};
+        inline int getNbIndices() const {return _nbIndices;};
+
+    private:
+        void* _data;
+        std::size_t _size;
+        const ShapeRecord* _shapes;
+        const MaterialRecord* _materials;
+        const TextureRecord* _textures;
+        const BvhNode* _nodes;
+        const int32_t* _indices;
+        int _nbShapes, _nbMaterials, _nbTextures, _nbNodes, _nbIndices;
+};
+
+#endif
@@ -0,0 +1,130 @@
+/**
+ * @file scenes.cpp
+ * @brief Implémentation des scènes prédéfinies
+ */
+
+#include "scenes.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+Camera cameraDemo() {
+    const Vector3f& camCenter = Vector3f(100,600,-400);
+    const Vector3f& camDirection = Vector3f(0,0,200);
+    const Vector3f& camUp = Vector3f(0,1,0);
+    return Camera(camCenter, camDirection, camUp);
+}
+
+Ray3f sourceDemo() {
+    const Vector3f& sourceOrigin = Vector3f(100,500,0);
+    const Vector3f& sourceDirection = Vector3f(0,1,0);
+    return Ray3f(sourceOrigin, sourceDirection);
+}
+
+void construitSceneDemo(Scene& sc, const std::string& texture, bool objets) {
+    sc.reserve(objets ? 5 : 0,5);
+
+    // Initialisation des matériaux
+    MaterialHandle rouge = sc.addMaterial(Material(255,10,10,0.5));
+    MaterialHandle vert = sc.addMaterial(Material(30,255,30,0));
+    MaterialHandle bleu = sc.addMaterial(Material(30,30,255,0.8));
+    MaterialHandle jaune = sc.addMaterial(Material(255,255,30,0.8));
+    MaterialHandle gris = sc.addMaterial(Material(70,70,70,0));
+
+    if (!texture.empty()) {
+        TextureHandle image = sc.addTexture(texture);
+        sc.setMaterialTexture(rouge, image);
+        sc.setMaterialTexture(gris, image);
+    }
+    if (!objets)
+        return;
+
+    // Initialisation de la liste des objets
+    sc.addSphere(Vector3f(50,400,150),100,rouge);     // Sphère en rouge
+    sc.addCubeQuad(Vector3f(700,700,40),Vector3f(100),bleu);   // Cube en bleu
+    sc.addCubeQuad(Vector3f(300,1000,300),Vector3f(20,600,20),vert);   // Cube en vert
+    float theta = 0.75;
+    std::array<Vector3f, 3> rotatedBasis = {
+        Vector3f(std::cos(theta),std::sin(theta),0),
+        Vector3f(-std::sin(theta),std::cos(theta),0),
+        Vector3f(0,0,1)
+    };
+    sc.addCubeQuad(Vector3f(400,700,40),Vector3f(100),jaune,rotatedBasis);
+
+    // Les rectangles délimitant la scène / boîte
+    sc.addCubeQuad(Vector3f(0,500,0), Vector3f(1000,500,500), gris);
+}
+
+void construitSceneSpheres(Scene& sc, int nbX, int nbY, bool objets) {
+    sc.reserve(objets ? nbX * nbY + 1 : 0, 3);
+    MaterialHandle orange = sc.addMaterial(Material(200,100,50,0));
+    MaterialHandle miroir = sc.addMaterial(Material(220,220,220,0.6));
+    MaterialHandle gris = sc.addMaterial(Material(70,70,70,0));
+    if (!objets)
+        return;
+    Real pasX = Real(1000) / nbX, pasY = Real(800) / nbY;
+    Real rayon = Real(0.4) * std::min(pasX, pasY);
+    for (int a = 0; a < nbX; a++) {
+        for (int b = 0; b < nbY; b++)
+            sc.addSphere(Vector3f(-400 + a*pasX, 300 + b*pasY, 300), rayon, ((a + b) % 5 == 0) ? miroir : orange);
+    }
+    sc.addCubeQuad(Vector3f(0,500,0), Vector3f(1000,500,500), gris);
+}
+
+void construitSceneImplicite(Scene& sc, bool objets) {
+    sc.reserve(objets ? 4 : 0, 4);
+    MaterialHandle bleu = sc.addMaterial(Material(40,60,230,0.5));
+    MaterialHandle or_ = sc.addMaterial(Material(240,180,40,0.7));
+    MaterialHandle rouge = sc.addMaterial(Material(230,40,40,0.2));
+    MaterialHandle gris = sc.addMaterial(Material(70,70,70,0));
+    if (!objets)
+        return;
+
+    sc.addSdf(SdfPrimitive::roundedBox(Vector3f(-350,450,200), Vector3f(120), 30), bleu);
+    sc.addSdf(SdfPrimitive::torus(Vector3f(100,350,150), 120, 35), or_);
+    sc.addSdf(SdfPrimitive::roundedBox(Vector3f(450,400,200), Vector3f(90,60,90), 20),
+              SdfPrimitive::torus(Vector3f(450,480,200), 110, 25), 60, rouge);
+    sc.addCubeQuad(Vector3f(0,500,0), Vector3f(1000,500,500), gris);
+}
+
+/**
+ * @brief Bruit de valeur lissé dans [0,1] (valeurs aléatoires aux noeuds d'un réseau de
+ * pas 1, interpolées avec un lissage cubique)
+ */
+static float bruit(float x, float y, float z) {
+    int x0 = int(std::floor(x)), y0 = int(std::floor(y)), z0 = int(std::floor(z));
+    auto lisse = [](float f) { return f * f * (3 - 2 * f); };
+    float fx = lisse(x - x0), fy = lisse(y - y0), fz = lisse(z - z0);
+    auto valeur = [](int i, int j, int k) {
+        return Rng::hash(Rng::hash(Rng::hash(uint32_t(i)) ^ uint32_t(j)) ^ uint32_t(k)) * (1.f / 4294967296.f);
+    };
+    float v = 0;
+    for (int c = 0; c < 8; c++) {
+        int dx = c & 1, dy = (c >> 1) & 1, dz = c >> 2;
+        v += valeur(x0 + dx, y0 + dy, z0 + dz) * (dx ? fx : 1 - fx) * (dy ? fy : 1 - fy) * (dz ? fz : 1 - fz);
+    }
+    return v;
+}
+
+void ajouteBrouillardDemo(Scene& sc) {
+    // Boîte de la scène de démonstration
+    Aabb boite(Vector3f(-1000,0,-500), Vector3f(1000,1000,500));
+    sc.addMedium(Medium(boite, 0.0004f, Vector3f(0.8,0.8,0.85)));
+
+    // Nappes de brume dans la moitié de la boîte où y > 500 : bruit à deux octaves seuillé,
+    // nul sur la plus grande partie de la couche
+    Aabb couche(Vector3f(-1000,500,-500), Vector3f(1000,1000,500));
+    const int nx = 64, ny = 16, nz = 32;
+    std::vector<float> densites(std::size_t(nx) * ny * nz);
+    for (int k = 0; k < nz; k++) {
+        for (int j = 0; j < ny; j++) {
+            for (int i = 0; i < nx; i++) {
+                float x = (i + 0.5f) / 8, y = (j + 0.5f) / 8, z = (k + 0.5f) / 8;
+                float n = 0.7f * bruit(x, y, z) + 0.3f * bruit(2 * x + 17, 2 * y + 31, 2 * z + 47);
+                densites[(std::size_t(k) * ny + j) * nx + i] = std::max(0.f, n - 0.6f) * 2;
+            }
+        }
+    }
+    sc.addMedium(Medium(couche, nx, ny, nz, densites, 0.01f, Vector3f(0.9,0.9,0.9)));
+}
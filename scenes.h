@@ -0,0 +1,63 @@
+/**
+ * @file scenes.h
+ * @brief Scènes prédéfinies (démonstration et catalogue de non-régression)
+ */
+#ifndef SCENES_H
+#define SCENES_H
+
+#include "scene.h"
+#include <string>
+
+/**
+ * @brief Caméra de la scène de démonstration
+ *
+ * @return Camera
+ */
+Camera cameraDemo();
+
+/**
+ * @brief Source de lumière de la scène de démonstration (dirigée vers le bas)
+ *
+ * @return Ray3f
+ */
+Ray3f sourceDemo();
+
+/**
+ * @brief Remplit la scène de démonstration (matériaux et objets)
+ *
+ * @param sc
+ * @param texture image appliquée à la sphère et aux murs (aucune si vide)
+ * @param objets ajoute les objets (sinon seulement les matériaux et textures, pour une
+ * scène dont les objets viennent d'un fichier de pages)
+ */
+void construitSceneDemo(Scene& sc, const std::string& texture = "", bool objets = true);
+
+/**
+ * @brief Remplit une scène de nbX x nbY petites sphères devant un mur, dans la boîte
+ * de la scène de démonstration (beaucoup d'objets : sollicite la hiérarchie de boîtes)
+ *
+ * @param sc
+ * @param nbX
+ * @param nbY
+ * @param objets ajoute les objets (sinon seulement les matériaux)
+ */
+void construitSceneSpheres(Scene& sc, int nbX, int nbY, bool objets = true);
+
+/**
+ * @brief Remplit une scène de surfaces implicites dans la boîte de la scène de
+ * démonstration : une boîte arrondie, un tore et l'union lisse d'une boîte et d'un tore
+ *
+ * @param sc
+ * @param objets ajoute les objets (sinon seulement les matériaux)
+ */
+void construitSceneImplicite(Scene& sc, bool objets = true);
+
+/**
+ * @brief Ajoute à la scène de démonstration un brouillard léger et homogène dans toute
+ * la boîte, et des nappes de brume hétérogènes (grille de densités) éparses
+ *
+ * @param sc
+ */
+void ajouteBrouillardDemo(Scene& sc);
+
+#endif
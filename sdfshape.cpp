@@ -0,0 +1,240 @@
+/**
+ * @file sdfshape.cpp
+ * @brief Implémentation de la classe SdfShape
+ */
+
+#include "sdfshape.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+const Real SUR_RELAXATION = 1.2;                        // Pas de la marche, en distances à la surface
+const int NB_PAS_MAX = 128;                             // Pas de la marche au plus, par intervalle
+const int NB_PAS_OMBRE = 48;                            // Idem pour les rayons d'ombre
+const Real SEUIL_IMPACT = Epsilon<Real>::SURFACE / 10;  // Distance à la surface en deçà de laquelle elle est touchée
+const Real PENTE_OMBRE = 1e-3;                          // Croissance du seuil des rayons d'ombre avec la distance
+const Real DEPART = Epsilon<Real>::SURFACE;             // Début de la marche : un rayon qui part de la surface la quitte
+const Real PAS_NORMALE = Epsilon<Real>::SURFACE;        // Ecart des différences finies du calcul de la normale
+
+SdfPrimitive SdfPrimitive::roundedBox(const Vector3f& center, const Vector3f& halfSize, Real radius) {
+    SdfPrimitive p = {ROUNDED_BOX, {center.getX(), center.getY(), center.getZ()}, {halfSize.getX(), halfSize.getY(), halfSize.getZ(), 0}};
+    p.dims[3] = std::max(Real(0), std::min(radius, std::min(p.dims[0], std::min(p.dims[1], p.dims[2]))));
+    return p;
+}
+
+SdfPrimitive SdfPrimitive::torus(const Vector3f& center, Real majorRadius, Real minorRadius) {
+    return {TORUS, {center.getX(), center.getY(), center.getZ()}, {majorRadius, minorRadius, 0, 0}};
+}
+
+void SdfPrimitive::extent(Real e[3]) const {
+    if (kind == ROUNDED_BOX) {
+        e[0] = dims[0];
+        e[1] = dims[1];
+        e[2] = dims[2];
+    } else {
+        e[0] = e[2] = dims[0] + dims[1];
+        e[1] = dims[1];
+    }
+}
+
+/**
+ * @brief Distance signée du point (x, y, z) à la primitive p
+ */
+static inline Real distancePrimitive(const SdfPrimitive& p, Real x, Real y, Real z) {
+    x -= p.center[0];
+    y -= p.center[1];
+    z -= p.center[2];
+    if (p.kind == SdfPrimitive::ROUNDED_BOX) {
+        // Boîte réduite du rayon des arêtes, puis épaissie d'autant
+        Real r = p.dims[3];
+        Real qx = std::abs(x) - p.dims[0] + r, qy = std::abs(y) - p.dims[1] + r, qz = std::abs(z) - p.dims[2] + r;
+        Real mx = std::max(qx, Real(0)), my = std::max(qy, Real(0)), mz = std::max(qz, Real(0));
+        return std::sqrt(mx*mx + my*my + mz*mz) + std::min(std::max(qx, std::max(qy, qz)), Real(0)) - r;
+    }
+    Real q = std::sqrt(x*x + z*z) - p.dims[0];
+    return std::sqrt(q*q + y*y) - p.dims[1];
+}
+
+SdfShape::SdfShape(const SdfPrimitive& a, MaterialHandle mat)
+    : Shape(mat), a(a), b(), blend(0) {}
+
+SdfShape::SdfShape(const SdfPrimitive& a, const SdfPrimitive& b, Real blend, MaterialHandle mat)
+    : Shape(mat), a(a), b(b), blend(std::max(Real(0), blend)) {}
+
+Real SdfShape::distance(Real x, Real y, Real z) const {
+    Real da = distancePrimitive(a, x, y, z);
+    if (b.kind == SdfPrimitive::NONE)
+        return da;
+    Real db = distancePrimitive(b, x, y, z);
+    if (blend <= 0)
+        return std::min(da, db);
+    // Minimum polynomial lissé : s'écarte du minimum d'au plus blend / 4, là où les deux
+    // distances diffèrent de moins de blend, et reste 1-lipschitzien
+    Real h = std::max(blend - std::abs(da - db), Real(0)) / blend;
+    return std::min(da, db) - h * h * blend / 4;
+}
+
+int SdfShape::intervalles(const Real o[3], const Real d[3], Real tMax, Real ta[2], Real tb[2]) const {
+    int n = 0;
+    Real marge = (b.kind == SdfPrimitive::NONE) ? 0 : blend / 4;
+    for (const SdfPrimitive* p : {&a, &b}) {
+        if (p->kind == SdfPrimitive::NONE)
+            continue;
+        Real e[3];
+        p->extent(e);
+        Real t0 = DEPART, t1 = tMax;
+        for (int k = 0; k < 3; k++) {
+            Real inv = 1 / d[k];
+            Real u = (p->center[k] - e[k] - marge - o[k]) * inv, v = (p->center[k] + e[k] + marge - o[k]) * inv;
+            if (u > v)
+                std::swap(u, v);
+            // Les comparaisons écartent les NaN d'une direction parallèle à la face
+            t0 = u > t0 ? u : t0;
+            t1 = v < t1 ? v : t1;
+        }
+        if (t0 <= t1) {
+            ta[n] = t0;
+            tb[n] = t1;
+            n++;
+        }
+    }
+    if (n == 2) {
+        if (ta[1] < ta[0]) {
+            std::swap(ta[0], ta[1]);
+            std::swap(tb[0], tb[1]);
+        }
+        if (ta[1] <= tb[0]) {
+            tb[0] = std::max(tb[0], tb[1]);
+            n = 1;
+        }
+    }
+    return n;
+}
+
+Real SdfShape::marche(const Real o[3], const Real d[3], Real ta, Real tb, Real seuil, Real pente, int nbPasMax) const {
+    Real t = ta, omega = SUR_RELAXATION, rPrec = 0, pas = 0;
+    for (int i = 0; i < nbPasMax; i++) {
+        Real r = std::abs(distance(o[0] + d[0]*t, o[1] + d[1]*t, o[2] + d[2]*t));
+        if (omega > 1 && r + rPrec < pas) {
+            // Les sphères de sûreté des deux derniers points sont disjointes : le pas
+            // sur-relaxé a pu franchir la surface, on reprend au pas sûr du point précédent
+            t += rPrec - pas;
+            omega = 1;
+            continue;
+        }
+        if (r < seuil + pente * t)
+            return t;
+        pas = omega * r;
+        rPrec = r;
+        t += pas;
+        if (t > tb) {
+            // Le pas sûr pouvait encore s'arrêter dans l'intervalle
+            if (omega > 1 && t - pas + rPrec < tb) {
+                t += rPrec - pas;
+                omega = 1;
+                continue;
+            }
+            return -1;
+        }
+    }
+    return -1;
+}
+
+Real SdfShape::is_hit(const Ray3f& ray) const {
+    // Marche en distances, le long de la direction normée
+    const Vector3f& dir = ray.getDirection();
+    Real norme = dir.norm();
+    Real o[3] = {ray.getOrigin().getX(), ray.getOrigin().getY(), ray.getOrigin().getZ()};
+    Real d[3] = {dir.getX() / norme, dir.getY() / norme, dir.getZ() / norme};
+    Real ta[2], tb[2];
+    int n = intervalles(o, d, std::numeric_limits<Real>::max(), ta, tb);
+    for (int k = 0; k < n; k++) {
+        Real t = marche(o, d, ta[k], tb[k], SEUIL_IMPACT, 0, NB_PAS_MAX);
+        if (t >= 0)
+            return t / norme;
+    }
+    return -1;
+}
+
+bool SdfShape::occludes(const Ray3f& ray, Real distanceMax) const {
+    const Vector3f& dir = ray.getDirection();
+    Real norme = dir.norm();
+    Real o[3] = {ray.getOrigin().getX(), ray.getOrigin().getY(), ray.getOrigin().getZ()};
+    Real d[3] = {dir.getX() / norme, dir.getY() / norme, dir.getZ() / norme};
+    Real ta[2], tb[2];
+    int n = intervalles(o, d, distanceMax * norme, ta, tb);
+    for (int k = 0; k < n; k++) {
+        if (marche(o, d, ta[k], tb[k], SEUIL_IMPACT, PENTE_OMBRE, NB_PAS_OMBRE) >= 0)
+            return true;
+    }
+    return false;
+}
+
+Vector3f SdfShape::getNormal(const Vector3f& v) const {
+    // Sommets (1,-1,-1), (-1,-1,1), (-1,1,-1) et (1,1,1) d'un tétraèdre autour de v : la
+    // somme pondérée des distances est proportionnelle au gradient
+    Real x = v.getX(), y = v.getY(), z = v.getZ(), h = PAS_NORMALE;
+    Real d0 = distance(x + h, y - h, z - h);
+    Real d1 = distance(x - h, y - h, z + h);
+    Real d2 = distance(x - h, y + h, z - h);
+    Real d3 = distance(x + h, y + h, z + h);
+    return Vector3f(d0 - d1 - d2 + d3, -d0 - d1 + d2 + d3, -d0 + d1 - d2 + d3).normalized();
+}
+
+bool SdfShape::isInside(const Vector3f &v) const {
+    return distance(v.getX(), v.getY(), v.getZ()) < 0;
+}
+
+Aabb SdfShape::getBounds() const {
+    Aabb bounds;
+    Real marge = (b.kind == SdfPrimitive::NONE) ? 0 : blend / 4;
+    for (const SdfPrimitive* p : {&a, &b}) {
+        if (p->kind == SdfPrimitive::NONE)
+            continue;
+        Real e[3];
+        p->extent(e);
+        Vector3f c(p->center[0], p->center[1], p->center[2]), m(e[0] + marge, e[1] + marge, e[2] + marge);
+        bounds.extend(Aabb(c - m, c + m));
+    }
+    return bounds;
+}
+
+ShapeRecord SdfShape::getRecord() const {
+    ShapeRecord r = {ShapeRecord::SDF, getMaterial(), a.kind | b.kind << 8, {}};
+    for (int k = 0; k < 3; k++) {
+        r.params[k] = a.center[k];
+        r.params[7 + k] = b.center[k];
+    }
+    for (int k = 0; k < 4; k++) {
+        r.params[3 + k] = a.dims[k];
+        r.params[10 + k] = b.dims[k];
+    }
+    r.params[14] = blend;
+    return r;
+}
+
+SurfaceUV SdfShape::getUV(const Vector3f& v) const {
+    Vector3f n = getNormal(v);
+    Aabb bounds = getBounds();
+    int axe = 0;
+    if (std::abs(n[1]) > std::abs(n[axe])) axe = 1;
+    if (std::abs(n[2]) > std::abs(n[axe])) axe = 2;
+    int i = (axe + 1) % 3, j = (axe + 2) % 3;
+    Vector3f taille = bounds.getMax() - bounds.getMin();
+    Real u = (v[i] - bounds.getMin()[i]) / taille[i];
+    Real w = (v[j] - bounds.getMin()[j]) / taille[j];
+    return {u, w, 1 / std::min(taille[i], taille[j])};
+}
+
+Ray3f SdfShape::reflect(const Ray3f& ray) const {
+    // Calcul de la position de l'intersection sur le rayon
+    Real t = this->is_hit(ray);
+
+    // Calcul du point d'intersection (= origine du rayon réfléchi)
+    Vector3f intersection = ray.pointAt(t);
+
+    // Calcul de la direction du rayon réfléchi
+    Vector3f reflectedDirection = ray.getDirection().reflect(getNormal(intersection));
+
+    return Ray3f(intersection,reflectedDirection);
+}
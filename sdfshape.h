@@ -0,0 +1,192 @@
+/**
+ * @file sdfshape.h
+ * @brief Création de la classe SdfShape (surfaces implicites : boîtes arrondies, tores et
+ * leur union lisse)
+ */
+#ifndef SDFSHAPE_H
+#define SDFSHAPE_H
+
+#include "shape.h" // Pour inclure la définition de la classe Shape
+#include "vector3f.h"
+#include "ray3f.h"
+
+/**
+ * @brief Primitive d'un SdfShape, alignée sur les axes du monde, décrite par sa fonction
+ * de distance signée (exacte)
+ */
+struct SdfPrimitive {
+    enum Kind : int32_t { NONE, ROUNDED_BOX, TORUS };
+
+    int32_t kind;
+    Real center[3];
+    Real dims[4];   // ROUNDED_BOX : demi-taille (arêtes comprises), rayon des arêtes ; TORUS : grand rayon, petit rayon (anneau dans le plan xz)
+
+    /**
+     * @brief Boîte arrondie
+     *
+     * @param center
+     * @param halfSize demi-taille, arêtes arrondies comprises
+     * @param radius rayon des arêtes (ramené à la plus petite demi-taille)
+     * @return SdfPrimitive
+     */
+    static SdfPrimitive roundedBox(const Vector3f& center, const Vector3f& halfSize, Real radius);
+
+    /**
+     * @brief Tore d'axe y
+     *
+     * @param center
+     * @param majorRadius rayon du cercle central de l'anneau
+     * @param minorRadius rayon de la section de l'anneau
+     * @return SdfPrimitive
+     */
+    static SdfPrimitive torus(const Vector3f& center, Real majorRadius, Real minorRadius);
+
+    /**
+     * @brief Demi-taille de la boîte englobante de la primitive, autour de son centre
+     *
+     * @param e reçoit la demi-taille sur chaque axe
+     */
+    void extent(Real e[3]) const;
+};
+
+/**
+ * @brief Classe pour représenter une surface implicite : une primitive, ou l'union lisse
+ * de deux primitives (raccord de rayon blend).
+ *
+ * Les rayons sont d'abord coupés aux boîtes englobantes des primitives (élargies du
+ * raccord, que la surface ne dépasse pas) : la marche n'a lieu que dans ces intervalles.
+ * Elle avance par pas sur-relaxés (sphere tracing à pas 1,2 fois la distance, repris au
+ * pas sûr dès que les sphères de sûreté de deux points successifs ne se recouvrent plus)
+ * et s'arrête après un nombre de pas borné. Le test d'occultation des rayons d'ombre a sa
+ * propre marche, moins précise et plus courte : il n'attend qu'une réponse oui/non
+ */
+class SdfShape : public Shape {
+
+    private:
+        /**
+         * @brief Primitives de la surface (b.kind vaut NONE pour une primitive seule)
+         *
+         */
+        SdfPrimitive a, b;
+
+        /**
+         * @brief Rayon du raccord lisse entre a et b (0 : union simple)
+         *
+         */
+        Real blend;
+
+        /**
+         * @brief Coupe le rayon (origine o, direction normée d) aux boîtes des primitives,
+         * avant tMax : au plus deux intervalles disjoints, triés
+         *
+         * @return int nombre d'intervalles
+         */
+        int intervalles(const Real o[3], const Real d[3], Real tMax, Real ta[2], Real tb[2]) const;
+
+        /**
+         * @brief Marche le long du rayon sur [ta, tb] : première distance où la surface est
+         * à moins de seuil + pente * t, -1 si aucune en nbPasMax pas
+         */
+        Real marche(const Real o[3], const Real d[3], Real ta, Real tb, Real seuil, Real pente, int nbPasMax) const;
+
+    public:
+        /**
+         * @brief Constructeur d'une surface à une primitive
+         *
+         * @param a
+         * @param mat indice du matériau dans la table de la Scene
+         */
+        SdfShape(const SdfPrimitive& a, MaterialHandle mat);
+
+        /**
+         * @brief Constructeur de l'union lisse de deux primitives
+         *
+         * @param a
+         * @param b
+         * @param blend rayon du raccord (0 : union simple)
+         * @param mat indice du matériau dans la table de la Scene
+         */
+        SdfShape(const SdfPrimitive& a, const SdfPrimitive& b, Real blend, MaterialHandle mat);
+
+        inline const SdfPrimitive& getPrimitive(int k) const {return k == 0 ? a : b;}
+        inline Real getBlend() const {return blend;}
+
+        /**
+         * @brief Distance signée du point (x, y, z) à la surface (négative à l'intérieur),
+         * minorant de la distance exacte pour une union lisse
+         *
+         * @return Real
+         */
+        Real distance(Real x, Real y, Real z) const;
+
+        /**
+         * @brief Méthode qui renvoie -1 si le Ray3f n'intersecte pas la surface et
+         * la distance entre l'origine du rayon et l'intersection sinon
+         *
+         * @param ray
+         * @return Real
+         */
+        Real is_hit(const Ray3f &ray) const override;
+
+        /**
+         * @brief Marche d'ombre : seuil d'impact qui croît avec la distance, moins de pas,
+         * arrêt à distance
+         *
+         * @param ray
+         * @param distance
+         * @return bool
+         */
+        bool occludes(const Ray3f &ray, Real distance) const override;
+
+        /**
+         * @brief Normale au point v, par différences finies sur les sommets d'un tétraèdre
+         * (quatre évaluations de la distance)
+         *
+         * @param v
+         * @return Vector3f
+         */
+        Vector3f getNormal(const Vector3f& v) const override;
+
+        /**
+         * @brief Retourne si le point se trouve à l'intérieur de la surface ou non
+         *
+         * @param v
+         * @return bool
+         */
+        bool isInside(const Vector3f &v) const override;
+
+        /**
+         * @brief Retourne la boîte englobante de la surface (boîtes des primitives élargies
+         * du raccord)
+         *
+         * @return Aabb
+         */
+        Aabb getBounds() const override;
+
+        /**
+         * @brief Retourne la description à plat de la surface (primitives et raccord)
+         *
+         * @return ShapeRecord
+         */
+        ShapeRecord getRecord() const override;
+
+        /**
+         * @brief Projection du point sur le plan de la boîte englobante le plus proche de
+         * la normale, de 0 à 1 d'un bord à l'autre de la boîte
+         *
+         * @param v
+         * @return SurfaceUV
+         */
+        SurfaceUV getUV(const Vector3f& v) const override;
+
+        /**
+         * @brief Retourne le Ray3f réfléchi par l'intersection avec la surface (on suppose
+         * qu'il y a bien intersection)
+         *
+         * @param ray
+         * @return Ray3f
+         */
+        Ray3f reflect(const Ray3f &ray) const override;
+};
+
+#endif
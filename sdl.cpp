@@ -9,6 +9,11 @@
 #include <stdexcept>
 
 Sdl::~Sdl() {
+    if (_texture != nullptr) {
+        SDL_DestroyTexture(_texture);
+        _texture = nullptr;
+    }
+
     if (_renderer != nullptr) {
         SDL_DestroyRenderer(_renderer);
         _renderer = nullptr;
@@ -58,3 +63,31 @@ void Sdl::clear() {
     setColor(0, 0, 0, SDL_ALPHA_OPAQUE);
     SDL_RenderClear(_renderer);
 }
+
+void Sdl::createTexture(int width, int height) {
+    _texture = SDL_CreateTexture(_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+    if (_texture == nullptr) {
+        throw std::runtime_error("La création de la texture SDL a échoué");
+    }
+}
+
+Uint32* Sdl::lockTexture(int& pitch) {
+    void* pixels = nullptr;
+    if (SDL_LockTexture(_texture, nullptr, &pixels, &pitch) != 0) {
+        throw std::runtime_error("Le verrouillage de la texture SDL a échoué");
+    }
+    return static_cast<Uint32*>(pixels);
+}
+
+void Sdl::unlockTexture() {
+    SDL_UnlockTexture(_texture);
+}
+
+void Sdl::present() {
+    SDL_RenderCopy(_renderer, _texture, nullptr, nullptr);
+    SDL_RenderPresent(_renderer);
+}
+
+void Sdl::setTitle(const std::string& title) {
+    SDL_SetWindowTitle(_window, title.c_str());
+}
@@ -24,11 +24,16 @@ class Sdl {
         SDL_Window* _window;
         SDL_Renderer* _renderer;
 
+        /**
+         * @brief Texture de diffusion (streaming) pour l'affichage interactif
+         */
+        SDL_Texture* _texture;
+
     public:
         /**
          * Constructeur par défaut de la classe SDL
          */
-        Sdl() : _window(nullptr), _renderer(nullptr) {}
+        Sdl() : _window(nullptr), _renderer(nullptr), _texture(nullptr) {}
 
         /**
          * Destructeur de la classe SDL
@@ -70,6 +75,36 @@ class Sdl {
          * @brief Méthode qui nettoie la fenêtre (donne un noir complet)
          */
         void clear();
+
+        /**
+         * @brief Crée une texture de diffusion (streaming) de la taille donnée, au format ARGB8888
+         * @param width
+         * @param height
+         */
+        void createTexture(int width, int height);
+
+        /**
+         * @brief Verrouille la texture pour y écrire directement les pixels
+         * @param pitch nombre d'octets par ligne de la texture
+         * @return Uint32* pointeur sur les pixels
+         */
+        Uint32* lockTexture(int& pitch);
+
+        /**
+         * @brief Déverrouille la texture après écriture
+         */
+        void unlockTexture();
+
+        /**
+         * @brief Affiche la texture dans la fenêtre, sans attente
+         */
+        void present();
+
+        /**
+         * @brief Change le titre de la fenêtre
+         * @param title
+         */
+        void setTitle(const std::string& title);
 };
 
 #endif
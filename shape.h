@@ -10,6 +10,31 @@
 
 #include "ray3f.h" // Pour inclure la définition de la classe Ray3f
 #include "material.h" // Pour donner une texture aux Shapes
+#include "aabb.h" // Pour la boîte englobante
+#include <cstdint>
+
+/**
+ * @brief Coordonnées de texture d'un point de la surface (entre 0 et 1), et échelle
+ * locale de la paramétrisation (unités de texture par unité de longueur)
+ */
+struct SurfaceUV {
+    Real u, v;
+    Real scale;
+};
+
+/**
+ * @brief Description à plat d'une Shape, sans pointeur ni table virtuelle : c'est sous
+ * cette forme que les objets sont enregistrés dans le cache de scène compilée
+ */
+struct ShapeRecord {
+    enum Type : int32_t { SPHERE, CUBEQUAD, SDF };
+
+    int32_t type;
+    int32_t material;   // Indice du matériau dans la table de la Scene
+    int32_t variant;    // SdfShape : nature des primitives a (8 bits de poids faible) et b (8 suivants)
+    Real params[15];    // Sphere : centre, rayon ; CubeQuad : centre, demi-taille, base (3 vecteurs) ;
+                        // SdfShape : centre et dimensions de a (7), puis de b (7), rayon du raccord
+};
 
 /**
  * @brief Classe abstraite pour représenter un objet
@@ -18,17 +43,17 @@
 class Shape {
     private:
         /**
-         * @brief Attribut pour la texture de la Shape
+         * @brief Indice du matériau de la Shape dans la table de la Scene
          * 
          */
-        Material mat;
+        MaterialHandle material;
 
     public:
         /**
          * @brief Constructeur par défaut de Shape
-         * @param mat Material associé à la Shape
+         * @param material indice du matériau associé à la Shape
          */
-        Shape(Material mat) : mat(mat) {}
+        Shape(MaterialHandle material) : material(material) {}
 
         /**
          * @brief Destructeur virtuel de Shape
@@ -41,9 +66,22 @@ class Shape {
          * la distance entre l'origine du rayon et l'intersection sinon
          * 
          * @param ray 
-         * @return float 
+         * @return Real 
+         */
+        virtual Real is_hit(const Ray3f &ray) const = 0;
+
+        /**
+         * @brief Retourne vrai si la Shape coupe le Ray3f avant la distance donnée (rayons
+         * d'ombre : seule l'existence d'une intersection compte)
+         *
+         * @param ray
+         * @param distance
+         * @return bool
          */
-        virtual float is_hit(const Ray3f &ray) const = 0;
+        virtual bool occludes(const Ray3f &ray, Real distance) const {
+            Real t = is_hit(ray);
+            return t > 0 && t < distance;
+        }
 
         /**
          * @brief Méthode qui calcule le Ray3f réfléchi à partir de l'intersection
@@ -72,10 +110,32 @@ class Shape {
         virtual bool isInside(const Vector3f &vec) const = 0;
 
         /**
-         * @brief Retourne la texture de l'objet
+         * @brief Retourne une boîte englobante de la shape dans le repère du monde
+         *
+         * @return Aabb
+         */
+        virtual Aabb getBounds() const = 0;
+
+        /**
+         * @brief Retourne la description à plat de la shape
+         *
+         * @return ShapeRecord
+         */
+        virtual ShapeRecord getRecord() const = 0;
+
+        /**
+         * @brief Retourne les coordonnées de texture d'un point de la surface
+         *
+         * @param vec
+         * @return SurfaceUV
+         */
+        virtual SurfaceUV getUV(const Vector3f &vec) const = 0;
+
+        /**
+         * @brief Retourne l'indice du matériau de l'objet
          * 
-         * @return Material 
+         * @return MaterialHandle 
          */
-        inline Material getMat() const {return mat;}
+        inline MaterialHandle getMaterial() const {return material;}
 };
 #endif
@@ -6,25 +6,34 @@
  */
 
 #include "sphere.h"
+#include <algorithm>
 #include <iostream>
 
-float Sphere::is_hit(const Ray3f& ray) const {
+template <typename T>
+T intersectSphere(const Ray3<T>& ray, const Vector3<T>& center, T radius) {
     // Calcule le vecteur d'origine du rayon à la sphère
-    Vector3f oc = ray.getOrigin() - center;
+    Vector3<T> oc = ray.getOrigin() - center;
+    const Vector3<T>& d = ray.getDirection();
 
-    // Calcule les coefficients de l'équation quadratique qui décrit l'intersection entre le rayon et la sphère
-    float a = ray.getDirection().squaredNorm();
-    float b = 2 * oc.dot(ray.getDirection());
-    float c = oc.squaredNorm() - radius*radius;
+    // Coefficients de l'équation quadratique a t² + 2 h t + c = 0 qui décrit l'intersection
+    // entre le rayon et la sphère
+    T a = d.squaredNorm();
+    T h = oc.dot(d);
+    T c = oc.squaredNorm() - radius*radius;
 
-    // Calcule le discriminant de l'équation quadratique
-    float discriminant = b*b - 4*a*c;
+    // Discriminant h² - a c calculé depuis la distance du centre à la droite du rayon : la
+    // différence h² - a c perd tous ses chiffres en float pour une petite sphère lointaine,
+    // et la sphère serait touchée hors de sa surface
+    Vector3<T> perpendiculaire = oc - d * (h / a);
+    T discriminant = a * (radius*radius - perpendiculaire.squaredNorm());
 
-    // Renvoie true si le discriminant est positif, false sinon (c'est-à-dire si le rayon intersecte la sphère)
+    // Renvoie -1 si le discriminant n'est pas positif (le rayon ne touche pas la sphère)
     if (discriminant > 0){
-        // deux solutions
-        float t1 = (-b + std::sqrt(discriminant)) / (2*a);
-        float t2 = (-b - std::sqrt(discriminant)) / (2*a);
+        // deux solutions, la plus éloignée de 0 d'abord (sans soustraction de deux nombres
+        // proches), l'autre par le produit des racines
+        T q = -(h + std::copysign(std::sqrt(discriminant), h));
+        T t1 = q / a;
+        T t2 = c / q;
         if (t1<0) {
             return (t2<0) ? -1 : t2;
         } else {
@@ -39,9 +48,21 @@ float Sphere::is_hit(const Ray3f& ray) const {
     };
 }
 
+template float intersectSphere(const Ray3<float>&, const Vector3<float>&, float);
+template double intersectSphere(const Ray3<double>&, const Vector3<double>&, double);
+
+Real Sphere::is_hit(const Ray3f& ray) const {
+    return intersectSphere(ray, center, radius);
+}
+
+bool Sphere::occludes(const Ray3f& ray, Real distance) const {
+    Real t = intersectSphere(ray, center, radius);
+    return t > 0 && t < distance;
+}
+
 Ray3f Sphere::reflect(const Ray3f& ray) const {
     // Calcul de la position de l'intersection sur le rayon
-    float t = this->is_hit(ray);
+    Real t = this->is_hit(ray);
 
     // Calcul du point d'intersection (= origine du rayon réfléchi)
     Vector3f intersection = ray.pointAt(t);
@@ -62,3 +83,23 @@ Vector3f Sphere::getNormal(const Vector3f& v) const {
 bool Sphere::isInside(const Vector3f &v) const {
     return (v-center).norm()<radius;
 }
+
+Aabb Sphere::getBounds() const {
+    return Aabb(center - Vector3f(radius), center + Vector3f(radius));
+}
+
+ShapeRecord Sphere::getRecord() const {
+    ShapeRecord r = {ShapeRecord::SPHERE, getMaterial(), 0, {}};
+    for (int a = 0; a < 3; a++)
+        r.params[a] = center[a];
+    r.params[3] = radius;
+    return r;
+}
+
+SurfaceUV Sphere::getUV(const Vector3f& v) const {
+    Vector3f d = (v - center) / radius;
+    Real u = Real(0.5) + std::atan2(d.getZ(), d.getX()) / Real(2 * M_PI);
+    Real w = std::acos(std::min(Real(1), std::max(Real(-1), d.getY()))) / Real(M_PI);
+    // Un texel de v couvre pi*r : on prend cette échelle (celle de u ne diffère qu'aux pôles)
+    return {u, w, 1 / (Real(M_PI) * radius)};
+}
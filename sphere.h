@@ -10,6 +10,18 @@
 #include "shape.h" // Pour inclure la définition de la classe Shape
 #include <cmath> // Pour sqrt()
 
+/**
+ * @brief Noyau d'intersection rayon / sphère, de précision T (instancié pour float et double)
+ *
+ * @param ray
+ * @param center centre de la sphère
+ * @param radius rayon de la sphère
+ * @return T -1 si le rayon ne touche pas la sphère, la distance entre l'origine du rayon
+ * et l'intersection la plus proche devant lui sinon
+ */
+template <typename T>
+T intersectSphere(const Ray3<T>& ray, const Vector3<T>& center, T radius);
+
 /**
  * @brief Classe pour représenter une sphère
  * 
@@ -27,7 +39,7 @@ class Sphere : public Shape {
          * @brief Le rayon de la sphère
          *
          */
-        float radius;
+        Real radius;
 
     public:
         /**
@@ -35,9 +47,9 @@ class Sphere : public Shape {
          *
          * @param center
          * @param radius
-         * @param mat
+         * @param mat indice du matériau dans la table de la Scene
          */
-        Sphere(const Vector3f &center, float radius, Material mat)
+        Sphere(const Vector3f &center, Real radius, MaterialHandle mat)
             : Shape(mat), center(center), radius(radius) {}
 
         /**
@@ -50,18 +62,27 @@ class Sphere : public Shape {
         /**
          * @brief Retourne le rayon de la Sphere
          *
-         * @return float
+         * @return Real
          */
-        inline float getRadius() const { return radius; }
+        inline Real getRadius() const { return radius; }
 
         /**
          * @brief Méthode qui renvoie -1 si le Ray3f n'intersecte pas la Sphère et
          * la distance entre l'origine du rayon et l'intersection sinon
          * 
          * @param ray 
-         * @return float 
+         * @return Real 
+         */
+        Real is_hit(const Ray3f &ray) const override;
+
+        /**
+         * @brief Retourne vrai si le rayon coupe la sphère avant la distance donnée
+         *
+         * @param ray
+         * @param distance
+         * @return bool
          */
-        float is_hit(const Ray3f &ray) const override;
+        bool occludes(const Ray3f &ray, Real distance) const override;
 
         /**
          * @brief Méthode qui calcule le vecteur normal à un point situé sur la sphère 
@@ -79,6 +100,29 @@ class Sphere : public Shape {
          */
         bool isInside(const Vector3f &v) const override;
 
+        /**
+         * @brief Retourne la boîte englobante de la Sphere dans le repère du monde
+         *
+         * @return Aabb
+         */
+        Aabb getBounds() const override;
+
+        /**
+         * @brief Retourne la description à plat de la Sphere (centre, rayon)
+         *
+         * @return ShapeRecord
+         */
+        ShapeRecord getRecord() const override;
+
+        /**
+         * @brief Coordonnées sphériques du point : u selon la longitude, v de 0 au pôle
+         * supérieur à 1 au pôle inférieur
+         *
+         * @param v
+         * @return SurfaceUV
+         */
+        SurfaceUV getUV(const Vector3f& v) const override;
+
         /**
          * @brief Retourne le Ray3f réfléchi par l'intersection avec la Sphere (on
          * suppose qu'il y a intersection)
@@ -0,0 +1,77 @@
+/**
+ * @file parallel_test.cpp
+ * @brief Test de parallelFor : chaque indice est traité une fois, et une exception levée
+ * dans un thread est relancée dans le thread appelant après la fin de tous les threads.
+ *
+ * Compilation et exécution depuis la racine du dépôt :
+ *   g++ -std=c++17 -O2 -I. tests/parallel_test.cpp parallel.cpp -pthread -o parallel_test
+ *   ./parallel_test
+ * Le code de sortie vaut 1 dès qu'un cas échoue
+ */
+
+#include "parallel.h"
+#include <atomic>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static int nbEchecs = 0;
+
+static void verifie(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "ECHEC : " << message << std::endl;
+        nbEchecs++;
+    }
+}
+
+/**
+ * @brief Chaque indice est traité exactement une fois, quel que soit le nombre de threads
+ */
+static void testIndices() {
+    for (int nbThreads : {1, 4, 16}) {
+        std::vector<std::atomic<int>> vus(1000);
+        parallelFor(vus.size(), nbThreads, [&](int k) { vus[k]++; });
+        bool unique = true;
+        for (const std::atomic<int>& v : vus)
+            unique = unique && v == 1;
+        verifie(unique, "indices : chacun traité une fois avec " + std::to_string(nbThreads) + " threads");
+    }
+}
+
+/**
+ * @brief L'exception d'une itération arrive au thread appelant, une fois les autres
+ * threads terminés ; la boucle reste utilisable ensuite
+ */
+static void testException() {
+    for (int nbThreads : {1, 4}) {
+        std::atomic<int> enCours(0);
+        std::string message;
+        try {
+            parallelFor(200, nbThreads, [&](int k) {
+                enCours++;
+                if (k == 37) {
+                    enCours--;
+                    throw std::runtime_error("échec 37");
+                }
+                enCours--;
+            });
+        } catch (const std::runtime_error& e) {
+            message = e.what();
+        }
+        verifie(message == "échec 37", "exception : relancée avec " + std::to_string(nbThreads) + " threads");
+        verifie(enCours == 0, "exception : aucune itération en cours au retour");
+    }
+    std::atomic<int> total(0);
+    parallelFor(100, 4, [&](int k) { total += k; });
+    verifie(total == 4950, "exception : boucle utilisable après une exception");
+}
+
+int main() {
+    testIndices();
+    testException();
+
+    if (nbEchecs == 0)
+        std::cout << "parallel_test : tous les cas passent" << std::endl;
+    return nbEchecs == 0 ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file renderjob_test.cpp
+ * @brief Test des rendus asynchrones (RenderQueue, RenderJob) : rendu complet, annulation,
+ * image vide refusée, snapshot depuis la fonction de suivi.
+ *
+ * Compilation et exécution depuis la racine du dépôt :
+ *   g++ -std=c++17 -O2 -I. tests/renderjob_test.cpp $(ls *.cpp | grep -v -x main.cpp) -lSDL2 -pthread -o renderjob_test
+ *   ./renderjob_test
+ * Le code de sortie vaut 1 dès qu'un cas échoue
+ */
+
+#include "renderjob.h"
+#include "scenes.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int nbEchecs = 0;
+
+static void verifie(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "ECHEC : " << message << std::endl;
+        nbEchecs++;
+    }
+}
+
+/**
+ * @brief Attend la fin du travail ; un travail bloqué arrête le test (les threads de la
+ * file ne se termineraient jamais)
+ */
+static RenderJob::Status attend(const RenderJob& job, const std::string& cas) {
+    if (job.getFuture().wait_for(std::chrono::seconds(60)) != std::future_status::ready) {
+        std::cerr << "ECHEC : " << cas << " : le travail ne se termine pas" << std::endl;
+        std::_Exit(1);
+    }
+    return job.wait();
+}
+
+/**
+ * @brief Le travail va jusqu'au bout, et son image est celle de renderFrame
+ */
+static void testRendu(RenderQueue& file, const Scene& sc) {
+    const int largeur = 100, hauteur = 70;
+    std::atomic<int> nbAppels(0);
+    std::shared_ptr<RenderJob> job = file.submit(sc, sc.getCamera(), largeur, hauteur, 0,
+                                                 [&](const RenderProgress&) { nbAppels++; });
+    verifie(attend(*job, "rendu") == RenderJob::DONE, "rendu : état final DONE");
+    verifie(job->getStatus() == RenderJob::DONE, "rendu : getStatus DONE");
+    RenderProgress p = job->getProgress();
+    verifie(p.tilesDone == p.tilesTotal && p.tilesTotal == job->getNbTiles(), "rendu : toutes les tuiles faites");
+    verifie(nbAppels == job->getNbTiles(), "rendu : un appel de suivi par tuile");
+
+    Framebuffer attendu(largeur, hauteur);
+    sc.renderFrame(attendu, sc.getCamera(), 1);
+    std::vector<float> a(largeur * hauteur * 3), b(largeur * hauteur * 3);
+    attendu.getRGB(0, hauteur, a.data());
+    job->getFramebuffer().getRGB(0, hauteur, b.data());
+    verifie(a == b, "rendu : image identique à celle de renderFrame");
+}
+
+/**
+ * @brief Annulé depuis sa fonction de suivi après la première tuile, le travail se termine
+ * CANCELLED sans calculer toutes ses tuiles
+ */
+static void testAnnulation(RenderQueue& file, const Scene& sc) {
+    std::atomic<RenderJob*> courant(nullptr);
+    std::shared_ptr<RenderJob> job = file.submit(sc, sc.getCamera(), 640, 480, 0, [&](const RenderProgress&) {
+        RenderJob* j;
+        while ((j = courant.load()) == nullptr)
+            std::this_thread::yield();
+        j->cancel();
+    });
+    courant = job.get();
+    verifie(attend(*job, "annulation") == RenderJob::CANCELLED, "annulation : état final CANCELLED");
+    verifie(job->isCancelled(), "annulation : isCancelled");
+    verifie(job->getProgress().tilesDone < job->getNbTiles(), "annulation : tuiles abandonnées");
+}
+
+/**
+ * @brief Une image vide n'a aucune tuile : submit la refuse au lieu de rendre un travail
+ * qui ne finirait jamais
+ */
+static void testImageVide(RenderQueue& file, const Scene& sc) {
+    for (int k = 0; k < 3; k++) {
+        int largeur = k == 1 ? 0 : 64, hauteur = k == 0 ? 0 : (k == 1 ? 64 : -5);
+        bool refuse = false;
+        try {
+            file.submit(sc, sc.getCamera(), largeur, hauteur);
+        } catch (const std::runtime_error&) {
+            refuse = true;
+        }
+        verifie(refuse, "image vide : " + std::to_string(largeur) + " x " + std::to_string(hauteur) + " refusée");
+    }
+}
+
+/**
+ * @brief snapshot appelé depuis la fonction de suivi ne bloque pas, et voit au moins la
+ * tuile qui vient de finir
+ */
+static void testSnapshotDepuisSuivi(RenderQueue& file, const Scene& sc) {
+    const int largeur = 96, hauteur = 96;
+    std::atomic<RenderJob*> courant(nullptr);
+    std::atomic<int> nbVides(0), nbAppels(0);
+    Framebuffer copie(largeur, hauteur);
+    std::shared_ptr<RenderJob> job = file.submit(sc, sc.getCamera(), largeur, hauteur, 0, [&](const RenderProgress& p) {
+        RenderJob* j;
+        while ((j = courant.load()) == nullptr)
+            std::this_thread::yield();
+        // Les appels de suivi ne se chevauchent pas : copie n'est écrite que par l'un d'eux
+        if (j->snapshot(copie) < p.tilesDone)
+            nbVides++;
+        nbAppels++;
+    });
+    courant = job.get();
+    verifie(attend(*job, "snapshot") == RenderJob::DONE, "snapshot : état final DONE");
+    verifie(nbAppels == job->getNbTiles(), "snapshot : un appel de suivi par tuile");
+    verifie(nbVides == 0, "snapshot : les tuiles comptées sont recopiées");
+}
+
+int main() {
+    Scene sc(cameraDemo(), sourceDemo());
+    construitSceneDemo(sc);
+    sc.buildBvh();
+
+    RenderQueue file(4);
+    testRendu(file, sc);
+    testAnnulation(file, sc);
+    testImageVide(file, sc);
+    testSnapshotDepuisSuivi(file, sc);
+
+    if (nbEchecs == 0)
+        std::cout << "renderjob_test : tous les cas passent" << std::endl;
+    return nbEchecs == 0 ? 0 : 1;
+}
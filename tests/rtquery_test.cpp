@@ -0,0 +1,81 @@
+/**
+ * @file rtquery_test.cpp
+ * @brief Test de l'interface C de requêtes de rayons : boîtes orientées (centre dans le
+ * repère du monde) et descriptions de boîtes refusées.
+ *
+ * Compilation et exécution depuis la racine du dépôt :
+ *   g++ -std=c++17 -O2 -I. tests/rtquery_test.cpp rtquery.cpp bvh.cpp aabb.cpp sphere.cpp cubequad.cpp arena.cpp
+ *       parallel.cpp costmap.cpp perfcounters.cpp vector3f.cpp ray3f.cpp -pthread -o rtquery_test
+ *   ./rtquery_test
+ * Le code de sortie vaut 1 dès qu'un cas échoue
+ */
+
+#include "rtquery.h"
+#include <cmath>
+#include <iostream>
+#include <string>
+
+static int nbEchecs = 0;
+
+static void verifie(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "ECHEC : " << message << std::endl;
+        nbEchecs++;
+    }
+}
+
+/**
+ * @brief Boîte tournée de 45 degrés autour de z, centrée en (5, 2, 0) dans le monde : les
+ * rayons verticaux qui passent par le centre la touchent à la hauteur de sa face
+ */
+static void testBoiteOrientee() {
+    const float c = std::sqrt(0.5f);
+    RtqBox boite = {{5, 2, 0}, {1, 1, 1}, {c, c, 0, -c, c, 0, 0, 0, 1}};
+    RtqScene* scene = rtqCreateScene(nullptr, 0, &boite, 1);
+    verifie(scene != nullptr, "boîte orientée : scène construite");
+    if (scene == nullptr)
+        return;
+
+    // Un rayon au centre, un à côté de la boîte, un vers le coin de la boîte vu d'en haut
+    float ox[3] = {5, 8, 5 + 1.2f * c}, oy[3] = {2, 2, 2 + 1.2f * c}, oz[3] = {10, 10, 10};
+    float dx[3] = {0, 0, 0}, dy[3] = {0, 0, 0}, dz[3] = {-1, -1, -1};
+    float tMax[3] = {0, 0, 0};
+    RtqRays rayons = {ox, oy, oz, dx, dy, dz, tMax};
+    float t[3], nx[3], ny[3], nz[3];
+    int32_t id[3];
+    RtqHits impacts = {t, id, nx, ny, nz};
+    verifie(rtqIntersect(scene, &rayons, 3, &impacts, 1) == 1, "boîte orientée : un seul rayon touche");
+    verifie(id[0] == 0 && std::abs(t[0] - 9) < 1e-4f, "boîte orientée : impact sur la face du haut");
+    verifie(std::abs(nz[0] - 1) < 1e-4f, "boîte orientée : normale de la face du haut");
+    verifie(id[1] == -1 && t[1] == -1, "boîte orientée : rayon à côté");
+    // Le coin, à sqrt(2) du centre dans le plan xy, dépasse 1,2 * sqrt(0.5) sur l'axe du
+    // premier vecteur de la base : le rayon passe hors de la boîte
+    verifie(id[2] == -1, "boîte orientée : rayon hors de la boîte tournée");
+    rtqDestroyScene(scene);
+}
+
+/**
+ * @brief Demi-taille nulle ou négative et bases non orthonormées sont refusées
+ */
+static void testBoitesInvalides() {
+    RtqBox boites[4] = {
+        {{0, 0, 0}, {1, 0, 1}, {1, 0, 0, 0, 1, 0, 0, 0, 1}},
+        {{0, 0, 0}, {1, -1, 1}, {}},
+        {{0, 0, 0}, {1, 1, 1}, {2, 0, 0, 0, 1, 0, 0, 0, 1}},
+        {{0, 0, 0}, {1, 1, 1}, {1, 0, 0, 1, 0, 0, 0, 0, 1}},
+    };
+    for (int k = 0; k < 4; k++) {
+        RtqScene* scene = rtqCreateScene(nullptr, 0, &boites[k], 1);
+        verifie(scene == nullptr && std::string(rtqGetLastError()).size() > 0,
+                "boîte invalide " + std::to_string(k) + " refusée avec un message");
+        rtqDestroyScene(scene);
+    }
+}
+
+int main() {
+    testBoiteOrientee();
+    testBoitesInvalides();
+    if (nbEchecs == 0)
+        std::cout << "rtquery_test : tous les cas passent" << std::endl;
+    return nbEchecs == 0 ? 0 : 1;
+}
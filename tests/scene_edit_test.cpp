@@ -0,0 +1,215 @@
+/**
+ * @file scene_edit_test.cpp
+ * @brief Test des modifications de scène (insertShape, removeShape, transformShape,
+ * updateBvh) : déplacement des boîtes orientées, validité des handles, et requêtes de la
+ * hiérarchie mise à jour comparées à un parcours de tous les objets après des
+ * modifications aléatoires.
+ *
+ * Compilation et exécution depuis la racine du dépôt :
+ *   g++ -std=c++17 -O2 -I. tests/scene_edit_test.cpp $(ls *.cpp | grep -v -x main.cpp) -lSDL2 -pthread -o scene_edit_test
+ *   ./scene_edit_test
+ * Le code de sortie vaut 1 dès qu'un cas échoue
+ */
+
+#include "cubequad.h"
+#include "scene.h"
+#include "scenes.h"
+#include "sphere.h"
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static int nbEchecs = 0;
+
+static void verifie(bool condition, const std::string& message) {
+    if (!condition) {
+        std::cerr << "ECHEC : " << message << std::endl;
+        nbEchecs++;
+    }
+}
+
+static bool proches(const Vector3f& a, const Vector3f& b, Real tolerance) {
+    return std::abs(a[0] - b[0]) < tolerance && std::abs(a[1] - b[1]) < tolerance && std::abs(a[2] - b[2]) < tolerance;
+}
+
+/**
+ * @brief Centre de l'objet dans le repère du monde (celui d'une CubeQuad est exprimé dans sa base)
+ */
+static Vector3f centreMonde(const Shape& s) {
+    ShapeRecord r = s.getRecord();
+    if (r.type != ShapeRecord::CUBEQUAD)
+        return Vector3f(r.params[0], r.params[1], r.params[2]);
+    Vector3f centre(0, 0, 0);
+    for (int b = 0; b < 3; b++)
+        centre = centre + Vector3f(r.params[6 + 3*b], r.params[7 + 3*b], r.params[8 + 3*b]) * r.params[b];
+    return centre;
+}
+
+/**
+ * @brief Boîte tournée de 45 degrés autour de z, de centre (70.7, 70.7, 0) dans le monde :
+ * une translation déplace ce centre d'autant, une rotation autour de z le laisse en place
+ */
+static void testBoiteOrientee(Scene& sc, MaterialHandle mat) {
+    const Real c = std::sqrt(Real(0.5));
+    std::array<Vector3f, 3> base = {Vector3f(c, c, 0), Vector3f(-c, c, 0), Vector3f(0, 0, 1)};
+    ShapeHandle h = sc.addCubeQuad(Vector3f(100, 0, 0), Vector3f(5, 5, 5), mat, base);
+    sc.buildBvh();
+    const Vector3f depart(100 * c, 100 * c, 0);
+    verifie(proches(centreMonde(sc.getShape(h)), depart, 1e-3), "boîte orientée : centre initial");
+
+    const std::array<Vector3f, 3> identite = Vector3f::basis();
+    sc.transformShape(h, identite, Vector3f(10, 0, 0));
+    sc.updateBvh(1);
+    verifie(proches(centreMonde(sc.getShape(h)), depart + Vector3f(10, 0, 0), 1e-3), "boîte orientée : translation");
+
+    // Le rayon vertical qui passe par le nouveau centre touche la face du dessus
+    Real t;
+    Ray3f rayon(depart + Vector3f(10, 0, 20), Vector3f(0, 0, -1));
+    int touche = sc.getBvh().closestHit(rayon, sc.getShapes(), t);
+    verifie(touche >= 0 && std::abs(t - 15) < 1e-3, "boîte orientée : touchée à sa nouvelle place");
+
+    const std::array<Vector3f, 3> quartDeTour = {Vector3f(0, 1, 0), Vector3f(-1, 0, 0), Vector3f(0, 0, 1)};
+    sc.transformShape(h, quartDeTour, Vector3f(0, 0, 0));
+    sc.updateBvh(1);
+    verifie(proches(centreMonde(sc.getShape(h)), depart + Vector3f(10, 0, 0), 1e-3), "boîte orientée : rotation sur place");
+    ShapeRecord r = sc.getShape(h).getRecord();
+    verifie(proches(Vector3f(r.params[6], r.params[7], r.params[8]), Vector3f(-c, c, 0), 1e-5), "boîte orientée : base tournée");
+    sc.removeShape(h);
+    sc.updateBvh(1);
+}
+
+/**
+ * @brief Les handles restent valides après le retrait d'un autre objet, celui de l'objet
+ * retiré ne l'est plus
+ */
+static void testHandles(Scene& sc, MaterialHandle mat) {
+    ShapeHandle a = sc.insertShape(Sphere(Vector3f(0, 0, 0), 1, mat).getRecord());
+    ShapeHandle b = sc.insertShape(Sphere(Vector3f(5, 0, 0), 2, mat).getRecord());
+    ShapeHandle c = sc.insertShape(Sphere(Vector3f(10, 0, 0), 3, mat).getRecord());
+    sc.removeShape(a);
+    sc.updateBvh(1);
+    verifie(!sc.hasShape(a), "handles : objet retiré");
+    verifie(sc.hasShape(b) && sc.getShape(b).getRecord().params[3] == 2, "handles : b garde son objet");
+    verifie(sc.hasShape(c) && sc.getShape(c).getRecord().params[3] == 3, "handles : c garde son objet");
+
+    sc.transformShape(c, Vector3f::basis(), Vector3f(0, 4, 0));
+    sc.updateBvh(1);
+    verifie(proches(centreMonde(sc.getShape(c)), Vector3f(10, 4, 0), 1e-6), "handles : sphère translatée");
+    sc.removeShape(b);
+    sc.removeShape(c);
+    sc.updateBvh(1);
+    verifie(sc.getShapes().empty(), "handles : scène vide");
+}
+
+/**
+ * @brief Objet le plus proche par parcours de tous les objets (à distance égale, le plus
+ * petit indice, comme Bvh::closestHit)
+ */
+static int plusProcheBrut(const Ray3f& rayon, const std::vector<Shape*>& shapes, Real& t) {
+    int meilleur = -1;
+    for (std::size_t k = 0; k < shapes.size(); k++) {
+        Real d = shapes[k]->is_hit(rayon);
+        if (d > 0 && (meilleur < 0 || d < t)) {
+            meilleur = k;
+            t = d;
+        }
+    }
+    return meilleur;
+}
+
+static bool occulteBrut(const Ray3f& rayon, const std::vector<Shape*>& shapes, Real distance) {
+    for (const Shape* s : shapes)
+        if (s->occludes(rayon, distance))
+            return true;
+    return false;
+}
+
+static std::array<Vector3f, 3> rotationAleatoire(std::mt19937& gen) {
+    std::uniform_real_distribution<Real> angle(0, 2 * M_PI);
+    Real a = angle(gen), b = angle(gen);
+    // Rotation autour de z puis autour de x
+    Real ca = std::cos(a), sa = std::sin(a), cb = std::cos(b), sb = std::sin(b);
+    return {Vector3f(ca, sa * cb, sa * sb), Vector3f(-sa, ca * cb, ca * sb), Vector3f(0, -sb, cb)};
+}
+
+static ShapeRecord objetAleatoire(std::mt19937& gen, MaterialHandle mat) {
+    std::uniform_real_distribution<Real> position(-50, 50), taille(0.5, 4);
+    Vector3f centre(position(gen), position(gen), position(gen));
+    if (gen() % 2 == 0)
+        return Sphere(centre, taille(gen), mat).getRecord();
+    std::array<Vector3f, 3> base = rotationAleatoire(gen);
+    // Le centre est donné dans la base de la boîte
+    Vector3f centreBase(centre.dot(base[0]), centre.dot(base[1]), centre.dot(base[2]));
+    return CubeQuad(centreBase, Vector3f(taille(gen), taille(gen), taille(gen)), mat, base).getRecord();
+}
+
+/**
+ * @brief Insertions, retraits et déplacements aléatoires : après chaque updateBvh, les
+ * requêtes de la hiérarchie donnent les mêmes réponses que le parcours de tous les objets
+ */
+static void testModificationsAleatoires(Scene& sc, MaterialHandle mat) {
+    std::mt19937 gen(2024);
+    std::vector<ShapeHandle> handles;
+    for (int k = 0; k < 300; k++)
+        handles.push_back(sc.insertShape(objetAleatoire(gen, mat)));
+    sc.updateBvh(1);
+
+    std::uniform_real_distribution<Real> position(-60, 60), pas(-8, 8);
+    int nbDifferences = 0, nbRayons = 0;
+    for (int tour = 0; tour < 40; tour++) {
+        for (int m = 0; m < 25; m++) {
+            int choix = gen() % 4;
+            if (choix == 0 || handles.empty()) {
+                handles.push_back(sc.insertShape(objetAleatoire(gen, mat)));
+            } else {
+                std::size_t k = gen() % handles.size();
+                if (choix == 1) {
+                    sc.removeShape(handles[k]);
+                    handles[k] = handles.back();
+                    handles.pop_back();
+                } else if (choix == 2) {
+                    sc.transformShape(handles[k], Vector3f::basis(), Vector3f(pas(gen), pas(gen), pas(gen)));
+                } else {
+                    sc.transformShape(handles[k], rotationAleatoire(gen), Vector3f(pas(gen), pas(gen), pas(gen)));
+                }
+            }
+        }
+        sc.updateBvh(1);
+        verifie(sc.getShapes().size() == handles.size(), "modifications : nombre d'objets");
+
+        const std::vector<Shape*>& shapes = sc.getShapes();
+        for (int k = 0; k < 200; k++) {
+            Vector3f origine(position(gen), position(gen), position(gen));
+            Vector3f cible(position(gen), position(gen), position(gen));
+            Ray3f rayon(origine, (cible - origine).normalized());
+            Real t = 0, tBrut = 0;
+            int touche = sc.getBvh().closestHit(rayon, shapes, t);
+            int toucheBrut = plusProcheBrut(rayon, shapes, tBrut);
+            if ((touche < 0) != (toucheBrut < 0) || (touche >= 0 && std::abs(t - tBrut) > 1e-4))
+                nbDifferences++;
+            Real distance = (cible - origine).norm();
+            if (sc.getBvh().occluded(rayon, shapes, distance) != occulteBrut(rayon, shapes, distance))
+                nbDifferences++;
+            nbRayons++;
+        }
+    }
+    verifie(nbDifferences == 0, "modifications : " + std::to_string(nbDifferences) + " réponses différentes sur "
+            + std::to_string(nbRayons) + " rayons");
+    for (ShapeHandle h : handles)
+        sc.removeShape(h);
+    sc.updateBvh(1);
+}
+
+int main() {
+    Scene sc(cameraDemo(), sourceDemo());
+    MaterialHandle mat = sc.addMaterial(Material(0.5, 0.5, 0.5, 0));
+    testBoiteOrientee(sc, mat);
+    testHandles(sc, mat);
+    testModificationsAleatoires(sc, mat);
+
+    if (nbEchecs == 0)
+        std::cout << "scene_edit_test : tous les cas passent" << std::endl;
+    return nbEchecs == 0 ? 0 : 1;
+}
@@ -0,0 +1,385 @@
+/**
+ * @file texture.cpp
+ * @brief Implémentation de la classe TextureCache
+ */
+
+#include "texture.h"
+#include "alloctracker.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const int T = TextureCache::TILE_SIZE;
+const std::size_t OCTETS_TUILE = std::size_t(T) * T * 3;
+const std::size_t DEBUT_TUILES = 4096;      // Les tuiles commencent à la première page après l'en-tête
+const char MAGIQUE_TEXTURE[8] = "RTTEX";
+const uint32_t VERSION_TEXTURE = 1;
+const int BITS_TUILE = 20;                  // Bits de chaque coordonnée de tuile dans les clés du cache
+
+/**
+ * @brief En-tête du fichier tuilé : dimensions du niveau 0 et identification de la source
+ */
+struct EnTeteTexture {
+    char magic[8];
+    uint32_t version, tileSize, width, height;
+    uint64_t sourceSize;
+    int64_t sourceTime;     // Date de modification de la source (ns)
+};
+
+static int64_t dateModification(const struct stat& st) {
+    return int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+/**
+ * @brief Position dans le fichier du texel (x, y) d'un niveau : les texels sont rangés
+ * par tuiles, chaque tuile ligne par ligne
+ */
+static inline std::size_t adresseTexel(const TextureCache::Level& l, int x, int y) {
+    return l.offset + ((std::size_t(y / T) * l.tilesX + x / T) * T * T + std::size_t(y % T) * T + x % T) * 3;
+}
+
+/**
+ * @brief Rend au système les pages entièrement comprises dans [begin, end[ d'une
+ * projection, après les avoir écrites sur le disque si ecrit
+ */
+static void libere(unsigned char* data, std::size_t begin, std::size_t end, bool ecrit) {
+    std::size_t page = sysconf(_SC_PAGESIZE);
+    begin = (begin + page - 1) / page * page;
+    end = end / page * page;
+    if (end <= begin)
+        return;
+    if (ecrit)
+        msync(data + begin, end - begin, MS_ASYNC);
+    madvise(data + begin, end - begin, MADV_DONTNEED);
+}
+
+/**
+ * @brief Pyramide des niveaux de mip-map d'une image width x height (jusqu'à 1x1)
+ * et taille totale du fichier tuilé
+ */
+static std::size_t niveaux(int width, int height, std::vector<TextureCache::Level>& levels) {
+    levels.clear();
+    std::size_t offset = DEBUT_TUILES;
+    while (true) {
+        TextureCache::Level l = {width, height, (width + T - 1) / T, (height + T - 1) / T, offset};
+        levels.push_back(l);
+        offset += std::size_t(l.tilesX) * l.tilesY * OCTETS_TUILE;
+        if (width == 1 && height == 1)
+            return offset;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+}
+
+/**
+ * @brief Lit un entier de l'en-tête d'un PPM (en sautant blancs et commentaires)
+ */
+static bool lisEntier(const unsigned char* data, std::size_t size, std::size_t& k, int& valeur) {
+    while (k < size && (std::isspace(data[k]) || data[k] == '#')) {
+        if (data[k] == '#')
+            while (k < size && data[k] != '\n')
+                k++;
+        else
+            k++;
+    }
+    if (k >= size || !std::isdigit(data[k]))
+        return false;
+    long v = 0;
+    while (k < size && std::isdigit(data[k]) && v <= (1 << 30))
+        v = v * 10 + (data[k++] - '0');
+    valeur = v;
+    return v > 0 && v <= (1 << 30);
+}
+
+/**
+ * @brief Convertit une image PPM en fichier tuilé et mip-mappé. Les deux fichiers sont
+ * projetés en mémoire et parcourus par rangées de tuiles, dont les pages sont rendues au
+ * système au fur et à mesure : la mémoire utilisée ne dépend pas de la taille de l'image
+ */
+static void convertit(const std::string& source, const std::string& tiled, const struct stat& st) {
+    int fd = open(source.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Texture illisible : " + source);
+    std::size_t taille = st.st_size;
+    void* p = (taille > 0) ? mmap(nullptr, taille, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (p == MAP_FAILED)
+        throw std::runtime_error("Texture illisible : " + source);
+    unsigned char* src = static_cast<unsigned char*>(p);
+    madvise(src, taille, MADV_SEQUENTIAL);
+
+    // En-tête P6 largeur hauteur 255
+    std::size_t k = 2;
+    int width, height, maxval;
+    if (taille < 2 || src[0] != 'P' || src[1] != '6' || !lisEntier(src, taille, k, width)
+        || !lisEntier(src, taille, k, height) || !lisEntier(src, taille, k, maxval) || maxval != 255
+        || k >= taille || width / T >= (1 << BITS_TUILE) || height / T >= (1 << BITS_TUILE)
+        || taille - k - 1 < std::size_t(width) * height * 3) {
+        munmap(src, taille);
+        throw std::runtime_error("Texture au format non reconnu (PPM binaire 8 bits attendu) : " + source);
+    }
+    const unsigned char* pixels = src + k + 1;
+    std::size_t debutPixels = k + 1;
+
+    std::vector<TextureCache::Level> levels;
+    std::size_t tailleTiled = niveaux(width, height, levels);
+    std::string temporaire = tiled + ".tmp";
+    int out = open(temporaire.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (out < 0 || ftruncate(out, tailleTiled) != 0) {
+        if (out >= 0)
+            close(out);
+        munmap(src, taille);
+        throw std::runtime_error("Impossible de créer la texture tuilée " + temporaire);
+    }
+    p = mmap(nullptr, tailleTiled, PROT_READ | PROT_WRITE, MAP_SHARED, out, 0);
+    close(out);
+    if (p == MAP_FAILED) {
+        munmap(src, taille);
+        throw std::runtime_error("La projection en mémoire de " + temporaire + " a échoué");
+    }
+    unsigned char* dst = static_cast<unsigned char*>(p);
+
+    // Niveau 0 : copie de l'image, les tuiles du bord sont complétées en répétant le bord
+    const TextureCache::Level& l0 = levels[0];
+    for (int ty = 0; ty < l0.tilesY; ty++) {
+        for (int y = ty * T; y < (ty + 1) * T; y++) {
+            const unsigned char* ligne = pixels + std::size_t(std::min(y, height - 1)) * width * 3;
+            for (int x = 0; x < l0.tilesX * T; x++)
+                std::memcpy(dst + adresseTexel(l0, x, y), ligne + std::size_t(std::min(x, width - 1)) * 3, 3);
+        }
+        std::size_t rangee = std::size_t(l0.tilesX) * OCTETS_TUILE;
+        libere(dst, l0.offset + ty * rangee, l0.offset + (ty + 1) * rangee, true);
+        libere(src, debutPixels + std::size_t(ty) * T * width * 3,
+               debutPixels + std::size_t(std::min(height, (ty + 1) * T)) * width * 3, false);
+    }
+    munmap(src, taille);
+
+    // Niveaux suivants : moyenne de 2x2 texels du niveau précédent
+    for (std::size_t n = 1; n < levels.size(); n++) {
+        const TextureCache::Level& l = levels[n];
+        const TextureCache::Level& prec = levels[n - 1];
+        for (int ty = 0; ty < l.tilesY; ty++) {
+            for (int y = ty * T; y < (ty + 1) * T; y++) {
+                int y0 = std::min(2 * std::min(y, l.height - 1), prec.height - 1);
+                int y1 = std::min(y0 + 1, prec.height - 1);
+                for (int x = 0; x < l.tilesX * T; x++) {
+                    int x0 = std::min(2 * std::min(x, l.width - 1), prec.width - 1);
+                    int x1 = std::min(x0 + 1, prec.width - 1);
+                    unsigned char* t = dst + adresseTexel(l, x, y);
+                    for (int c = 0; c < 3; c++) {
+                        int somme = dst[adresseTexel(prec, x0, y0) + c] + dst[adresseTexel(prec, x1, y0) + c]
+                                  + dst[adresseTexel(prec, x0, y1) + c] + dst[adresseTexel(prec, x1, y1) + c];
+                        t[c] = (somme + 2) / 4;
+                    }
+                }
+            }
+            std::size_t rangee = std::size_t(l.tilesX) * OCTETS_TUILE;
+            libere(dst, l.offset + ty * rangee, l.offset + (ty + 1) * rangee, true);
+            std::size_t rangeePrec = std::size_t(prec.tilesX) * OCTETS_TUILE;
+            libere(dst, prec.offset + std::size_t(2 * ty) * rangeePrec,
+                   prec.offset + std::size_t(std::min(prec.tilesY, 2 * ty + 2)) * rangeePrec, false);
+        }
+    }
+
+    EnTeteTexture e;
+    std::memset(&e, 0, sizeof(e));
+    std::memcpy(e.magic, MAGIQUE_TEXTURE, sizeof(MAGIQUE_TEXTURE));
+    e.version = VERSION_TEXTURE;
+    e.tileSize = T;
+    e.width = width;
+    e.height = height;
+    e.sourceSize = st.st_size;
+    e.sourceTime = dateModification(st);
+    std::memcpy(dst, &e, sizeof(e));
+    msync(dst, tailleTiled, MS_SYNC);
+    munmap(dst, tailleTiled);
+    if (std::rename(temporaire.c_str(), tiled.c_str()) != 0)
+        throw std::runtime_error("Impossible de renommer la texture tuilée " + temporaire);
+}
+
+/**
+ * @brief Ouvre le fichier tuilé s'il correspond à la source, retourne -1 sinon
+ */
+static int ouvreTiled(const std::string& tiled, const struct stat& st, std::vector<TextureCache::Level>& levels) {
+    int fd = open(tiled.c_str(), O_RDONLY);
+    if (fd < 0)
+        return -1;
+    EnTeteTexture e;
+    struct stat stTiled;
+    if (pread(fd, &e, sizeof(e), 0) == ssize_t(sizeof(e)) && fstat(fd, &stTiled) == 0
+        && std::memcmp(e.magic, MAGIQUE_TEXTURE, sizeof(MAGIQUE_TEXTURE)) == 0 && e.version == VERSION_TEXTURE
+        && e.tileSize == uint32_t(T) && e.sourceSize == uint64_t(st.st_size) && e.sourceTime == dateModification(st)
+        && e.width > 0 && e.height > 0 && e.width / T < (1u << BITS_TUILE) && e.height / T < (1u << BITS_TUILE)
+        && niveaux(e.width, e.height, levels) == std::size_t(stTiled.st_size))
+        return fd;
+    close(fd);
+    return -1;
+}
+
+TextureCache::TextureCache(std::size_t capacity) : _capacity(capacity), _hits(0), _misses(0) {
+}
+
+TextureCache::~TextureCache() {
+    for (Texture& t : _textures)
+        close(t.fd);
+}
+
+TextureHandle TextureCache::addTexture(const std::string& filename) {
+    if (_textures.size() >= (std::size_t(1) << 16))
+        throw std::runtime_error("Trop de textures");
+    struct stat st;
+    if (stat(filename.c_str(), &st) != 0)
+        throw std::runtime_error("Texture introuvable : " + filename);
+
+    // Le fichier tuilé est rangé à côté de la source et refait si elle a changé
+    std::string tiled = filename + ".tex";
+    Texture t = {filename, -1, {}};
+    t.fd = ouvreTiled(tiled, st, t.levels);
+    if (t.fd < 0) {
+        convertit(filename, tiled, st);
+        t.fd = ouvreTiled(tiled, st, t.levels);
+        if (t.fd < 0)
+            throw std::runtime_error("Texture tuilée invalide : " + tiled);
+    }
+    _textures.push_back(t);
+    return _textures.size() - 1;
+}
+
+void TextureCache::setCapacity(std::size_t capacity) {
+    _capacity = capacity;
+    for (Shard& shard : _shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        evict(shard, capacity / NB_SHARDS);
+    }
+}
+
+std::size_t TextureCache::getResidentBytes() const {
+    std::size_t total = 0;
+    for (Shard& shard : _shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.bytes;
+    }
+    return total;
+}
+
+void TextureCache::evict(Shard& shard, std::size_t capacity) const {
+    // On garde au moins la tuile la plus récente, quelle que soit la capacité
+    while (shard.bytes > capacity && shard.lru.size() > 1) {
+        shard.tiles.erase(shard.lru.back());
+        shard.lru.pop_back();
+        shard.bytes -= sizeof(Tile);
+    }
+}
+
+TextureCache::TilePtr TextureCache::getTile(TextureHandle h, int level, int tx, int ty) const {
+    uint64_t cle = (uint64_t(h) << 48) | (uint64_t(level) << (2 * BITS_TUILE)) | (uint64_t(ty) << BITS_TUILE) | uint64_t(tx);
+    Shard& shard = _shards[(cle * 0x9E3779B97F4A7C15ull) >> 60];
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.tiles.find(cle);
+        if (it != shard.tiles.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second.second);
+            _hits++;
+            return it->second.first;
+        }
+    }
+
+    // Lecture hors verrou : les autres threads continuent d'utiliser le cache. Ses
+    // allocations (tuile, entrées de l'index) sont bornées par la capacité du cache
+    ColdPathScope remplissage;
+    const Texture& t = _textures[h];
+    const Level& l = t.levels[level];
+    std::shared_ptr<Tile> tuile = std::make_shared<Tile>();
+    std::size_t offset = l.offset + (std::size_t(ty) * l.tilesX + tx) * OCTETS_TUILE;
+    if (pread(t.fd, tuile->texels, OCTETS_TUILE, offset) != ssize_t(OCTETS_TUILE)) {
+        // Fichier tronqué pendant le rendu : tuile magenta, bien visible
+        static std::once_flag avertissement;
+        std::call_once(avertissement, [&] { std::cerr << "Lecture de la texture " << t.source << " impossible" << std::endl; });
+        for (std::size_t k = 0; k < OCTETS_TUILE; k += 3) {
+            tuile->texels[k] = 255;
+            tuile->texels[k + 1] = 0;
+            tuile->texels[k + 2] = 255;
+        }
+    }
+    _misses++;
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.tiles.find(cle);
+    if (it != shard.tiles.end()) {
+        // Un autre thread l'a chargée entre-temps
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second.second);
+        return it->second.first;
+    }
+    shard.lru.push_front(cle);
+    shard.tiles.emplace(cle, std::make_pair(TilePtr(tuile), shard.lru.begin()));
+    shard.bytes += sizeof(Tile);
+    evict(shard, _capacity / NB_SHARDS);
+    return tuile;
+}
+
+Vector3f TextureCache::bilinear(TextureHandle h, int level, Real u, Real v) const {
+    const Level& l = _textures[h].levels[level];
+    Real x = (u - std::floor(u)) * l.width - Real(0.5);
+    Real y = (v - std::floor(v)) * l.height - Real(0.5);
+    int x0 = std::floor(x), y0 = std::floor(y);
+    Real fx = x - x0, fy = y - y0;
+
+    // Les quatre texels sont presque toujours dans la même tuile : on la garde
+    TilePtr tuile;
+    int tuileX = -1, tuileY = -1;
+    auto texel = [&](int tx, int ty) {
+        tx = (tx % l.width + l.width) % l.width;
+        ty = (ty % l.height + l.height) % l.height;
+        if (tx / T != tuileX || ty / T != tuileY) {
+            tuileX = tx / T;
+            tuileY = ty / T;
+            tuile = getTile(h, level, tuileX, tuileY);
+        }
+        const unsigned char* c = tuile->texels + (std::size_t(ty % T) * T + tx % T) * 3;
+        return Vector3f(c[0], c[1], c[2]);
+    };
+    Vector3f haut = texel(x0, y0) * (1 - fx) + texel(x0 + 1, y0) * fx;
+    Vector3f bas = texel(x0, y0 + 1) * (1 - fx) + texel(x0 + 1, y0 + 1) * fx;
+    return haut * (1 - fy) + bas * fy;
+}
+
+Vector3f TextureCache::sample(TextureHandle h, Real u, Real v, Real footprint) const {
+    const Texture& t = _textures[h];
+    int nbLevels = t.levels.size();
+    if (!std::isfinite(u) || !std::isfinite(v))
+        u = v = 0;
+    // Niveau où l'empreinte couvre un texel
+    Real lod = 0;
+    if (footprint > 0)
+        lod = std::log2(footprint * std::max(t.levels[0].width, t.levels[0].height));
+    lod = std::min(std::max(lod, Real(0)), Real(nbLevels - 1));
+    int l0 = lod;
+    Real f = lod - l0;
+    Vector3f couleur = bilinear(h, l0, u, v);
+    if (f > 0 && l0 + 1 < nbLevels)
+        couleur = couleur * (1 - f) + bilinear(h, l0 + 1, u, v) * f;
+    return couleur;
+}
+
+Material MaterialTable::resolve(MaterialHandle h, Real u, Real v, Real footprint) const {
+    const Material& mat = materials[h];
+    if (textures[h] == -1)
+        return mat;
+    Vector3f texel = cache.sample(textures[h], u, v, footprint) / 255;
+    return Material(mat.getR() * texel.getX(), mat.getG() * texel.getY(), mat.getB() * texel.getZ(), mat.getShininess());
+}
+
+Vector3f textureCoordinates(const Shape& shape, const Vector3f& point, const Vector3f& direction, const Vector3f& normal, Real coneWidth) {
+    SurfaceUV uv = shape.getUV(point);
+    // Une surface rasante étire l'empreinte (bornée pour les incidences presque tangentes)
+    Real cosinus = std::max(std::abs(direction.dot(normal)), Real(0.05));
+    return Vector3f(uv.u, uv.v, coneWidth * uv.scale / cosinus);
+}
@@ -0,0 +1,194 @@
+/**
+ * @file texture.h
+ * @brief Création de la classe TextureCache (textures tuilées et mip-mappées)
+ */
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include "material.h"
+#include "shape.h"
+#include "vector3f.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Identifiant (indice) d'une texture d'un TextureCache, -1 pour aucune texture
+ */
+typedef int TextureHandle;
+
+/**
+ * @brief Cache des textures de la scène. Chaque image source (PPM binaire) est convertie
+ * une fois pour toutes en un fichier tuilé et mip-mappé (source.ppm.tex, refait si la
+ * source change) ; les tuiles ne sont lues sur le disque qu'à leur premier accès et
+ * gardées dans un cache LRU de taille bornée, partagé par tous les threads de rendu.
+ * La mémoire utilisée ne dépend donc que de la capacité du cache, quelle que soit la
+ * taille des images référencées
+ *
+ */
+class TextureCache {
+
+    public:
+        /**
+         * @brief Côté des tuiles en texels (une tuile RGB de 64x64 occupe 12 Ko, soit 3 pages)
+         */
+        static const int TILE_SIZE = 64;
+
+        /**
+         * @brief Construit un cache vide
+         *
+         * @param capacity taille maximale des tuiles en mémoire, en octets
+         */
+        explicit TextureCache(std::size_t capacity = std::size_t(64) << 20);
+
+        /**
+         * @brief Ferme les fichiers tuilés
+         */
+        ~TextureCache();
+
+        TextureCache(const TextureCache&) = delete;
+        TextureCache& operator=(const TextureCache&) = delete;
+
+        /**
+         * @brief Ajoute une texture : prépare son fichier tuilé (conversion de l'image par
+         * bandes si elle est absente ou périmée) sans lire aucune tuile. Lève une exception
+         * si l'image est illisible
+         *
+         * @param filename image PPM binaire (P6, 255)
+         * @return TextureHandle
+         */
+        TextureHandle addTexture(const std::string& filename);
+
+        /**
+         * @brief Couleur filtrée (trilinéaire) de la texture en (u, v), avec répétition.
+         * Le niveau de mip-map est choisi pour que footprint, la largeur de l'empreinte du
+         * pixel en unités de texture, couvre environ un texel
+         *
+         * @param h
+         * @param u
+         * @param v
+         * @param footprint
+         * @return Vector3f couleur (composantes entre 0 et 255)
+         */
+        Vector3f sample(TextureHandle h, Real u, Real v, Real footprint) const;
+
+        /**
+         * @brief Modifie la capacité du cache (les tuiles en trop sont libérées)
+         *
+         * @param capacity en octets
+         */
+        void setCapacity(std::size_t capacity);
+
+        inline std::size_t getCapacity() const {return _capacity;};
+        inline int getNbTextures() const {return _textures.size();};
+        inline const std::string& getFilename(TextureHandle h) const {return _textures[h].source;};
+        inline int getWidth(TextureHandle h) const {return _textures[h].levels[0].width;};
+        inline int getHeight(TextureHandle h) const {return _textures[h].levels[0].height;};
+        inline int getNbLevels(TextureHandle h) const {return _textures[h].levels.size();};
+
+        /**
+         * @brief Statistiques du cache : octets des tuiles en mémoire, accès servis par
+         * le cache et tuiles lues sur le disque
+         */
+        std::size_t getResidentBytes() const;
+        inline uint64_t getHits() const {return _hits;};
+        inline uint64_t getMisses() const {return _misses;};
+
+        /**
+         * @brief Niveau de mip-map : dimensions, nombre de tuiles et position dans le fichier
+         */
+        struct Level {
+            int width, height, tilesX, tilesY;
+            uint64_t offset;
+        };
+
+    private:
+        struct Texture {
+            std::string source;
+            int fd;
+            std::vector<Level> levels;
+        };
+
+        struct Tile {
+            unsigned char texels[TILE_SIZE * TILE_SIZE * 3];
+        };
+        typedef std::shared_ptr<const Tile> TilePtr;    // Une tuile évincée reste valide pour ses lecteurs
+
+        /**
+         * @brief Partie du cache protégée par son propre verrou (les tuiles y sont réparties
+         * par clé pour limiter l'attente entre threads)
+         */
+        struct Shard {
+            std::mutex mutex;
+            std::list<uint64_t> lru;    // Clés, de la plus récemment utilisée à la plus ancienne
+            std::unordered_map<uint64_t, std::pair<TilePtr, std::list<uint64_t>::iterator>> tiles;
+            std::size_t bytes = 0;
+        };
+        static const int NB_SHARDS = 16;
+
+        std::vector<Texture> _textures;
+        std::atomic<std::size_t> _capacity;
+        mutable Shard _shards[NB_SHARDS];
+        mutable std::atomic<uint64_t> _hits, _misses;
+
+        TilePtr getTile(TextureHandle h, int level, int tx, int ty) const;
+        Vector3f bilinear(TextureHandle h, int level, Real u, Real v) const;
+        void evict(Shard& shard, std::size_t capacity) const;
+};
+
+/**
+ * @brief Matériaux tels que les voit l'ombrage : la table de la scène, la texture de chaque
+ * matériau (-1 si aucune) et le cache des tuiles
+ */
+struct MaterialTable {
+    const std::vector<Material>& materials;
+    const std::vector<TextureHandle>& textures;
+    const TextureCache& cache;
+
+    inline const Material& operator[](MaterialHandle h) const {return materials[h];};
+    inline bool isTextured(MaterialHandle h) const {return textures[h] != -1;};
+
+    /**
+     * @brief Matériau h au point de coordonnées (u, v) : sa couleur est modulée par celle
+     * de sa texture (une texture blanche la laisse inchangée)
+     *
+     * @param h
+     * @param u
+     * @param v
+     * @param footprint largeur de l'empreinte du pixel en unités de texture
+     * @return Material
+     */
+    Material resolve(MaterialHandle h, Real u, Real v, Real footprint) const;
+};
+
+/**
+ * @brief Cône de rayon : largeur à l'origine du rayon et angle d'ouverture (différentielles
+ * de rayon isotropes). Sa largeur au point d'impact donne l'empreinte du pixel
+ */
+struct RayCone {
+    Real width, spread;
+
+    inline RayCone propagate(Real t) const {return {width + spread * t, spread};};
+};
+
+/**
+ * @brief Coordonnées de texture du point d'impact et empreinte du pixel en unités de
+ * texture, déduite de la largeur du cône de rayon (différentielles de rayon isotropes)
+ * et de l'inclinaison de la surface
+ *
+ * @param shape objet touché
+ * @param point point d'impact
+ * @param direction direction du rayon
+ * @param normal normale au point d'impact
+ * @param coneWidth largeur du cône du rayon au point d'impact
+ * @return Vector3f (u, v, empreinte)
+ */
+Vector3f textureCoordinates(const Shape& shape, const Vector3f& point, const Vector3f& direction, const Vector3f& normal, Real coneWidth);
+
+#endif
@@ -0,0 +1,126 @@
+/**
+ * @file tileculling.cpp
+ * @brief Implémentation de la classe TileCulling
+ */
+
+#include "tileculling.h"
+#include "parallel.h"
+#include <algorithm>
+
+// Marge (en pixels virtuels) autour des tuiles : couvre le décalage des échantillons
+// du tracé de chemins dans chaque pixel
+const float MARGE_TUILE = 0.5;
+
+/**
+ * @brief Vrai si la boîte [bmin, bmax] est entièrement à l'extérieur d'un des plans
+ * (passant par eye, de normales orientées vers l'intérieur)
+ */
+static inline bool dehorsPyramide(const Vector3f normales[4], const Vector3f& eye, const Real bmin[3], const Real bmax[3]) {
+    for (int p = 0; p < 4; p++) {
+        const Vector3f& n = normales[p];
+        Vector3f positif(n[0] >= 0 ? bmax[0] : bmin[0], n[1] >= 0 ? bmax[1] : bmin[1], n[2] >= 0 ? bmax[2] : bmin[2]);
+        if (n.dot(positif - eye) < 0)
+            return true;
+    }
+    return false;
+}
+
+std::vector<Aabb> TileCulling::shapeBounds(const std::vector<Shape*>& shapes, int nbThreads) {
+    int nbShapes = shapes.size();
+    std::vector<Aabb> bounds(nbShapes);
+    const int BLOC = 4096;
+    parallelFor((nbShapes + BLOC - 1) / BLOC, nbThreads, [&](int b) {
+        for (int k = b * BLOC; k < std::min(nbShapes, (b + 1) * BLOC); k++)
+            bounds[k] = shapes[k]->getBounds();
+    });
+    return bounds;
+}
+
+TileCulling::TileCulling(const Camera& camera, const std::vector<Shape*>& shapes, const Bvh& bvh, int width, int height,
+                         int nbThreads, int tileSize)
+    : TileCulling(camera, shapeBounds(shapes, nbThreads), bvh, width, height, 0, height, nbThreads, tileSize) {}
+
+TileCulling::TileCulling(const Camera& camera, const std::vector<Aabb>& bounds, const Bvh& bvh, int width, int height,
+                         int y0, int rows, int nbThreads, int tileSize)
+    : _tileSize(tileSize), _tilesX((width + tileSize - 1) / tileSize),
+      _tilesY(rows > 0 ? (y0 + rows - 1) / tileSize - y0 / tileSize + 1 : 0), _firstTileY(y0 / tileSize) {
+    int nbShapes = bounds.size();
+    // Une hiérarchie en attente de mise à jour ne contient pas tous les objets : on les
+    // teste alors tous
+    bool parcours = bvh.isBuilt() && !bvh.hasPendingEdits();
+
+    const Vector3f& eye = camera.getPos();
+    std::vector<std::vector<int>> parTuile(_tilesX * _tilesY);
+    parallelFor(_tilesY, nbThreads, [&](int t) {
+        int ty = _firstTileY + t;
+        std::vector<int> pile;
+        for (int tx = 0; tx < _tilesX; tx++) {
+            // Coins de la tuile dans les coordonnées de Camera::getRay (comme Scene::tracePixel)
+            Real u0 = tx * tileSize - width/2 - MARGE_TUILE;
+            Real u1 = std::min((tx + 1) * tileSize, width) - 1 - width/2 + MARGE_TUILE;
+            Real v0 = ty * tileSize - height/2 - MARGE_TUILE;
+            Real v1 = std::min((ty + 1) * tileSize, height) - 1 - height/2 + MARGE_TUILE;
+            Vector3f d00 = camera.getRay(u0, v0).getDirection();
+            Vector3f d10 = camera.getRay(u1, v0).getDirection();
+            Vector3f d11 = camera.getRay(u1, v1).getDirection();
+            Vector3f d01 = camera.getRay(u0, v1).getDirection();
+            Vector3f milieu = camera.getRay((u0 + u1) / 2, (v0 + v1) / 2).getDirection();
+
+            // Normales des 4 plans latéraux, orientées vers l'intérieur de la pyramide
+            Vector3f normales[4] = {d00.cross(d10), d10.cross(d11), d11.cross(d01), d01.cross(d00)};
+            for (Vector3f& n : normales)
+                if (n.dot(milieu) < 0)
+                    n = n * -1;
+
+            std::vector<int>& liste = parTuile[t * _tilesX + tx];
+            auto candidat = [&](int k) {
+                Vector3f bmin = bounds[k].getMin(), bmax = bounds[k].getMax();
+                Real mn[3] = {bmin[0], bmin[1], bmin[2]}, mx[3] = {bmax[0], bmax[1], bmax[2]};
+                if (!dehorsPyramide(normales, eye, mn, mx))
+                    liste.push_back(k);
+            };
+            if (!parcours) {
+                for (int k = 0; k < nbShapes; k++)
+                    candidat(k);
+                continue;
+            }
+            // Parcours de la hiérarchie : les sous-arbres dont la boîte est hors de la
+            // pyramide sont écartés d'un test, les objets des feuilles atteintes sont testés
+            // un à un (mêmes candidats que le test de tous les objets)
+            const BvhNode* noeuds = bvh.getNodes();
+            const int32_t* indices = bvh.getIndices();
+            pile.assign(1, 0);
+            while (!pile.empty()) {
+                const BvhNode& noeud = noeuds[pile.back()];
+                pile.pop_back();
+                if (dehorsPyramide(normales, eye, noeud.min, noeud.max))
+                    continue;
+                if (noeud.count == 0) {
+                    pile.push_back(noeud.first + 1);
+                    pile.push_back(noeud.first);
+                    continue;
+                }
+                for (int c = noeud.first; c < noeud.first + noeud.count; c++) {
+                    if (indices[c] >= 0 && indices[c] < nbShapes)
+                        candidat(indices[c]);
+                }
+            }
+            // Dans l'ordre des objets, comme sans hiérarchie : à distance égale, le rayon
+            // primaire garde le premier
+            std::sort(liste.begin(), liste.end());
+        }
+    });
+
+    // Mise à plat des listes
+    _offsets.resize(parTuile.size() + 1);
+    _offsets[0] = 0;
+    for (std::size_t t = 0; t < parTuile.size(); t++)
+        _offsets[t + 1] = _offsets[t] + parTuile[t].size();
+    _indices.reserve(_offsets.back());
+    for (const std::vector<int>& liste : parTuile)
+        _indices.insert(_indices.end(), liste.begin(), liste.end());
+}
+
+float TileCulling::getMeanCandidates() const {
+    return _offsets.size() > 1 ? float(_indices.size()) / (_offsets.size() - 1) : 0;
+}
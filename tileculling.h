@@ -0,0 +1,106 @@
+/**
+ * @file tileculling.h
+ * @brief Création de la classe TileCulling (objets candidats de chaque tuile de l'image)
+ */
+#ifndef TILECULLING_H
+#define TILECULLING_H
+
+#include "bvh.h"
+#include "camera.h"
+#include "shape.h"
+#include <vector>
+
+/**
+ * @brief Liste d'indices d'objets (vue sur un tableau qui ne lui appartient pas)
+ */
+struct Candidates {
+    const int* indices;
+    int count;
+};
+
+/**
+ * @brief Pré-passe de tri des rayons primaires : l'image est découpée en tuiles, on
+ * construit la pyramide de vue de chaque tuile (4 plans passant par la caméra) et on
+ * ne garde pour elle que les objets dont la boîte englobante n'est pas entièrement
+ * à l'extérieur. Les rayons primaires d'une tuile ne testent que ces candidats. Chaque
+ * pyramide parcourt la hiérarchie de boîtes de la scène : seuls les objets des feuilles
+ * qu'elle atteint sont testés
+ *
+ */
+class TileCulling {
+
+    public:
+        /**
+         * @brief Taille par défaut des tuiles (en pixels)
+         */
+        static const int TAILLE_TUILE = 16;
+
+        /**
+         * @brief Construit les listes de candidats de toutes les tuiles
+         *
+         * @param camera caméra des rayons primaires
+         * @param shapes objets de la scène
+         * @param bvh hiérarchie des objets (tous les objets sont testés si elle n'est pas
+         * construite ou attend une mise à jour)
+         * @param width largeur de l'image
+         * @param height hauteur de l'image
+         * @param nbThreads nombre de threads (<= 0 : tous les coeurs)
+         * @param tileSize taille des tuiles
+         */
+        TileCulling(const Camera& camera, const std::vector<Shape*>& shapes, const Bvh& bvh, int width, int height,
+                    int nbThreads = 0, int tileSize = TAILLE_TUILE);
+
+        /**
+         * @brief Idem, avec les boîtes englobantes des objets déjà calculées (partagées par
+         * les vues d'un même rendu ou les bandes d'une image), pour les seules tuiles qui
+         * couvrent les lignes [y0, y0+rows[ de l'image (rendu par bandes : la mémoire ne
+         * dépend que de la hauteur de la bande). getCandidates n'accepte alors que les
+         * pixels de ces lignes
+         *
+         * @param bounds boîte de chaque objet, dans l'ordre de la scène (voir shapeBounds)
+         * @param y0 première ligne (0 pour toute l'image)
+         * @param rows nombre de lignes (height pour toute l'image)
+         */
+        TileCulling(const Camera& camera, const std::vector<Aabb>& bounds, const Bvh& bvh, int width, int height,
+                    int y0, int rows, int nbThreads = 0, int tileSize = TAILLE_TUILE);
+
+        /**
+         * @brief Boîtes englobantes des objets, calculées en parallèle
+         *
+         * @param shapes
+         * @param nbThreads nombre de threads (<= 0 : tous les coeurs)
+         * @return std::vector<Aabb>
+         */
+        static std::vector<Aabb> shapeBounds(const std::vector<Shape*>& shapes, int nbThreads = 0);
+
+        /**
+         * @brief Retourne les objets candidats pour les rayons primaires du pixel (i,j)
+         *
+         * @param i
+         * @param j
+         * @return Candidates
+         */
+        inline Candidates getCandidates(int i, int j) const {
+            int tile = (j / _tileSize - _firstTileY) * _tilesX + i / _tileSize;
+            return {_indices.data() + _offsets[tile], _offsets[tile + 1] - _offsets[tile]};
+        }
+
+        /**
+         * @brief Retourne le nombre moyen de candidats par tuile
+         *
+         * @return float
+         */
+        float getMeanCandidates() const;
+
+    private:
+        int _tileSize, _tilesX, _tilesY;
+        int _firstTileY;    // Première ligne de tuiles couverte
+
+        /**
+         * @brief Listes compactes : les candidats de la tuile t sont
+         * _indices[_offsets[t]] à _indices[_offsets[t+1]-1]
+         */
+        std::vector<int> _offsets, _indices;
+};
+
+#endif
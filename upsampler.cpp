@@ -0,0 +1,129 @@
+/**
+ * @file upsampler.cpp
+ * @brief Implémentation de la reconstruction des pixels non tracés
+ */
+
+#include "upsampler.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+
+const float SIGMA_PROFONDEUR = 0.05;  // Ecart relatif de profondeur toléré entre un voisin et la référence
+
+/**
+ * @brief Voisin tracé d'un pixel reconstruit
+ */
+struct Voisin {
+    std::size_t k;      // Indice du voisin
+    float poids;        // Poids bilinéaire
+};
+
+/**
+ * @brief Voisins tracés du pixel (i, j), de poids non nul
+ *
+ * @return int nombre de voisins (au plus 4)
+ */
+static int voisins(const Framebuffer& fb, SamplingMode mode, int i, int j, Voisin* v) {
+    int width = fb.getWidth(), height = fb.getHeight();
+    int n = 0;
+    if (mode == SAMPLING_CHECKERBOARD) {
+        const int di[4] = {-1, 1, 0, 0}, dj[4] = {0, 0, -1, 1};
+        for (int d = 0; d < 4; d++) {
+            int x = i + di[d], y = j + dj[d];
+            if (x >= 0 && x < width && y >= 0 && y < height)
+                v[n++] = {std::size_t(y) * width + x, 1};
+        }
+        return n;
+    }
+    // Coins de la case de la grille tracée (pas s) qui contient le pixel ; au bord droit
+    // ou bas de l'image, le coin manquant est remplacé par le coin tracé le plus proche
+    int s = (mode == SAMPLING_HALF) ? 2 : 4;
+    int x0 = i - i % s, y0 = j - j % s;
+    int x1 = (x0 + s < width) ? x0 + s : x0, y1 = (y0 + s < height) ? y0 + s : y0;
+    float fx = (x1 == x0) ? 0 : float(i - x0) / s, fy = (y1 == y0) ? 0 : float(j - y0) / s;
+    const int xs[4] = {x0, x1, x0, x1}, ys[4] = {y0, y0, y1, y1};
+    const float ws[4] = {(1 - fx) * (1 - fy), fx * (1 - fy), (1 - fx) * fy, fx * fy};
+    for (int c = 0; c < 4; c++) {
+        if (ws[c] > 0)
+            v[n++] = {std::size_t(ys[c]) * width + xs[c], ws[c]};
+    }
+    return n;
+}
+
+/**
+ * @brief Reconstruit le pixel k à partir de ses voisins tracés
+ */
+static void reconstruit(Framebuffer& fb, std::size_t k, const Voisin* v, int n) {
+    // Objet de référence : le plus représenté (somme des poids), le plus proche à égalité
+    int objet = fb.shape[v[0].k];
+    float meilleur = -1, profondeurMin = 0;
+    for (int a = 0; a < n; a++) {
+        int o = fb.shape[v[a].k];
+        float somme = 0, zMin = Framebuffer::PROFONDEUR_FOND;
+        for (int b = 0; b < n; b++) {
+            if (fb.shape[v[b].k] == o) {
+                somme += v[b].poids;
+                zMin = std::min(zMin, fb.depth[v[b].k]);
+            }
+        }
+        if (somme > meilleur || (somme == meilleur && zMin < profondeurMin)) {
+            objet = o;
+            meilleur = somme;
+            profondeurMin = zMin;
+        }
+    }
+
+    // Profondeur de référence : celle du voisin de l'objet de plus grand poids
+    int ref = -1;
+    for (int a = 0; a < n; a++) {
+        if (fb.shape[v[a].k] == objet && (ref == -1 || v[a].poids > v[ref].poids))
+            ref = a;
+    }
+    float zRef = fb.depth[v[ref].k];
+    float kz = 1 / (SIGMA_PROFONDEUR * SIGMA_PROFONDEUR * std::max(zRef * zRef, 1e-12f));
+
+    float w[4], somme = 0;
+    for (int a = 0; a < n; a++) {
+        w[a] = 0;
+        if (fb.shape[v[a].k] != objet)
+            continue;
+        float dz = fb.depth[v[a].k] - zRef;
+        w[a] = v[a].poids * std::exp(-dz * dz * kz);
+        somme += w[a];
+    }
+    std::vector<float> Framebuffer::* plans[] = {&Framebuffer::r, &Framebuffer::g, &Framebuffer::b,
+                                                 &Framebuffer::albedoR, &Framebuffer::albedoG, &Framebuffer::albedoB,
+                                                 &Framebuffer::normalX, &Framebuffer::normalY, &Framebuffer::normalZ,
+                                                 &Framebuffer::depth, &Framebuffer::variance};
+    for (auto plan : plans) {
+        std::vector<float>& p = fb.*plan;
+        float valeur = 0;
+        for (int a = 0; a < n; a++)
+            valeur += w[a] * p[v[a].k];
+        p[k] = valeur / somme;
+    }
+    float norme = std::sqrt(fb.normalX[k] * fb.normalX[k] + fb.normalY[k] * fb.normalY[k] + fb.normalZ[k] * fb.normalZ[k]);
+    if (norme > 0) {
+        fb.normalX[k] /= norme;
+        fb.normalY[k] /= norme;
+        fb.normalZ[k] /= norme;
+    }
+    fb.shape[k] = objet;
+}
+
+void upsample(Framebuffer& fb, SamplingMode mode, int nbThreads) {
+    if (mode == SAMPLING_FULL)
+        return;
+    int width = fb.getWidth();
+    // Les pixels reconstruits ne lisent que des pixels tracés : les lignes sont indépendantes
+    parallelFor(fb.getHeight(), nbThreads, [&](int j) {
+        Voisin v[4];
+        for (int i = 0; i < width; i++) {
+            if (isTracedPixel(mode, i, j))
+                continue;
+            int n = voisins(fb, mode, i, j, v);
+            if (n > 0)
+                reconstruit(fb, std::size_t(j) * width + i, v, n);
+        }
+    });
+}
@@ -0,0 +1,52 @@
+/**
+ * @file upsampler.h
+ * @brief Rendu d'une partie des pixels et reconstruction des autres
+ */
+#ifndef UPSAMPLER_H
+#define UPSAMPLER_H
+
+#include "framebuffer.h"
+
+/**
+ * @brief Pixels tracés d'une image (prévisualisations, vignettes) :
+ * - SAMPLING_FULL : tous ;
+ * - SAMPLING_CHECKERBOARD : un sur deux, en damier (i + j pair), pour un rendu 2 fois plus rapide ;
+ * - SAMPLING_HALF : un sur deux dans chaque direction (demi-résolution, 4 fois moins de rayons) ;
+ * - SAMPLING_QUARTER : un sur quatre dans chaque direction (quart de résolution, 16 fois moins).
+ * Les autres pixels sont reconstruits par upsample
+ */
+enum SamplingMode { SAMPLING_FULL, SAMPLING_CHECKERBOARD, SAMPLING_HALF, SAMPLING_QUARTER };
+
+/**
+ * @brief Indique si le pixel (i, j) est tracé
+ *
+ * @param mode
+ * @param i
+ * @param j
+ * @return true si le pixel est tracé, false s'il est reconstruit
+ */
+inline bool isTracedPixel(SamplingMode mode, int i, int j) {
+    switch (mode) {
+        case SAMPLING_CHECKERBOARD: return ((i + j) & 1) == 0;
+        case SAMPLING_HALF: return ((i | j) & 1) == 0;
+        case SAMPLING_QUARTER: return ((i | j) & 3) == 0;
+        default: return true;
+    }
+}
+
+/**
+ * @brief Reconstruit les pixels non tracés à partir de leurs voisins tracés (les 4 voisins
+ * directs en damier, les 4 coins de la case de la grille tracée sinon, pondérés
+ * bilinéairement). Le filtre respecte les bords : le pixel prend l'objet le plus
+ * représenté parmi ses voisins (le plus proche en cas d'égalité), et seuls les voisins
+ * de cet objet à une profondeur voisine y contribuent, si bien que les contours des
+ * objets restent nets. Tous les plans sont reconstruits (couleur, albédo, normale,
+ * profondeur, objet), ce qui permet de débruiter ensuite l'image
+ *
+ * @param fb image dont les pixels tracés sont remplis (plans auxiliaires et objets compris)
+ * @param mode pixels tracés
+ * @param nbThreads nombre de threads (<= 0 : tous les coeurs)
+ */
+void upsample(Framebuffer& fb, SamplingMode mode, int nbThreads = 0);
+
+#endif
@@ -1,7 +1,7 @@
 /**
  * @file vector3f.cpp
  * @author Arthur BABIN
- * @brief Implémentation de la classe Vector3f
+ * @brief Implémentation de la classe Vector3
  * @date Décembre 2022
  */
 
@@ -9,26 +9,37 @@
 #include <stdexcept>
 
 
-Vector3f Vector3f::operator+(const Vector3f& other) const {
-    return Vector3f(x + other.x, y + other.y, z + other.z);
+template <typename T>
+Vector3<T> Vector3<T>::operator+(const Vector3<T>& other) const {
+    return Vector3<T>(x + other.x, y + other.y, z + other.z);
 }
 
 
-Vector3f Vector3f::operator-(const Vector3f& other) const {
-    return Vector3f(x - other.x, y - other.y, z - other.z);
+template <typename T>
+Vector3<T> Vector3<T>::operator-(const Vector3<T>& other) const {
+    return Vector3<T>(x - other.x, y - other.y, z - other.z);
 }
 
 
-Vector3f Vector3f::operator*(float scalar) const {
-    return Vector3f(x * scalar, y * scalar, z * scalar);
+template <typename T>
+Vector3<T> Vector3<T>::operator*(T scalar) const {
+    return Vector3<T>(x * scalar, y * scalar, z * scalar);
 }
 
 
-Vector3f Vector3f::operator/(float scalar) const {
-    return Vector3f(x / scalar, y / scalar, z / scalar);
+template <typename T>
+Vector3<T> Vector3<T>::operator*(const Vector3<T>& other) const {
+    return Vector3<T>(x * other.x, y * other.y, z * other.z);
 }
 
-float Vector3f::operator[](std::size_t index) const {
+
+template <typename T>
+Vector3<T> Vector3<T>::operator/(T scalar) const {
+    return Vector3<T>(x / scalar, y / scalar, z / scalar);
+}
+
+template <typename T>
+T Vector3<T>::operator[](std::size_t index) const {
     switch (index) {
       case 0:
         return x;
@@ -42,22 +53,26 @@ float Vector3f::operator[](std::size_t index) const {
 }
 
 // Produit scalaire
-float Vector3f::dot(Vector3f v) const {
+template <typename T>
+T Vector3<T>::dot(const Vector3<T>& v) const {
     return this->x*v.x + this->y*v.y + this->z*v.z;
 }
 
-float Vector3f::norm() const {
+template <typename T>
+T Vector3<T>::norm() const {
     return std::sqrt(x*x + y*y + z*z);
 }
 
 
-float Vector3f::squaredNorm() const {
+template <typename T>
+T Vector3<T>::squaredNorm() const {
     return x*x + y*y + z*z;
 }
 
 
-void Vector3f::normalize() {
-    float n = norm();
+template <typename T>
+void Vector3<T>::normalize() {
+    T n = norm();
     if (n > 0) {
         x /= n;
         y /= n;
@@ -66,23 +81,30 @@ void Vector3f::normalize() {
 }
 
 
-Vector3f Vector3f::normalized() const {
-    Vector3f v(*this);
+template <typename T>
+Vector3<T> Vector3<T>::normalized() const {
+    Vector3<T> v(*this);
     v.normalize();
     return v;
 }
 
 // Calcul du rayon réfléchi
-Vector3f Vector3f::reflect(const Vector3f& n) const {
-    Vector3f vNorm = this->normalized();
-    Vector3f nNorm = n.normalized();
+template <typename T>
+Vector3<T> Vector3<T>::reflect(const Vector3<T>& n) const {
+    Vector3<T> vNorm = this->normalized();
+    Vector3<T> nNorm = n.normalized();
     return vNorm - nNorm*2*vNorm.dot(nNorm);
 } 
 
 // Produit vectoriel
-Vector3f Vector3f::cross(const Vector3f& other) const {
-    float cX = y * other.z - z * other.y;
-    float cY = z * other.x - x * other.z;
-    float cZ = x * other.y - y * other.x;
-    return Vector3f(cX, cY, cZ);
+template <typename T>
+Vector3<T> Vector3<T>::cross(const Vector3<T>& other) const {
+    T cX = y * other.z - z * other.y;
+    T cY = z * other.x - x * other.z;
+    T cZ = x * other.y - y * other.x;
+    return Vector3<T>(cX, cY, cZ);
 }
+
+// Instanciations explicites pour les deux précisions
+template class Vector3<float>;
+template class Vector3<double>;
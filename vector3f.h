@@ -1,134 +1,146 @@
 /**
  * @file vector3f.h
  * @author Arthur BABIN
- * @brief Création de la classe Vector3f (vecteur 3D de float)
+ * @brief Création de la classe Vector3 (vecteur 3D de scalaires T) et de Vector3 (scalaires Real)
  * @date Décembre 2022
  */
 #ifndef VECTOR3F_H
 #define VECTOR3F_H
 
 #include <cmath> // Pour utiliser sqrt()
-#include <array> // Pour la base de Vector3f
+#include <array> // Pour la base de Vector3
+#include <cstddef>
+#include "precision.h" // Pour le type Real
 
 /**
- * @brief Classe pour représenter un vecteur de flottants dans l'espace
+ * @brief Classe pour représenter un vecteur de flottants dans l'espace, de précision T
+ * (instanciée pour float et double)
  * 
  */
-class Vector3f {
+template <typename T>
+class Vector3 {
 
     private:
         /**
          * @brief Composantes x,y,z du vecteur
          * 
          */
-        float x, y, z;
+        T x, y, z;
 
     public:
         /**
-         * @brief Construit un Vector3f
+         * @brief Construit un Vector3
          * 
          */
-        Vector3f() : x(0), y(0), z(0) {}
+        Vector3() : x(0), y(0), z(0) {}
 
         /**
-         * @brief Construit un Vector3f à coordonnées égales
+         * @brief Construit un Vector3 à coordonnées égales
          * 
          * @param s
          */
-        Vector3f(float s) : x(s), y(s), z(s) {}
+        Vector3(T s) : x(s), y(s), z(s) {}
 
         /**
-         * @brief Construit un Vector3f
+         * @brief Construit un Vector3
          * 
          * @param x 
          * @param y 
          * @param z 
          */
-        Vector3f(float x, float y, float z) : x(x), y(y), z(z) {}
+        Vector3(T x, T y, T z) : x(x), y(y), z(z) {}
 
         /**
          * @brief Retourne la coordonnée x
          * 
-         * @return float 
+         * @return T 
          */
-        inline float getX() const { return x; }
+        inline T getX() const { return x; }
 
         /**
          * @brief Retourne la coordonnée y
          * 
-         * @return float 
+         * @return T 
          */
-        inline float getY() const { return y; }
+        inline T getY() const { return y; }
 
         /**
          * @brief Retourne la coordonnée z
          * 
-         * @return float 
+         * @return T 
          */
-        inline float getZ() const { return z; }
+        inline T getZ() const { return z; }
 
 
         /**
          * @brief Opérateur d'addition de vecteurs
          * 
          * @param other le vecteur à additionner
-         * @return Vector3f 
+         * @return Vector3 
          */
-        Vector3f operator+(const Vector3f &other) const;
+        Vector3 operator+(const Vector3 &other) const;
 
         /**
          * @brief Opérateur de soustraction de vecteurs
          * 
          * @param other le vecteur à soustraire
-         * @return Vector3f 
+         * @return Vector3 
          */
-        Vector3f operator-(const Vector3f &other) const;
+        Vector3 operator-(const Vector3 &other) const;
 
         /**
          * @brief Opérateur de multiplication d'un vecteur par un scalaire
          * 
          * @param scalar 
-         * @return Vector3f 
+         * @return Vector3 
          */
-        Vector3f operator*(float scalar) const;
+        Vector3 operator*(T scalar) const;
+
+        /**
+         * @brief Opérateur de multiplication terme à terme de deux vecteurs
+         * 
+         * @param other 
+         * @return Vector3 
+         */
+        Vector3 operator*(const Vector3 &other) const;
 
         /**
          * @brief Opérateur de division d'un vecteur par un scalaire
          * 
          * @param scalar 
-         * @return Vector3f 
+         * @return Vector3 
          */
-        Vector3f operator/(float scalar) const;
+        Vector3 operator/(T scalar) const;
 
         /**
          * @brief Accède à une coordonnée 
          * 
          * @param index 
-         * @return float 
+         * @return T 
          */
-        float operator[](std::size_t index) const;
+        T operator[](std::size_t index) const;
 
         /**
          * @brief Calcule le produit scalaire avec un vecteur
          * 
          * @param v 
-         * @return float 
+         * @return T 
          */
-        float dot(Vector3f v) const;
+        T dot(const Vector3& v) const;
 
         /**
          * @brief Calcule la norme du vecteur
          * 
-         * @return float 
+         * @return T 
          */
-        float norm() const;
+        T norm() const;
 
         /**
          * @brief Calcule la norme du vecteur au carré
          * 
-         * @return float 
+         * @return T 
          */
-        float squaredNorm() const;
+        T squaredNorm() const;
 
         /**
          * @brief Normalise le vecteur
@@ -139,35 +151,41 @@ class Vector3f {
         /**
          * @brief Renvoie le vecteur normalisé
          * 
-         * @return Vector3f 
+         * @return Vector3 
          */
-        Vector3f normalized() const;
+        Vector3 normalized() const;
 
         /**
-         * @brief Renvoie le produit vectoriel avec un autre Vector3f 
+         * @brief Renvoie le produit vectoriel avec un autre Vector3 
          * 
-         * @return Vector3f 
+         * @return Vector3 
          */
-        Vector3f cross(const Vector3f& other) const;
+        Vector3 cross(const Vector3& other) const;
 
         /**
          * @brief Calcule la direction réfléchie à partir de sa 
          * de la normale au point d'intersection 
          * 
          * @param n direction de la normale au point d'intersection
-         * @return Vector3f 
+         * @return Vector3 
          */
-        Vector3f reflect(const Vector3f& n) const;
+        Vector3 reflect(const Vector3& n) const;
 
         /**
-         * @brief Retourne la base canonique de Vector3f
+         * @brief Retourne la base canonique de Vector3
          * 
-         * @return std::array<Vector3f, 3> 
+         * @return std::array<Vector3, 3> 
          */
-        static std::array<Vector3f, 3> basis() {
-            std::array<Vector3f, 3> bas = {Vector3f(1,0,0),Vector3f(0,1,0),Vector3f(0,0,1)};
+        static std::array<Vector3, 3> basis() {
+            std::array<Vector3, 3> bas = {Vector3(1,0,0),Vector3(0,1,0),Vector3(0,0,1)};
             return bas;
         } 
 };
 
+/**
+ * @brief Vecteur de la précision choisie à la compilation (le nom est historique :
+ * les composantes sont des double avec -DRAYTRACER_DOUBLE)
+ */
+typedef Vector3<Real> Vector3f;
+
 #endif
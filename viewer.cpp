@@ -0,0 +1,325 @@
+/**
+ * @file viewer.cpp
+ * @brief Implémentation de la classe Viewer
+ */
+
+#include "viewer.h"
+#include "parallel.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+const float PAS_DEPLACEMENT = 20;     // Déplacement par appui de touche
+const float PAS_ROTATION = 0.005;     // Rotation (radians) par pixel de souris
+const float PAS_SHININESS = 0.1;      // Variation de shininess par appui de touche
+const int TAILLE_BLOC_MAX = 8;        // Taille des blocs de la première passe
+const int ECHELLE_TEXTE = 3;          // Agrandissement de la police des statistiques
+
+/**
+ * @brief Police 3x5 pour les statistiques : chaque caractère est décrit par 5 lignes de 3 bits
+ */
+static const unsigned char *glyphe(char c) {
+    static const unsigned char chiffres[10][5] = {
+        {7,5,5,5,7}, {2,6,2,2,7}, {7,1,7,4,7}, {7,1,7,1,7}, {5,5,7,1,1},
+        {7,4,7,1,7}, {7,4,7,5,7}, {7,1,1,1,1}, {7,5,7,5,7}, {7,5,7,1,7}
+    };
+    static const unsigned char point[5] = {0,0,0,0,2};
+    static const unsigned char m[5] = {0,0,7,7,5};
+    static const unsigned char s[5] = {0,3,4,1,6};
+    static const unsigned char M[5] = {5,7,7,5,5};
+    static const unsigned char r[5] = {0,5,6,4,4};
+    static const unsigned char a[5] = {0,6,3,5,7};
+    static const unsigned char y[5] = {0,5,7,1,6};
+    static const unsigned char slash[5] = {1,1,2,4,4};
+    static const unsigned char espace[5] = {0,0,0,0,0};
+    if (c >= '0' && c <= '9') return chiffres[c - '0'];
+    switch (c) {
+        case '.': return point;
+        case 'm': return m;
+        case 's': return s;
+        case 'M': return M;
+        case 'r': return r;
+        case 'a': return a;
+        case 'y': return y;
+        case '/': return slash;
+        default: return espace;
+    }
+}
+
+/**
+ * @brief Dessine le texte en blanc sur fond noir dans les pixels (x,y : coin haut gauche)
+ */
+static void dessineTexte(uint32_t* pixels, int pitch, int width, int height, int x, int y, const char* texte) {
+    int n = std::strlen(texte);
+    int w = (4*n + 1) * ECHELLE_TEXTE, h = 7 * ECHELLE_TEXTE;
+    for (int j = y; j < y + h && j < height; j++)
+        for (int i = x; i < x + w && i < width; i++)
+            pixels[j*pitch + i] = 0xFF000000;
+    for (int k = 0; k < n; k++) {
+        const unsigned char* g = glyphe(texte[k]);
+        for (int row = 0; row < 5; row++)
+            for (int col = 0; col < 3; col++) {
+                if (!(g[row] & (4 >> col)))
+                    continue;
+                for (int dj = 0; dj < ECHELLE_TEXTE; dj++)
+                    for (int di = 0; di < ECHELLE_TEXTE; di++) {
+                        int i = x + ((4*k + 1 + col) * ECHELLE_TEXTE) + di;
+                        int j = y + ((1 + row) * ECHELLE_TEXTE) + dj;
+                        if (i < width && j < height)
+                            pixels[j*pitch + i] = 0xFFFFFFFF;
+                    }
+            }
+    }
+}
+
+/**
+ * @brief Convertit une couleur en pixel ARGB8888
+ */
+static inline uint32_t versPixel(const Material& c) {
+    return 0xFF000000u | (uint32_t(c.getR()) << 16) | (uint32_t(c.getG()) << 8) | uint32_t(c.getB());
+}
+
+Viewer::Viewer(Scene& scene, int width, int height, int nbThreads)
+    : _scene(scene), _width(width), _height(height), _nbThreads(nbThreads),
+      _camera(scene.getCamera()), _generation(0), _cameraGeneration(0), _quit(false),
+      _lightMove(0), _selected(0), _gbuffer(width, height, scene.getNbGBufferLayers()), _fb(width, height),
+      _work(width*height, 0xFF000000), _back(width*height, 0xFF000000), _front(width*height, 0xFF000000),
+      _frameReady(false), _passTime(0), _passRays(0) {
+    for (int h = 0; h < scene.getNbMaterials(); h++)
+        _palette.push_back(scene.getMaterial(h));
+}
+
+bool Viewer::renderPass(const Camera& camera, int blockSize, int generation) {
+    std::atomic<bool> aborted(false);
+    TileCulling culling(camera, _scene.getShapes(), _scene.getBvh(), _width, _height, _nbThreads);
+    int nbRows = (_height + blockSize - 1) / blockSize;
+    parallelFor(nbRows, _nbThreads, [&](int row) {
+        if (aborted || _generation != generation || _quit) {
+            aborted = true;
+            return;
+        }
+        int j = row * blockSize;
+        for (int i = 0; i < _width; i += blockSize) {
+            // Les pixels déjà calculés à la passe précédente sont conservés
+            if (blockSize < TAILLE_BLOC_MAX && i % (2*blockSize) == 0 && j % (2*blockSize) == 0)
+                continue;
+            PixelAov aov;
+            uint32_t p = versPixel(_scene.tracePixel(camera, i, j, _width, _height, aov, &culling));
+            for (int dj = j; dj < std::min(j + blockSize, _height); dj++)
+                for (int di = i; di < std::min(i + blockSize, _width); di++)
+                    _work[dj*_width + di] = p;
+        }
+    });
+    return !aborted;
+}
+
+void Viewer::publish(double passTime, long passRays) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _back = _work;
+    _frameReady = true;
+    _passTime = passTime;
+    _passRays = passRays;
+}
+
+void Viewer::deferredPass(bool rebuild, const Camera& camera, bool shadows) {
+    auto t0 = std::chrono::steady_clock::now();
+    if (rebuild)
+        _scene.buildGBuffer(_gbuffer, camera, _nbThreads);
+    else if (shadows)
+        _scene.updateShadows(_gbuffer, _nbThreads);
+    _scene.shadeGBuffer(_gbuffer, _fb, _nbThreads);
+    for (std::size_t k = 0; k < _fb.getSize(); k++)
+        _work[k] = versPixel(Material(_fb.r[k], _fb.g[k], _fb.b[k], 0));
+    double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    publish(dt, rebuild ? long(_width) * _height : 0);
+}
+
+void Viewer::renderLoop() {
+    int done = -1;
+    int gbufferCamera = -1;   // Génération de la caméra du G-buffer (-1 : aucun)
+    while (!_quit) {
+        Camera camera = _scene.getCamera();
+        int generation, cameraGeneration;
+        std::vector<std::pair<MaterialHandle, Material>> edits;
+        Vector3f lightMove(0);
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait(lock, [&] { return _quit || _generation != done; });
+            if (_quit)
+                break;
+            camera = _camera;
+            generation = _generation;
+            cameraGeneration = _cameraGeneration;
+            std::swap(edits, _materialEdits);
+            std::swap(lightMove, _lightMove);
+        }
+
+        // Application des modifications en attente (seul ce thread lit la scène). Le
+        // G-buffer ne suit pas les réflexions des matériaux mats : un matériau qui devient
+        // réfléchissant le fait reconstruire
+        bool reflets = false;
+        for (const auto& edit : edits) {
+            reflets = reflets || (!(_scene.getMaterial(edit.first).getShininess() > 0) && edit.second.getShininess() > 0);
+            _scene.setMaterial(edit.first, edit.second);
+        }
+        bool lightMoved = lightMove.squaredNorm() > 0;
+        if (lightMoved) {
+            const Ray3f& source = _scene.getSource();
+            _scene.setSource(Ray3f(source.getOrigin() + lightMove, source.getDirection()));
+        }
+
+        // Seul l'éclairage a changé : ombrage différé depuis le G-buffer de la caméra.
+        // L'éclairage différé ignore les milieux : avec du brouillard, toutes les passes
+        // sont des rendus directs
+        bool deferred = _scene.getSettings().integrator == RenderSettings::WHITTED && _scene.getMedia().empty();
+        if (deferred && gbufferCamera == cameraGeneration) {
+            deferredPass(reflets, camera, lightMoved);
+            done = generation;
+            continue;
+        }
+
+        bool complete = true;
+        for (int blockSize = TAILLE_BLOC_MAX; blockSize >= 1; blockSize /= 2) {
+            // La dernière passe construit le G-buffer, réutilisé tant que la caméra ne bouge pas
+            if (deferred && blockSize == 1) {
+                deferredPass(true, camera, false);
+                gbufferCamera = cameraGeneration;
+                break;
+            }
+            auto t0 = std::chrono::steady_clock::now();
+            if (!renderPass(camera, blockSize, generation)) {
+                complete = false;
+                break;
+            }
+            double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            // Nombre de pixels calculés pendant la passe (un rayon primaire chacun)
+            long passRays = long((_width + blockSize - 1) / blockSize) * ((_height + blockSize - 1) / blockSize);
+            if (blockSize < TAILLE_BLOC_MAX)
+                passRays -= long((_width + 2*blockSize - 1) / (2*blockSize)) * ((_height + 2*blockSize - 1) / (2*blockSize));
+
+            // Publication de la passe dans le tampon arrière
+            publish(dt, passRays);
+        }
+        if (complete)
+            done = generation;
+    }
+}
+
+void Viewer::display(Sdl& sdl) {
+    double passTime;
+    long passRays;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_frameReady)
+            return;
+        std::swap(_front, _back);
+        _frameReady = false;
+        passTime = _passTime;
+        passRays = _passRays;
+    }
+
+    int pitch;
+    Uint32* pixels = sdl.lockTexture(pitch);
+    pitch /= sizeof(Uint32);
+    for (int j = 0; j < _height; j++)
+        std::memcpy(pixels + j*pitch, _front.data() + j*_width, _width * sizeof(uint32_t));
+
+    char texte[64];
+    std::snprintf(texte, sizeof(texte), "%.1f ms %.2f Mray/s", passTime*1000, passTime > 0 ? passRays/passTime/1e6 : 0.);
+    dessineTexte(pixels, pitch, _width, _height, 0, 0, texte);
+    sdl.unlockTexture();
+}
+
+void Viewer::run() {
+    Sdl sdl = Sdl();
+    sdl.init(_width, _height, "raytracing");
+    sdl.createTexture(_width, _height);
+
+    std::thread renderer(&Viewer::renderLoop, this);
+    bool dragging = false;
+    while (!_quit) {
+        SDL_Event e;
+        float forward = 0, right = 0, up = 0, yaw = 0, pitch = 0;
+        Vector3f lightMove(0);
+        std::vector<std::pair<MaterialHandle, Material>> edits;
+        while (SDL_PollEvent(&e)) {
+            switch (e.type) {
+                case SDL_QUIT:
+                    _quit = true;
+                    break;
+                case SDL_KEYDOWN:
+                    switch (e.key.keysym.sym) {
+                        case SDLK_ESCAPE: _quit = true; break;
+                        case SDLK_w: case SDLK_UP: forward += PAS_DEPLACEMENT; break;
+                        case SDLK_s: case SDLK_DOWN: forward -= PAS_DEPLACEMENT; break;
+                        case SDLK_a: case SDLK_LEFT: right -= PAS_DEPLACEMENT; break;
+                        case SDLK_d: case SDLK_RIGHT: right += PAS_DEPLACEMENT; break;
+                        case SDLK_q: up -= PAS_DEPLACEMENT; break;
+                        case SDLK_e: up += PAS_DEPLACEMENT; break;
+                        case SDLK_i: lightMove = lightMove + Vector3f(0,0,PAS_DEPLACEMENT); break;
+                        case SDLK_k: lightMove = lightMove - Vector3f(0,0,PAS_DEPLACEMENT); break;
+                        case SDLK_j: lightMove = lightMove - Vector3f(PAS_DEPLACEMENT,0,0); break;
+                        case SDLK_l: lightMove = lightMove + Vector3f(PAS_DEPLACEMENT,0,0); break;
+                        case SDLK_u: lightMove = lightMove - Vector3f(0,PAS_DEPLACEMENT,0); break;
+                        case SDLK_o: lightMove = lightMove + Vector3f(0,PAS_DEPLACEMENT,0); break;
+                    }
+                    // Modification du matériau choisi
+                    if (!_palette.empty()) {
+                        Material& mat = _palette[_selected];
+                        bool modifie = true;
+                        switch (e.key.keysym.sym) {
+                            case SDLK_c: mat = Material(mat.getG(), mat.getB(), mat.getR(), mat.getShininess()); break;
+                            case SDLK_n: mat = Material(mat.getR(), mat.getG(), mat.getB(), mat.getShininess() - PAS_SHININESS); break;
+                            case SDLK_m: mat = Material(mat.getR(), mat.getG(), mat.getB(), mat.getShininess() + PAS_SHININESS); break;
+                            case SDLK_TAB: _selected = (_selected + 1) % _palette.size(); modifie = false; break;
+                            default: modifie = false;
+                        }
+                        if (modifie)
+                            edits.push_back({_selected, mat});
+                    }
+                    break;
+                case SDL_MOUSEBUTTONDOWN:
+                    if (e.button.button == SDL_BUTTON_LEFT) dragging = true;
+                    break;
+                case SDL_MOUSEBUTTONUP:
+                    if (e.button.button == SDL_BUTTON_LEFT) dragging = false;
+                    break;
+                case SDL_MOUSEMOTION:
+                    if (dragging) {
+                        yaw += e.motion.xrel * PAS_ROTATION;
+                        pitch += e.motion.yrel * PAS_ROTATION;
+                    }
+                    break;
+            }
+        }
+
+        // Un mouvement de caméra relance le rendu progressif
+        if (forward != 0 || right != 0 || up != 0 || yaw != 0 || pitch != 0) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _camera.translate(forward, right, up);
+            _camera.rotate(yaw, pitch);
+            _cameraGeneration++;
+            _generation++;
+        }
+        // Une modification de l'éclairage seul est ré-éclairée depuis le G-buffer
+        if (lightMove.squaredNorm() > 0 || !edits.empty()) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _lightMove = _lightMove + lightMove;
+            _materialEdits.insert(_materialEdits.end(), edits.begin(), edits.end());
+            _generation++;
+        }
+        _cond.notify_all();
+
+        display(sdl);
+        sdl.present();
+        SDL_Delay(16);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit = true;
+    }
+    _cond.notify_all();
+    renderer.join();
+}
@@ -0,0 +1,140 @@
+/**
+ * @file viewer.h
+ * @brief Création de la classe Viewer (prévisualisation interactive)
+ */
+
+#ifndef VIEWER_H
+#define VIEWER_H
+
+#include "scene.h"
+#include "camera.h"
+#include "sdl.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Visualiseur interactif : un thread de rendu calcule l'image de façon progressive
+ * (blocs de 8x8, puis 4x4, 2x2 et enfin pixel par pixel) dans un tampon arrière, le thread
+ * principal affiche le dernier tampon terminé via une texture de diffusion et gère le
+ * clavier et la souris. Tout mouvement de la caméra relance le rendu progressif. Avec le
+ * tracé de Whitted, la dernière passe passe par un G-buffer : les modifications de
+ * matériaux et les déplacements de la source sont ensuite ré-éclairés sans relancer les
+ * rayons primaires
+ *
+ * Commandes : WASD ou flèches pour se déplacer, Q/E pour descendre/monter,
+ * clic gauche glissé pour tourner, Echap pour quitter. IJKL et U/O déplacent la source,
+ * Tab choisit un matériau, C permute ses couleurs et N/M diminuent/augmentent sa shininess
+ */
+class Viewer {
+
+    public:
+        /**
+         * @brief Construit le visualiseur de la scène
+         *
+         * @param scene la scène à afficher
+         * @param width largeur de la fenêtre
+         * @param height hauteur de la fenêtre
+         * @param nbThreads nombre de threads de rendu (<= 0 : tous les coeurs)
+         */
+        Viewer(Scene& scene, int width, int height, int nbThreads = 0);
+
+        /**
+         * @brief Ouvre la fenêtre et boucle jusqu'à sa fermeture
+         */
+        void run();
+
+    private:
+        /**
+         * @brief Boucle du thread de rendu
+         */
+        void renderLoop();
+
+        /**
+         * @brief Calcule une passe progressive de taille de bloc blockSize
+         *
+         * @param camera
+         * @param blockSize
+         * @param generation génération de la caméra (la passe est abandonnée si elle change)
+         * @return bool vrai si la passe est allée au bout
+         */
+        bool renderPass(const Camera& camera, int blockSize, int generation);
+
+        /**
+         * @brief Ombrage différé de l'image complète depuis le G-buffer, publié dans le
+         * tampon arrière
+         *
+         * @param rebuild vrai pour reconstruire le G-buffer (la caméra a changé, ou un
+         * matériau est devenu réfléchissant)
+         * @param camera
+         * @param shadows vrai pour relancer les rayons d'ombre (la source a bougé)
+         */
+        void deferredPass(bool rebuild, const Camera& camera, bool shadows);
+
+        /**
+         * @brief Publie le tampon de travail dans le tampon arrière
+         */
+        void publish(double passTime, long passRays);
+
+        /**
+         * @brief Recopie le tampon affiché dans la texture et y dessine les statistiques
+         *
+         * @param sdl
+         */
+        void display(Sdl& sdl);
+
+        /**
+         * @brief La scène n'est lue et modifiée que par le thread de rendu
+         */
+        Scene& _scene;
+        int _width, _height, _nbThreads;
+
+        /**
+         * @brief Caméra courante (modifiée par le thread principal), protégée par _mutex.
+         * _generation change à chaque modification (caméra, source ou matériaux),
+         * _cameraGeneration seulement quand la caméra bouge
+         */
+        Camera _camera;
+        std::atomic<int> _generation;
+        int _cameraGeneration;
+        std::atomic<bool> _quit;
+
+        /**
+         * @brief Modifications en attente, appliquées à la scène par le thread de rendu
+         * (protégées par _mutex)
+         */
+        std::vector<std::pair<MaterialHandle, Material>> _materialEdits;
+        Vector3f _lightMove;
+
+        /**
+         * @brief Copie des matériaux modifiée par le thread principal, et matériau choisi
+         */
+        std::vector<Material> _palette;
+        int _selected;
+
+        /**
+         * @brief G-buffer et image de l'ombrage différé (thread de rendu)
+         */
+        GBuffer _gbuffer;
+        Framebuffer _fb;
+
+        /**
+         * @brief Tampon de travail du thread de rendu, puis double tampon (arrière/affiché)
+         */
+        std::vector<uint32_t> _work, _back, _front;
+        bool _frameReady;
+
+        /**
+         * @brief Statistiques de la dernière passe : durée et nombre de rayons primaires
+         */
+        double _passTime;
+        long _passRays;
+
+        std::mutex _mutex;
+        std::condition_variable _cond;
+};
+
+#endif